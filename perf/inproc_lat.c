@@ -60,6 +60,11 @@ void worker (NN_UNUSED void *arg)
         assert (rc == (int)message_size);
     }
 
+    /*  Closing the socket drops the messages the peer haven't received
+        yet. Wait till the peer confirms it has got all of them. */
+    rc = nn_recv (s, buf, message_size, 0);
+    assert (rc == 0);
+
     free (buf);
     rc = nn_close (s);
     assert (rc == 0);
@@ -108,6 +113,9 @@ int main (int argc, char *argv [])
 
     elapsed = nn_stopwatch_term (&stopwatch);
 
+    rc = nn_send (s, NULL, 0, 0);
+    assert (rc == 0);
+
     latency = (double) elapsed / (roundtrip_count * 2);
     printf ("message size: %d [B]\n", (int) message_size);
     printf ("roundtrip count: %d\n", (int) roundtrip_count);
@@ -0,0 +1,195 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/utils/cont.h"
+#include "../src/utils/attr.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/mutex.c"
+#include "../src/utils/atomic.c"
+#include "../src/utils/queue.c"
+#include "../src/utils/mpscq.c"
+#include "../src/utils/efd.c"
+#include "../src/utils/closefd.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*  Measures how fast tasks can be posted to a worker thread by many
+    threads at once. The lock-free queue with suppressed signaling used by
+    nn_worker_execute is compared with the mutex-protected queue and an
+    eventfd signal per task it replaced. */
+
+struct task {
+    struct nn_queue_item qitem;
+    struct nn_mpscq_item mitem;
+};
+
+static int producer_count;
+static int task_count;
+static struct task *tasks;
+
+static struct nn_efd efd;
+static struct nn_atomic signals;
+
+static struct nn_mutex lock;
+static struct nn_queue queue;
+static struct nn_mpscq mpscq;
+
+static void mutex_producer (void *arg)
+{
+    int i;
+    struct task *t;
+
+    t = (struct task*) arg;
+    for (i = 0; i != task_count; ++i) {
+        nn_mutex_lock (&lock);
+        nn_queue_push (&queue, &t [i].qitem);
+        nn_efd_signal (&efd);
+        nn_atomic_inc (&signals, 1);
+        nn_mutex_unlock (&lock);
+    }
+}
+
+static void mpscq_producer (void *arg)
+{
+    int i;
+    struct task *t;
+
+    t = (struct task*) arg;
+    for (i = 0; i != task_count; ++i) {
+        if (nn_mpscq_push (&mpscq, &t [i].mitem)) {
+            nn_efd_signal (&efd);
+            nn_atomic_inc (&signals, 1);
+        }
+    }
+}
+
+static void mutex_consumer (void)
+{
+    int rc;
+    int received;
+    struct nn_queue tmp;
+
+    received = 0;
+    while (received != producer_count * task_count) {
+        rc = nn_efd_wait (&efd, -1);
+        errnum_assert (rc == 0, -rc);
+        nn_mutex_lock (&lock);
+        nn_efd_unsignal (&efd);
+        memcpy (&tmp, &queue, sizeof (tmp));
+        nn_queue_init (&queue);
+        nn_mutex_unlock (&lock);
+        while (nn_queue_pop (&tmp))
+            ++received;
+        nn_queue_term (&tmp);
+    }
+}
+
+static void mpscq_consumer (void)
+{
+    int rc;
+    int received;
+    struct nn_mpscq_item *item;
+
+    received = 0;
+    while (received != producer_count * task_count) {
+        if (nn_mpscq_sleep (&mpscq)) {
+            rc = nn_efd_wait (&efd, -1);
+            errnum_assert (rc == 0, -rc);
+            nn_efd_unsignal (&efd);
+        }
+        for (item = nn_mpscq_pop_all (&mpscq); item;
+              item = nn_mpscq_next (item))
+            ++received;
+    }
+}
+
+static void run (const char *name, nn_thread_routine *producer,
+    void (*consumer) (void))
+{
+    int i;
+    uint64_t elapsed;
+    struct nn_thread *threads;
+    struct nn_stopwatch stopwatch;
+
+    threads = malloc (sizeof (struct nn_thread) * producer_count);
+    nn_assert (threads);
+    nn_atomic_init (&signals, 0);
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != producer_count; ++i)
+        nn_thread_init (&threads [i], producer,
+            tasks + (size_t) i * task_count);
+    consumer ();
+    elapsed = nn_stopwatch_term (&stopwatch);
+    for (i = 0; i != producer_count; ++i)
+        nn_thread_term (&threads [i]);
+
+    printf ("%-6s %10.0f [tasks/s] %8.3f [signals/task]\n", name,
+        (double) producer_count * task_count * 1000000 / elapsed,
+        (double) signals.n / ((double) producer_count * task_count));
+
+    nn_atomic_term (&signals);
+    free (threads);
+}
+
+int main (int argc, char *argv [])
+{
+    int rc;
+    size_t i;
+
+    if (argc != 3) {
+        printf ("usage: mpscq <producer-count> <tasks-per-producer>\n");
+        return 1;
+    }
+
+    producer_count = atoi (argv [1]);
+    task_count = atoi (argv [2]);
+    nn_assert (producer_count > 0 && task_count > 0);
+
+    tasks = malloc (sizeof (struct task) * producer_count * task_count);
+    nn_assert (tasks);
+    for (i = 0; i != (size_t) producer_count * task_count; ++i) {
+        nn_queue_item_init (&tasks [i].qitem);
+        nn_mpscq_item_init (&tasks [i].mitem);
+    }
+    rc = nn_efd_init (&efd);
+    errnum_assert (rc == 0, -rc);
+    nn_mutex_init (&lock);
+    nn_queue_init (&queue);
+    nn_mpscq_init (&mpscq);
+
+    printf ("producer count: %d\n", producer_count);
+    printf ("tasks per producer: %d\n", task_count);
+    run ("mutex", mutex_producer, mutex_consumer);
+    run ("mpscq", mpscq_producer, mpscq_consumer);
+
+    nn_mpscq_term (&mpscq);
+    nn_queue_term (&queue);
+    nn_mutex_term (&lock);
+    nn_efd_term (&efd);
+    free (tasks);
+    return 0;
+}
@@ -0,0 +1,311 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#if defined NN_USE_EPOLL
+
+#include <sys/epoll.h>
+
+/*  Count the calls to the pollset made by the poller. */
+static int ctl_calls;
+static int wait_calls;
+
+static int counted_epoll_ctl (int epfd, int op, int fd,
+    struct epoll_event *event)
+{
+    ++ctl_calls;
+    return epoll_ctl (epfd, op, fd, event);
+}
+
+static int counted_epoll_wait (int epfd, struct epoll_event *events,
+    int maxevents, int timeout)
+{
+    ++wait_calls;
+    return epoll_wait (epfd, events, maxevents, timeout);
+}
+
+#define epoll_ctl counted_epoll_ctl
+#define epoll_wait counted_epoll_wait
+
+#include "../src/aio/poller.c"
+#include "../src/utils/list.c"
+#include "../src/utils/closefd.c"
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+
+#include <sys/socket.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*  Compares the edge-triggered poller with the level-triggered one it
+    replaced, which modified the pollset each time the interest in IN or OUT
+    changed. The old implementation is reproduced below. The traffic mimics
+    nn_usock receiving a message that is not available yet: recv fails with
+    EAGAIN, interest in IN is set, the data arrive, the IN event is processed
+    and the interest is reset again. */
+
+struct lt_poller_hndl {
+    int fd;
+    uint32_t events;
+};
+
+struct lt_poller {
+    int ep;
+    int nevents;
+    int index;
+    struct epoll_event events [NN_POLLER_MAX_EVENTS];
+};
+
+static void lt_poller_init (struct lt_poller *self)
+{
+    self->ep = epoll_create (1);
+    errno_assert (self->ep != -1);
+    self->nevents = 0;
+    self->index = 0;
+}
+
+static void lt_poller_term (struct lt_poller *self)
+{
+    nn_closefd (self->ep);
+}
+
+static void lt_poller_add (struct lt_poller *self, int fd,
+    struct lt_poller_hndl *hndl)
+{
+    int rc;
+    struct epoll_event ev;
+
+    hndl->fd = fd;
+    hndl->events = 0;
+    memset (&ev, 0, sizeof (ev));
+    ev.data.ptr = (void*) hndl;
+    rc = epoll_ctl (self->ep, EPOLL_CTL_ADD, fd, &ev);
+    errno_assert (rc == 0);
+}
+
+static void lt_poller_set_events (struct lt_poller *self,
+    struct lt_poller_hndl *hndl, uint32_t events)
+{
+    int rc;
+    int i;
+    struct epoll_event ev;
+
+    if (hndl->events == events)
+        return;
+    hndl->events = events;
+    memset (&ev, 0, sizeof (ev));
+    ev.events = events;
+    ev.data.ptr = (void*) hndl;
+    rc = epoll_ctl (self->ep, EPOLL_CTL_MOD, hndl->fd, &ev);
+    errno_assert (rc == 0);
+    for (i = self->index; i != self->nevents; ++i)
+        if (self->events [i].data.ptr == hndl)
+            self->events [i].events &= events;
+}
+
+static void lt_poller_wait (struct lt_poller *self, int timeout)
+{
+    self->index = 0;
+    self->nevents = epoll_wait (self->ep, self->events,
+        NN_POLLER_MAX_EVENTS, timeout);
+    errno_assert (self->nevents != -1);
+}
+
+static int lt_poller_event (struct lt_poller *self, int *event,
+    struct lt_poller_hndl **hndl)
+{
+    while (self->index < self->nevents) {
+        if (self->events [self->index].events != 0)
+            break;
+        ++self->index;
+    }
+    if (self->index >= self->nevents)
+        return -EAGAIN;
+    *hndl = (struct lt_poller_hndl*) self->events [self->index].data.ptr;
+    if (self->events [self->index].events & EPOLLIN) {
+        *event = NN_POLLER_IN;
+        self->events [self->index].events &= ~EPOLLIN;
+        return 0;
+    }
+    if (self->events [self->index].events & EPOLLOUT) {
+        *event = NN_POLLER_OUT;
+        self->events [self->index].events &= ~EPOLLOUT;
+        return 0;
+    }
+    *event = NN_POLLER_ERR;
+    ++self->index;
+    return 0;
+}
+
+static int message_size;
+static int message_count;
+static int io_calls;
+static char *buf;
+
+/*  Sends a message to the peer. */
+static void send_msg (int s)
+{
+    ssize_t nbytes;
+
+    ++io_calls;
+    nbytes = send (s, buf, message_size, 0);
+    errno_assert (nbytes == message_size);
+}
+
+/*  Receives as much as is available. Returns 0 if there was nothing. */
+static int recv_msg (int s)
+{
+    ssize_t nbytes;
+
+    ++io_calls;
+    nbytes = recv (s, buf, message_size, 0);
+    if (nbytes < 0) {
+        errno_assert (errno == EAGAIN || errno == EWOULDBLOCK);
+        return 0;
+    }
+    nn_assert (nbytes == message_size);
+    return 1;
+}
+
+static void report (const char *name, uint64_t elapsed)
+{
+    printf ("%-6s %8.2f [syscalls/msg] %8.2f [epoll_ctl/msg] "
+        "%10.1f [ns/msg]\n", name,
+        (double) (io_calls + ctl_calls + wait_calls) / message_count,
+        (double) ctl_calls / message_count,
+        (double) elapsed * 1000 / message_count);
+}
+
+static void bench_et (int s [2])
+{
+    int i;
+    int rc;
+    int event;
+    struct nn_poller poller;
+    struct nn_poller_hndl hndl;
+    struct nn_poller_hndl *phndl;
+    struct nn_stopwatch stopwatch;
+
+    rc = nn_poller_init (&poller);
+    errnum_assert (rc == 0, -rc);
+    nn_poller_add (&poller, s [1], &hndl);
+
+    io_calls = ctl_calls = wait_calls = 0;
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != message_count; ++i) {
+        nn_assert (!recv_msg (s [1]));
+        nn_poller_set_in (&poller, &hndl);
+        send_msg (s [0]);
+        while (1) {
+            rc = nn_poller_event (&poller, &event, &phndl);
+            if (rc == 0)
+                break;
+            nn_poller_wait (&poller, -1);
+        }
+        nn_assert (phndl == &hndl && event == NN_POLLER_IN);
+        nn_assert (recv_msg (s [1]));
+        nn_poller_reset_in (&poller, &hndl);
+    }
+    report ("edge", nn_stopwatch_term (&stopwatch));
+
+    nn_poller_rm (&poller, &hndl);
+    nn_poller_term (&poller);
+}
+
+static void bench_lt (int s [2])
+{
+    int i;
+    int rc;
+    int event;
+    struct lt_poller poller;
+    struct lt_poller_hndl hndl;
+    struct lt_poller_hndl *phndl;
+    struct nn_stopwatch stopwatch;
+
+    lt_poller_init (&poller);
+    lt_poller_add (&poller, s [1], &hndl);
+
+    io_calls = ctl_calls = wait_calls = 0;
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != message_count; ++i) {
+        nn_assert (!recv_msg (s [1]));
+        lt_poller_set_events (&poller, &hndl, EPOLLIN);
+        send_msg (s [0]);
+        while (1) {
+            rc = lt_poller_event (&poller, &event, &phndl);
+            if (rc == 0)
+                break;
+            lt_poller_wait (&poller, -1);
+        }
+        nn_assert (phndl == &hndl && event == NN_POLLER_IN);
+        nn_assert (recv_msg (s [1]));
+        lt_poller_set_events (&poller, &hndl, 0);
+    }
+    report ("level", nn_stopwatch_term (&stopwatch));
+
+    lt_poller_term (&poller);
+}
+
+int main (int argc, char *argv [])
+{
+    int rc;
+    int s [2];
+
+    if (argc != 3) {
+        printf ("usage: poller <message-size> <message-count>\n");
+        return 1;
+    }
+
+    message_size = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+    nn_assert (message_size > 0 && message_count > 0);
+    buf = malloc (message_size);
+    alloc_assert (buf);
+    memset (buf, 0, message_size);
+
+    rc = socketpair (AF_UNIX, SOCK_STREAM, 0, s);
+    errno_assert (rc == 0);
+    rc = fcntl (s [1], F_SETFL, fcntl (s [1], F_GETFL, 0) | O_NONBLOCK);
+    errno_assert (rc != -1);
+
+    printf ("message size: %d [B]\n", message_size);
+    printf ("message count: %d\n", message_count);
+    bench_et (s);
+    bench_lt (s);
+
+    nn_closefd (s [0]);
+    nn_closefd (s [1]);
+    free (buf);
+    return 0;
+}
+
+#else
+
+#include <stdio.h>
+
+int main ()
+{
+    printf ("poller: the benchmark requires epoll\n");
+    return 0;
+}
+
+#endif
+
@@ -0,0 +1,165 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*  Measures the cost of waiting for one ready socket out of many, using
+    nn_poll, which checks all the sockets on every call, and the persistent
+    pollset, which reports only the ready ones. */
+
+static int pair_count;
+static int roundtrip_count;
+static int *sb;
+static int *sc;
+
+static void ping (int i)
+{
+    int rc;
+
+    rc = nn_send (sc [i], "A", 1, 0);
+    errno_assert (rc == 1);
+}
+
+static void pong (int s)
+{
+    int rc;
+    char buf [1];
+
+    rc = nn_recv (s, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+}
+
+static uint64_t run_poll (void)
+{
+    int rc;
+    int i;
+    int j;
+    struct nn_pollfd *pfd;
+    struct nn_stopwatch stopwatch;
+
+    pfd = malloc (sizeof (struct nn_pollfd) * pair_count);
+    nn_assert (pfd);
+    for (i = 0; i != pair_count; ++i) {
+        pfd [i].fd = sb [i];
+        pfd [i].events = NN_POLLIN;
+    }
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != roundtrip_count; ++i) {
+        ping (i % pair_count);
+        rc = nn_poll (pfd, pair_count, -1);
+        errno_assert (rc == 1);
+        for (j = 0; j != pair_count; ++j)
+            if (pfd [j].revents & NN_POLLIN)
+                pong (pfd [j].fd);
+    }
+
+    free (pfd);
+    return nn_stopwatch_term (&stopwatch);
+}
+
+static uint64_t run_pollset (void)
+{
+    int rc;
+    int i;
+    int j;
+    struct nn_pollset *ps;
+    struct nn_pollfd pfd [16];
+    struct nn_stopwatch stopwatch;
+
+    ps = nn_pollset_create ();
+    errno_assert (ps);
+    for (i = 0; i != pair_count; ++i) {
+        rc = nn_pollset_add (ps, sb [i], NN_POLLIN);
+        errno_assert (rc == 0);
+    }
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != roundtrip_count; ++i) {
+        ping (i % pair_count);
+        rc = nn_pollset_wait (ps, pfd, 16, -1);
+        errno_assert (rc == 1);
+        for (j = 0; j != rc; ++j)
+            pong (pfd [j].fd);
+    }
+
+    rc = nn_pollset_close (ps);
+    errno_assert (rc == 0);
+    return nn_stopwatch_term (&stopwatch);
+}
+
+int main (int argc, char *argv [])
+{
+    int rc;
+    int i;
+    char addr [32];
+    uint64_t elapsed;
+
+    if (argc != 3) {
+        printf ("usage: pollset <socket-count> <roundtrip-count>\n");
+        return 1;
+    }
+
+    pair_count = atoi (argv [1]);
+    roundtrip_count = atoi (argv [2]);
+    nn_assert (pair_count > 0 && roundtrip_count > 0);
+
+    sb = malloc (sizeof (int) * pair_count);
+    nn_assert (sb);
+    sc = malloc (sizeof (int) * pair_count);
+    nn_assert (sc);
+    for (i = 0; i != pair_count; ++i) {
+        sprintf (addr, "inproc://pollset%d", i);
+        sb [i] = nn_socket (AF_SP, NN_PAIR);
+        errno_assert (sb [i] >= 0);
+        rc = nn_bind (sb [i], addr);
+        errno_assert (rc >= 0);
+        sc [i] = nn_socket (AF_SP, NN_PAIR);
+        errno_assert (sc [i] >= 0);
+        rc = nn_connect (sc [i], addr);
+        errno_assert (rc >= 0);
+    }
+
+    printf ("socket count: %d\n", pair_count);
+    printf ("roundtrip count: %d\n", roundtrip_count);
+    elapsed = run_poll ();
+    printf ("nn_poll: %.3f [us]\n", (double) elapsed / roundtrip_count);
+    elapsed = run_pollset ();
+    printf ("nn_pollset: %.3f [us]\n", (double) elapsed / roundtrip_count);
+
+    for (i = 0; i != pair_count; ++i) {
+        rc = nn_close (sc [i]);
+        errno_assert (rc == 0);
+        rc = nn_close (sb [i]);
+        errno_assert (rc == 0);
+    }
+    free (sc);
+    free (sb);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*  Measures how fast sockets can be created and closed when there are many
+    of them, and how long it takes to look a socket up in the socket table.
+    PUSH sockets are used as they need a single file descriptor each. */
+
+int main (int argc, char *argv [])
+{
+    int rc;
+    int i;
+    int j;
+    int socket_count;
+    int round_count;
+    int *socks;
+    int sndbuf;
+    size_t sz;
+    uint64_t create_time;
+    uint64_t close_time;
+    uint64_t lookup_time;
+    struct nn_stopwatch stopwatch;
+
+    if (argc != 3) {
+        printf ("usage: socktab <socket-count> <round-count>\n");
+        return 1;
+    }
+
+    socket_count = atoi (argv [1]);
+    round_count = atoi (argv [2]);
+    nn_assert (socket_count > 0 && round_count > 0);
+
+    socks = malloc (sizeof (int) * socket_count);
+    nn_assert (socks);
+
+    create_time = 0;
+    close_time = 0;
+    lookup_time = 0;
+    for (i = 0; i != round_count; ++i) {
+        nn_stopwatch_init (&stopwatch);
+        for (j = 0; j != socket_count; ++j) {
+            socks [j] = nn_socket (AF_SP, NN_PUSH);
+            errno_assert (socks [j] >= 0);
+        }
+        create_time += nn_stopwatch_term (&stopwatch);
+
+        nn_stopwatch_init (&stopwatch);
+        for (j = 0; j != socket_count; ++j) {
+            sz = sizeof (sndbuf);
+            rc = nn_getsockopt (socks [j], NN_SOL_SOCKET, NN_SNDBUF,
+                &sndbuf, &sz);
+            errno_assert (rc == 0);
+        }
+        lookup_time += nn_stopwatch_term (&stopwatch);
+
+        /*  Close the sockets in the order they were created, so that the
+            table doesn't shrink to nothing until the very end. */
+        nn_stopwatch_init (&stopwatch);
+        for (j = 0; j != socket_count; ++j) {
+            rc = nn_close (socks [j]);
+            errno_assert (rc == 0);
+        }
+        close_time += nn_stopwatch_term (&stopwatch);
+    }
+
+    printf ("socket count: %d\n", socket_count);
+    printf ("round count: %d\n", round_count);
+    printf ("create: %.0f [sockets/s]\n",
+        (double) socket_count * round_count * 1000000 / create_time);
+    printf ("close: %.0f [sockets/s]\n",
+        (double) socket_count * round_count * 1000000 / close_time);
+    printf ("getsockopt: %.3f [us]\n",
+        (double) lookup_time / socket_count / round_count);
+
+    free (socks);
+    return 0;
+}
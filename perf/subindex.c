@@ -0,0 +1,157 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/protocols/pubsub/subindex.c"
+#include "../src/protocols/pubsub/trie.c"
+#include "../src/utils/alloc.c"
+#include "../src/utils/list.c"
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*  Compares matching a published message against the subscription index
+    shared by all the subscribers of xpub with matching it against a trie
+    per subscriber, which is what xpub used to do. Each subscriber is
+    subscribed to one of subscriber-count / fan-out topics, so that each
+    message is delivered to 'fan-out' subscribers. */
+
+#define TOPIC_SIZE 32
+
+static int sub_count;
+static int fan_out;
+static int msg_count;
+static int topic_count;
+static int *msgs;
+
+static void make_topic (uint8_t *buf, int topic)
+{
+    sprintf ((char*) buf, "market.quotes.%08d.", topic);
+}
+
+static void report (const char *name, uint64_t elapsed, uint64_t delivered)
+{
+    printf ("%-6s %10.1f [ns/msg] %10.1f [subscribers/msg]\n", name,
+        (double) elapsed * 1000 / msg_count,
+        (double) delivered / msg_count);
+}
+
+static void bench_index ()
+{
+    int i;
+    uint64_t delivered;
+    uint8_t buf [TOPIC_SIZE];
+    struct nn_subindex index;
+    struct nn_subindex_subscriber *subs;
+    struct nn_stopwatch stopwatch;
+
+    subs = malloc (sizeof (struct nn_subindex_subscriber) * sub_count);
+    nn_assert (subs);
+    nn_subindex_init (&index);
+    for (i = 0; i != sub_count; ++i) {
+        nn_subindex_subscriber_init (&subs [i]);
+        make_topic (buf, i % topic_count);
+        nn_subindex_subscribe (&index, &subs [i], buf,
+            strlen ((char*) buf));
+    }
+
+    delivered = 0;
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != msg_count; ++i) {
+        make_topic (buf, msgs [i]);
+        delivered += nn_subindex_match (&index, buf, sizeof (buf));
+    }
+    report ("index", nn_stopwatch_term (&stopwatch), delivered);
+
+    for (i = 0; i != sub_count; ++i) {
+        nn_subindex_rm (&index, &subs [i]);
+        nn_subindex_subscriber_term (&subs [i]);
+    }
+    nn_subindex_term (&index);
+    free (subs);
+}
+
+static void bench_trie ()
+{
+    int i;
+    int j;
+    uint64_t delivered;
+    uint8_t buf [TOPIC_SIZE];
+    struct nn_trie *tries;
+    struct nn_stopwatch stopwatch;
+
+    tries = malloc (sizeof (struct nn_trie) * sub_count);
+    nn_assert (tries);
+    for (i = 0; i != sub_count; ++i) {
+        nn_trie_init (&tries [i]);
+        make_topic (buf, i % topic_count);
+        nn_trie_subscribe (&tries [i], buf, strlen ((char*) buf));
+    }
+
+    delivered = 0;
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != msg_count; ++i) {
+        make_topic (buf, msgs [i]);
+        for (j = 0; j != sub_count; ++j)
+            delivered += nn_trie_match (&tries [j], buf, sizeof (buf));
+    }
+    report ("trie", nn_stopwatch_term (&stopwatch), delivered);
+
+    for (i = 0; i != sub_count; ++i)
+        nn_trie_term (&tries [i]);
+    free (tries);
+}
+
+int main (int argc, char *argv [])
+{
+    int i;
+
+    if (argc != 4) {
+        printf ("usage: subindex <subscriber-count> <fan-out> "
+            "<message-count>\n");
+        return 1;
+    }
+
+    sub_count = atoi (argv [1]);
+    fan_out = atoi (argv [2]);
+    msg_count = atoi (argv [3]);
+    nn_assert (sub_count > 0 && fan_out > 0 && fan_out <= sub_count &&
+        msg_count > 0);
+    topic_count = sub_count / fan_out;
+
+    /*  Same pseudo-random topics are published to both implementations. */
+    msgs = malloc (sizeof (int) * msg_count);
+    nn_assert (msgs);
+    srand (1);
+    for (i = 0; i != msg_count; ++i)
+        msgs [i] = rand () % topic_count;
+
+    printf ("subscriber count: %d\n", sub_count);
+    printf ("fan-out: %d\n", fan_out);
+    printf ("message count: %d\n", msg_count);
+    bench_index ();
+    bench_trie ();
+
+    free (msgs);
+    return 0;
+}
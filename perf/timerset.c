@@ -0,0 +1,194 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/aio/timerset.c"
+#include "../src/utils/clock.c"
+#include "../src/utils/list.c"
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*  Compares the timing wheel used by nn_timerset with the ordered list of
+    timeouts it replaced. The old implementation is reproduced below. */
+
+struct list_timerset_hndl {
+    struct nn_list_item list;
+    uint64_t timeout;
+};
+
+struct list_timerset {
+    struct nn_clock clock;
+    struct nn_list timeouts;
+};
+
+static void list_timerset_add (struct list_timerset *self, int timeout,
+    struct list_timerset_hndl *hndl)
+{
+    struct nn_list_item *it;
+
+    hndl->timeout = nn_clock_now (&self->clock) + timeout;
+    for (it = nn_list_begin (&self->timeouts);
+          it != nn_list_end (&self->timeouts);
+          it = nn_list_next (&self->timeouts, it))
+        if (hndl->timeout <
+              nn_cont (it, struct list_timerset_hndl, list)->timeout)
+            break;
+    nn_list_insert (&self->timeouts, &hndl->list, it);
+}
+
+static void list_timerset_rm (struct list_timerset *self,
+    struct list_timerset_hndl *hndl)
+{
+    nn_list_erase (&self->timeouts, &hndl->list);
+}
+
+static int list_timerset_timeout (struct list_timerset *self)
+{
+    int timeout;
+
+    if (nn_list_empty (&self->timeouts))
+        return -1;
+    timeout = (int) (nn_cont (nn_list_begin (&self->timeouts),
+        struct list_timerset_hndl, list)->timeout -
+        nn_clock_now (&self->clock));
+    return timeout < 0 ? 0 : timeout;
+}
+
+static int timer_count;
+static int max_timeout;
+static int *timeouts;
+
+static void report (const char *name, const char *op, uint64_t elapsed)
+{
+    printf ("%-6s %-8s %10.1f [ns/op]\n", name, op,
+        (double) elapsed * 1000 / timer_count);
+}
+
+static void bench_wheel ()
+{
+    int i;
+    struct nn_timerset ts;
+    struct nn_timerset_hndl *hndls;
+    struct nn_stopwatch stopwatch;
+
+    hndls = malloc (sizeof (struct nn_timerset_hndl) * timer_count);
+    nn_assert (hndls);
+    nn_timerset_init (&ts);
+    for (i = 0; i != timer_count; ++i)
+        nn_timerset_hndl_init (&hndls [i]);
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != timer_count; ++i)
+        nn_timerset_add (&ts, timeouts [i], &hndls [i]);
+    report ("wheel", "add", nn_stopwatch_term (&stopwatch));
+
+    /*  Re-arm each timer, the way the worker thread does it when a timer
+        is restarted, and query the waiting interval afterwards. */
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != timer_count; ++i) {
+        nn_timerset_rm (&ts, &hndls [i]);
+        nn_timerset_add (&ts, timeouts [timer_count - i - 1], &hndls [i]);
+        nn_timerset_timeout (&ts);
+    }
+    report ("wheel", "rearm", nn_stopwatch_term (&stopwatch));
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != timer_count; ++i)
+        nn_timerset_rm (&ts, &hndls [i]);
+    report ("wheel", "rm", nn_stopwatch_term (&stopwatch));
+
+    for (i = 0; i != timer_count; ++i)
+        nn_timerset_hndl_term (&hndls [i]);
+    nn_timerset_term (&ts);
+    free (hndls);
+}
+
+static void bench_list ()
+{
+    int i;
+    struct list_timerset ts;
+    struct list_timerset_hndl *hndls;
+    struct nn_stopwatch stopwatch;
+
+    hndls = malloc (sizeof (struct list_timerset_hndl) * timer_count);
+    nn_assert (hndls);
+    nn_clock_init (&ts.clock);
+    nn_list_init (&ts.timeouts);
+    for (i = 0; i != timer_count; ++i)
+        nn_list_item_init (&hndls [i].list);
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != timer_count; ++i)
+        list_timerset_add (&ts, timeouts [i], &hndls [i]);
+    report ("list", "add", nn_stopwatch_term (&stopwatch));
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != timer_count; ++i) {
+        list_timerset_rm (&ts, &hndls [i]);
+        list_timerset_add (&ts, timeouts [timer_count - i - 1], &hndls [i]);
+        list_timerset_timeout (&ts);
+    }
+    report ("list", "rearm", nn_stopwatch_term (&stopwatch));
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != timer_count; ++i)
+        list_timerset_rm (&ts, &hndls [i]);
+    report ("list", "rm", nn_stopwatch_term (&stopwatch));
+
+    for (i = 0; i != timer_count; ++i)
+        nn_list_item_term (&hndls [i].list);
+    nn_list_term (&ts.timeouts);
+    nn_clock_term (&ts.clock);
+    free (hndls);
+}
+
+int main (int argc, char *argv [])
+{
+    int i;
+
+    if (argc != 3) {
+        printf ("usage: timerset <timer-count> <max-timeout-ms>\n");
+        return 1;
+    }
+
+    timer_count = atoi (argv [1]);
+    max_timeout = atoi (argv [2]);
+    nn_assert (timer_count > 0 && max_timeout > 0);
+
+    /*  Same pseudo-random timeouts are used for both implementations. */
+    timeouts = malloc (sizeof (int) * timer_count);
+    nn_assert (timeouts);
+    srand (1);
+    for (i = 0; i != timer_count; ++i)
+        timeouts [i] = rand () % max_timeout;
+
+    printf ("timer count: %d\n", timer_count);
+    printf ("max timeout: %d [ms]\n", max_timeout);
+    bench_wheel ();
+    bench_list ();
+
+    free (timeouts);
+    return 0;
+}
+
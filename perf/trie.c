@@ -0,0 +1,190 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+
+/*  Memory allocation is intercepted to keep track of the memory used by
+    the trie. */
+#define nn_alloc_ counted_alloc
+#define nn_realloc counted_realloc
+#define nn_free counted_free
+
+#include "../src/protocols/pubsub/trie.c"
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdio.h>
+
+/*  Measures the rate of subscribing, matching and unsubscribing with
+    nn_trie, as well as the memory used per subscription. Topics are
+    hierarchical strings with the specified fan-out at each level. */
+
+static size_t alloc_bytes;
+
+void *counted_alloc (size_t size)
+{
+    size_t *chunk;
+
+    chunk = malloc (sizeof (size_t) + size);
+    nn_assert (chunk);
+    *chunk = size;
+    alloc_bytes += size;
+    return chunk + 1;
+}
+
+void *counted_realloc (void *ptr, size_t size)
+{
+    size_t *chunk;
+
+    chunk = realloc (((size_t*) ptr) - 1, sizeof (size_t) + size);
+    nn_assert (chunk);
+    alloc_bytes += size - *chunk;
+    *chunk = size;
+    return chunk + 1;
+}
+
+void counted_free (void *ptr)
+{
+    size_t *chunk;
+
+    if (!ptr)
+        return;
+    chunk = ((size_t*) ptr) - 1;
+    alloc_bytes -= *chunk;
+    free (chunk);
+}
+
+#define TOPIC_MAX 256
+
+struct topic {
+    uint8_t data [TOPIC_MAX];
+    size_t size;
+};
+
+static int sub_count;
+static int fan_out;
+static int levels;
+static struct topic *topics;
+static struct topic *msgs;
+
+static void make_topic (struct topic *topic, int index)
+{
+    int i;
+    size_t pos;
+
+    /*  Each level is a fixed segment preceded by the character that
+        branches the trie. */
+    pos = sprintf ((char*) topic->data, "marketdata/");
+    for (i = 0; i != levels; ++i) {
+        topic->data [pos++] = (uint8_t) ('0' + index % fan_out);
+        pos += sprintf ((char*) topic->data + pos, "/quotes/");
+        index /= fan_out;
+    }
+    topic->size = pos;
+}
+
+static void report (const char *op, uint64_t elapsed)
+{
+    printf ("%-12s %10.1f [ns/op]\n", op, (double) elapsed * 1000 / sub_count);
+}
+
+int main (int argc, char *argv [])
+{
+    int i;
+    int rc;
+    int matches;
+    struct nn_trie trie;
+    struct nn_stopwatch stopwatch;
+
+    if (argc != 3) {
+        printf ("usage: trie <subscription-count> <fan-out>\n");
+        return 1;
+    }
+
+    sub_count = atoi (argv [1]);
+    fan_out = atoi (argv [2]);
+    nn_assert (sub_count > 0 && fan_out > 1 && fan_out <= 200);
+    levels = 1;
+    for (i = fan_out; i < sub_count; i *= fan_out)
+        ++levels;
+
+    topics = malloc (sizeof (struct topic) * sub_count);
+    nn_assert (topics);
+    msgs = malloc (sizeof (struct topic) * sub_count);
+    nn_assert (msgs);
+    srand (1);
+    for (i = 0; i != sub_count; ++i)
+        make_topic (&topics [i], i);
+
+    /*  Messages are published to the subscribed topics with some payload
+        appended, in random order. */
+    for (i = 0; i != sub_count; ++i) {
+        msgs [i] = topics [rand () % sub_count];
+        memcpy (msgs [i].data + msgs [i].size, "payload", 7);
+        msgs [i].size += 7;
+    }
+
+    printf ("subscription count: %d\n", sub_count);
+    printf ("fan-out: %d\n", fan_out);
+    printf ("levels: %d\n", levels);
+
+    nn_trie_init (&trie);
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != sub_count; ++i) {
+        rc = nn_trie_subscribe (&trie, topics [i].data, topics [i].size);
+        nn_assert (rc == 1);
+    }
+    report ("subscribe", nn_stopwatch_term (&stopwatch));
+    printf ("%-12s %10.1f [B/subscription]\n", "memory",
+        (double) alloc_bytes / sub_count);
+
+    matches = 0;
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != sub_count; ++i)
+        matches += nn_trie_match (&trie, msgs [i].data, msgs [i].size);
+    report ("match", nn_stopwatch_term (&stopwatch));
+    nn_assert (matches == sub_count);
+
+    /*  Change the branching character of the deepest level so that the
+        messages don't match any more. */
+    for (i = 0; i != sub_count; ++i)
+        msgs [i].data [msgs [i].size - 16] = (uint8_t) ('0' + fan_out);
+    matches = 0;
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != sub_count; ++i)
+        matches += nn_trie_match (&trie, msgs [i].data, msgs [i].size);
+    report ("mismatch", nn_stopwatch_term (&stopwatch));
+    nn_assert (matches == 0);
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != sub_count; ++i) {
+        rc = nn_trie_unsubscribe (&trie, topics [i].data, topics [i].size);
+        nn_assert (rc == 1);
+    }
+    report ("unsubscribe", nn_stopwatch_term (&stopwatch));
+    nn_assert (alloc_bytes == 0);
+    nn_trie_term (&trie);
+
+    free (msgs);
+    free (topics);
+    return 0;
+}
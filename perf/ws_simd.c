@@ -0,0 +1,194 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/transports/ws/ws_simd.c"
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*  Measures throughput of the WebSocket payload masking and UTF-8
+    validation kernels. The byte-by-byte loops the transport used before
+    are reproduced below as the baseline. */
+
+static void byte_mask (uint8_t *buf, size_t len, const uint8_t *mask)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+        buf [i] ^= mask [i % NN_WS_SIMD_MASK_LEN];
+}
+
+static size_t byte_utf8 (const uint8_t *buf, size_t len)
+{
+    size_t pos;
+    size_t n;
+    size_t i;
+
+    pos = 0;
+    while (pos < len) {
+        if (buf [pos] <= 0x7f)
+            n = 1;
+        else if (buf [pos] < 0xc2 || buf [pos] > 0xf4)
+            return pos;
+        else if (buf [pos] <= 0xdf)
+            n = 2;
+        else if (buf [pos] <= 0xef) {
+            if (len - pos < 3 ||
+                  (buf [pos] == 0xe0 && buf [pos + 1] < 0xa0) ||
+                  (buf [pos] == 0xed && buf [pos + 1] >= 0xa0))
+                return pos;
+            n = 3;
+        }
+        else {
+            if (len - pos < 4 ||
+                  (buf [pos] == 0xf0 && buf [pos + 1] < 0x90) ||
+                  (buf [pos] == 0xf4 && buf [pos + 1] >= 0x90))
+                return pos;
+            n = 4;
+        }
+        if (len - pos < n)
+            return pos;
+        for (i = 1; i != n; ++i)
+            if ((buf [pos + i] & 0xc0) != 0x80)
+                return pos;
+        pos += n;
+    }
+    return pos;
+}
+
+/*  Validates the way nn_sws does: vectorised prefix first, the rest code
+    point by code point. */
+static size_t kernel_utf8 (const uint8_t *buf, size_t len)
+{
+    size_t pos;
+    size_t n;
+
+    pos = 0;
+    while (pos < len) {
+        pos += nn_ws_utf8_prefix (buf + pos, len - pos);
+        if (pos == len)
+            break;
+        n = byte_utf8 (buf + pos, buf [pos] < 0x80 ? 1 :
+            (len - pos < 4 ? len - pos : 4));
+        nn_assert (n > 0);
+        pos += n;
+    }
+    return pos;
+}
+
+static size_t msg_size;
+static int iterations;
+
+static void report (const char *name, const char *op, uint64_t elapsed)
+{
+    printf ("%-8s %-12s %10.1f [MB/s]\n", name, op,
+        (double) msg_size * iterations / (elapsed ? elapsed : 1));
+}
+
+static void bench (const char *name, int level, uint8_t *ascii,
+    uint8_t *text)
+{
+    int i;
+    uint8_t mask [NN_WS_SIMD_MASK_LEN] = {0x12, 0x34, 0x56, 0x78};
+    struct nn_stopwatch stopwatch;
+
+    if (level >= 0 && nn_ws_simd_setlevel (level) != 0) {
+        printf ("%-8s not supported\n", name);
+        return;
+    }
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != iterations; ++i) {
+        if (level < 0)
+            byte_mask (ascii, msg_size, mask);
+        else
+            nn_ws_mask (ascii, msg_size, mask, 0);
+    }
+    report (name, "mask", nn_stopwatch_term (&stopwatch));
+
+    /*  Odd number of maskings so far; restore the original payload. */
+    if (iterations % 2)
+        byte_mask (ascii, msg_size, mask);
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != iterations; ++i)
+        nn_assert ((level < 0 ? byte_utf8 (ascii, msg_size) :
+            kernel_utf8 (ascii, msg_size)) == msg_size);
+    report (name, "utf8-ascii", nn_stopwatch_term (&stopwatch));
+
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != iterations; ++i)
+        nn_assert ((level < 0 ? byte_utf8 (text, msg_size) :
+            kernel_utf8 (text, msg_size)) == msg_size);
+    report (name, "utf8-mixed", nn_stopwatch_term (&stopwatch));
+}
+
+int main (int argc, char *argv [])
+{
+    static const char *samples [] = {"hello ", "world ", "\xc2\xa9 ",
+        "\xe2\x82\xac ", "\xf0\x9f\x98\x80 ", "\xd0\xbf\xd1\x80\xd0\xb8 "};
+    uint8_t *ascii;
+    uint8_t *text;
+    size_t pos;
+    size_t n;
+    const char *s;
+
+    if (argc != 3) {
+        printf ("usage: ws_simd <message-size> <iterations>\n");
+        return 1;
+    }
+
+    msg_size = (size_t) atoi (argv [1]);
+    iterations = atoi (argv [2]);
+    nn_assert (msg_size > 0 && iterations > 0);
+
+    /*  Pure ASCII payload and a payload mixing code points of all
+        lengths. */
+    ascii = malloc (msg_size);
+    text = malloc (msg_size);
+    nn_assert (ascii && text);
+    memset (ascii, 'a', msg_size);
+    srand (1);
+    pos = 0;
+    while (pos < msg_size) {
+        s = samples [rand () % (sizeof (samples) / sizeof (samples [0]))];
+        n = strlen (s);
+        if (pos + n > msg_size)
+            s = " ", n = 1;
+        memcpy (text + pos, s, n);
+        pos += n;
+    }
+
+    printf ("message size: %d [B]\n", (int) msg_size);
+    printf ("iterations: %d\n", iterations);
+    bench ("byte", -1, ascii, text);
+    bench ("word", NN_WS_SIMD_NONE, ascii, text);
+    bench ("sse", NN_WS_SIMD_SSE, ascii, text);
+    bench ("avx2", NN_WS_SIMD_AVX2, ascii, text);
+
+    free (text);
+    free (ascii);
+    return 0;
+}
+
@@ -31,6 +31,10 @@ void nn_ctx_init (struct nn_ctx *self, struct nn_pool *pool,
 {
     nn_mutex_init (&self->sync);
     self->pool = pool;
+
+    /*  All the state machines living in this context are handled by
+        the same worker thread. */
+    self->worker = nn_pool_choose_worker (pool);
     nn_queue_init (&self->events);
     nn_queue_init (&self->eventsto);
     self->onleave = onleave;
@@ -40,6 +44,7 @@ void nn_ctx_term (struct nn_ctx *self)
 {
     nn_queue_term (&self->eventsto);
     nn_queue_term (&self->events);
+    nn_pool_release_worker (self->pool, self->worker);
     nn_mutex_term (&self->sync);
 }
 
@@ -97,7 +102,7 @@ void nn_ctx_leave (struct nn_ctx *self)
 
 struct nn_worker *nn_ctx_choose_worker (struct nn_ctx *self)
 {
-    return nn_pool_choose_worker (self->pool);
+    return self->worker;
 }
 
 void nn_ctx_raise (struct nn_ctx *self, struct nn_fsm_event *event)
@@ -20,6 +20,8 @@
     IN THE SOFTWARE.
 */
 
+#include "../utils/list.h"
+
 #include <stdint.h>
 #include <sys/types.h>
 #include <sys/epoll.h>
@@ -28,9 +30,22 @@
 
 #define NN_POLLER_MAX_EVENTS 32
 
+/*  File descriptors are registered with the pollset only once, in
+    edge-triggered mode, for both IN and OUT. Whether the user is interested
+    in the events is tracked here rather than in the kernel, so that changing
+    it doesn't require a system call. */
 struct nn_poller_hndl {
     int fd;
+
+    /*  Events the user is interested in. */
     uint32_t events;
+
+    /*  Edges that were reported while the user was not interested in them.
+        They are delivered as soon as the user asks for them. */
+    uint32_t ready;
+
+    /*  Set when the handle is waiting in the list of pending events. */
+    struct nn_list_item item;
 };
 
 struct nn_poller {
@@ -46,5 +61,8 @@ struct nn_poller {
 
     /*  Events being processed at the moment. */
     struct epoll_event events [NN_POLLER_MAX_EVENTS];
+
+    /*  Handles with stored edges the user has asked for. */
+    struct nn_list pending;
 };
 
@@ -22,20 +22,101 @@
 
 #include "pool.h"
 
-/*  TODO: The dummy implementation of a thread pool. As for now there's only
-    one worker thread created. */
+#include "../utils/err.h"
 
-int nn_pool_init (struct nn_pool *self)
+#if defined NN_HAVE_WINDOWS
+#include "../utils/win.h"
+#else
+#include <unistd.h>
+#endif
+
+/*  Private functions. */
+static int nn_pool_ncpus (void);
+
+int nn_pool_init (struct nn_pool *self, int nworkers)
 {
-    return nn_worker_init (&self->worker);
+    int rc;
+    int i;
+
+    /*  By default, run one worker thread per CPU core. */
+    if (nworkers <= 0)
+        nworkers = nn_pool_ncpus ();
+    if (nworkers > NN_POOL_MAX_WORKERS)
+        nworkers = NN_POOL_MAX_WORKERS;
+
+    for (i = 0; i != nworkers; ++i) {
+        rc = nn_worker_init (&self->workers [i]);
+        if (nn_slow (rc < 0)) {
+            while (i > 0)
+                nn_worker_term (&self->workers [--i]);
+            self->nworkers = 0;
+            return rc;
+        }
+        self->loads [i] = 0;
+    }
+    self->nworkers = nworkers;
+    self->next = 0;
+
+    return 0;
 }
 
 void nn_pool_term (struct nn_pool *self)
 {
-    nn_worker_term (&self->worker);
+    int i;
+
+    for (i = 0; i != self->nworkers; ++i)
+        nn_worker_term (&self->workers [i]);
+}
+
+int nn_pool_nworkers (struct nn_pool *self)
+{
+    return self->nworkers;
 }
 
 struct nn_worker *nn_pool_choose_worker (struct nn_pool *self)
 {
-    return &self->worker;
+    int i;
+    int j;
+    int best;
+
+    nn_assert (self->nworkers > 0);
+
+    /*  Find the worker with the fewest AIO contexts pinned to it. */
+    best = self->next;
+    for (i = 1; i != self->nworkers; ++i) {
+        j = (self->next + i) % self->nworkers;
+        if (self->loads [j] < self->loads [best])
+            best = j;
+    }
+    self->next = (best + 1) % self->nworkers;
+
+    ++self->loads [best];
+    return &self->workers [best];
+}
+
+void nn_pool_release_worker (struct nn_pool *self, struct nn_worker *worker)
+{
+    int index;
+
+    index = (int) (worker - self->workers);
+    nn_assert (index >= 0 && index < self->nworkers);
+    nn_assert (self->loads [index] > 0);
+    --self->loads [index];
+}
+
+static int nn_pool_ncpus (void)
+{
+#if defined NN_HAVE_WINDOWS
+    SYSTEM_INFO info;
+
+    GetSystemInfo (&info);
+    return info.dwNumberOfProcessors > 0 ? (int) info.dwNumberOfProcessors : 1;
+#elif defined _SC_NPROCESSORS_ONLN
+    long n;
+
+    n = sysconf (_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int) n : 1;
+#else
+    return 1;
+#endif
 }
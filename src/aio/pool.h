@@ -25,15 +25,46 @@
 
 #include "worker.h"
 
-/*  Worker thread pool. */
+/*  Worker thread pool. Each AIO context is pinned to a single worker thread
+    for its whole lifetime, so that all the state machines belonging to one
+    SP socket are processed by the same thread, while distinct sockets are
+    spread among all the workers in the pool. */
+
+/*  Maximum number of worker threads in the pool. */
+#define NN_POOL_MAX_WORKERS 64
 
 struct nn_pool {
-    struct nn_worker worker;
+
+    /*  Number of worker threads actually running. */
+    int nworkers;
+
+    /*  Index of the worker to start the search for the least loaded worker
+        from. Rotating it ensures that ties are broken in round-robin manner.
+        Protected by nn_glock, same as 'loads'. */
+    int next;
+
+    /*  Worker threads. */
+    struct nn_worker workers [NN_POOL_MAX_WORKERS];
+
+    /*  Number of AIO contexts currently pinned to each worker. */
+    int loads [NN_POOL_MAX_WORKERS];
 };
 
-int nn_pool_init (struct nn_pool *self);
+/*  Start 'nworkers' worker threads. If 'nworkers' is zero or negative,
+    the number of worker threads is set to the number of CPU cores. */
+int nn_pool_init (struct nn_pool *self, int nworkers);
 void nn_pool_term (struct nn_pool *self);
+
+/*  Returns the number of worker threads in the pool. */
+int nn_pool_nworkers (struct nn_pool *self);
+
+/*  Pins a new AIO context to the least loaded worker and releases it.
+    The functions don't lock anything themselves. They rely on the caller
+    holding nn_glock to serialise access to 'loads' and 'next'. AIO contexts
+    are created and destroyed along with the sockets, i.e. with nn_glock
+    held. */
 struct nn_worker *nn_pool_choose_worker (struct nn_pool *self);
+void nn_pool_release_worker (struct nn_pool *self, struct nn_worker *worker);
 
 #endif
 
@@ -26,88 +26,115 @@
 #include "../utils/cont.h"
 #include "../utils/err.h"
 
+#define NN_TIMERSET_EXPIRED -1
+#define NN_TIMERSET_NONE -2
+
+/*  Private functions. */
+static void nn_timerset_insert (struct nn_timerset *self,
+    struct nn_timerset_hndl *hndl);
+static void nn_timerset_advance (struct nn_timerset *self, uint64_t now);
+static int nn_timerset_first (struct nn_timerset *self, uint64_t *when);
+static int nn_timerset_fls (uint64_t x);
+static int nn_timerset_ffs (uint64_t x);
+static uint64_t nn_timerset_rotr (uint64_t x, int n);
+
 void nn_timerset_init (struct nn_timerset *self)
 {
+    int i;
+
     nn_clock_init (&self->clock);
-    nn_list_init (&self->timeouts);
+    self->now = nn_clock_now (&self->clock);
+    for (i = 0; i != NN_TIMERSET_LEVELS; ++i)
+        self->pending [i] = 0;
+    for (i = 0; i != NN_TIMERSET_LEVELS * NN_TIMERSET_SLOTS; ++i)
+        nn_list_init (&self->slots [i]);
+    nn_list_init (&self->expired);
 }
 
 void nn_timerset_term (struct nn_timerset *self)
 {
-    nn_list_term (&self->timeouts);
+    int i;
+
+    nn_list_term (&self->expired);
+    for (i = 0; i != NN_TIMERSET_LEVELS * NN_TIMERSET_SLOTS; ++i)
+        nn_list_term (&self->slots [i]);
     nn_clock_term (&self->clock);
 }
 
 int nn_timerset_add (struct nn_timerset *self, int timeout,
     struct nn_timerset_hndl *hndl)
 {
-    struct nn_list_item *it;
-    struct nn_timerset_hndl *ith;
-    int first;
-
     /*  Compute the instant when the timeout will be due. */
     hndl->timeout = nn_clock_now (&self->clock) + timeout;
 
-    /*  Insert it into the ordered list of timeouts. */
-    for (it = nn_list_begin (&self->timeouts);
-          it != nn_list_end (&self->timeouts);
-          it = nn_list_next (&self->timeouts, it)) {
-        ith = nn_cont (it, struct nn_timerset_hndl, list);
-        if (hndl->timeout < ith->timeout)
-            break;
-    }
-
-    /*  If the new timeout happens to be the first one to expire, let the user
-        know that the current waiting interval has to be changed. */
-    first = nn_list_begin (&self->timeouts) == it ? 1 : 0;
-    nn_list_insert (&self->timeouts, &hndl->list, it);
-    return first;
+    /*  Put it into the wheel. If it landed in the slot that is going to
+        expire first, let the user know that the current waiting interval
+        may have to be changed. */
+    nn_timerset_insert (self, hndl);
+    return nn_timerset_first (self, NULL) == hndl->slot ? 1 : 0;
 }
 
 int nn_timerset_rm (struct nn_timerset *self, struct nn_timerset_hndl *hndl)
 {
     int first;
+    int level;
+    struct nn_list *slot;
 
-    /*  Ignore if handle is not in the timeouts list. */
+    /*  Ignore if handle is not in the timerset. */
     if (!nn_list_item_isinlist (&hndl->list))
         return 0;
 
-    /*  If it was the first timeout that was removed, the actual waiting time
-        may have changed. We'll thus return 1 to let the user know. */
-    first = nn_list_begin (&self->timeouts) == &hndl->list ? 1 : 0;
-    nn_list_erase (&self->timeouts, &hndl->list);
+    /*  If the timeout was in the slot to expire first, the actual waiting
+        time may have changed. We'll thus return 1 to let the user know. */
+    first = nn_timerset_first (self, NULL) == hndl->slot ? 1 : 0;
+
+    if (hndl->slot == NN_TIMERSET_EXPIRED) {
+        nn_list_erase (&self->expired, &hndl->list);
+        return first;
+    }
+    slot = &self->slots [hndl->slot];
+    nn_list_erase (slot, &hndl->list);
+    if (nn_list_empty (slot)) {
+        level = hndl->slot / NN_TIMERSET_SLOTS;
+        self->pending [level] &=
+            ~((uint64_t) 1 << (hndl->slot % NN_TIMERSET_SLOTS));
+    }
     return first;
 }
 
 int nn_timerset_timeout (struct nn_timerset *self)
 {
-    int timeout;
+    uint64_t now;
+    uint64_t when;
+    int first;
 
-    if (nn_fast (nn_list_empty (&self->timeouts)))
-        return -1;
+    now = nn_clock_now (&self->clock);
+    nn_timerset_advance (self, now);
 
-    timeout = (int) (nn_cont (nn_list_begin (&self->timeouts),
-        struct nn_timerset_hndl, list)->timeout - nn_clock_now (&self->clock));
-    return timeout < 0 ? 0 : timeout;
+    first = nn_timerset_first (self, &when);
+    if (nn_fast (first == NN_TIMERSET_NONE))
+        return -1;
+    if (first == NN_TIMERSET_EXPIRED || when <= now)
+        return 0;
+    return (int) (when - now);
 }
 
 int nn_timerset_event (struct nn_timerset *self, struct nn_timerset_hndl **hndl)
 {
     struct nn_timerset_hndl *first;
 
-    /*  If there's no timeout, there's no event to report. */
-    if (nn_fast (nn_list_empty (&self->timeouts)))
-        return -EAGAIN;
+    /*  Move the timeouts that are already due to the list of expired
+        timeouts. */
+    nn_timerset_advance (self, nn_clock_now (&self->clock));
 
     /*  If no timeout have expired yet, there's no event to return. */
-    first = nn_cont (nn_list_begin (&self->timeouts),
-        struct nn_timerset_hndl, list);
-    if (first->timeout > nn_clock_now (&self->clock))
+    if (nn_fast (nn_list_empty (&self->expired)))
         return -EAGAIN;
 
-    /*  Return the first timeout and remove it from the list of active
-        timeouts. */
-    nn_list_erase (&self->timeouts, &first->list);
+    /*  Return the first expired timeout and remove it from the timerset. */
+    first = nn_cont (nn_list_begin (&self->expired),
+        struct nn_timerset_hndl, list);
+    nn_list_erase (&self->expired, &first->list);
     *hndl = first;
     return 0;
 }
@@ -115,6 +142,8 @@ int nn_timerset_event (struct nn_timerset *self, struct nn_timerset_hndl **hndl)
 void nn_timerset_hndl_init (struct nn_timerset_hndl *self)
 {
     nn_list_item_init (&self->list);
+    self->timeout = 0;
+    self->slot = NN_TIMERSET_NONE;
 }
 
 void nn_timerset_hndl_term (struct nn_timerset_hndl *self)
@@ -127,3 +156,155 @@ int nn_timerset_hndl_isactive (struct nn_timerset_hndl *self)
     return nn_list_item_isinlist (&self->list);
 }
 
+static void nn_timerset_insert (struct nn_timerset *self,
+    struct nn_timerset_hndl *hndl)
+{
+    int level;
+    int pos;
+
+    /*  The timeout is already due. */
+    if (hndl->timeout <= self->now) {
+        hndl->slot = NN_TIMERSET_EXPIRED;
+        nn_list_insert (&self->expired, &hndl->list,
+            nn_list_end (&self->expired));
+        return;
+    }
+
+    /*  The level is determined by the most significant bit in which
+        the timeout differs from the current time. Timeouts too far in the
+        future to fit into the wheel are stored on the topmost level and
+        cascaded down as the time passes. */
+    level = nn_timerset_fls (hndl->timeout ^ self->now) / NN_TIMERSET_BITS;
+    if (nn_slow (level >= NN_TIMERSET_LEVELS))
+        level = NN_TIMERSET_LEVELS - 1;
+    pos = (int) ((hndl->timeout >> (level * NN_TIMERSET_BITS)) &
+        (NN_TIMERSET_SLOTS - 1));
+
+    hndl->slot = level * NN_TIMERSET_SLOTS + pos;
+    nn_list_insert (&self->slots [hndl->slot], &hndl->list,
+        nn_list_end (&self->slots [hndl->slot]));
+    self->pending [level] |= (uint64_t) 1 << pos;
+}
+
+static void nn_timerset_advance (struct nn_timerset *self, uint64_t now)
+{
+    int level;
+    int shift;
+    int start;
+    int pos;
+    uint64_t elapsed;
+    uint64_t passed;
+    struct nn_list todo;
+    struct nn_list *slot;
+    struct nn_list_item *it;
+
+    if (nn_fast (now <= self->now))
+        return;
+
+    /*  Collect the timeouts from all the slots the wheel have moved past.
+        Slots are visited in the order of expiration. */
+    nn_list_init (&todo);
+    for (level = 0; level != NN_TIMERSET_LEVELS; ++level) {
+        shift = level * NN_TIMERSET_BITS;
+        elapsed = (now >> shift) - (self->now >> shift);
+
+        /*  If the time haven't moved on this level, it haven't moved on the
+            higher levels either. */
+        if (elapsed == 0)
+            break;
+
+        start = (int) (((self->now >> shift) + 1) & (NN_TIMERSET_SLOTS - 1));
+        passed = nn_timerset_rotr (self->pending [level], start);
+        if (elapsed < NN_TIMERSET_SLOTS)
+            passed &= ((uint64_t) 1 << elapsed) - 1;
+        while (passed) {
+            pos = (start + nn_timerset_ffs (passed)) & (NN_TIMERSET_SLOTS - 1);
+            passed &= passed - 1;
+            slot = &self->slots [level * NN_TIMERSET_SLOTS + pos];
+            while (!nn_list_empty (slot)) {
+                it = nn_list_begin (slot);
+                nn_list_erase (slot, it);
+                nn_list_insert (&todo, it, nn_list_end (&todo));
+            }
+            self->pending [level] &= ~((uint64_t) 1 << pos);
+        }
+    }
+    self->now = now;
+
+    /*  Re-insert the collected timeouts. They'll either end up in the list
+        of expired timeouts or on a lower level of the wheel. */
+    while (!nn_list_empty (&todo)) {
+        it = nn_list_begin (&todo);
+        nn_list_erase (&todo, it);
+        nn_timerset_insert (self,
+            nn_cont (it, struct nn_timerset_hndl, list));
+    }
+    nn_list_term (&todo);
+}
+
+static int nn_timerset_first (struct nn_timerset *self, uint64_t *when)
+{
+    int level;
+    int shift;
+    int start;
+    int dist;
+    uint64_t pending;
+
+    if (!nn_list_empty (&self->expired))
+        return NN_TIMERSET_EXPIRED;
+
+    /*  The first non-empty slot on the lowest non-empty level contains the
+        timeout to expire first. Report the instant when the slot begins;
+        on level 0 that's exactly the expiration time. */
+    for (level = 0; level != NN_TIMERSET_LEVELS; ++level) {
+        pending = self->pending [level];
+        if (nn_fast (!pending))
+            continue;
+        shift = level * NN_TIMERSET_BITS;
+        start = (int) (((self->now >> shift) + 1) & (NN_TIMERSET_SLOTS - 1));
+        dist = nn_timerset_ffs (nn_timerset_rotr (pending, start));
+        if (when)
+            *when = ((self->now >> shift) + 1 + dist) << shift;
+        return level * NN_TIMERSET_SLOTS +
+            ((start + dist) & (NN_TIMERSET_SLOTS - 1));
+    }
+    return NN_TIMERSET_NONE;
+}
+
+/*  Returns index of the most significant bit set. 'x' must not be zero. */
+static int nn_timerset_fls (uint64_t x)
+{
+#if defined __GNUC__
+    return 63 - __builtin_clzll (x);
+#else
+    int n;
+
+    n = 0;
+    while (x >>= 1)
+        ++n;
+    return n;
+#endif
+}
+
+/*  Returns index of the least significant bit set. 'x' must not be zero. */
+static int nn_timerset_ffs (uint64_t x)
+{
+#if defined __GNUC__
+    return __builtin_ctzll (x);
+#else
+    int n;
+
+    n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+static uint64_t nn_timerset_rotr (uint64_t x, int n)
+{
+    return n ? (x >> n) | (x << (64 - n)) : x;
+}
+
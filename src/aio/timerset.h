@@ -26,24 +26,61 @@
 #include "../utils/clock.h"
 #include "../utils/list.h"
 
-/*  This class stores a list of timeouts and reports the next one to expire
-    along with the time till it happens. */
+/*  This class stores a set of timeouts and reports the next one to expire
+    along with the time till it happens.
+
+    Timeouts are kept in a hierarchical timing wheel. Each level consists of
+    NN_TIMERSET_SLOTS slots, each slot on level N spanning NN_TIMERSET_SLOTS
+    times more milliseconds than a slot on level N-1. Adding and removing
+    a timeout is O(1). As the time passes, slots on higher levels are
+    cascaded down into lower levels and eventually into the list of expired
+    timeouts. */
+
+#define NN_TIMERSET_BITS 6
+#define NN_TIMERSET_SLOTS (1 << NN_TIMERSET_BITS)
+#define NN_TIMERSET_LEVELS 6
 
 struct nn_timerset_hndl {
     struct nn_list_item list;
     uint64_t timeout;
+
+    /*  Index of the slot the handle is stored in. NN_TIMERSET_EXPIRED if it
+        is in the list of expired timeouts. */
+    int slot;
 };
 
 struct nn_timerset {
     struct nn_clock clock;
-    struct nn_list timeouts;
+
+    /*  The point in time the wheel was advanced to. */
+    uint64_t now;
+
+    /*  Bitmaps of non-empty slots, one per level. */
+    uint64_t pending [NN_TIMERSET_LEVELS];
+
+    /*  The wheel itself. */
+    struct nn_list slots [NN_TIMERSET_LEVELS * NN_TIMERSET_SLOTS];
+
+    /*  Timeouts that are already due. They are appended as the wheel moves
+        past their slots and are not sorted by expiration time. All of them
+        are due, so they are reported in the order they were appended. */
+    struct nn_list expired;
 };
 
 void nn_timerset_init (struct nn_timerset *self);
 void nn_timerset_term (struct nn_timerset *self);
+
+/*  Adds and removes a timeout. Both functions return 1 if the time till
+    the next timeout expires may have changed, 0 otherwise. */
 int nn_timerset_add (struct nn_timerset *self, int timeout,
     struct nn_timerset_hndl *hndl);
 int nn_timerset_rm (struct nn_timerset *self, struct nn_timerset_hndl *hndl);
+
+/*  Returns number of milliseconds till the next timeout expires, -1 if there
+    are no timeouts. The returned value may be shorter than the actual
+    interval if the timeout still resides on a higher level of the wheel.
+    In such case nn_timerset_event will report nothing once the interval
+    elapses and the user should simply wait anew. */
 int nn_timerset_timeout (struct nn_timerset *self);
 int nn_timerset_event (struct nn_timerset *self, struct nn_timerset_hndl **hndl);
 
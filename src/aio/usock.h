@@ -39,10 +39,12 @@
 #define NN_USOCK_SHUTDOWN 8
 
 /*  Maximum number of iovecs that can be passed to nn_usock_send function. */
-#define NN_USOCK_MAX_IOVCNT 3
+#define NN_USOCK_MAX_IOVCNT 96
 
 /*  Size of the buffer used for batch-reads of inbound data. To keep the
-    performance optimal make sure that this value is larger than network MTU. */
+    performance optimal make sure that this value is larger than network MTU.
+    The buffer grows up to the size set by nn_usock_set_rcvbatch while the
+    inbound traffic is heavy and shrinks back once it calms down. */
 #define NN_USOCK_BATCH_SIZE 2048
 
 #if defined NN_HAVE_WINDOWS
@@ -89,6 +91,18 @@ void nn_usock_send (struct nn_usock *self, const struct nn_iovec *iov,
     int iovcnt);
 void nn_usock_recv (struct nn_usock *self, void *buf, size_t len, int *fd);
 
+/*  Receives 'len' bytes if they are already available in the batch buffer.
+    Returns 0 in such case. Otherwise, nothing is received and -EAGAIN is
+    returned. No event is raised either way. */
+int nn_usock_try_recv (struct nn_usock *self, void *buf, size_t len);
+
+/*  Same as nn_usock_try_recv, however, instead of copying the data, it returns
+    a chunk referencing the batch buffer. */
+int nn_usock_try_recv_slice (struct nn_usock *self, size_t len, void **chunk);
+
+/*  Sets the maximal size of the buffer used for batch-reads. */
+void nn_usock_set_rcvbatch (struct nn_usock *self, size_t maxsize);
+
 int nn_usock_geterrno (struct nn_usock *self);
 
 #endif
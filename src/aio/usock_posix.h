@@ -47,12 +47,29 @@ struct nn_usock {
         uint8_t *buf;
         size_t len;
 
-        /*  Buffer for batch-reading inbound data. */
+        /*  Buffer for batch-reading inbound data. It lives inside a chunk
+            so that received messages can reference it directly. */
+        void *batch_chunk;
         uint8_t *batch;
 
-        /*  Size of the batch buffer. */
+        /*  1 if slices of the batch buffer were handed out since it was
+            filled in. Such buffer can't be reused. */
+        int batch_sliced;
+
+        /*  Amount of data in the batch buffer. */
         size_t batch_len;
 
+        /*  Size of the batch buffer and the size it is allowed to grow to. */
+        size_t batch_size;
+        size_t batch_maxsize;
+
+        /*  Size the batch buffer should be resized to once it's empty. */
+        size_t batch_resize;
+
+        /*  Number of consecutive reads that used only a small portion of
+            the batch buffer. */
+        int batch_underused;
+
         /*  Current position in the batch buffer. The data preceding this
             position were already received by the user. The data that follow
             will be received in the future. */
@@ -21,8 +21,7 @@
     IN THE SOFTWARE.
 */
 
-#include "../utils/queue.h"
-#include "../utils/mutex.h"
+#include "../utils/mpscq.h"
 #include "../utils/thread.h"
 #include "../utils/efd.h"
 
@@ -45,13 +44,16 @@ void nn_worker_fd_term (struct nn_worker_fd *self);
 struct nn_worker_task {
     int src;
     struct nn_fsm *owner;
-    struct nn_queue_item item;
+    struct nn_mpscq_item item;
 };
 
 struct nn_worker {
-    struct nn_mutex sync;
-    struct nn_queue tasks;
-    struct nn_queue_item stop;
+
+    /*  Tasks posted to the worker thread. The eventfd is signaled only if
+        the worker thread is asleep, or about to fall asleep, when the task
+        is posted. */
+    struct nn_mpscq tasks;
+    struct nn_mpscq_item stop;
     struct nn_efd efd;
     struct nn_poller poller;
     struct nn_poller_hndl efd_hndl;
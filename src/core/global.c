@@ -40,6 +40,7 @@
 #include "../utils/random.h"
 #include "../utils/glock.h"
 #include "../utils/chunk.h"
+#include "../utils/chunkpool.h"
 #include "../utils/msg.h"
 #include "../utils/attr.h"
 
@@ -92,45 +93,65 @@
 #include <unistd.h>
 #endif
 
+/*  The socket descriptor is composed of the index of the socket's slot in
+    the socket table and of the generation of the slot. The generation is
+    incremented each time the slot is vacated so that the descriptor of
+    a closed socket doesn't refer to a socket that reuses the slot later on.
+    The generation is 11 bits long, which keeps the descriptors positive. */
+#define NN_SOCKTAB_INDEX_BITS 20
+#define NN_SOCKTAB_INDEX_MASK ((1 << NN_SOCKTAB_INDEX_BITS) - 1)
+#define NN_SOCKTAB_GEN_MASK 0x7ff
+
 /*  Max number of concurrent SP sockets. */
-#define NN_MAX_SOCKETS 512
+#define NN_MAX_SOCKETS (1 << NN_SOCKTAB_INDEX_BITS)
 
-/*  To save some space, list of unused socket slots uses uint16_t integers to
-    refer to individual sockets. If there's a need to more that 0x10000 sockets,
-    the type should be changed to uint32_t or int. */
-CT_ASSERT (NN_MAX_SOCKETS <= 0x10000);
+/*  The socket table is allocated in segments of this many slots. */
+#define NN_SOCKTAB_SEGMENT 256
+#define NN_SOCKTAB_SEGMENTS (NN_MAX_SOCKETS / NN_SOCKTAB_SEGMENT)
 
 /*  This check is performed at the beginning of each socket operation to make
-    sure that the library was initialised, the socket actually exists, and is
-    a valid socket index. */
+    sure that the library was initialised and the socket actually exists.
+    It stores the socket into the 'sock' variable. */
 #define NN_BASIC_CHECKS \
-    if (nn_slow (s < 0 || s > NN_MAX_SOCKETS)) {\
-        errno = EBADF;\
-        return -1;\
-        }\
-    if (nn_slow (!self.socks || !self.socks [s])) {\
+    sock = nn_global_getsock (s);\
+    if (nn_slow (!sock)) {\
         errno = EBADF;\
         return -1;\
     }
 
 #define NN_CTX_FLAG_ZOMBIE 1
 
+/*  Maximal number of messages nn_sendmmsg and nn_recvmmsg pass to the socket
+    at once. */
+#define NN_GLOBAL_BATCH 64
+
 #define NN_GLOBAL_SRC_STAT_TIMER 1
 
 #define NN_GLOBAL_STATE_IDLE           1
 #define NN_GLOBAL_STATE_ACTIVE         2
 #define NN_GLOBAL_STATE_STOPPING_TIMER 3
 
+/*  A slot in the global table of sockets. */
+struct nn_global_slot {
+    struct nn_sock *volatile sock;
+    volatile uint32_t gen;
+};
+
 struct nn_global {
 
-    /*  The global table of existing sockets. The descriptor representing
-        the socket is the index to this table. This pointer is also used to
-        find out whether context is initialised. If it is NULL, context is
-        uninitialised. */
-    struct nn_sock **socks;
+    /*  The global table of existing sockets. It is allocated one segment at
+        a time, as the number of sockets grows. Segments are never moved or
+        deallocated while the library is initialised, so the sockets can be
+        looked up without locking. Any thread that got hold of a descriptor
+        got it after the socket's slot was filled in. */
+    struct nn_global_slot *volatile segments [NN_SOCKTAB_SEGMENTS];
 
-    /*  Stack of unused file descriptors. */
-    uint16_t *unused;
+    /*  Number of slots in the allocated segments. */
+    uint32_t nslots;
+
+    /*  Stack of unused slots. This pointer is also used to find out whether
+        context is initialised. If it is NULL, context is uninitialised. */
+    uint32_t *unused;
 
     /*  Number of actual open sockets in the socket table. */
     size_t nsocks;
@@ -177,12 +198,18 @@ static void nn_global_add_socktype (struct nn_socktype *socktype);
 
 /*  Private function that unifies nn_bind and nn_connect functionality.
     It returns the ID of the newly created endpoint. */
-static int nn_global_create_ep (int s, const char *addr, int bind);
+static int nn_global_create_ep (struct nn_sock *sock, const char *addr,
+    int bind);
 
 /*  Private socket creator which doesn't initialize global state and
     does no locking by itself */
 static int nn_global_create_socket (int domain, int protocol);
 
+/*  Socket table. */
+static int nn_global_grow (void);
+static struct nn_global_slot *nn_global_slot (uint32_t index);
+static struct nn_sock *nn_global_getsock (int s);
+
 /*  FSM callbacks  */
 static void nn_global_handler (struct nn_fsm *self,
     int src, int type, void *srcptr);
@@ -202,7 +229,6 @@ const char *nn_strerror (int errnum)
 
 static void nn_global_init (void)
 {
-    int i;
     char *envvar;
     int rc;
     char *addr;
@@ -212,7 +238,7 @@ static void nn_global_init (void)
 #endif
 
     /*  Check whether the library was already initialised. If so, do nothing. */
-    if (self.socks)
+    if (self.unused)
         return;
 
     /*  On Windows, initialise the socket library. */
@@ -229,13 +255,12 @@ static void nn_global_init (void)
     /*  Seed the pseudo-random number generator. */
     nn_random_seed ();
 
-    /*  Allocate the global table of SP sockets. */
-    self.socks = nn_alloc ((sizeof (struct nn_sock*) * NN_MAX_SOCKETS) +
-        (sizeof (uint16_t) * NN_MAX_SOCKETS), "socket table");
-    alloc_assert (self.socks);
-    for (i = 0; i != NN_MAX_SOCKETS; ++i)
-        self.socks [i] = NULL;
+    /*  Allocate the first segment of the global table of SP sockets. */
+    self.nslots = 0;
     self.nsocks = 0;
+    self.unused = NULL;
+    rc = nn_global_grow ();
+    errnum_assert (rc == 0, -rc);
     self.flags = 0;
 
     /*  Print connection and accepting errors to the stderr  */
@@ -247,12 +272,6 @@ static void nn_global_init (void)
     envvar = getenv("NN_PRINT_STATISTICS");
     self.print_statistics = envvar && *envvar;
 
-    /*  Allocate the stack of unused file descriptors. */
-    self.unused = (uint16_t*) (self.socks + NN_MAX_SOCKETS);
-    alloc_assert (self.unused);
-    for (i = 0; i != NN_MAX_SOCKETS; ++i)
-        self.unused [i] = NN_MAX_SOCKETS - i - 1;
-
     /*  Initialise other parts of the global state. */
     nn_list_init (&self.transports);
     nn_list_init (&self.socktypes);
@@ -286,8 +305,10 @@ static void nn_global_init (void)
     nn_global_add_socktype (nn_bus_socktype);
     nn_global_add_socktype (nn_xbus_socktype);
 
-    /*  Start the worker threads. */
-    nn_pool_init (&self.pool);
+    /*  Start the worker threads. By default there's one worker thread
+        per CPU core. */
+    envvar = getenv ("NN_WORKER_THREADS");
+    nn_pool_init (&self.pool, envvar ? atoi (envvar) : 0);
 
     /*  Start FSM  */
     nn_fsm_init_root (&self.fsm, nn_global_handler, nn_global_shutdown,
@@ -304,7 +325,8 @@ static void nn_global_init (void)
         self.statistics_socket = nn_global_create_socket (AF_SP, NN_PUB);
         errno_assert (self.statistics_socket >= 0);
 
-        rc = nn_global_create_ep (self.statistics_socket, addr, 0);
+        rc = nn_global_create_ep (nn_global_getsock (self.statistics_socket),
+            addr, 0);
         errno_assert (rc >= 0);
     } else {
         self.statistics_socket = -1;
@@ -345,11 +367,12 @@ static void nn_global_term (void)
 #if defined NN_HAVE_WINDOWS
     int rc;
 #endif
+    uint32_t i;
     struct nn_list_item *it;
     struct nn_transport *tp;
 
     /*  If there are no sockets remaining, uninitialise the global context. */
-    nn_assert (self.socks);
+    nn_assert (self.unused);
     if (self.nsocks > 0)
         return;
 
@@ -373,6 +396,11 @@ static void nn_global_term (void)
         nn_list_erase (&self.transports, it);
     }
 
+    /*  Give the memory cached by the chunk pool back to the system. The
+        worker threads are gone by now and their caches were handed over
+        to the pool's depot. */
+    nn_chunkpool_drain ();
+
     /*  For now there's nothing to deallocate about socket types, however,
         let's remove them from the list anyway. */
     while (!nn_list_empty (&self.socktypes))
@@ -381,10 +409,15 @@ static void nn_global_term (void)
     /*  Final deallocation of the nn_global object itself. */
     nn_list_term (&self.socktypes);
     nn_list_term (&self.transports);
-    nn_free (self.socks);
+    for (i = 0; i != self.nslots / NN_SOCKTAB_SEGMENT; ++i) {
+        nn_free (self.segments [i]);
+        self.segments [i] = NULL;
+    }
+    self.nslots = 0;
+    nn_free (self.unused);
 
     /*  This marks the global state as uninitialised. */
-    self.socks = NULL;
+    self.unused = NULL;
 
     /*  Shut down the memory allocation subsystem. */
     nn_alloc_term ();
@@ -398,7 +431,8 @@ static void nn_global_term (void)
 
 void nn_term (void)
 {
-    int i;
+    uint32_t i;
+    struct nn_sock *sock;
 
     nn_glock_lock ();
 
@@ -406,10 +440,12 @@ void nn_term (void)
     self.flags |= NN_CTX_FLAG_ZOMBIE;
 
     /*  Mark all open sockets as terminating. */
-    if (self.socks && self.nsocks) {
-        for (i = 0; i != NN_MAX_SOCKETS; ++i)
-            if (self.socks [i])
-                nn_sock_zombify (self.socks [i]);
+    if (self.unused && self.nsocks) {
+        for (i = 0; i != self.nslots; ++i) {
+            sock = nn_global_slot (i)->sock;
+            if (sock)
+                nn_sock_zombify (sock);
+        }
     }
 
     nn_glock_unlock ();
@@ -489,10 +525,69 @@ struct nn_cmsghdr *nn_cmsg_nxthdr_ (const struct nn_msghdr *mhdr,
     return next;
 }
 
+static struct nn_global_slot *nn_global_slot (uint32_t index)
+{
+    return &self.segments [index / NN_SOCKTAB_SEGMENT]
+        [index % NN_SOCKTAB_SEGMENT];
+}
+
+static struct nn_sock *nn_global_getsock (int s)
+{
+    uint32_t index;
+    struct nn_global_slot *segment;
+    struct nn_global_slot *slot;
+    struct nn_sock *sock;
+
+    if (nn_slow (s < 0))
+        return NULL;
+    index = (uint32_t) s & NN_SOCKTAB_INDEX_MASK;
+    segment = self.segments [index / NN_SOCKTAB_SEGMENT];
+    if (nn_slow (!segment))
+        return NULL;
+    slot = &segment [index % NN_SOCKTAB_SEGMENT];
+    sock = slot->sock;
+    if (nn_slow (!sock ||
+          slot->gen != ((uint32_t) s >> NN_SOCKTAB_INDEX_BITS)))
+        return NULL;
+    return sock;
+}
+
+static int nn_global_grow (void)
+{
+    uint32_t i;
+    struct nn_global_slot *segment;
+
+    /*  The function is called with nn_glock held and with no unused slots
+        remaining. */
+    nn_assert (self.nsocks == self.nslots);
+    if (nn_slow (self.nslots == NN_MAX_SOCKETS))
+        return -EMFILE;
+
+    segment = nn_alloc (sizeof (struct nn_global_slot) * NN_SOCKTAB_SEGMENT,
+        "socket table");
+    alloc_assert (segment);
+    for (i = 0; i != NN_SOCKTAB_SEGMENT; ++i) {
+        segment [i].sock = NULL;
+        segment [i].gen = 0;
+    }
+    self.unused = nn_realloc (self.unused,
+        sizeof (uint32_t) * (self.nslots + NN_SOCKTAB_SEGMENT));
+    alloc_assert (self.unused);
+
+    /*  Lowest slots are used first. */
+    for (i = 0; i != NN_SOCKTAB_SEGMENT; ++i)
+        self.unused [i] = self.nslots + NN_SOCKTAB_SEGMENT - i - 1;
+    self.segments [self.nslots / NN_SOCKTAB_SEGMENT] = segment;
+    self.nslots += NN_SOCKTAB_SEGMENT;
+    return 0;
+}
+
 int nn_global_create_socket (int domain, int protocol)
 {
     int rc;
     int s;
+    uint32_t index;
+    struct nn_global_slot *slot;
     struct nn_list_item *it;
     struct nn_socktype *socktype;
     struct nn_sock *sock;
@@ -503,13 +598,17 @@ int nn_global_create_socket (int domain, int protocol)
         return -EAFNOSUPPORT;
     }
 
-    /*  If socket limit was reached, report error. */
-    if (nn_slow (self.nsocks >= NN_MAX_SOCKETS)) {
-        return -EMFILE;
+    /*  If the socket table is full, extend it. */
+    if (nn_slow (self.nsocks == self.nslots)) {
+        rc = nn_global_grow ();
+        if (nn_slow (rc < 0))
+            return rc;
     }
 
     /*  Find an empty socket slot. */
-    s = self.unused [NN_MAX_SOCKETS - self.nsocks - 1];
+    index = self.unused [self.nslots - self.nsocks - 1];
+    slot = nn_global_slot (index);
+    s = (int) (index | (slot->gen << NN_SOCKTAB_INDEX_BITS));
 
     /*  Find the appropriate socket type. */
     for (it = nn_list_begin (&self.socktypes);
@@ -522,11 +621,13 @@ int nn_global_create_socket (int domain, int protocol)
             sock = nn_alloc (sizeof (struct nn_sock), "sock");
             alloc_assert (sock);
             rc = nn_sock_init (sock, socktype, s);
-            if (rc < 0)
+            if (rc < 0) {
+                nn_free (sock);
                 return rc;
+            }
 
             /*  Adjust the global socket table. */
-            self.socks [s] = sock;
+            slot->sock = sock;
             ++self.nsocks;
             return s;
         }
@@ -568,6 +669,9 @@ int nn_socket (int domain, int protocol)
 int nn_close (int s)
 {
     int rc;
+    uint32_t index;
+    struct nn_global_slot *slot;
+    struct nn_sock *sock;
 
     NN_BASIC_CHECKS;
 
@@ -576,7 +680,7 @@ int nn_close (int s)
     nn_glock_lock ();
 
     /*  Deallocate the socket object. */
-    rc = nn_sock_term (self.socks [s]);
+    rc = nn_sock_term (sock);
     if (nn_slow (rc == -EINTR)) {
         nn_glock_unlock ();
         errno = EINTR;
@@ -585,9 +689,12 @@ int nn_close (int s)
 
     /*  Remove the socket from the socket table, add it to unused socket
         table. */
-    nn_free (self.socks [s]);
-    self.socks [s] = NULL;
-    self.unused [NN_MAX_SOCKETS - self.nsocks] = s;
+    index = (uint32_t) s & NN_SOCKTAB_INDEX_MASK;
+    slot = nn_global_slot (index);
+    slot->sock = NULL;
+    slot->gen = (slot->gen + 1) & NN_SOCKTAB_GEN_MASK;
+    nn_free (sock);
+    self.unused [self.nslots - self.nsocks] = index;
     --self.nsocks;
 
     /*  Destroy the global context if there's no socket remaining. */
@@ -602,6 +709,7 @@ int nn_setsockopt (int s, int level, int option, const void *optval,
     size_t optvallen)
 {
     int rc;
+    struct nn_sock *sock;
 
     NN_BASIC_CHECKS;
 
@@ -610,7 +718,7 @@ int nn_setsockopt (int s, int level, int option, const void *optval,
         return -1;
     }
 
-    rc = nn_sock_setopt (self.socks [s], level, option, optval, optvallen);
+    rc = nn_sock_setopt (sock, level, option, optval, optvallen);
     if (nn_slow (rc < 0)) {
         errno = -rc;
         return -1;
@@ -624,6 +732,7 @@ int nn_getsockopt (int s, int level, int option, void *optval,
     size_t *optvallen)
 {
     int rc;
+    struct nn_sock *sock;
 
     NN_BASIC_CHECKS;
 
@@ -632,7 +741,7 @@ int nn_getsockopt (int s, int level, int option, void *optval,
         return -1;
     }
 
-    rc = nn_sock_getopt (self.socks [s], level, option, optval, optvallen);
+    rc = nn_sock_getopt (sock, level, option, optval, optvallen);
     if (nn_slow (rc < 0)) {
         errno = -rc;
         return -1;
@@ -645,11 +754,13 @@ int nn_getsockopt (int s, int level, int option, void *optval,
 int nn_bind (int s, const char *addr)
 {
     int rc;
+    struct nn_sock *sock;
+
     NN_BASIC_CHECKS;
     
 
     nn_glock_lock();
-    rc = nn_global_create_ep (s, addr, 1);
+    rc = nn_global_create_ep (sock, addr, 1);
     nn_glock_unlock();
     if (rc < 0) {
         errno = -rc;
@@ -662,11 +773,12 @@ int nn_bind (int s, const char *addr)
 int nn_connect (int s, const char *addr)
 {
     int rc;
+    struct nn_sock *sock;
 
     NN_BASIC_CHECKS;
 
     nn_glock_lock();
-    rc = nn_global_create_ep (s, addr, 0);
+    rc = nn_global_create_ep (sock, addr, 0);
     nn_glock_unlock();
     if (rc < 0) {
         errno = -rc;
@@ -679,10 +791,11 @@ int nn_connect (int s, const char *addr)
 int nn_shutdown (int s, int how)
 {
     int rc;
+    struct nn_sock *sock;
 
     NN_BASIC_CHECKS;
 
-    rc = nn_sock_rm_ep (self.socks [s], how);
+    rc = nn_sock_rm_ep (sock, how);
     if (nn_slow (rc < 0)) {
         errno = -rc;
         return -1;
@@ -724,39 +837,69 @@ int nn_recv (int s, void *buf, size_t len, int flags)
     return nn_recvmsg (s, &hdr, flags);
 }
 
-int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
+/*  Builds a message from the header supplied by the user. 'copied' is set
+    if the user-supplied chunks were copied into the message and have to be
+    deallocated once it is sent. Returns the size of the payload or
+    a negative error code. */
+static int nn_global_msg_init (struct nn_sock *sock,
+    const struct nn_msghdr *msghdr, struct nn_msg *msg, int *copied)
 {
-    int rc;
     size_t sz;
     size_t spsz;
     int i;
     struct nn_iovec *iov;
-    struct nn_msg msg;
     void *chunk;
-    int nnmsg;
+    void *chunks [NN_MSG_MAXPARTS];
+    int nchunks;
     struct nn_cmsghdr *cmsg;
 
-    NN_BASIC_CHECKS;
+    if (nn_slow (!msghdr))
+        return -EINVAL;
 
-    if (nn_slow (!msghdr)) {
-        errno = EINVAL;
-        return -1;
-    }
-
-    if (nn_slow (msghdr->msg_iovlen < 0)) {
-        errno = EMSGSIZE;
-        return -1;
-    }
+    if (nn_slow (msghdr->msg_iovlen < 0))
+        return -EMSGSIZE;
 
+    *copied = 0;
     if (msghdr->msg_iovlen == 1 && msghdr->msg_iov [0].iov_len == NN_MSG) {
         chunk = *(void**) msghdr->msg_iov [0].iov_base;
-        if (nn_slow (chunk == NULL)) {
-            errno = EFAULT;
-            return -1;
-        }
+        if (nn_slow (chunk == NULL))
+            return -EFAULT;
         sz = nn_chunk_size (chunk);
-        nn_msg_init_chunk (&msg, chunk);
-        nnmsg = 1;
+        nn_msg_init_chunk (msg, chunk);
+    }
+    else if (msghdr->msg_iovlen > 1 && msghdr->msg_iov [0].iov_len == NN_MSG) {
+
+        /*  The payload is composed of multiple pre-allocated chunks. */
+        if (nn_slow (msghdr->msg_iovlen > NN_MSG_MAXPARTS))
+            return -EMSGSIZE;
+        nchunks = msghdr->msg_iovlen;
+        sz = 0;
+        for (i = 0; i != nchunks; ++i) {
+            iov = &msghdr->msg_iov [i];
+            if (nn_slow (iov->iov_len != NN_MSG))
+                return -EINVAL;
+            chunks [i] = *(void**) iov->iov_base;
+            if (nn_slow (chunks [i] == NULL))
+                return -EFAULT;
+            sz += nn_chunk_size (chunks [i]);
+        }
+
+        /*  Pass the chunks down the stack as they are so that the transport
+            can write them directly to the network. Socket types that inspect
+            the payload need it in a single chunk though. In such case copy
+            the chunks and deallocate them once the message is sent. */
+        if (sock->socktype->flags & NN_SOCKTYPE_FLAG_FLATSEND) {
+            nn_msg_init (msg, sz);
+            sz = 0;
+            for (i = 0; i != nchunks; ++i) {
+                memcpy (((uint8_t*) nn_chunkref_data (&msg->body)) + sz,
+                    chunks [i], nn_chunk_size (chunks [i]));
+                sz += nn_chunk_size (chunks [i]);
+            }
+            *copied = 1;
+        }
+        else
+            nn_msg_init_parts (msg, chunks, nchunks);
     }
     else {
 
@@ -764,32 +907,24 @@ int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
         sz = 0;
         for (i = 0; i != msghdr->msg_iovlen; ++i) {
             iov = &msghdr->msg_iov [i];
-            if (nn_slow (iov->iov_len == NN_MSG)) {
-               errno = EINVAL;
-               return -1;
-            }
-            if (nn_slow (!iov->iov_base && iov->iov_len)) {
-                errno = EFAULT;
-                return -1;
-            }
-            if (nn_slow (sz + iov->iov_len < sz)) {
-                errno = EINVAL;
-                return -1;
-            }
+            if (nn_slow (iov->iov_len == NN_MSG))
+               return -EINVAL;
+            if (nn_slow (!iov->iov_base && iov->iov_len))
+                return -EFAULT;
+            if (nn_slow (sz + iov->iov_len < sz))
+                return -EINVAL;
             sz += iov->iov_len;
         }
 
         /*  Create a message object from the supplied scatter array. */
-        nn_msg_init (&msg, sz);
+        nn_msg_init (msg, sz);
         sz = 0;
         for (i = 0; i != msghdr->msg_iovlen; ++i) {
             iov = &msghdr->msg_iov [i];
-            memcpy (((uint8_t*) nn_chunkref_data (&msg.body)) + sz,
+            memcpy (((uint8_t*) nn_chunkref_data (&msg->body)) + sz,
                 iov->iov_base, iov->iov_len);
             sz += iov->iov_len;
         }
-
-        nnmsg = 0;
     }
 
     /*  Add ancillary data to the message. */
@@ -799,13 +934,13 @@ int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
         /*  TODO: SP_HDR should not be copied here! */
         if (msghdr->msg_controllen == NN_MSG) {
             chunk = *((void**) msghdr->msg_control);
-            nn_chunkref_term (&msg.hdrs);
-            nn_chunkref_init_chunk (&msg.hdrs, chunk);
+            nn_chunkref_term (&msg->hdrs);
+            nn_chunkref_init_chunk (&msg->hdrs, chunk);
         }
         else {
-            nn_chunkref_term (&msg.hdrs);
-            nn_chunkref_init (&msg.hdrs, msghdr->msg_controllen);
-            memcpy (nn_chunkref_data (&msg.hdrs),
+            nn_chunkref_term (&msg->hdrs);
+            nn_chunkref_init (&msg->hdrs, msghdr->msg_controllen);
+            memcpy (nn_chunkref_data (&msg->hdrs),
                 msghdr->msg_control, msghdr->msg_controllen);
         }
 
@@ -814,10 +949,10 @@ int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
         while (cmsg) {
             if (cmsg->cmsg_level == PROTO_SP && cmsg->cmsg_type == SP_HDR) {
                 /*  Copy body of SP_HDR property into 'sphdr'. */
-                nn_chunkref_term (&msg.sphdr);
+                nn_chunkref_term (&msg->sphdr);
                 spsz = cmsg->cmsg_len - NN_CMSG_SPACE (0);
-                nn_chunkref_init (&msg.sphdr, spsz);
-                memcpy (nn_chunkref_data (&msg.sphdr),
+                nn_chunkref_init (&msg->sphdr, spsz);
+                memcpy (nn_chunkref_data (&msg->sphdr),
                     NN_CMSG_DATA (cmsg), spsz);
                 break;
             }
@@ -825,31 +960,44 @@ int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
         }
     }
 
-    /*  Send it further down the stack. */
-    rc = nn_sock_send (self.socks [s], &msg, flags);
-    if (nn_slow (rc < 0)) {
+    return (int) sz;
+}
+
+/*  Disposes of a message built by nn_global_msg_init once it was sent
+    ('sent' is 1) or if sending it failed ('sent' is 0). In the latter case
+    the user-supplied buffers remain owned by the user. */
+static void nn_global_msg_done (const struct nn_msghdr *msghdr,
+    struct nn_msg *msg, int copied, int sent)
+{
+    int i;
 
-        /*  If we are dealing with user-supplied buffer, detach it from
-            the message object. */
-        if (nnmsg)
-            nn_chunkref_init (&msg.body, 0);
+    if (sent) {
 
-        nn_msg_term (&msg);
-        errno = -rc;
-        return -1;
+        /*  The user-supplied chunks were copied into the message. */
+        if (copied)
+            for (i = 0; i != msghdr->msg_iovlen; ++i)
+                nn_chunk_free (*(void**) msghdr->msg_iov [i].iov_base);
+        return;
     }
 
-    /*  Adjust the statistics. */
-    nn_sock_stat_increment (self.socks [s], NN_STAT_MESSAGES_SENT, 1);
-    nn_sock_stat_increment (self.socks [s], NN_STAT_BYTES_SENT, sz);
+    /*  If we are dealing with user-supplied buffers, detach them from
+        the message object. */
+    if (!copied && msghdr->msg_iovlen >= 1 &&
+          msghdr->msg_iov [0].iov_len == NN_MSG) {
+        nn_chunkref_init (&msg->body, 0);
+        nn_chunkref_term (&msg->parts);
+        nn_chunkref_init (&msg->parts, 0);
+    }
 
-    return (int) sz;
+    nn_msg_term (msg);
 }
 
-int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
+/*  Moves a received message to the header supplied by the user. The message
+    is deallocated in the process. Returns the size of the payload or
+    a negative error code. */
+static int nn_global_msg_recv (struct nn_msghdr *msghdr, struct nn_msg *msg)
 {
     int rc;
-    struct nn_msg msg;
     uint8_t *data;
     size_t sz;
     int i;
@@ -862,41 +1010,21 @@ int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
     size_t sptotalsz;
     struct nn_cmsghdr *chdr;
 
-    NN_BASIC_CHECKS;
-
-    if (nn_slow (!msghdr)) {
-        errno = EINVAL;
-        return -1;
-    }
-
-    if (nn_slow (msghdr->msg_iovlen < 0)) {
-        errno = EMSGSIZE;
-        return -1;
-    }
-
-    /*  Get a message. */
-    rc = nn_sock_recv (self.socks [s], &msg, flags);
-    if (nn_slow (rc < 0)) {
-        errno = -rc;
-        return -1;
-    }
-
     if (msghdr->msg_iovlen == 1 && msghdr->msg_iov [0].iov_len == NN_MSG) {
-        chunk = nn_chunkref_getchunk (&msg.body);
+        chunk = nn_chunkref_getchunk (&msg->body);
         *(void**) (msghdr->msg_iov [0].iov_base) = chunk;
         sz = nn_chunk_size (chunk);
     }
     else {
 
         /*  Copy the message content into the supplied gather array. */
-        data = nn_chunkref_data (&msg.body);
-        sz = nn_chunkref_size (&msg.body);
+        data = nn_chunkref_data (&msg->body);
+        sz = nn_chunkref_size (&msg->body);
         for (i = 0; i != msghdr->msg_iovlen; ++i) {
             iov = &msghdr->msg_iov [i];
             if (nn_slow (iov->iov_len == NN_MSG)) {
-                nn_msg_term (&msg);
-                errno = EINVAL;
-                return -1;
+                nn_msg_term (msg);
+                return -EINVAL;
             }
             if (iov->iov_len > sz) {
                 memcpy (iov->iov_base, data, sz);
@@ -906,20 +1034,20 @@ int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
             data += iov->iov_len;
             sz -= iov->iov_len;
         }
-        sz = nn_chunkref_size (&msg.body);
+        sz = nn_chunkref_size (&msg->body);
     }
 
     /*  Retrieve the ancillary data from the message. */
     if (msghdr->msg_control) {
 
-        spsz = nn_chunkref_size (&msg.sphdr);
+        spsz = nn_chunkref_size (&msg->sphdr);
         sptotalsz = NN_CMSG_SPACE (spsz);
-        ctrlsz = sptotalsz + nn_chunkref_size (&msg.hdrs);
+        ctrlsz = sptotalsz + nn_chunkref_size (&msg->hdrs);
 
         if (msghdr->msg_controllen == NN_MSG) {
 
             /* Allocate the buffer. */
-            rc = nn_chunk_alloc (ctrlsz, 0, &ctrl);
+            rc = nn_chunk_alloc (ctrlsz, NN_CHUNK_POOLED, &ctrl);
             errnum_assert (rc == 0, -rc);
 
             /* Set output parameters. */
@@ -941,23 +1069,226 @@ int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
             chdr->cmsg_len = sptotalsz;
             chdr->cmsg_level = PROTO_SP;
             chdr->cmsg_type = SP_HDR;
-            memcpy (chdr + 1, nn_chunkref_data (&msg.sphdr), spsz);
+            memcpy (chdr + 1, nn_chunkref_data (&msg->sphdr), spsz);
 
             /*  Fill in as many remaining properties as possible.
                 Truncate the trailing properties if necessary. */
-            hdrssz = nn_chunkref_size (&msg.hdrs);
+            hdrssz = nn_chunkref_size (&msg->hdrs);
             if (hdrssz > ctrlsz - sptotalsz)
                 hdrssz = ctrlsz - sptotalsz;
             memcpy (((char*) ctrl) + sptotalsz,
-                nn_chunkref_data (&msg.hdrs), hdrssz);
+                nn_chunkref_data (&msg->hdrs), hdrssz);
         }
     }
 
-    nn_msg_term (&msg);
+    nn_msg_term (msg);
 
     return (int) sz;
 }
 
+/*  Checks whether a received message can be stored to the header supplied
+    by the user, so that no message is lost half way through a batch. */
+static int nn_global_check_recvhdr (const struct nn_msghdr *msghdr)
+{
+    int i;
+
+    if (nn_slow (!msghdr))
+        return -EINVAL;
+    if (nn_slow (msghdr->msg_iovlen < 0))
+        return -EMSGSIZE;
+    if (msghdr->msg_iovlen == 1 && msghdr->msg_iov [0].iov_len == NN_MSG)
+        return 0;
+    for (i = 0; i != msghdr->msg_iovlen; ++i)
+        if (nn_slow (msghdr->msg_iov [i].iov_len == NN_MSG))
+            return -EINVAL;
+    return 0;
+}
+
+int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags)
+{
+    int rc;
+    int sz;
+    int copied;
+    struct nn_msg msg;
+    struct nn_sock *sock;
+
+    NN_BASIC_CHECKS;
+
+    rc = nn_global_msg_init (sock, msghdr, &msg, &copied);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+    sz = rc;
+
+    /*  Send it further down the stack. */
+    rc = nn_sock_send (sock, &msg, flags);
+    if (nn_slow (rc < 0)) {
+        nn_global_msg_done (msghdr, &msg, copied, 0);
+        errno = -rc;
+        return -1;
+    }
+    nn_global_msg_done (msghdr, &msg, copied, 1);
+
+    /*  Adjust the statistics. */
+    nn_sock_stat_increment (sock, NN_STAT_MESSAGES_SENT, 1);
+    nn_sock_stat_increment (sock, NN_STAT_BYTES_SENT, sz);
+
+    return sz;
+}
+
+int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags)
+{
+    int rc;
+    struct nn_msg msg;
+    struct nn_sock *sock;
+
+    NN_BASIC_CHECKS;
+
+    if (nn_slow (!msghdr)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (nn_slow (msghdr->msg_iovlen < 0)) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    /*  Get a message. */
+    rc = nn_sock_recv (sock, &msg, flags);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+
+    rc = nn_global_msg_recv (msghdr, &msg);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+
+    return rc;
+}
+
+int nn_sendmmsg (int s, struct nn_mmsghdr *msgvec, int vlen, int flags)
+{
+    int rc;
+    int i;
+    int n;
+    int sent;
+    int done;
+    int copied [NN_GLOBAL_BATCH];
+    struct nn_msg msgs [NN_GLOBAL_BATCH];
+    size_t sz;
+    struct nn_sock *sock;
+
+    NN_BASIC_CHECKS;
+
+    if (nn_slow (!msgvec || vlen < 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (nn_slow (vlen == 0))
+        return 0;
+
+    /*  The messages are passed to the socket in batches. Only the first
+        batch may block, the rest are sent as long as the socket accepts them
+        without blocking. */
+    done = 0;
+    sz = 0;
+    while (done != vlen) {
+
+        /*  Build the batch. If one of the messages is malformed, the batch
+            stops short of it and the error is reported by the next call. */
+        for (n = 0; n != NN_GLOBAL_BATCH && done + n != vlen; ++n) {
+            rc = nn_global_msg_init (sock,
+                &msgvec [done + n].msg_hdr, &msgs [n], &copied [n]);
+            if (nn_slow (rc < 0))
+                break;
+            msgvec [done + n].msg_len = rc;
+        }
+        if (nn_slow (n == 0))
+            break;
+
+        rc = nn_sock_sendv (sock, msgs, n,
+            done ? flags | NN_DONTWAIT : flags);
+        sent = rc < 0 ? 0 : rc;
+
+        for (i = 0; i != n; ++i)
+            nn_global_msg_done (&msgvec [done + i].msg_hdr, &msgs [i],
+                copied [i], i < sent);
+        for (i = 0; i != sent; ++i)
+            sz += msgvec [done + i].msg_len;
+        done += sent;
+        if (sent != n)
+            break;
+    }
+
+    /*  If not even the first message was sent, 'rc' holds the reason. */
+    if (nn_slow (done == 0)) {
+        errno = -rc;
+        return -1;
+    }
+
+    /*  Adjust the statistics. */
+    nn_sock_stat_increment (sock, NN_STAT_MESSAGES_SENT, done);
+    nn_sock_stat_increment (sock, NN_STAT_BYTES_SENT, sz);
+
+    return done;
+}
+
+int nn_recvmmsg (int s, struct nn_mmsghdr *msgvec, int vlen, int flags)
+{
+    int rc;
+    int i;
+    int n;
+    int received;
+    int done;
+    struct nn_msg msgs [NN_GLOBAL_BATCH];
+    struct nn_sock *sock;
+
+    NN_BASIC_CHECKS;
+
+    if (nn_slow (!msgvec || vlen < 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (nn_slow (vlen == 0))
+        return 0;
+    for (i = 0; i != vlen; ++i) {
+        rc = nn_global_check_recvhdr (&msgvec [i].msg_hdr);
+        if (nn_slow (rc < 0)) {
+            errno = -rc;
+            return -1;
+        }
+    }
+
+    /*  Only the first batch may block. */
+    done = 0;
+    while (done != vlen) {
+        n = vlen - done < NN_GLOBAL_BATCH ? vlen - done : NN_GLOBAL_BATCH;
+        received = nn_sock_recvv (sock, msgs, n,
+            done ? flags | NN_DONTWAIT : flags);
+        if (nn_slow (received < 0)) {
+            if (done)
+                break;
+            errno = -received;
+            return -1;
+        }
+        for (i = 0; i != received; ++i) {
+            rc = nn_global_msg_recv (&msgvec [done + i].msg_hdr, &msgs [i]);
+            errnum_assert (rc >= 0, -rc);
+            msgvec [done + i].msg_len = rc;
+        }
+        done += received;
+        if (received != n)
+            break;
+    }
+
+    return done;
+}
+
 static void nn_global_add_transport (struct nn_transport *transport)
 {
     if (transport->init)
@@ -1121,18 +1452,27 @@ static void nn_global_submit_errors (int i, struct nn_sock *s,
 
 static void nn_global_submit_statistics ()
 {
+    uint32_t index;
     int i;
+    struct nn_global_slot *slot;
     struct nn_sock *s;
+    struct nn_chunkpool_stats poolstats;
 
     /*  TODO(tailhook)  optimized it to use nsocks and unused  */
-    for(i = 0; i < NN_MAX_SOCKETS; ++i) {
+    for (index = 0; ; ++index) {
 
         nn_glock_lock ();
-        s = self.socks [i];
+        if (index >= self.nslots) {
+            nn_glock_unlock ();
+            break;
+        }
+        slot = nn_global_slot (index);
+        s = slot->sock;
         if (!s) {
             nn_glock_unlock ();
             continue;
         }
+        i = (int) (index | (slot->gen << NN_SOCKTAB_INDEX_BITS));
         if (i == self.statistics_socket) {
             nn_glock_unlock ();
             continue;
@@ -1162,6 +1502,10 @@ static void nn_global_submit_statistics ()
             "bytes_sent", s->statistics.bytes_sent);
         nn_global_submit_counter (i, s,
             "bytes_received", s->statistics.bytes_received);
+        nn_global_submit_counter (i, s,
+            "busy_poll_hits", s->statistics.busy_poll_hits);
+        nn_global_submit_counter (i, s,
+            "busy_poll_blocks", s->statistics.busy_poll_blocks);
         nn_global_submit_level (i, s,
             "current_connections", s->statistics.current_connections);
         nn_global_submit_level (i, s,
@@ -1172,9 +1516,23 @@ static void nn_global_submit_statistics ()
             "current_ep_errors", s->statistics.current_ep_errors);
         nn_ctx_leave (&s->ctx);
     }
+
+    /*  Message buffer pool is shared by all the sockets in the process. */
+    if (self.print_statistics) {
+        nn_chunkpool_stats (&poolstats);
+        fprintf (stderr, "nanomsg: chunkpool: allocs: %llu hits: %llu "
+            "misses: %llu releases: %llu hit_rate: %.1f%%\n",
+            (long long unsigned int) poolstats.allocs,
+            (long long unsigned int) poolstats.hits,
+            (long long unsigned int) poolstats.misses,
+            (long long unsigned int) poolstats.releases,
+            poolstats.allocs ?
+            100.0 * poolstats.hits / poolstats.allocs : 0.0);
+    }
 }
 
-static int nn_global_create_ep (int s, const char *addr, int bind)
+static int nn_global_create_ep (struct nn_sock *sock, const char *addr,
+    int bind)
 {
     int rc;
     const char *proto;
@@ -1217,7 +1575,7 @@ static int nn_global_create_ep (int s, const char *addr, int bind)
     }
 
     /*  Ask the socket to create the endpoint. */
-    rc = nn_sock_add_ep (self.socks [s], tp, bind, addr);
+    rc = nn_sock_add_ep (sock, tp, bind, addr);
     return rc;
 }
 
@@ -1336,3 +1694,13 @@ static void nn_global_shutdown (struct nn_fsm *self,
 int nn_global_print_errors () {
     return self.print_errors;
 }
+
+int nn_global_isterm (void)
+{
+    int res;
+
+    nn_glock_lock ();
+    res = self.flags & NN_CTX_FLAG_ZOMBIE ? 1 : 0;
+    nn_glock_unlock ();
+    return res;
+}
@@ -30,4 +30,7 @@ struct nn_transport *nn_global_transport (int id);
 struct nn_pool *nn_global_getpool ();
 int nn_global_print_errors();
 
+/*  Returns 1 if nn_term() was already called, 0 otherwise. */
+int nn_global_isterm (void);
+
 #endif
@@ -61,6 +61,8 @@ void nn_pipebase_init (struct nn_pipebase *self,
         sizeof (struct nn_ep_options));
     nn_fsm_event_init (&self->in);
     nn_fsm_event_init (&self->out);
+    self->queued = 0;
+    self->addr = nn_ep_getaddr (epbase->ep);
 }
 
 void nn_pipebase_term (struct nn_pipebase *self)
@@ -123,6 +125,11 @@ void nn_pipebase_sent (struct nn_pipebase *self)
         nn_fsm_raise (&self->fsm, &self->out, NN_PIPE_OUT);
 }
 
+void nn_pipebase_setqueued (struct nn_pipebase *self, int queued)
+{
+    self->queued = queued;
+}
+
 void nn_pipebase_getopt (struct nn_pipebase *self, int level, int option,
     void *optval, size_t *optvallen)
 {
@@ -142,6 +149,15 @@ void nn_pipebase_getopt (struct nn_pipebase *self, int level, int option,
         case NN_IPV4ONLY:
             intval = self->options.ipv4only;
             break;
+        case NN_SNDBATCH:
+            intval = self->options.sndbatch;
+            break;
+        case NN_RCVBATCH:
+            intval = self->options.rcvbatch;
+            break;
+        case NN_RCVZEROCOPY:
+            intval = self->options.rcvzerocopy;
+            break;
 
         /*  Fallback to socket options  */
         default:
@@ -226,3 +242,13 @@ void nn_pipe_getopt (struct nn_pipe *self, int level, int option,
     nn_pipebase_getopt (pipebase, level, option, optval, optvallen);
 }
 
+int nn_pipe_queued (struct nn_pipe *self)
+{
+    return ((struct nn_pipebase*) self)->queued;
+}
+
+const char *nn_pipe_getaddr (struct nn_pipe *self)
+{
+    return ((struct nn_pipebase*) self)->addr;
+}
+
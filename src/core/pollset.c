@@ -0,0 +1,537 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../nn.h"
+
+#include "global.h"
+
+#include "../utils/alloc.h"
+#include "../utils/fast.h"
+#include "../utils/err.h"
+#include "../utils/hash.h"
+#include "../utils/list.h"
+#include "../utils/fd.h"
+#include "../utils/cont.h"
+
+#include <string.h>
+#include <errno.h>
+
+/*  A persistent pollset keeps the registered sockets between the calls to
+    nn_pollset_wait so that the NN_RCVFD and NN_SNDFD descriptors have to be
+    retrieved only once, when the socket is added. Where epoll is available
+    the descriptors are registered with the kernel as well and waiting costs
+    time proportional to the number of ready sockets rather than to the
+    number of registered sockets. Elsewhere the set is polled by nn_poll. */
+
+/*  NN_POLLIN and NN_POLLOUT, as the latter share the layout of the array
+    with the former. */
+#define NN_POLLSET_DIRS 2
+
+struct nn_pollset_item;
+
+/*  One of the efds of a registered socket. */
+struct nn_pollset_watch {
+    struct nn_pollset_item *item;
+    short event;
+    nn_fd fd;
+};
+
+struct nn_pollset_item {
+
+    /*  Registered sockets are found by socket number. */
+    struct nn_hash_item hndl;
+
+    /*  Item in the list of all registered sockets. */
+    struct nn_list_item item;
+
+    /*  Events the user is interested in. */
+    short events;
+
+    /*  Watches for NN_POLLIN and NN_POLLOUT, respectively. */
+    struct nn_pollset_watch watches [NN_POLLSET_DIRS];
+
+    /*  Position of the socket in the array passed to the ongoing
+        nn_pollset_wait, valid if 'seq' matches the pollset's sequence
+        number. Used to merge NN_POLLIN and NN_POLLOUT of the same socket
+        into a single entry. */
+    int pos;
+    uint32_t seq;
+};
+
+static int nn_pollset_getfd (int s, short event, nn_fd *fd)
+{
+    int rc;
+    size_t sz;
+
+    sz = sizeof (*fd);
+    rc = nn_getsockopt (s, NN_SOL_SOCKET,
+        event == NN_POLLIN ? NN_RCVFD : NN_SNDFD, fd, &sz);
+    if (nn_slow (rc < 0))
+        return -errno;
+    nn_assert (sz == sizeof (*fd));
+    return 0;
+}
+
+#if defined NN_USE_EPOLL
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+struct nn_pollset {
+
+    /*  The kernel pollset. */
+    int ep;
+
+    /*  Registered sockets, by socket number and all of them. */
+    struct nn_hash items;
+    struct nn_list all;
+
+    /*  Buffer for the events reported by the kernel. */
+    struct epoll_event *events;
+    int nevents;
+
+    /*  Incremented with each call to nn_pollset_wait. */
+    uint32_t seq;
+};
+
+static int nn_pollset_init (struct nn_pollset *self)
+{
+    self->ep = epoll_create (1);
+    if (nn_slow (self->ep < 0))
+        return -errno;
+    nn_hash_init (&self->items);
+    nn_list_init (&self->all);
+    self->events = NULL;
+    self->nevents = 0;
+    self->seq = 0;
+    return 0;
+}
+
+static void nn_pollset_term (struct nn_pollset *self)
+{
+    int rc;
+
+    rc = close (self->ep);
+    errno_assert (rc == 0);
+    nn_free (self->events);
+    nn_list_term (&self->all);
+    nn_hash_term (&self->items);
+}
+
+static int nn_pollset_watch (struct nn_pollset *self,
+    struct nn_pollset_watch *watch)
+{
+    int rc;
+    struct epoll_event ev;
+
+    memset (&ev, 0, sizeof (ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = watch;
+    rc = epoll_ctl (self->ep, EPOLL_CTL_ADD, watch->fd, &ev);
+    if (nn_slow (rc < 0))
+        return -errno;
+    return 0;
+}
+
+static void nn_pollset_unwatch (struct nn_pollset *self,
+    struct nn_pollset_watch *watch)
+{
+    /*  If the socket was closed in the meantime, its efd was closed as well
+        and the kernel has already dropped it from the pollset. */
+    epoll_ctl (self->ep, EPOLL_CTL_DEL, watch->fd, NULL);
+}
+
+static int nn_pollset_poll (struct nn_pollset *self, struct nn_pollfd *fds,
+    int nfds, int timeout)
+{
+    int rc;
+    int i;
+    int res;
+    struct nn_pollset_watch *watch;
+    struct nn_pollset_item *item;
+
+    /*  Each socket can be reported twice, once for each direction. As the
+        results are merged, 'nfds' events always fit into the array. */
+    if (nn_slow (self->nevents < nfds)) {
+        nn_free (self->events);
+        self->events = nn_alloc (sizeof (struct epoll_event) * nfds,
+            "pollset events");
+        alloc_assert (self->events);
+        self->nevents = nfds;
+    }
+
+    rc = epoll_wait (self->ep, self->events, nfds, timeout);
+    if (nn_slow (rc < 0))
+        return -errno;
+
+    ++self->seq;
+    res = 0;
+    for (i = 0; i != rc; ++i) {
+        watch = (struct nn_pollset_watch*) self->events [i].data.ptr;
+        item = watch->item;
+        if (item->seq != self->seq) {
+            item->seq = self->seq;
+            item->pos = res;
+            fds [res].fd = (int) item->hndl.key;
+            fds [res].events = item->events;
+            fds [res].revents = 0;
+            ++res;
+        }
+        fds [item->pos].revents |= watch->event;
+    }
+
+    return res;
+}
+
+#else
+
+struct nn_pollset {
+
+    /*  Registered sockets, by socket number and all of them. */
+    struct nn_hash items;
+    struct nn_list all;
+
+    /*  Registered sockets in the form accepted by nn_poll, along with the
+        item each entry belongs to. */
+    struct nn_pollfd *pfds;
+    struct nn_pollset_item **pitems;
+    int npfds;
+    int capacity;
+
+    /*  Where to start looking for ready sockets. If they don't all fit into
+        the array passed to nn_pollset_wait, the next call continues where
+        the previous one stopped so that no socket is starved. */
+    int next;
+
+    /*  Incremented with each call to nn_pollset_wait. */
+    uint32_t seq;
+};
+
+static int nn_pollset_init (struct nn_pollset *self)
+{
+    nn_hash_init (&self->items);
+    nn_list_init (&self->all);
+    self->pfds = NULL;
+    self->pitems = NULL;
+    self->npfds = 0;
+    self->capacity = 0;
+    self->next = 0;
+    self->seq = 0;
+    return 0;
+}
+
+static void nn_pollset_term (struct nn_pollset *self)
+{
+    nn_free (self->pitems);
+    nn_free (self->pfds);
+    nn_list_term (&self->all);
+    nn_hash_term (&self->items);
+}
+
+static int nn_pollset_watch (struct nn_pollset *self,
+    struct nn_pollset_watch *watch)
+{
+    int i;
+    struct nn_pollset_item *item;
+
+    item = watch->item;
+
+    /*  Both directions of a socket share a single entry. */
+    for (i = 0; i != NN_POLLSET_DIRS; ++i) {
+        if (&item->watches [i] != watch &&
+              item->watches [i].event != 0) {
+            self->pfds [item->pos].events |= watch->event;
+            return 0;
+        }
+    }
+
+    if (nn_slow (self->npfds == self->capacity)) {
+        self->capacity = self->capacity ? self->capacity * 2 : 16;
+        self->pfds = nn_realloc (self->pfds,
+            sizeof (struct nn_pollfd) * self->capacity);
+        alloc_assert (self->pfds);
+        self->pitems = nn_realloc (self->pitems,
+            sizeof (struct nn_pollset_item*) * self->capacity);
+        alloc_assert (self->pitems);
+    }
+    item->pos = self->npfds;
+    self->pfds [item->pos].fd = (int) item->hndl.key;
+    self->pfds [item->pos].events = watch->event;
+    self->pitems [item->pos] = item;
+    ++self->npfds;
+    return 0;
+}
+
+static void nn_pollset_unwatch (struct nn_pollset *self,
+    struct nn_pollset_watch *watch)
+{
+    struct nn_pollset_item *item;
+
+    item = watch->item;
+    self->pfds [item->pos].events &= ~watch->event;
+    if (self->pfds [item->pos].events)
+        return;
+
+    /*  Move the last entry to the vacated position. */
+    --self->npfds;
+    if (item->pos != self->npfds) {
+        self->pfds [item->pos] = self->pfds [self->npfds];
+        self->pitems [item->pos] = self->pitems [self->npfds];
+        self->pitems [item->pos]->pos = item->pos;
+    }
+}
+
+static int nn_pollset_poll (struct nn_pollset *self, struct nn_pollfd *fds,
+    int nfds, int timeout)
+{
+    int rc;
+    int i;
+    int start;
+    int pos;
+    int res;
+
+    /*  On timeout, nn_poll leaves 'revents' as they were. */
+    rc = nn_poll (self->pfds, self->npfds, timeout);
+    if (nn_slow (rc <= 0))
+        return rc < 0 ? -errno : 0;
+
+    ++self->seq;
+    res = 0;
+    start = self->next;
+    for (i = 0; i != self->npfds && res != nfds; ++i) {
+        pos = (start + i) % self->npfds;
+        if (!self->pfds [pos].revents)
+            continue;
+        fds [res].fd = self->pfds [pos].fd;
+        fds [res].events = self->pitems [pos]->events;
+        fds [res].revents = self->pfds [pos].revents;
+        ++res;
+        self->next = pos + 1;
+    }
+
+    return res;
+}
+
+#endif
+
+/*  Brings the watches of the item in line with 'events'. On failure, the
+    watches are left as they were. */
+static int nn_pollset_update (struct nn_pollset *self,
+    struct nn_pollset_item *item, short events)
+{
+    int rc;
+    int i;
+    short event;
+    struct nn_pollset_watch *watch;
+    short added;
+
+    /*  Start watching the new directions first, so that nothing has to be
+        undone except for what was added by this call. */
+    added = 0;
+    for (i = 0; i != NN_POLLSET_DIRS; ++i) {
+        event = i == 0 ? NN_POLLIN : NN_POLLOUT;
+        watch = &item->watches [i];
+        if (!(events & event) || watch->event)
+            continue;
+        rc = nn_pollset_getfd ((int) item->hndl.key, event, &watch->fd);
+        if (nn_fast (rc == 0)) {
+            watch->event = event;
+            rc = nn_pollset_watch (self, watch);
+            if (nn_slow (rc < 0))
+                watch->event = 0;
+        }
+        if (nn_slow (rc < 0)) {
+            for (i = 0; i != NN_POLLSET_DIRS; ++i) {
+                watch = &item->watches [i];
+                if (added & watch->event) {
+                    nn_pollset_unwatch (self, watch);
+                    watch->event = 0;
+                }
+            }
+            return rc;
+        }
+        added |= event;
+    }
+
+    for (i = 0; i != NN_POLLSET_DIRS; ++i) {
+        watch = &item->watches [i];
+        if (watch->event && !(events & watch->event)) {
+            nn_pollset_unwatch (self, watch);
+            watch->event = 0;
+        }
+    }
+
+    item->events = events;
+    return 0;
+}
+
+static void nn_pollset_rm (struct nn_pollset *self,
+    struct nn_pollset_item *item)
+{
+    nn_pollset_update (self, item, 0);
+    nn_list_erase (&self->all, &item->item);
+    nn_list_item_term (&item->item);
+    nn_hash_erase (&self->items, &item->hndl);
+    nn_hash_item_term (&item->hndl);
+    nn_free (item);
+}
+
+struct nn_pollset *nn_pollset_create (void)
+{
+    int rc;
+    struct nn_pollset *self;
+
+    /*  If nn_term() was already called, return ETERM. */
+    if (nn_slow (nn_global_isterm ())) {
+        errno = ETERM;
+        return NULL;
+    }
+
+    self = nn_alloc (sizeof (struct nn_pollset), "pollset");
+    if (nn_slow (!self)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    rc = nn_pollset_init (self);
+    if (nn_slow (rc < 0)) {
+        nn_free (self);
+        errno = -rc;
+        return NULL;
+    }
+    return self;
+}
+
+int nn_pollset_close (struct nn_pollset *self)
+{
+    while (!nn_list_empty (&self->all))
+        nn_pollset_rm (self, nn_cont (nn_list_begin (&self->all),
+            struct nn_pollset_item, item));
+    nn_pollset_term (self);
+    nn_free (self);
+    return 0;
+}
+
+int nn_pollset_add (struct nn_pollset *self, int s, short events)
+{
+    int rc;
+    struct nn_pollset_item *item;
+
+    if (nn_slow (s < 0)) {
+        errno = EBADF;
+        return -1;
+    }
+    if (nn_slow (events & ~(NN_POLLIN | NN_POLLOUT))) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (nn_slow (nn_hash_get (&self->items, (uint32_t) s) != NULL)) {
+        errno = EEXIST;
+        return -1;
+    }
+
+    item = nn_alloc (sizeof (struct nn_pollset_item), "pollset item");
+    alloc_assert (item);
+    nn_hash_item_init (&item->hndl);
+    item->hndl.key = (uint32_t) s;
+    item->events = 0;
+    memset (item->watches, 0, sizeof (item->watches));
+    item->watches [0].item = item;
+    item->watches [1].item = item;
+    item->pos = 0;
+    item->seq = self->seq;
+
+    rc = nn_pollset_update (self, item, events);
+    if (nn_slow (rc < 0)) {
+        nn_hash_item_term (&item->hndl);
+        nn_free (item);
+        errno = -rc;
+        return -1;
+    }
+    nn_hash_insert (&self->items, (uint32_t) s, &item->hndl);
+    nn_list_item_init (&item->item);
+    nn_list_insert (&self->all, &item->item, nn_list_end (&self->all));
+    return 0;
+}
+
+int nn_pollset_modify (struct nn_pollset *self, int s, short events)
+{
+    int rc;
+    struct nn_hash_item *hndl;
+
+    if (nn_slow (events & ~(NN_POLLIN | NN_POLLOUT))) {
+        errno = EINVAL;
+        return -1;
+    }
+    hndl = s < 0 ? NULL : nn_hash_get (&self->items, (uint32_t) s);
+    if (nn_slow (!hndl)) {
+        errno = ENOENT;
+        return -1;
+    }
+    rc = nn_pollset_update (self,
+        nn_cont (hndl, struct nn_pollset_item, hndl), events);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+    return 0;
+}
+
+int nn_pollset_remove (struct nn_pollset *self, int s)
+{
+    struct nn_hash_item *hndl;
+
+    hndl = s < 0 ? NULL : nn_hash_get (&self->items, (uint32_t) s);
+    if (nn_slow (!hndl)) {
+        errno = ENOENT;
+        return -1;
+    }
+    nn_pollset_rm (self, nn_cont (hndl, struct nn_pollset_item, hndl));
+    return 0;
+}
+
+int nn_pollset_wait (struct nn_pollset *self, struct nn_pollfd *fds,
+    int nfds, int timeout)
+{
+    int rc;
+
+    if (nn_slow (nfds <= 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    /*  If nn_term() was already called, return ETERM. nn_term() signals
+        the efds of all the sockets, so the wait below is interrupted as
+        well if the pollset has any sockets in it. */
+    if (nn_slow (nn_global_isterm ())) {
+        errno = ETERM;
+        return -1;
+    }
+    rc = nn_pollset_poll (self, fds, nfds, timeout);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+    if (nn_slow (rc > 0 && nn_global_isterm ())) {
+        errno = ETERM;
+        return -1;
+    }
+    return rc;
+}
@@ -33,9 +33,16 @@
 #include "../utils/fast.h"
 #include "../utils/alloc.h"
 #include "../utils/msg.h"
+#include "../utils/stopwatch.h"
 
 #include <limits.h>
 
+#if defined NN_HAVE_WINDOWS
+#include "../utils/win.h"
+#elif !(defined __GNUC__ && (defined __i386__ || defined __x86_64__))
+#include <sched.h>
+#endif
+
 /*  These bits specify whether individual efds are signalled or not at
     the moment. Storing this information allows us to avoid redundant signalling
     and unsignalling of the efd objects. */
@@ -56,6 +63,9 @@
 /*  Subordinated source objects. */
 #define NN_SOCK_SRC_EP 1
 
+/*  Number of busy-poll iterations between two reads of the clock. */
+#define NN_SOCK_SPIN_CHECK 64
+
 /*  Private functions. */
 static struct nn_optset *nn_sock_optset (struct nn_sock *self, int id);
 static int nn_sock_setopt_inner (struct nn_sock *self, int level,
@@ -129,6 +139,10 @@ int nn_sock_init (struct nn_sock *self, struct nn_socktype *socktype, int fd)
     self->ep_template.sndprio = 8;
     self->ep_template.rcvprio = 8;
     self->ep_template.ipv4only = 1;
+    self->ep_template.sndbatch = 0;
+    self->ep_template.rcvbatch = 65536;
+    self->ep_template.rcvzerocopy = 0;
+    self->busy_poll = 0;
 
     /* Initialize statistic entries */
     self->statistics.established_connections = 0;
@@ -143,6 +157,8 @@ int nn_sock_init (struct nn_sock *self, struct nn_socktype *socktype, int fd)
     self->statistics.messages_received = 0;
     self->statistics.bytes_sent = 0;
     self->statistics.bytes_received = 0;
+    self->statistics.busy_poll_hits = 0;
+    self->statistics.busy_poll_blocks = 0;
 
     self->statistics.current_connections = 0;
     self->statistics.inprogress_connections = 0;
@@ -344,6 +360,26 @@ static int nn_sock_setopt_inner (struct nn_sock *self, int level,
                 return -EINVAL;
             dst = &self->ep_template.ipv4only;
             break;
+        case NN_SNDBATCH:
+            if (nn_slow (val < 0))
+                return -EINVAL;
+            dst = &self->ep_template.sndbatch;
+            break;
+        case NN_RCVBATCH:
+            if (nn_slow (val <= 0))
+                return -EINVAL;
+            dst = &self->ep_template.rcvbatch;
+            break;
+        case NN_RCVZEROCOPY:
+            if (nn_slow (val != 0 && val != 1))
+                return -EINVAL;
+            dst = &self->ep_template.rcvzerocopy;
+            break;
+        case NN_BUSY_POLL:
+            if (nn_slow (val < 0))
+                return -EINVAL;
+            dst = &self->busy_poll;
+            break;
         default:
             return -ENOPROTOOPT;
         }
@@ -418,6 +454,18 @@ int nn_sock_getopt_inner (struct nn_sock *self, int level,
         case NN_IPV4ONLY:
             intval = self->ep_template.ipv4only;
             break;
+        case NN_SNDBATCH:
+            intval = self->ep_template.sndbatch;
+            break;
+        case NN_RCVBATCH:
+            intval = self->ep_template.rcvbatch;
+            break;
+        case NN_RCVZEROCOPY:
+            intval = self->ep_template.rcvzerocopy;
+            break;
+        case NN_BUSY_POLL:
+            intval = self->busy_poll;
+            break;
         case NN_SNDFD:
             if (self->socktype->flags & NN_SOCKTYPE_FLAG_NOSEND)
                 return -ENOPROTOOPT;
@@ -535,12 +583,82 @@ int nn_sock_rm_ep (struct nn_sock *self, int eid)
     return 0;
 }
 
+/*  Hints the CPU that we are in a spin-wait loop. On x86 this lets the
+    sibling hyperthread run and avoids the memory-order mis-speculation
+    penalty on loop exit; elsewhere it gives up the rest of the time slice. */
+static void nn_sock_pause (void)
+{
+#if defined __GNUC__ && (defined __i386__ || defined __x86_64__)
+    __builtin_ia32_pause ();
+#elif defined NN_HAVE_WINDOWS
+    YieldProcessor ();
+#else
+    sched_yield ();
+#endif
+}
+
+/*  Spins for at most 'busy_poll' microseconds, waiting for the socket to
+    signal 'flag'. The spin never outlasts the remaining '*timeout' (in
+    milliseconds); if nothing happens, time spent spinning is deducted from
+    it. Returns 1 if the flag was set or the socket was terminated while
+    spinning. Must be called from outside of the socket's critical section. */
+static int nn_sock_spin (struct nn_sock *self, int flag, int busy_poll,
+    int *timeout)
+{
+    struct nn_stopwatch stopwatch;
+    volatile int *flags;
+    volatile int *state;
+    uint64_t limit;
+    uint64_t elapsed;
+    int i;
+
+    flags = &self->flags;
+    state = &self->state;
+    limit = (uint64_t) busy_poll;
+    if (*timeout >= 0 && limit > (uint64_t) *timeout * 1000)
+        limit = (uint64_t) *timeout * 1000;
+
+    /*  Reading the clock costs far more than testing the flags, so do it
+        only once every NN_SOCK_SPIN_CHECK iterations. */
+    nn_stopwatch_init (&stopwatch);
+    i = 0;
+    while (1) {
+        if ((*flags & flag) || *state == NN_SOCK_STATE_ZOMBIE)
+            return 1;
+        nn_sock_pause ();
+        if (++i == NN_SOCK_SPIN_CHECK) {
+            i = 0;
+            elapsed = nn_stopwatch_term (&stopwatch);
+            if (elapsed >= limit)
+                break;
+        }
+    }
+
+    if (*timeout >= 0) {
+        elapsed /= 1000;
+        *timeout = elapsed >= (uint64_t) *timeout ?
+            0 : *timeout - (int) elapsed;
+    }
+    return 0;
+}
+
 int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
 {
     int rc;
+
+    rc = nn_sock_sendv (self, msg, 1, flags);
+    return rc < 0 ? rc : 0;
+}
+
+int nn_sock_sendv (struct nn_sock *self, struct nn_msg *msgs, int count,
+    int flags)
+{
+    int rc;
+    int done;
     uint64_t deadline;
     uint64_t now;
     int timeout;
+    int busy_poll;
 
     /*  Some sockets types cannot be used for sending messages. */
     if (nn_slow (self->socktype->flags & NN_SOCKTYPE_FLAG_NOSEND))
@@ -567,10 +685,17 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
         }
 
         /*  Try to send the message in a non-blocking way. */
-        rc = self->sockbase->vfptr->send (self->sockbase, msg);
+        rc = self->sockbase->vfptr->send (self->sockbase, msgs);
         if (nn_fast (rc == 0)) {
+
+            /*  Carry on with the rest of the messages while it's possible
+                without blocking. */
+            for (done = 1; done != count; ++done)
+                if (self->sockbase->vfptr->send (self->sockbase,
+                      msgs + done) != 0)
+                    break;
             nn_ctx_leave (&self->ctx);
-            return 0;
+            return done;
         }
         nn_assert (rc < 0);
 
@@ -589,19 +714,31 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
 
         /*  With blocking send, wait while there are new pipes available
             for sending. */
+        busy_poll = self->busy_poll;
         nn_ctx_leave (&self->ctx);
-        rc = nn_efd_wait (&self->sndfd, timeout);
-        if (nn_slow (rc == -ETIMEDOUT))
-            return -EAGAIN;
-        if (nn_slow (rc == -EINTR))
-            return -EINTR;
-        errnum_assert (rc == 0, rc);
-        nn_ctx_enter (&self->ctx);
-        /*
-         *  Double check if pipes are still available for sending
-         */
-        if (!nn_efd_wait (&self->sndfd, 0)) {
-            self->flags |= NN_SOCK_FLAG_OUT;
+
+        /*  If NN_BUSY_POLL is set, spin for a while before going to sleep. */
+        if (busy_poll > 0 &&
+              nn_sock_spin (self, NN_SOCK_FLAG_OUT, busy_poll, &timeout)) {
+            nn_ctx_enter (&self->ctx);
+            nn_sock_stat_increment (self, NN_STAT_BUSY_POLL_HITS, 1);
+        }
+        else {
+            rc = nn_efd_wait (&self->sndfd, timeout);
+            if (nn_slow (rc == -ETIMEDOUT))
+                return -EAGAIN;
+            if (nn_slow (rc == -EINTR))
+                return -EINTR;
+            errnum_assert (rc == 0, rc);
+            nn_ctx_enter (&self->ctx);
+            if (busy_poll > 0)
+                nn_sock_stat_increment (self, NN_STAT_BUSY_POLL_BLOCKS, 1);
+            /*
+             *  Double check if pipes are still available for sending
+             */
+            if (!nn_efd_wait (&self->sndfd, 0)) {
+                self->flags |= NN_SOCK_FLAG_OUT;
+            }
         }
 
         /*  If needed, re-compute the timeout to reflect the time that have
@@ -616,9 +753,20 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags)
 int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
 {
     int rc;
+
+    rc = nn_sock_recvv (self, msg, 1, flags);
+    return rc < 0 ? rc : 0;
+}
+
+int nn_sock_recvv (struct nn_sock *self, struct nn_msg *msgs, int count,
+    int flags)
+{
+    int rc;
+    int done;
     uint64_t deadline;
     uint64_t now;
     int timeout;
+    int busy_poll;
 
     /*  Some sockets types cannot be used for receiving messages. */
     if (nn_slow (self->socktype->flags & NN_SOCKTYPE_FLAG_NORECV))
@@ -645,10 +793,17 @@ int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
         }
 
         /*  Try to receive the message in a non-blocking way. */
-        rc = self->sockbase->vfptr->recv (self->sockbase, msg);
+        rc = self->sockbase->vfptr->recv (self->sockbase, msgs);
         if (nn_fast (rc == 0)) {
+
+            /*  Carry on with the rest of the messages while it's possible
+                without blocking. */
+            for (done = 1; done != count; ++done)
+                if (self->sockbase->vfptr->recv (self->sockbase,
+                      msgs + done) != 0)
+                    break;
             nn_ctx_leave (&self->ctx);
-            return 0;
+            return done;
         }
         nn_assert (rc < 0);
 
@@ -667,19 +822,31 @@ int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags)
 
         /*  With blocking recv, wait while there are new pipes available
             for receiving. */
+        busy_poll = self->busy_poll;
         nn_ctx_leave (&self->ctx);
-        rc = nn_efd_wait (&self->rcvfd, timeout);
-        if (nn_slow (rc == -ETIMEDOUT))
-            return -EAGAIN;
-        if (nn_slow (rc == -EINTR))
-            return -EINTR;
-        errnum_assert (rc == 0, rc);
-        nn_ctx_enter (&self->ctx);
-        /*
-         *  Double check if pipes are still available for receiving
-         */
-        if (!nn_efd_wait (&self->rcvfd, 0)) {
-            self->flags |= NN_SOCK_FLAG_IN;
+
+        /*  If NN_BUSY_POLL is set, spin for a while before going to sleep. */
+        if (busy_poll > 0 &&
+              nn_sock_spin (self, NN_SOCK_FLAG_IN, busy_poll, &timeout)) {
+            nn_ctx_enter (&self->ctx);
+            nn_sock_stat_increment (self, NN_STAT_BUSY_POLL_HITS, 1);
+        }
+        else {
+            rc = nn_efd_wait (&self->rcvfd, timeout);
+            if (nn_slow (rc == -ETIMEDOUT))
+                return -EAGAIN;
+            if (nn_slow (rc == -EINTR))
+                return -EINTR;
+            errnum_assert (rc == 0, rc);
+            nn_ctx_enter (&self->ctx);
+            if (busy_poll > 0)
+                nn_sock_stat_increment (self, NN_STAT_BUSY_POLL_BLOCKS, 1);
+            /*
+             *  Double check if pipes are still available for receiving
+             */
+            if (!nn_efd_wait (&self->rcvfd, 0)) {
+                self->flags |= NN_SOCK_FLAG_IN;
+            }
         }
 
         /*  If needed, re-compute the timeout to reflect the time that have
@@ -1050,6 +1217,14 @@ void nn_sock_stat_increment (struct nn_sock *self, int name, int64_t increment)
             nn_assert (increment >= 0);
             self->statistics.bytes_received += increment;
             break;
+        case NN_STAT_BUSY_POLL_HITS:
+            nn_assert (increment > 0);
+            self->statistics.busy_poll_hits += increment;
+            break;
+        case NN_STAT_BUSY_POLL_BLOCKS:
+            nn_assert (increment > 0);
+            self->statistics.busy_poll_blocks += increment;
+            break;
 
         case NN_STAT_CURRENT_CONNECTIONS:
             nn_assert (increment > 0 ||
@@ -44,6 +44,8 @@ struct nn_pipe;
 #define NN_STAT_MESSAGES_RECEIVED      302
 #define NN_STAT_BYTES_SENT             303
 #define NN_STAT_BYTES_RECEIVED         304
+#define NN_STAT_BUSY_POLL_HITS         305
+#define NN_STAT_BUSY_POLL_BLOCKS       306
 
 
 struct nn_sock
@@ -86,6 +88,7 @@ struct nn_sock
     int rcvtimeo;
     int reconnect_ivl;
     int reconnect_ivl_max;
+    int busy_poll;
 
     /*  Endpoint-specific options.  */
     struct nn_ep_options ep_template;
@@ -120,6 +123,10 @@ struct nn_sock
         uint64_t bytes_sent;
         /*  Bytes recevied (sum length of data in messages received)  */
         uint64_t bytes_received;
+        /*  Blocking sends/recvs satisfied while busy-polling  */
+        uint64_t busy_poll_hits;
+        /*  Blocking sends/recvs that had to sleep after busy-polling  */
+        uint64_t busy_poll_blocks;
 
         /*****  Level-style values *****/
 
@@ -171,6 +178,19 @@ int nn_sock_send (struct nn_sock *self, struct nn_msg *msg, int flags);
 /*  Receive a message from the socket. */
 int nn_sock_recv (struct nn_sock *self, struct nn_msg *msg, int flags);
 
+/*  Send up to 'count' messages to the socket. Only the first message is
+    waited for, the rest are sent as long as it's possible without blocking.
+    Returns the number of messages sent, which the socket took ownership of,
+    or a negative error code if not even the first one could be sent. */
+int nn_sock_sendv (struct nn_sock *self, struct nn_msg *msgs, int count,
+    int flags);
+
+/*  Receive up to 'count' messages from the socket. Only the first message
+    is waited for. Returns the number of messages received, or a negative
+    error code if there was none. */
+int nn_sock_recvv (struct nn_sock *self, struct nn_msg *msgs, int count,
+    int flags);
+
 /*  Set a socket option. */
 int nn_sock_setopt (struct nn_sock *self, int level, int option,
     const void *optval, size_t optvallen);
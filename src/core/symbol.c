@@ -83,6 +83,8 @@ static const struct nn_symbol_properties sym_value_names [] = {
         NN_TYPE_NONE, NN_UNIT_NONE},
     {NN_UNIT_BOOLEAN, "NN_UNIT_BOOLEAN", NN_NS_OPTION_UNIT,
         NN_TYPE_NONE, NN_UNIT_NONE},
+    {NN_UNIT_MICROSECONDS, "NN_UNIT_MICROSECONDS", NN_NS_OPTION_UNIT,
+        NN_TYPE_NONE, NN_UNIT_NONE},
 
     {NN_VERSION_CURRENT, "NN_VERSION_CURRENT", NN_NS_VERSION,
         NN_TYPE_NONE, NN_UNIT_NONE},
@@ -160,6 +162,14 @@ static const struct nn_symbol_properties sym_value_names [] = {
         NN_TYPE_INT, NN_UNIT_BOOLEAN},
     {NN_SOCKET_NAME, "NN_SOCKET_NAME", NN_NS_SOCKET_OPTION,
         NN_TYPE_STR, NN_UNIT_NONE},
+    {NN_SNDBATCH, "NN_SNDBATCH", NN_NS_SOCKET_OPTION,
+        NN_TYPE_INT, NN_UNIT_BYTES},
+    {NN_RCVBATCH, "NN_RCVBATCH", NN_NS_SOCKET_OPTION,
+        NN_TYPE_INT, NN_UNIT_BYTES},
+    {NN_RCVZEROCOPY, "NN_RCVZEROCOPY", NN_NS_SOCKET_OPTION,
+        NN_TYPE_INT, NN_UNIT_BOOLEAN},
+    {NN_BUSY_POLL, "NN_BUSY_POLL", NN_NS_SOCKET_OPTION,
+        NN_TYPE_INT, NN_UNIT_MICROSECONDS},
 
     {NN_SUB_SUBSCRIBE, "NN_SUB_SUBSCRIBE", NN_NS_TRANSPORT_OPTION,
         NN_TYPE_STR, NN_UNIT_NONE},
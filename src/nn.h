@@ -219,6 +219,7 @@ NN_EXPORT const char *nn_symbol (int i, int *value);
 #define NN_UNIT_MILLISECONDS 2
 #define NN_UNIT_PRIORITY 3
 #define NN_UNIT_BOOLEAN 4
+#define NN_UNIT_MICROSECONDS 5
 
 /*  Structure that is returned from nn_symbol  */
 struct nn_symbol_properties {
@@ -336,6 +337,24 @@ NN_EXPORT  struct nn_cmsghdr *nn_cmsg_nxthdr_ (
 #define NN_PROTOCOL 13
 #define NN_IPV4ONLY 14
 #define NN_SOCKET_NAME 15
+#define NN_SNDBATCH 16
+#define NN_RCVBATCH 17
+#define NN_RCVZEROCOPY 18
+#define NN_BUSY_POLL 19
+
+/*  Load balancing policies. See NN_REQ_BALANCE and NN_PUSH_BALANCE.          */
+#define NN_BALANCE_ROUNDROBIN 0
+#define NN_BALANCE_LEAST 1
+#define NN_BALANCE_P2C 2
+#define NN_BALANCE_HASH 3
+
+/*  Ancillary property (NN_SOL_SOCKET level) holding the key the message is
+    routed by when NN_BALANCE_HASH policy is used.                           */
+#define NN_BALANCE_KEY 1
+
+/*  Fair queueing policies. See NN_PULL_FAIRNESS.                             */
+#define NN_FQ_ROUNDROBIN 0
+#define NN_FQ_DRR 1
 
 /*  Send/recv options.                                                        */
 #define NN_DONTWAIT 1
@@ -358,6 +377,18 @@ NN_EXPORT int nn_recv (int s, void *buf, size_t len, int flags);
 NN_EXPORT int nn_sendmsg (int s, const struct nn_msghdr *msghdr, int flags);
 NN_EXPORT int nn_recvmsg (int s, struct nn_msghdr *msghdr, int flags);
 
+/*  Batched variants of nn_sendmsg and nn_recvmsg. 'msg_len' is set to the
+    size of each message sent or received. */
+struct nn_mmsghdr {
+    struct nn_msghdr msg_hdr;
+    int msg_len;
+};
+
+NN_EXPORT int nn_sendmmsg (int s, struct nn_mmsghdr *msgvec, int vlen,
+    int flags);
+NN_EXPORT int nn_recvmmsg (int s, struct nn_mmsghdr *msgvec, int vlen,
+    int flags);
+
 /******************************************************************************/
 /*  Socket mutliplexing support.                                              */
 /******************************************************************************/
@@ -373,6 +404,18 @@ struct nn_pollfd {
 
 NN_EXPORT int nn_poll (struct nn_pollfd *fds, int nfds, int timeout);
 
+/*  Persistent set of sockets to poll. Unlike with nn_poll, sockets are
+    registered once and waiting reports only the sockets that are ready. */
+struct nn_pollset;
+
+NN_EXPORT struct nn_pollset *nn_pollset_create (void);
+NN_EXPORT int nn_pollset_close (struct nn_pollset *ps);
+NN_EXPORT int nn_pollset_add (struct nn_pollset *ps, int s, short events);
+NN_EXPORT int nn_pollset_modify (struct nn_pollset *ps, int s, short events);
+NN_EXPORT int nn_pollset_remove (struct nn_pollset *ps, int s);
+NN_EXPORT int nn_pollset_wait (struct nn_pollset *ps, struct nn_pollfd *fds,
+    int nfds, int timeout);
+
 /******************************************************************************/
 /*  Built-in support for devices.                                             */
 /******************************************************************************/
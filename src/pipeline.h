@@ -33,6 +33,9 @@ extern "C" {
 #define NN_PUSH (NN_PROTO_PIPELINE * 16 + 0)
 #define NN_PULL (NN_PROTO_PIPELINE * 16 + 1)
 
+#define NN_PUSH_BALANCE 1
+#define NN_PULL_FAIRNESS 1
+
 #ifdef __cplusplus
 }
 #endif
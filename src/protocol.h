@@ -73,6 +73,14 @@ int nn_pipe_recv (struct nn_pipe *self, struct nn_msg *msg);
 void nn_pipe_getopt (struct nn_pipe *self, int level, int option,
     void *optval, size_t *optvallen);
 
+/*  Returns the number of messages sent to the pipe that the transport has
+    not written to the network yet. Transports that don't queue messages
+    always return 0. */
+int nn_pipe_queued (struct nn_pipe *self);
+
+/*  Returns the address of the endpoint the pipe was created by. */
+const char *nn_pipe_getaddr (struct nn_pipe *self);
+
 
 /******************************************************************************/
 /*  Base class for all socket types.                                          */
@@ -168,6 +176,10 @@ void nn_sockbase_stat_increment (struct nn_sockbase *self, int name,
 /*  Specifies that the socket type can be never used to send messages. */
 #define NN_SOCKTYPE_FLAG_NOSEND 2
 
+/*  Specifies that the socket type inspects the payload of outgoing messages
+    and thus needs it to be stored in a single chunk. */
+#define NN_SOCKTYPE_FLAG_FLATSEND 4
+
 struct nn_socktype {
 
     /*  Domain and protocol IDs as specified in nn_socket() function. */
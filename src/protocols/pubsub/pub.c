@@ -30,7 +30,7 @@
 static struct nn_socktype nn_pub_socktype_struct = {
     AF_SP,
     NN_PUB,
-    0,
+    NN_SOCKTYPE_FLAG_FLATSEND,
     nn_xpub_create,
     nn_xpub_ispeer,
     NN_LIST_ITEM_INITIALIZER
@@ -0,0 +1,442 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "subindex.h"
+
+#include "../../utils/alloc.h"
+#include "../../utils/fast.h"
+#include "../../utils/err.h"
+#include "../../utils/cont.h"
+
+#include <string.h>
+
+/*  Each node represents the string composed of all the prefixes on the way
+    from the root, including the prefix in that node. Child nodes are kept
+    sorted by the first character of their prefix, so that no two children
+    of a node share the first character. */
+struct nn_subindex_node {
+    struct nn_subindex_node *parent;
+
+    /*  Subscriptions to the string represented by this node
+        (nn_subindex_entry objects). */
+    struct nn_list entries;
+
+    struct nn_subindex_node **children;
+    uint16_t nchildren;
+    uint16_t capacity;
+
+    size_t prefix_len;
+    uint8_t prefix [1];
+};
+
+/*  Subscription of a single subscriber to a single string. */
+struct nn_subindex_entry {
+    struct nn_list_item node_item;
+    struct nn_list_item sub_item;
+    struct nn_subindex_node *node;
+    struct nn_subindex_subscriber *sub;
+
+    /*  Number of times the subscriber subscribed to the string. */
+    uint32_t refcount;
+};
+
+/*  Private functions. */
+static struct nn_subindex_node *nn_subindex_node_new (
+    struct nn_subindex_node *parent, const uint8_t *prefix, size_t prefix_len);
+static void nn_subindex_node_free (struct nn_subindex_node *self);
+static int nn_subindex_node_find (struct nn_subindex_node *self, uint8_t c,
+    int *index);
+static void nn_subindex_node_insert (struct nn_subindex_node *self, int index,
+    struct nn_subindex_node *child);
+static void nn_subindex_node_erase (struct nn_subindex_node *self, int index);
+static struct nn_subindex_node *nn_subindex_lookup (struct nn_subindex *self,
+    const uint8_t *data, size_t size, int create);
+static void nn_subindex_prune (struct nn_subindex *self,
+    struct nn_subindex_node *node);
+static void nn_subindex_erase (struct nn_subindex *self,
+    struct nn_subindex_entry *entry);
+static void nn_subindex_collect (struct nn_subindex *self,
+    struct nn_subindex_node *node);
+
+void nn_subindex_init (struct nn_subindex *self)
+{
+    self->root = nn_subindex_node_new (NULL, NULL, 0);
+    self->seq = 0;
+    self->matches = NULL;
+    self->nmatches = 0;
+    self->capacity = 0;
+}
+
+void nn_subindex_term (struct nn_subindex *self)
+{
+    nn_assert (self->root->nchildren == 0);
+    nn_assert (nn_list_empty (&self->root->entries));
+    nn_subindex_node_free (self->root);
+    if (self->matches)
+        nn_free (self->matches);
+}
+
+void nn_subindex_subscriber_init (struct nn_subindex_subscriber *self)
+{
+    nn_list_init (&self->entries);
+    self->mark = 0;
+}
+
+void nn_subindex_subscriber_term (struct nn_subindex_subscriber *self)
+{
+    nn_list_term (&self->entries);
+}
+
+int nn_subindex_subscribe (struct nn_subindex *self,
+    struct nn_subindex_subscriber *sub, const uint8_t *data, size_t size)
+{
+    struct nn_subindex_node *node;
+    struct nn_subindex_entry *entry;
+    struct nn_list_item *it;
+
+    node = nn_subindex_lookup (self, data, size, 1);
+
+    /*  If the subscriber is already subscribed to the string, just increment
+        the reference count. */
+    for (it = nn_list_begin (&sub->entries);
+          it != nn_list_end (&sub->entries);
+          it = nn_list_next (&sub->entries, it)) {
+        entry = nn_cont (it, struct nn_subindex_entry, sub_item);
+        if (entry->node == node) {
+            ++entry->refcount;
+            return 0;
+        }
+    }
+
+    entry = nn_alloc (sizeof (struct nn_subindex_entry),
+        "subscription index entry");
+    alloc_assert (entry);
+    nn_list_item_init (&entry->node_item);
+    nn_list_item_init (&entry->sub_item);
+    entry->node = node;
+    entry->sub = sub;
+    entry->refcount = 1;
+    nn_list_insert (&node->entries, &entry->node_item,
+        nn_list_end (&node->entries));
+    nn_list_insert (&sub->entries, &entry->sub_item,
+        nn_list_end (&sub->entries));
+
+    return 1;
+}
+
+int nn_subindex_unsubscribe (struct nn_subindex *self,
+    struct nn_subindex_subscriber *sub, const uint8_t *data, size_t size)
+{
+    struct nn_subindex_node *node;
+    struct nn_subindex_entry *entry;
+    struct nn_list_item *it;
+
+    node = nn_subindex_lookup (self, data, size, 0);
+    if (!node)
+        return -EINVAL;
+
+    for (it = nn_list_begin (&sub->entries);
+          it != nn_list_end (&sub->entries);
+          it = nn_list_next (&sub->entries, it)) {
+        entry = nn_cont (it, struct nn_subindex_entry, sub_item);
+        if (entry->node == node) {
+            if (--entry->refcount)
+                return 0;
+            nn_subindex_erase (self, entry);
+            return 1;
+        }
+    }
+
+    return -EINVAL;
+}
+
+void nn_subindex_rm (struct nn_subindex *self,
+    struct nn_subindex_subscriber *sub)
+{
+    while (!nn_list_empty (&sub->entries))
+        nn_subindex_erase (self, nn_cont (nn_list_begin (&sub->entries),
+            struct nn_subindex_entry, sub_item));
+}
+
+size_t nn_subindex_match (struct nn_subindex *self,
+    const uint8_t *data, size_t size)
+{
+    int index;
+    struct nn_subindex_node *node;
+    struct nn_subindex_node *child;
+
+    ++self->seq;
+    self->nmatches = 0;
+
+    /*  Subscribers of every node on the path spelled by the message are
+        subscribed to a prefix of the message. */
+    node = self->root;
+    while (1) {
+        nn_subindex_collect (self, node);
+        if (!size)
+            break;
+        if (!nn_subindex_node_find (node, *data, &index))
+            break;
+        child = node->children [index];
+        if (child->prefix_len > size ||
+              memcmp (child->prefix, data, child->prefix_len) != 0)
+            break;
+        data += child->prefix_len;
+        size -= child->prefix_len;
+        node = child;
+    }
+
+    return self->nmatches;
+}
+
+static void nn_subindex_collect (struct nn_subindex *self,
+    struct nn_subindex_node *node)
+{
+    struct nn_list_item *it;
+    struct nn_subindex_subscriber *sub;
+
+    for (it = nn_list_begin (&node->entries);
+          it != nn_list_end (&node->entries);
+          it = nn_list_next (&node->entries, it)) {
+        sub = nn_cont (it, struct nn_subindex_entry, node_item)->sub;
+        if (sub->mark == self->seq)
+            continue;
+        sub->mark = self->seq;
+        if (nn_slow (self->nmatches == self->capacity)) {
+            self->capacity = self->capacity ? self->capacity * 2 : 16;
+            self->matches = self->matches ?
+                nn_realloc (self->matches, self->capacity *
+                    sizeof (struct nn_subindex_subscriber*)) :
+                nn_alloc (self->capacity *
+                    sizeof (struct nn_subindex_subscriber*),
+                    "subscription index matches");
+            alloc_assert (self->matches);
+        }
+        self->matches [self->nmatches++] = sub;
+    }
+}
+
+static void nn_subindex_erase (struct nn_subindex *self,
+    struct nn_subindex_entry *entry)
+{
+    struct nn_subindex_node *node;
+
+    node = entry->node;
+    nn_list_erase (&node->entries, &entry->node_item);
+    nn_list_erase (&entry->sub->entries, &entry->sub_item);
+    nn_list_item_term (&entry->node_item);
+    nn_list_item_term (&entry->sub_item);
+    nn_free (entry);
+    nn_subindex_prune (self, node);
+}
+
+static struct nn_subindex_node *nn_subindex_lookup (struct nn_subindex *self,
+    const uint8_t *data, size_t size, int create)
+{
+    int index;
+    size_t common;
+    struct nn_subindex_node *node;
+    struct nn_subindex_node *child;
+    struct nn_subindex_node *mid;
+
+    node = self->root;
+    while (size) {
+
+        /*  No child starts with the next character. Add the rest of the
+            string as a new leaf. */
+        if (!nn_subindex_node_find (node, *data, &index)) {
+            if (!create)
+                return NULL;
+            child = nn_subindex_node_new (node, data, size);
+            nn_subindex_node_insert (node, index, child);
+            return child;
+        }
+
+        child = node->children [index];
+        common = 1;
+        while (common < child->prefix_len && common < size &&
+              child->prefix [common] == data [common])
+            ++common;
+
+        /*  The string diverges from the child's prefix, or ends in the
+            middle of it. Split the child in two. */
+        if (common < child->prefix_len) {
+            if (!create)
+                return NULL;
+            mid = nn_subindex_node_new (node, child->prefix, common);
+            child->prefix_len -= common;
+            memmove (child->prefix, child->prefix + common, child->prefix_len);
+            child->parent = mid;
+            nn_subindex_node_insert (mid, 0, child);
+            node->children [index] = mid;
+            child = mid;
+        }
+
+        data += common;
+        size -= common;
+        node = child;
+    }
+
+    return node;
+}
+
+static void nn_subindex_prune (struct nn_subindex *self,
+    struct nn_subindex_node *node)
+{
+    int index;
+    int rc;
+    struct nn_subindex_node *parent;
+    struct nn_subindex_node *child;
+    struct nn_subindex_node *merged;
+    struct nn_list_item *it;
+    uint16_t i;
+
+    while (node != self->root && nn_list_empty (&node->entries)) {
+        parent = node->parent;
+        rc = nn_subindex_node_find (parent, node->prefix [0], &index);
+        nn_assert (rc && parent->children [index] == node);
+
+        /*  A leaf with no subscriptions can be dropped. The parent may have
+            become redundant as a consequence, so check it as well. */
+        if (node->nchildren == 0) {
+            nn_subindex_node_erase (parent, index);
+            nn_subindex_node_free (node);
+            node = parent;
+            continue;
+        }
+
+        /*  A node with a single child and no subscriptions is merged with
+            the child, so that the path stays compressed. */
+        if (node->nchildren == 1) {
+            child = node->children [0];
+            merged = nn_subindex_node_new (parent, NULL,
+                node->prefix_len + child->prefix_len);
+            memcpy (merged->prefix, node->prefix, node->prefix_len);
+            memcpy (merged->prefix + node->prefix_len, child->prefix,
+                child->prefix_len);
+            merged->entries = child->entries;
+            merged->children = child->children;
+            merged->nchildren = child->nchildren;
+            merged->capacity = child->capacity;
+            for (i = 0; i != merged->nchildren; ++i)
+                merged->children [i]->parent = merged;
+            for (it = nn_list_begin (&merged->entries);
+                  it != nn_list_end (&merged->entries);
+                  it = nn_list_next (&merged->entries, it))
+                nn_cont (it, struct nn_subindex_entry, node_item)->node =
+                    merged;
+            parent->children [index] = merged;
+            nn_free (node->children);
+            nn_free (node);
+            nn_free (child);
+        }
+        break;
+    }
+}
+
+static struct nn_subindex_node *nn_subindex_node_new (
+    struct nn_subindex_node *parent, const uint8_t *prefix, size_t prefix_len)
+{
+    struct nn_subindex_node *self;
+    size_t sz;
+
+    /*  The prefix is stored in place, at the end of the node. Never allocate
+        less than the full structure though, as that's what the compiler
+        assumes when the fields are accessed. */
+    sz = offsetof (struct nn_subindex_node, prefix) + prefix_len;
+    if (sz < sizeof (struct nn_subindex_node))
+        sz = sizeof (struct nn_subindex_node);
+    self = nn_alloc (sz, "subscription index node");
+    alloc_assert (self);
+    self->parent = parent;
+    nn_list_init (&self->entries);
+    self->children = NULL;
+    self->nchildren = 0;
+    self->capacity = 0;
+    self->prefix_len = prefix_len;
+    if (prefix)
+        memcpy (self->prefix, prefix, prefix_len);
+    return self;
+}
+
+static void nn_subindex_node_free (struct nn_subindex_node *self)
+{
+    nn_assert (self->nchildren == 0);
+    nn_list_term (&self->entries);
+    if (self->children)
+        nn_free (self->children);
+    nn_free (self);
+}
+
+/*  Looks for the child starting with character 'c'. Returns 1 if found,
+    0 otherwise. In either case 'index' is set to the position where such
+    child is, or would be, stored. */
+static int nn_subindex_node_find (struct nn_subindex_node *self, uint8_t c,
+    int *index)
+{
+    int lo;
+    int hi;
+    int mid;
+    uint8_t key;
+
+    lo = 0;
+    hi = self->nchildren;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        key = self->children [mid]->prefix [0];
+        if (key == c) {
+            *index = mid;
+            return 1;
+        }
+        if (key < c)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *index = lo;
+    return 0;
+}
+
+static void nn_subindex_node_insert (struct nn_subindex_node *self, int index,
+    struct nn_subindex_node *child)
+{
+    if (self->nchildren == self->capacity) {
+        self->capacity = self->capacity ? self->capacity * 2 : 2;
+        self->children = self->children ?
+            nn_realloc (self->children, self->capacity *
+                sizeof (struct nn_subindex_node*)) :
+            nn_alloc (self->capacity * sizeof (struct nn_subindex_node*),
+                "subscription index children");
+        alloc_assert (self->children);
+    }
+    memmove (self->children + index + 1, self->children + index,
+        (self->nchildren - index) * sizeof (struct nn_subindex_node*));
+    self->children [index] = child;
+    ++self->nchildren;
+}
+
+static void nn_subindex_node_erase (struct nn_subindex_node *self, int index)
+{
+    --self->nchildren;
+    memmove (self->children + index, self->children + index + 1,
+        (self->nchildren - index) * sizeof (struct nn_subindex_node*));
+}
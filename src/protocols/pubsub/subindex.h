@@ -0,0 +1,100 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_SUBINDEX_INCLUDED
+#define NN_SUBINDEX_INCLUDED
+
+#include "../../utils/int.h"
+#include "../../utils/list.h"
+
+#include <stddef.h>
+
+/*  Subscription index shared by all the subscribers of a publisher. It's
+    a patricia trie where each node carries the list of subscribers that
+    are subscribed to the string the node represents. Matching a message
+    thus takes a single walk of the topic, no matter how many subscribers
+    there are, and yields the set of matching subscribers. */
+
+struct nn_subindex_node;
+
+/*  Subscriber as seen by the index. To be embedded in the user's per-pipe
+    structure. */
+struct nn_subindex_subscriber {
+
+    /*  Subscriptions of this subscriber (nn_subindex_entry objects). */
+    struct nn_list entries;
+
+    /*  Number of the last match that reported this subscriber. Used to
+        report each subscriber only once even if it has several matching
+        subscriptions. */
+    uint64_t mark;
+};
+
+struct nn_subindex {
+
+    /*  Node representing the empty string. */
+    struct nn_subindex_node *root;
+
+    /*  Number of the match being processed at the moment. */
+    uint64_t seq;
+
+    /*  Subscribers reported by the last match. */
+    struct nn_subindex_subscriber **matches;
+    size_t nmatches;
+    size_t capacity;
+};
+
+/*  Initialise an empty index. */
+void nn_subindex_init (struct nn_subindex *self);
+
+/*  Release all the resources associated with the index. All the subscribers
+    must have been removed beforehand. */
+void nn_subindex_term (struct nn_subindex *self);
+
+void nn_subindex_subscriber_init (struct nn_subindex_subscriber *self);
+void nn_subindex_subscriber_term (struct nn_subindex_subscriber *self);
+
+/*  Add the subscription to the index. Returns 1 if this is a new
+    subscription of the subscriber and 0 if the subscriber was already
+    subscribed to the same topic. */
+int nn_subindex_subscribe (struct nn_subindex *self,
+    struct nn_subindex_subscriber *sub, const uint8_t *data, size_t size);
+
+/*  Remove the subscription from the index. Returns 1 if the subscription
+    was removed, 0 if the subscriber is still subscribed to the topic (it
+    subscribed to it several times) and -EINVAL if the subscriber was not
+    subscribed to the topic at all. */
+int nn_subindex_unsubscribe (struct nn_subindex *self,
+    struct nn_subindex_subscriber *sub, const uint8_t *data, size_t size);
+
+/*  Remove all the subscriptions of the subscriber. */
+void nn_subindex_rm (struct nn_subindex *self,
+    struct nn_subindex_subscriber *sub);
+
+/*  Find all the subscribers that are subscribed to a prefix of the message.
+    Returns the number of such subscribers. The subscribers themselves are
+    stored in 'matches' array, each of them only once, and stay valid until
+    the next call to any of the functions above. */
+size_t nn_subindex_match (struct nn_subindex *self,
+    const uint8_t *data, size_t size);
+
+#endif
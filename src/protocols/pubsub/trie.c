@@ -19,9 +19,7 @@
     FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
     IN THE SOFTWARE.
 */
-
 #include <string.h>
-#include <assert.h>
 #include <stdio.h>
 
 #include "trie.h"
@@ -29,18 +27,54 @@
 #include "../../utils/fast.h"
 #include "../../utils/err.h"
 
-/*  Double check that the size of node structure is as small as
+#if defined __SSE2__ && defined __GNUC__
+#define NN_TRIE_SSE2
+#include <emmintrin.h>
+#endif
+
+/*  Double check that the size of node header is as small as
     we believe it to be. */
-CT_ASSERT (sizeof (struct nn_trie_node) == 24);
+CT_ASSERT (sizeof (struct nn_trie_node) == 12);
+
+/*  Size of the node structure for each node type. The prefix is stored
+    right after it. */
+static const size_t nn_node_sizes [] = {
+    sizeof (struct nn_trie_node),
+    sizeof (struct nn_trie_node4),
+    sizeof (struct nn_trie_node16),
+    sizeof (struct nn_trie_node48),
+    sizeof (struct nn_trie_node256)
+};
+
+/*  Maximum number of children for each node type. */
+static const int nn_node_capacities [] = {0, 4, 16, 48, 256};
+
+/*  When the number of children drops to this value, the node is converted
+    to the next smaller type. The gap between the threshold and the capacity
+    of the smaller type prevents the node from being converted back and forth
+    when a child is repeatedly added and removed. */
+static const int nn_node_thresholds [] = {0, 0, 3, 12, 37};
 
 /*  Forward declarations. */
+static struct nn_trie_node *nn_node_alloc (int type, const uint8_t *prefix,
+    size_t prefix_len);
+static struct nn_trie_node *nn_node_chain (const uint8_t *data, size_t size,
+    struct nn_trie_node **leaf);
+static uint8_t *nn_node_prefix (struct nn_trie_node *self);
 static struct nn_trie_node *nn_node_compact (struct nn_trie_node *self);
 static int nn_node_check_prefix (struct nn_trie_node *self,
     const uint8_t *data, size_t size);
-static struct nn_trie_node **nn_node_child (struct nn_trie_node *self,
-    int index);
+static int nn_node_children (struct nn_trie_node *self, uint8_t *keys,
+    struct nn_trie_node **children);
 static struct nn_trie_node **nn_node_next (struct nn_trie_node *self,
     uint8_t c);
+static void nn_node_insert (struct nn_trie_node *self, uint8_t c,
+    struct nn_trie_node *child);
+static void nn_node_add (struct nn_trie_node **self, uint8_t c,
+    struct nn_trie_node *child);
+static void nn_node_remove (struct nn_trie_node **self, uint8_t c);
+static struct nn_trie_node *nn_node_convert (struct nn_trie_node *self,
+    int type);
 static int nn_node_unsubscribe (struct nn_trie_node **self,
     const uint8_t *data, size_t size);
 static void nn_node_term (struct nn_trie_node *self);
@@ -68,6 +102,9 @@ void nn_node_dump (struct nn_trie_node *self, int indent)
 {
     int i;
     int children;
+    uint8_t keys [256];
+    struct nn_trie_node *ch [256];
+    static const char *names [] = {"0", "4", "16", "48", "256"};
 
     if (!self) {
         nn_node_indent (indent);
@@ -82,37 +119,21 @@ void nn_node_dump (struct nn_trie_node *self, int indent)
     nn_node_indent (indent);
     printf ("prefix_len=%d\n", (int) self->prefix_len);
     nn_node_indent (indent);
-    if (self->type == NN_TRIE_DENSE_TYPE)
-        printf ("type=dense\n");
-    else
-        printf ("type=sparse\n");
+    printf ("type=node%s\n", names [self->type]);
     nn_node_indent (indent);
     printf ("prefix=\"");
     for (i = 0; i != self->prefix_len; ++i)
-        nn_node_putchar (self->prefix [i]);
+        nn_node_putchar (nn_node_prefix (self) [i]);
+    printf ("\"\n");
+    children = nn_node_children (self, keys, ch);
+    nn_node_indent (indent);
+    printf ("children=\"");
+    for (i = 0; i != children; ++i)
+        nn_node_putchar (keys [i]);
     printf ("\"\n");
-    if (self->type <= 8) {
-        nn_node_indent (indent);
-        printf ("sparse.children=\"");
-        for (i = 0; i != self->type; ++i)
-            nn_node_putchar (self->u.sparse.children [i]);
-        printf ("\"\n");
-        children = self->type;
-    }
-    else {
-        nn_node_indent (indent);
-        printf ("dense.min='%c' (%d)\n", (char) self->u.dense.min,
-            (int) self->u.dense.min);
-        nn_node_indent (indent);
-        printf ("dense.max='%c' (%d)\n", (char) self->u.dense.max,
-            (int) self->u.dense.max);
-        nn_node_indent (indent);
-        printf ("dense.nbr=%d\n", (int) self->u.dense.nbr);
-        children = self->u.dense.max - self->u.dense.min + 1;
-    }
 
     for (i = 0; i != children; ++i)
-        nn_node_dump (((struct nn_trie_node**) (self + 1)) [i], indent + 1);
+        nn_node_dump (ch [i], indent + 1);
 
     nn_node_indent (indent);
     printf ("===================\n");
@@ -138,30 +159,76 @@ void nn_node_term (struct nn_trie_node *self)
 {
     int children;
     int i;
+    uint8_t keys [256];
+    struct nn_trie_node *ch [256];
 
     /*  Trivial case of the recursive algorithm. */
     if (!self)
         return;
 
     /*  Recursively destroy the child nodes. */
-    children = self->type <= NN_TRIE_SPARSE_MAX ?
-        self->type : (self->u.dense.max - self->u.dense.min + 1);
+    children = nn_node_children (self, keys, ch);
     for (i = 0; i != children; ++i)
-        nn_node_term (*nn_node_child (self, i));
+        nn_node_term (ch [i]);
 
     /*  Deallocate this node. */
     nn_free (self);
 }
 
+struct nn_trie_node *nn_node_alloc (int type, const uint8_t *prefix,
+    size_t prefix_len)
+{
+    /*  Creates a node of the specified type with no children. */
+
+    struct nn_trie_node *self;
+
+    self = nn_alloc (nn_node_sizes [type] + prefix_len, "trie node");
+    alloc_assert (self);
+    memset (self, 0, nn_node_sizes [type]);
+    self->type = (uint8_t) type;
+    self->prefix_len = (uint16_t) prefix_len;
+    memcpy (nn_node_prefix (self), prefix, prefix_len);
+    return self;
+}
+
+struct nn_trie_node *nn_node_chain (const uint8_t *data, size_t size,
+    struct nn_trie_node **leaf)
+{
+    /*  Creates nodes representing the supplied string. If the string doesn't
+        fit into a single prefix, it's split into a chain of nodes. Returns
+        the first node of the chain and stores the last one in 'leaf'. */
+
+    struct nn_trie_node *self;
+    size_t prefix_len;
+
+    prefix_len = size < NN_TRIE_PREFIX_MAX ? size : NN_TRIE_PREFIX_MAX;
+    if (prefix_len == size) {
+        self = nn_node_alloc (NN_TRIE_NODE0, data, size);
+        *leaf = self;
+        return self;
+    }
+    self = nn_node_alloc (NN_TRIE_NODE4, data, prefix_len);
+    nn_node_insert (self, data [prefix_len], nn_node_chain (
+        data + prefix_len + 1, size - prefix_len - 1, leaf));
+    return self;
+}
+
+uint8_t *nn_node_prefix (struct nn_trie_node *self)
+{
+    return ((uint8_t*) self) + nn_node_sizes [self->type];
+}
+
 int nn_node_check_prefix (struct nn_trie_node *self,
     const uint8_t *data, size_t size)
 {
     /*  Check how many characters from the data match the prefix. */
 
     int i;
+    uint8_t *prefix;
 
+    prefix = nn_node_prefix (self);
     for (i = 0; i != self->prefix_len; ++i) {
-        if (!size || self->prefix [i] != *data)
+        if (!size || prefix [i] != *data)
             return i;
         ++data;
         --size;
@@ -169,11 +236,59 @@ int nn_node_check_prefix (struct nn_trie_node *self,
     return self->prefix_len;
 }
 
-struct nn_trie_node **nn_node_child (struct nn_trie_node *self, int index)
+int nn_node_children (struct nn_trie_node *self, uint8_t *keys,
+    struct nn_trie_node **children)
 {
-    /*  Finds pointer to the n-th child of the node. */
+    /*  Fills in the characters and the pointers of all the child nodes.
+        Returns the number of children. */
 
-    return ((struct nn_trie_node**) (self + 1)) + index;
+    int i;
+    int nbr;
+    struct nn_trie_node4 *n4;
+    struct nn_trie_node16 *n16;
+    struct nn_trie_node48 *n48;
+    struct nn_trie_node256 *n256;
+
+    switch (self->type) {
+    case NN_TRIE_NODE0:
+        return 0;
+    case NN_TRIE_NODE4:
+        n4 = (struct nn_trie_node4*) self;
+        memcpy (keys, n4->keys, self->nbr);
+        memcpy (children, n4->children,
+            self->nbr * sizeof (struct nn_trie_node*));
+        return self->nbr;
+    case NN_TRIE_NODE16:
+        n16 = (struct nn_trie_node16*) self;
+        memcpy (keys, n16->keys, self->nbr);
+        memcpy (children, n16->children,
+            self->nbr * sizeof (struct nn_trie_node*));
+        return self->nbr;
+    case NN_TRIE_NODE48:
+        n48 = (struct nn_trie_node48*) self;
+        nbr = 0;
+        for (i = 0; i != 256; ++i) {
+            if (n48->index [i]) {
+                keys [nbr] = (uint8_t) i;
+                children [nbr] = n48->children [n48->index [i] - 1];
+                ++nbr;
+            }
+        }
+        return nbr;
+    case NN_TRIE_NODE256:
+        n256 = (struct nn_trie_node256*) self;
+        nbr = 0;
+        for (i = 0; i != 256; ++i) {
+            if (n256->children [i]) {
+                keys [nbr] = (uint8_t) i;
+                children [nbr] = n256->children [i];
+                ++nbr;
+            }
+        }
+        return nbr;
+    default:
+        nn_assert (0);
+    }
 }
 
 struct nn_trie_node **nn_node_next (struct nn_trie_node *self, uint8_t c)
@@ -182,22 +297,166 @@ struct nn_trie_node **nn_node_next (struct nn_trie_node *self, uint8_t c)
         If there is no such pointer, it returns NULL. */
 
     int i;
-
-    if (self->type == 0)
+    struct nn_trie_node4 *n4;
+    struct nn_trie_node16 *n16;
+    struct nn_trie_node48 *n48;
+    struct nn_trie_node256 *n256;
+#if defined NN_TRIE_SSE2
+    int mask;
+#endif
+
+    switch (self->type) {
+    case NN_TRIE_NODE0:
         return NULL;
-
-    /*  Sparse mode. */
-    if (self->type <= 8) {
-        for (i = 0; i != self->type; ++i)
-            if (self->u.sparse.children [i] == c)
-                return nn_node_child (self, i);
+    case NN_TRIE_NODE4:
+        n4 = (struct nn_trie_node4*) self;
+        for (i = 0; i != self->nbr; ++i)
+            if (n4->keys [i] == c)
+                return &n4->children [i];
+        return NULL;
+    case NN_TRIE_NODE16:
+        n16 = (struct nn_trie_node16*) self;
+#if defined NN_TRIE_SSE2
+        /*  Compare all the keys at once. Keys past the number of children
+            are masked out. */
+        mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_set1_epi8 ((char) c),
+            _mm_loadu_si128 ((const __m128i*) n16->keys)));
+        mask &= (1 << self->nbr) - 1;
+        return mask ? &n16->children [__builtin_ctz (mask)] : NULL;
+#else
+        for (i = 0; i != self->nbr; ++i)
+            if (n16->keys [i] == c)
+                return &n16->children [i];
         return NULL;
+#endif
+    case NN_TRIE_NODE48:
+        n48 = (struct nn_trie_node48*) self;
+        i = n48->index [c];
+        return i ? &n48->children [i - 1] : NULL;
+    case NN_TRIE_NODE256:
+        n256 = (struct nn_trie_node256*) self;
+        return n256->children [c] ? &n256->children [c] : NULL;
+    default:
+        nn_assert (0);
     }
+}
 
-    /*  Dense mode. */
-    if (c < self->u.dense.min || c > self->u.dense.max)
-        return NULL;
-    return nn_node_child (self, c - self->u.dense.min);
+void nn_node_insert (struct nn_trie_node *self, uint8_t c,
+    struct nn_trie_node *child)
+{
+    /*  Adds a child to the node. There must be room for it. */
+
+    int i;
+    struct nn_trie_node4 *n4;
+    struct nn_trie_node16 *n16;
+    struct nn_trie_node48 *n48;
+    struct nn_trie_node256 *n256;
+
+    nn_assert (self->nbr < nn_node_capacities [self->type]);
+
+    switch (self->type) {
+    case NN_TRIE_NODE4:
+        n4 = (struct nn_trie_node4*) self;
+        n4->keys [self->nbr] = c;
+        n4->children [self->nbr] = child;
+        break;
+    case NN_TRIE_NODE16:
+        n16 = (struct nn_trie_node16*) self;
+        n16->keys [self->nbr] = c;
+        n16->children [self->nbr] = child;
+        break;
+    case NN_TRIE_NODE48:
+        n48 = (struct nn_trie_node48*) self;
+        for (i = 0; n48->children [i]; ++i)
+            ;
+        n48->children [i] = child;
+        n48->index [c] = (uint8_t) (i + 1);
+        break;
+    case NN_TRIE_NODE256:
+        n256 = (struct nn_trie_node256*) self;
+        n256->children [c] = child;
+        break;
+    default:
+        nn_assert (0);
+    }
+    ++self->nbr;
+}
+
+void nn_node_add (struct nn_trie_node **self, uint8_t c,
+    struct nn_trie_node *child)
+{
+    /*  Adds a child to the node, converting the node to a bigger type
+        if needed. */
+
+    if ((*self)->nbr == nn_node_capacities [(*self)->type])
+        *self = nn_node_convert (*self, (*self)->type + 1);
+    nn_node_insert (*self, c, child);
+}
+
+void nn_node_remove (struct nn_trie_node **self, uint8_t c)
+{
+    /*  Removes the child from the node, converting the node to a smaller
+        type if it became too sparse. */
+
+    int i;
+    struct nn_trie_node4 *n4;
+    struct nn_trie_node16 *n16;
+    struct nn_trie_node48 *n48;
+    struct nn_trie_node256 *n256;
+    struct nn_trie_node *node;
+
+    node = *self;
+    switch (node->type) {
+    case NN_TRIE_NODE4:
+        n4 = (struct nn_trie_node4*) node;
+        for (i = 0; n4->keys [i] != c; ++i)
+            ;
+        n4->keys [i] = n4->keys [node->nbr - 1];
+        n4->children [i] = n4->children [node->nbr - 1];
+        break;
+    case NN_TRIE_NODE16:
+        n16 = (struct nn_trie_node16*) node;
+        for (i = 0; n16->keys [i] != c; ++i)
+            ;
+        n16->keys [i] = n16->keys [node->nbr - 1];
+        n16->children [i] = n16->children [node->nbr - 1];
+        break;
+    case NN_TRIE_NODE48:
+        n48 = (struct nn_trie_node48*) node;
+        n48->children [n48->index [c] - 1] = NULL;
+        n48->index [c] = 0;
+        break;
+    case NN_TRIE_NODE256:
+        n256 = (struct nn_trie_node256*) node;
+        n256->children [c] = NULL;
+        break;
+    default:
+        nn_assert (0);
+    }
+    --node->nbr;
+
+    if (node->nbr == nn_node_thresholds [node->type])
+        *self = nn_node_convert (node, node->type - 1);
+}
+
+struct nn_trie_node *nn_node_convert (struct nn_trie_node *self, int type)
+{
+    /*  Creates a node of different type with the same content. The old
+        node is deallocated. */
+
+    int i;
+    int children;
+    uint8_t keys [256];
+    struct nn_trie_node *ch [256];
+    struct nn_trie_node *node;
+
+    node = nn_node_alloc (type, nn_node_prefix (self), self->prefix_len);
+    node->refcount = self->refcount;
+    children = nn_node_children (self, keys, ch);
+    for (i = 0; i != children; ++i)
+        nn_node_insert (node, keys [i], ch [i]);
+    nn_free (self);
+    return node;
 }
 
 struct nn_trie_node *nn_node_compact (struct nn_trie_node *self)
@@ -206,25 +465,34 @@ struct nn_trie_node *nn_node_compact (struct nn_trie_node *self)
         the compacted node. */
 
     struct nn_trie_node *ch;
+    uint8_t keys [256];
+    struct nn_trie_node *children [256];
+    size_t prefix_len;
+    uint8_t *prefix;
 
     /*  Node that is a subscription cannot be compacted. */
     if (nn_node_has_subscribers (self))
         return self;
 
     /*  Only a node with a single child can be compacted. */
-    if (self->type != 1)
+    if (self->nbr != 1)
         return self;
 
     /*  Check whether combined prefixes would fix into a single node. */
-    ch = *nn_node_child (self, 0);
-    if (self->prefix_len + ch->prefix_len + 1 > NN_TRIE_PREFIX_MAX)
+    nn_node_children (self, keys, children);
+    ch = children [0];
+    prefix_len = self->prefix_len + ch->prefix_len + 1;
+    if (prefix_len > NN_TRIE_PREFIX_MAX)
         return self;
 
     /*  Concatenate the prefixes. */
-    memmove (ch->prefix + self->prefix_len + 1, ch->prefix, ch->prefix_len);
-    memcpy (ch->prefix, self->prefix, self->prefix_len);
-    ch->prefix [self->prefix_len] = self->u.sparse.children [0];
-    ch->prefix_len += self->prefix_len + 1;
+    ch = nn_realloc (ch, nn_node_sizes [ch->type] + prefix_len);
+    alloc_assert (ch);
+    prefix = nn_node_prefix (ch);
+    memmove (prefix + self->prefix_len + 1, prefix, ch->prefix_len);
+    memcpy (prefix, nn_node_prefix (self), self->prefix_len);
+    prefix [self->prefix_len] = keys [0];
+    ch->prefix_len = (uint16_t) prefix_len;
 
     /*  Get rid of the obsolete parent node. */
     nn_free (self);
@@ -235,207 +503,73 @@ struct nn_trie_node *nn_node_compact (struct nn_trie_node *self)
 
 int nn_trie_subscribe (struct nn_trie *self, const uint8_t *data, size_t size)
 {
-    int i;
     struct nn_trie_node **node;
     struct nn_trie_node **n;
     struct nn_trie_node *ch;
-    struct nn_trie_node *old_node;
-    int pos;
+    struct nn_trie_node *leaf;
+    uint8_t *prefix;
     uint8_t c;
-    uint8_t c2;
-    uint8_t new_min;
-    uint8_t new_max;
-    int old_children;
-    int new_children;
-    int inserted;
-    int more_nodes;
-
-    /*  Step 1 -- Traverse the trie. */
+    int pos;
 
+    /*  Traverse the trie. */
     node = &self->root;
-    pos = 0;
     while (1) {
 
-        /*  If there are no more nodes on the path, go to step 4. */
-        if (!*node)
-            goto step4;
+        /*  If there are no more nodes on the path, create them. */
+        if (!*node) {
+            *node = nn_node_chain (data, size, &leaf);
+            break;
+        }
 
         /*  Check whether prefix matches the new subscription. */
         pos = nn_node_check_prefix (*node, data, size);
         data += pos;
         size -= pos;
 
-        /*  If only part of the prefix matches, go to step 2. */
-        if (pos < (*node)->prefix_len)
-            goto step2;
-
-        /*  Even if whole prefix matches and there's no more data to match,
-            go directly to step 5. */
-        if (!size)
-            goto step5;
-
-        /*  Move to the next node. If it is not present, go to step 3. */
-        n = nn_node_next (*node, *data);
-        if (!n || !*n)
-            goto step3;
-        node = n;
-        ++data;
-        --size;
-    }
-
-    /*  Step 2 -- Split the prefix into two parts if required. */
-step2:
-
-    ch = *node;
-    *node = nn_alloc (sizeof (struct nn_trie_node) +
-        sizeof (struct nn_trie_node*), "trie node");
-    assert (*node);
-    (*node)->refcount = 0;
-    (*node)->prefix_len = pos;
-    (*node)->type = 1;
-    memcpy ((*node)->prefix, ch->prefix, pos);
-    (*node)->u.sparse.children [0] = ch->prefix [pos];
-    ch->prefix_len -= (pos + 1);
-    memmove (ch->prefix, ch->prefix + pos + 1, ch->prefix_len);
-    ch = nn_node_compact (ch);
-    *nn_node_child (*node, 0) = ch;
-    pos = (*node)->prefix_len;
-
-    /*  Step 3 -- Adjust the child array to accommodate the new character. */
-step3:
-
-    /*  If there are no more data in the subscription, there's nothing to
-        adjust in the child array. Proceed directly to the step 5. */
-    if (!size)
-        goto step5;
-
-    /*  If the new branch fits into sparse array... */
-    if ((*node)->type < NN_TRIE_SPARSE_MAX) {
-        *node = nn_realloc (*node, sizeof (struct nn_trie_node) +
-            ((*node)->type + 1) * sizeof (struct nn_trie_node*));
-        assert (*node);
-        (*node)->u.sparse.children [(*node)->type] = *data;
-        ++(*node)->type;
-        node = nn_node_child (*node, (*node)->type - 1);
-        *node = NULL;
-        ++data;
-        --size;
-        goto step4;
-    }
-
-    /*  If the node is already a dense array, resize it to fit the next
-        character. */
-    if ((*node)->type == NN_TRIE_DENSE_TYPE) {
-        c = *data;
-        if (c < (*node)->u.dense.min || c > (*node)->u.dense.max) {
-            new_min = (*node)->u.dense.min < c ? (*node)->u.dense.min : c;
-            new_max = (*node)->u.dense.max > c ? (*node)->u.dense.max : c;
-            *node = nn_realloc (*node, sizeof (struct nn_trie_node) +
-                (new_max - new_min + 1) * sizeof (struct nn_trie_node*));
-            assert (*node);
-            old_children = (*node)->u.dense.max - (*node)->u.dense.min + 1;
-            new_children = new_max - new_min + 1;
-            if ((*node)->u.dense.min != new_min) {
-                inserted = (*node)->u.dense.min - new_min;
-                memmove (nn_node_child (*node, inserted),
-                    nn_node_child (*node, 0),
-                    old_children * sizeof (struct nn_trie_node*));
-                memset (nn_node_child (*node, 0), 0,
-                    inserted * sizeof (struct nn_trie_node*));
-            }
-            else {
-                memset (nn_node_child (*node, old_children), 0,
-                    (new_children - old_children) *
-                    sizeof (struct nn_trie_node*));
+        /*  If only part of the prefix matches, split the node into two. */
+        if (pos < (*node)->prefix_len) {
+            ch = *node;
+            prefix = nn_node_prefix (ch);
+            *node = nn_node_alloc (NN_TRIE_NODE4, prefix, pos);
+            c = prefix [pos];
+            ch->prefix_len -= (uint16_t) (pos + 1);
+            memmove (prefix, prefix + pos + 1, ch->prefix_len);
+            ch = nn_realloc (ch, nn_node_sizes [ch->type] + ch->prefix_len);
+            alloc_assert (ch);
+            nn_node_insert (*node, c, nn_node_compact (ch));
+            if (!size) {
+                leaf = *node;
+                break;
             }
-            (*node)->u.dense.min = new_min;
-            (*node)->u.dense.max = new_max;
+            nn_node_add (node, *data, nn_node_chain (data + 1, size - 1,
+                &leaf));
+            break;
         }
-        ++(*node)->u.dense.nbr;
 
-        node = nn_node_child (*node, c - (*node)->u.dense.min);
-        ++data;
-        --size;
-        goto step4;
-    }
-
-    /*  This is a sparse array, but no more children can be added to it.
-        We have to convert it into a dense array. */
-    {
-        /*  First, determine the range of children. */
-        new_min = 255;
-        new_max = 0;
-        for (i = 0; i != (*node)->type; ++i) {
-            c2 = (*node)->u.sparse.children [i];
-            new_min = new_min < c2 ? new_min : c2;
-            new_max = new_max > c2 ? new_max : c2;
+        /*  If whole prefix matches and there's no more data to match,
+            this is the node to subscribe to. */
+        if (!size) {
+            leaf = *node;
+            break;
         }
-        new_min = new_min < *data ? new_min : *data;
-        new_max = new_max > *data ? new_max : *data;
-
-        /*  Create a new mode, while keeping the old one for a while. */
-        old_node = *node;
-        *node = (struct nn_trie_node*) nn_alloc (sizeof (struct nn_trie_node) +
-            (new_max - new_min + 1) * sizeof (struct nn_trie_node*),
-            "trie node");
-        assert (*node);
-
-        /*  Fill in the new node. */
-        (*node)->refcount = 0;
-        (*node)->prefix_len = old_node->prefix_len;
-        (*node)->type = NN_TRIE_DENSE_TYPE;
-        memcpy ((*node)->prefix, old_node->prefix, old_node->prefix_len);
-        (*node)->u.dense.min = new_min;
-        (*node)->u.dense.max = new_max;
-        (*node)->u.dense.nbr = old_node->type + 1;
-        memset (*node + 1, 0, (new_max - new_min + 1) *
-            sizeof (struct nn_trie_node*));
-        for (i = 0; i != old_node->type; ++i)
-            *nn_node_child (*node, old_node->u.sparse.children [i] - new_min) =
-                *nn_node_child (old_node, i);
-        node = nn_node_next (*node, *data);
-        ++data;
-        --size;
 
-        /*  Get rid of the obsolete old node. */
-        nn_free (old_node);
-    }
-
-    /*  Step 4 -- Create new nodes for remaining part of the subscription. */
-step4:
-
-    assert (!*node);
-    while (1) {
-
-        /*  Create a new node to hold the next part of the subscription. */
-        more_nodes = size > NN_TRIE_PREFIX_MAX;
-        *node = nn_alloc (sizeof (struct nn_trie_node) +
-            (more_nodes ? sizeof (struct nn_trie_node*) : 0), "trie node");
-        assert (*node);
-
-        /*  Fill in the new node. */
-        (*node)->refcount = 0;
-        (*node)->type = more_nodes ? 1 : 0;
-        (*node)->prefix_len = size < (uint8_t) NN_TRIE_PREFIX_MAX ?
-            (uint8_t) size : (uint8_t) NN_TRIE_PREFIX_MAX;
-        memcpy ((*node)->prefix, data, (*node)->prefix_len);
-        data += (*node)->prefix_len;
-        size -= (*node)->prefix_len;
-        if (!more_nodes)
+        /*  Move to the next node. If it is not present, create it. */
+        n = nn_node_next (*node, *data);
+        if (!n) {
+            nn_node_add (node, *data, nn_node_chain (data + 1, size - 1,
+                &leaf));
             break;
-        (*node)->u.sparse.children [0] = *data;
-        node = nn_node_child (*node, 0);
+        }
+        node = n;
         ++data;
         --size;
     }
 
-    /*  Step 5 -- Create the subscription as such. */
-step5:
-
-    ++(*node)->refcount;
+    /*  Create the subscription as such. */
+    ++leaf->refcount;
 
     /*  Return 1 in case of a fresh subscription. */
-    return (*node)->refcount == 1 ? 1 : 0;
+    return leaf->refcount == 1 ? 1 : 0;
 }
 
 int nn_trie_match (struct nn_trie *self, const uint8_t *data, size_t size)
@@ -452,7 +586,8 @@ int nn_trie_match (struct nn_trie *self, const uint8_t *data, size_t size)
 
         /*  Check whether whole prefix matches the data. If not so,
             the whole string won't match. */
-        if (nn_node_check_prefix (node, data, size) != node->prefix_len)
+        if (node->prefix_len > size ||
+              memcmp (nn_node_prefix (node), data, node->prefix_len) != 0)
             return 0;
 
         /*  Skip the prefix. */
@@ -464,6 +599,8 @@ int nn_trie_match (struct nn_trie *self, const uint8_t *data, size_t size)
             return 1;
 
         /*  Move to the next node. */
+        if (!size)
+            return 0;
         tmp = nn_node_next (node, *data);
         node = tmp ? *tmp : NULL;
         ++data;
@@ -479,20 +616,16 @@ int nn_trie_unsubscribe (struct nn_trie *self, const uint8_t *data, size_t size)
 static int nn_node_unsubscribe (struct nn_trie_node **self,
     const uint8_t *data, size_t size)
 {
-    int i;
-    int j;
-    int index;
-    int new_min;
+    int rc;
     struct nn_trie_node **ch;
-    struct nn_trie_node *new_node;
-    struct nn_trie_node *ch2;
 
-    if (!size)
-        goto found;
+    /*  Subscription doesn't exist. */
+    if (nn_slow (!*self))
+        return -EINVAL;
 
     /*  If prefix does not match the data, return. */
     if (nn_node_check_prefix (*self, data, size) != (*self)->prefix_len)
-        return 0;
+        return -EINVAL;
 
     /*  Skip the prefix. */
     data += (*self)->prefix_len;
@@ -504,13 +637,14 @@ static int nn_node_unsubscribe (struct nn_trie_node **self,
     /*  Move to the next node. */
     ch = nn_node_next (*self, *data);
     if (!ch)
-        return 0; /*  TODO: This should be an error. */
+        return -EINVAL;
 
     /*  Recursive traversal of the trie happens here. If the subscription
         wasn't really removed, nothing have changed in the trie and
         no additional pruning is needed. */
-    if (nn_node_unsubscribe (ch, data + 1, size - 1) == 0)
-        return 0;
+    rc = nn_node_unsubscribe (ch, data + 1, size - 1);
+    if (rc != 1)
+        return rc;
 
     /*  Subscription removal is already done. Now we are going to compact
         the trie. However, if the following node remains in place, there's
@@ -518,120 +652,27 @@ static int nn_node_unsubscribe (struct nn_trie_node **self,
     if (*ch)
         return 1;
 
-    /*  Sparse array. */
-    if ((*self)->type < NN_TRIE_DENSE_TYPE) {
-
-        /*  Get the indices of the removed child. */
-        for (index = 0; index != (*self)->type; ++index)
-            if ((*self)->u.sparse.children [index] == *data)
-                break;
-        assert (index != (*self)->type);
-
-        /*  Remove the destroyed child from both lists of children. */
-        memmove (
-            (*self)->u.sparse.children + index,
-            (*self)->u.sparse.children + index + 1,
-            (*self)->type - index - 1);
-        memmove (
-            nn_node_child (*self, index),
-            nn_node_child (*self, index + 1),
-            ((*self)->type - index - 1) * sizeof (struct nn_trie_node*));
-        --(*self)->type;
-        *self = nn_realloc (*self, sizeof (struct nn_trie_node) +
-            ((*self)->type * sizeof (struct nn_trie_node*)));
-        assert (*self);
-        
-        /*  If there are no more children and no refcount, we can delete
-            the node altogether. */
-        if (!(*self)->type && !nn_node_has_subscribers (*self)) {
-            nn_free (*self);
-            *self = NULL;
-            return 1;
-        }
-
-        /*  Try to merge the node with the following node. */
-        *self = nn_node_compact (*self);
-
-        return 1;
-    }
-
-    /*  Dense array. */
-
-    /*  In this case the array stays dense. We have to adjust the limits of
-        the array, if appropriate. */
-    if ((*self)->u.dense.nbr > NN_TRIE_SPARSE_MAX + 1) {
-
-        /*  If the removed item is the leftmost one, trim the array from
-            the left side. */
-        if (*data == (*self)->u.dense.min) {
-             for (i = 0; i != (*self)->u.dense.max - (*self)->u.dense.min + 1;
-                   ++i)
-                 if (*nn_node_child (*self, i))
-                     break;
-             new_min = i + (*self)->u.dense.min;
-             memmove (nn_node_child (*self, 0), nn_node_child (*self, i),
-                 ((*self)->u.dense.max - new_min + 1) *
-                 sizeof (struct nn_trie_node*));
-             (*self)->u.dense.min = new_min;
-             --(*self)->u.dense.nbr;
-             *self = nn_realloc (*self, sizeof (struct nn_trie_node) +
-                 ((*self)->u.dense.max - new_min + 1) *
-                 sizeof (struct nn_trie_node*));
-             assert (*self);
-             return 1;
-        }
+    /*  Remove the destroyed child. */
+    nn_node_remove (self, *data);
 
-        /*  If the removed item is the rightmost one, trim the array from
-            the right side. */
-        if (*data == (*self)->u.dense.max) {
-             for (i = (*self)->u.dense.max - (*self)->u.dense.min; i != 0; --i)
-                 if (*nn_node_child (*self, i))
-                     break;
-             (*self)->u.dense.max = i + (*self)->u.dense.min;
-             --(*self)->u.dense.nbr;
-             *self = nn_realloc (*self, sizeof (struct nn_trie_node) +
-                 ((*self)->u.dense.max - (*self)->u.dense.min + 1) *
-                 sizeof (struct nn_trie_node*));
-             assert (*self);
-             return 1;
-        }
-
-        /*  If the item is removed from the middle of the array, do nothing. */
-        --(*self)->u.dense.nbr;
-        return 1;
-    }
-
-    /*  Convert dense array into sparse array. */
-    {
-        new_node = nn_alloc (sizeof (struct nn_trie_node) +
-            NN_TRIE_SPARSE_MAX * sizeof (struct nn_trie_node*), "trie node");
-        assert (new_node);
-        new_node->refcount = 0;
-        new_node->prefix_len = (*self)->prefix_len;
-        memcpy (new_node->prefix, (*self)->prefix, new_node->prefix_len);
-        new_node->type = NN_TRIE_SPARSE_MAX;
-        j = 0;
-        for (i = 0; i != (*self)->u.dense.max - (*self)->u.dense.min + 1;
-              ++i) {
-            ch2 = *nn_node_child (*self, i);
-            if (ch2) {
-                new_node->u.sparse.children [j] = i + (*self)->u.dense.min;
-                *nn_node_child (new_node, j) = ch2;
-                ++j;
-            }
-        }
-        assert (j == NN_TRIE_SPARSE_MAX);
+    /*  If there are no more children and no refcount, we can delete
+        the node altogether. */
+    if (!(*self)->nbr && !nn_node_has_subscribers (*self)) {
         nn_free (*self);
-        *self = new_node;
+        *self = NULL;
         return 1;
     }
 
+    /*  Try to merge the node with the following node. */
+    *self = nn_node_compact (*self);
+    return 1;
+
 found:
 
     /*  We are at the end of the subscription here. */
 
     /*  Subscription doesn't exist. */
-    if (nn_slow (!*self || !nn_node_has_subscribers (*self)))
+    if (nn_slow (!nn_node_has_subscribers (*self)))
         return -EINVAL;
 
     /*  Subscription exists. Unsubscribe. */
@@ -642,7 +683,7 @@ found:
     if (!(*self)->refcount) {
 
         /*  If there are no children, we can delete the node altogether. */
-        if (!(*self)->type) {
+        if (!(*self)->nbr) {
             nn_free (*self);
             *self = NULL;
             return 1;
@@ -658,6 +699,6 @@ found:
 
 int nn_node_has_subscribers (struct nn_trie_node *node)
 {
-    /*  Returns 1 when there are no subscribers associated with the node. */
+    /*  Returns 1 when there are subscribers associated with the node. */
     return node->refcount ? 1 : 0;
 }
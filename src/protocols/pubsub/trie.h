@@ -27,63 +27,81 @@
 
 #include <stddef.h>
 
-/*  This class implements highly memory-efficient patricia trie. */
-
-/* Maximum length of the prefix. */
-#define NN_TRIE_PREFIX_MAX 10
-
-/* Maximum number of children in the sparse mode. */
-#define NN_TRIE_SPARSE_MAX 8
-
-/* 'type' is set to this value when in the dense mode. */
-#define NN_TRIE_DENSE_TYPE (NN_TRIE_SPARSE_MAX + 1)
-
-/*  This structure represents a node in patricia trie. It's a header to be
-    followed by the array of pointers to child nodes. Each node represents
+/*  This class implements an adaptive radix trie. Nodes grow and shrink
+    between several sizes depending on the number of their children, so that
+    both sparse and highly branching levels of the trie are represented
+    compactly while the child lookup stays fast. */
+
+/*  Maximum length of the prefix. Longer strings are stored as a chain of
+    nodes. */
+#define NN_TRIE_PREFIX_MAX 0xffff
+
+/*  Node types. Leaf nodes have no children. The other types can hold up to
+    4, 16, 48 and 256 children respectively. */
+#define NN_TRIE_NODE0 0
+#define NN_TRIE_NODE4 1
+#define NN_TRIE_NODE16 2
+#define NN_TRIE_NODE48 3
+#define NN_TRIE_NODE256 4
+
+/*  This structure represents a node in the trie. It's a header to be
+    followed by the children as defined by one of the structures below,
+    depending on the node type, and then by the prefix. Each node represents
     the string composed of all the prefixes on the way from the trie root,
-    including the prefix in that node. */
+    including the prefix in that node, and of the characters leading from
+    each node to the next one. */
 struct nn_trie_node
 {
     /*  Number of subscriptions to the given string. */
     uint32_t refcount;
 
-    /*  Number of elements is a sparse array, or NN_TRIE_DENSE_TYPE in case
-        the array of children is dense. */
+    /*  The node adds more characters to the string, compared to the parent
+        node. The first one is the character leading to the node from the
+        parent, the rest is stored as a 'prefix'. */
+    uint16_t prefix_len;
+
+    /*  Number of child nodes. */
+    uint16_t nbr;
+
+    /*  One of the NN_TRIE_NODE* constants. */
     uint8_t type;
+};
 
-    /*  The node adds more characters to the string, compared to the parent
-        node. If there is only a single character added, it's represented
-        directly in the child array. If there's more than one character added,
-        all but the last one are stored as a 'prefix'. */
-    uint8_t prefix_len;
-    uint8_t prefix [NN_TRIE_PREFIX_MAX];
-
-    /*  The array of characters pointing to individual children of the node.
-        Actual pointers to child nodes are stored in the memory following
-        nn_trie_node structure. */
-    union {
-
-        /*  Sparse array means that individual children are identified by
-            characters stored in 'children' array. The number of characters
-            in the array is specified in the 'type' field. */
-        struct {
-            uint8_t children [NN_TRIE_SPARSE_MAX];
-        } sparse;
-
-        /*  Dense array means that the array of node pointers following the
-            structure corresponds to a continuous list of characters starting
-            by 'min' character and ending by 'max' character. The characters
-            in the range that have no corresponding child node are represented
-            by NULL pointers. 'nbr' is the count of child nodes. */
-        struct {
-            uint8_t min;
-            uint8_t max;
-            uint16_t nbr;
-            /*  There are 4 bytes of padding here. */
-        } dense;
-    } u;
+/*  Up to 4 children. The characters leading to the children are stored in
+    'keys' in no particular order. */
+struct nn_trie_node4
+{
+    struct nn_trie_node hdr;
+    uint8_t keys [4];
+    struct nn_trie_node *children [4];
+};
+
+/*  Up to 16 children, organised the same way as in nn_trie_node4. The keys
+    fit into a single SSE2 register so that all of them can be compared to
+    the character being looked for at once. */
+struct nn_trie_node16
+{
+    struct nn_trie_node hdr;
+    uint8_t keys [16];
+    struct nn_trie_node *children [16];
+};
+
+/*  Up to 48 children. 'index' maps each character to the position of the
+    corresponding child in 'children' array plus one, zero meaning there's
+    no such child. */
+struct nn_trie_node48
+{
+    struct nn_trie_node hdr;
+    uint8_t index [256];
+    struct nn_trie_node *children [48];
+};
+
+/*  Child nodes are directly indexed by the character leading to them. */
+struct nn_trie_node256
+{
+    struct nn_trie_node hdr;
+    struct nn_trie_node *children [256];
 };
-/*  The structure is followed by the array of pointers to children. */
 
 struct nn_trie {
 
@@ -105,7 +123,7 @@ int nn_trie_subscribe (struct nn_trie *self, const uint8_t *data, size_t size);
 
 /*  Remove the string from the trie. If the string was actually removed,
     1 is returned. If reference count was decremented without falling to zero,
-    0 is returned. */
+    0 is returned. If the string is not in the trie, -EINVAL is returned. */
 int nn_trie_unsubscribe (struct nn_trie *self, const uint8_t *data,
     size_t size);
 
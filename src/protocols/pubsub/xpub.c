@@ -21,7 +21,7 @@
 */
 
 #include "xpub.h"
-#include "trie.h"
+#include "subindex.h"
 
 #include "../../nn.h"
 #include "../../pubsub.h"
@@ -41,13 +41,17 @@
 struct nn_xpub_data {
 	struct nn_fq_data in_item;
     struct nn_dist_data out_item;
-	struct nn_trie trie;
+	struct nn_subindex_subscriber sub;
 };
 
 struct nn_xpub {
     struct nn_sockbase sockbase;
     struct nn_fq in_pipes;
     struct nn_dist out_pipes;
+
+    /*  Subscriptions of all the pipes. Matching a message against it yields
+        the set of subscribed pipes in a single walk of the topic. */
+    struct nn_subindex subs;
 };
 
 /*  Private functions. */
@@ -66,8 +70,8 @@ static int nn_xpub_send (struct nn_sockbase *self, struct nn_msg *msg);
 static int nn_xpub_recv (struct nn_sockbase *self, struct nn_msg *msg);
 static int nn_xpub_setopt (struct nn_sockbase *self, int level, int option, const void *optval, size_t optvallen);
 static int nn_xpub_getopt (struct nn_sockbase *self, int level, int option, void *optval, size_t *optvallen);
-static int nn_xpub_subscribe(struct nn_sockbase *self, struct nn_trie *trie, const void *subval, size_t subvallen);
-static int nn_xpub_unsubscribe(struct nn_sockbase *self, struct nn_trie *trie, const void *subval, size_t subvallen);
+static int nn_xpub_subscribe(struct nn_sockbase *self, struct nn_xpub_data *data, const void *subval, size_t subvallen);
+static int nn_xpub_unsubscribe(struct nn_sockbase *self, struct nn_xpub_data *data, const void *subval, size_t subvallen);
 static int nn_xpub_handle_event(struct nn_sockbase *self, struct nn_msg *msg, struct nn_pipe *pipe);
 static const struct nn_sockbase_vfptr nn_xpub_sockbase_vfptr = {
     NULL,
@@ -89,10 +93,12 @@ static void nn_xpub_init (struct nn_xpub *self,
     nn_sockbase_init (&self->sockbase, vfptr, hint);
     nn_dist_init (&self->out_pipes);
 	nn_fq_init(&self->in_pipes);
+    nn_subindex_init (&self->subs);
 }
 
 static void nn_xpub_term (struct nn_xpub *self)
 {
+    nn_subindex_term (&self->subs);
 	nn_fq_term(&self->in_pipes);
     nn_dist_term (&self->out_pipes);
     nn_sockbase_term (&self->sockbase);
@@ -125,7 +131,7 @@ static int nn_xpub_add (struct nn_sockbase *self, struct nn_pipe *pipe)
     data = nn_alloc (sizeof (struct nn_xpub_data), "pipe data (pub)");
     alloc_assert (data);
 	
-	nn_trie_init(&data->trie);
+	nn_subindex_subscriber_init(&data->sub);
     nn_dist_add (&xpub->out_pipes, &data->out_item, pipe);
 	nn_fq_add(&xpub->in_pipes, &data->in_item, pipe, rcvprio);
     nn_pipe_setdata (pipe, data);
@@ -145,7 +151,8 @@ static void nn_xpub_rm (struct nn_sockbase *self, struct nn_pipe *pipe)
     xpub = nn_cont (self, struct nn_xpub, sockbase);
     data = nn_pipe_getdata (pipe);
 
-	nn_trie_term(&data->trie);
+	nn_subindex_rm(&xpub->subs, &data->sub);
+	nn_subindex_subscriber_term(&data->sub);
     nn_dist_rm (&xpub->out_pipes, &data->out_item);
 	nn_fq_rm(&xpub->in_pipes, &data->in_item);
     nn_free (data);
@@ -178,22 +185,25 @@ static int nn_xpub_events (NN_UNUSED struct nn_sockbase *self)
 	struct nn_xpub* sock;
 	sock = nn_cont(self, struct nn_xpub, sockbase);
 	return (nn_fq_can_recv(&sock->in_pipes) ? NN_SOCKBASE_EVENT_IN : 0) |
-		(nn_lb_can_send(&sock->out_pipes) ? NN_SOCKBASE_EVENT_OUT : 0);
+		NN_SOCKBASE_EVENT_OUT;
 }
 
 static int nn_xpub_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
+	struct nn_xpub *xpub;
 	struct nn_xpub_data *pipe_data;
 	struct nn_dist *dist;
 	char op;
 	int rc;
-	struct nn_list_item *it;
-	struct nn_dist_data *data;
+	size_t i;
+	size_t nmatches;
+	uint32_t count;
 	struct nn_msg copy;
 	
 	// Get the message header
 	op = *((char*)nn_chunkref_data(&msg->body));
-	dist = &(nn_cont(self, struct nn_xpub, sockbase)->out_pipes);
+	xpub = nn_cont(self, struct nn_xpub, sockbase);
+	dist = &xpub->out_pipes;
 
 	//printf("send: %s", nn_chunkref_data(&msg->body));
 
@@ -207,31 +217,36 @@ static int nn_xpub_send (struct nn_sockbase *self, struct nn_msg *msg)
 			return 0;
 		}
 
-		/*  Send the message to all the subscribers. */
-		nn_msg_bulkcopy_start(msg, dist->count);
-		it = nn_list_begin(&dist->pipes);
-		while (it != nn_list_end(&dist->pipes)) {
-			data = nn_cont(it, struct nn_dist_data, item);
-			nn_msg_bulkcopy_cp(&copy, msg);
+		/*  Find the subscribed pipes. Of those, only the ones that are
+		    currently writable (i.e. part of the distributor) get the
+		    message. */
+		nmatches = nn_subindex_match(&xpub->subs,
+			(uint8_t*)nn_chunkref_data(&msg->body) + 1,
+			nn_chunkref_size(&msg->body) - 1);
+		count = 0;
+		for (i = 0; i != nmatches; ++i) {
+			pipe_data = nn_cont(xpub->subs.matches[i], struct nn_xpub_data, sub);
+			if (nn_list_item_isinlist(&pipe_data->out_item.item))
+				++count;
+		}
+		if (count == 0) {
+			nn_msg_term(msg);
+			return 0;
+		}
 
-			// Match the message
-			pipe_data = (struct nn_xpub_data*)(nn_pipe_getdata(data->pipe));
-			rc = nn_trie_match(&pipe_data->trie, (uint8_t*)nn_chunkref_data(&msg->body) + 1, nn_chunkref_size(&msg->body) - 1);
-			if (rc == 0) {
-				//printf("no subscribers: %s", nn_chunkref_data(&msg->body));
-				nn_msg_term(&copy);
-			} else if (rc == 1) {
-				rc = nn_pipe_send(data->pipe, &copy);
-				errnum_assert(rc >= 0, -rc);
-				if (rc & NN_PIPE_RELEASE) {
-					--dist->count;
-					it = nn_list_erase(&dist->pipes, it);
-					continue;
-				}
-			} else {
-				errnum_assert(0, -rc);
+		/*  Send the message to all the matching subscribers. */
+		nn_msg_bulkcopy_start(msg, count);
+		for (i = 0; i != nmatches; ++i) {
+			pipe_data = nn_cont(xpub->subs.matches[i], struct nn_xpub_data, sub);
+			if (!nn_list_item_isinlist(&pipe_data->out_item.item))
+				continue;
+			nn_msg_bulkcopy_cp(&copy, msg);
+			rc = nn_pipe_send(pipe_data->out_item.pipe, &copy);
+			errnum_assert(rc >= 0, -rc);
+			if (rc & NN_PIPE_RELEASE) {
+				--dist->count;
+				nn_list_erase(&dist->pipes, &pipe_data->out_item.item);
 			}
-			it = nn_list_next(&dist->pipes, it);
 		}
 		nn_msg_term(msg);
 		return 0;
@@ -299,12 +314,12 @@ static int nn_xpub_handle_event(struct nn_sockbase *self, struct nn_msg *msg, st
 
 	if (op == 83) { // 'S'
 		printf("[XPUB] Subscribe: %d to '%s' \n", pipe, topic);
-		nn_xpub_subscribe(self, &pipe_data->trie, topic, size);
+		nn_xpub_subscribe(self, pipe_data, topic, size);
 	}
 
 	if (op == 85) { // 'U'
 		printf("[XPUB] Unsubscribe: %d from '%s' \n", pipe, topic);
-		nn_xpub_unsubscribe(self, &pipe_data->trie, topic, size);
+		nn_xpub_unsubscribe(self, pipe_data, topic, size);
 	}
 
 
@@ -318,25 +333,25 @@ static int nn_xpub_handle_event(struct nn_sockbase *self, struct nn_msg *msg, st
 }
 
 
-static int nn_xpub_subscribe(struct nn_sockbase *self, struct nn_trie *trie, const void *subval, size_t subvallen)
+static int nn_xpub_subscribe(struct nn_sockbase *self, struct nn_xpub_data *data, const void *subval, size_t subvallen)
 {
 	int rc;
 	struct nn_xpub *xpub;
 
 	xpub = nn_cont(self, struct nn_xpub, sockbase);
-	rc = nn_trie_subscribe(trie, subval, subvallen);
+	rc = nn_subindex_subscribe(&xpub->subs, &data->sub, subval, subvallen);
 	if (rc >= 0)
 		return 0;
 	return rc;
 }
 
-static int nn_xpub_unsubscribe(struct nn_sockbase *self, struct nn_trie *trie, const void *subval, size_t subvallen)
+static int nn_xpub_unsubscribe(struct nn_sockbase *self, struct nn_xpub_data *data, const void *subval, size_t subvallen)
 {
 	int rc;
 	struct nn_xpub *xpub;
 
 	xpub = nn_cont(self, struct nn_xpub, sockbase);
-	rc = nn_trie_unsubscribe(trie, subval, subvallen);
+	rc = nn_subindex_unsubscribe(&xpub->subs, &data->sub, subval, subvallen);
 	if (rc >= 0)
 		return 0;
 	return rc;
@@ -376,7 +391,7 @@ int nn_xpub_ispeer (int socktype)
 static struct nn_socktype nn_xpub_socktype_struct = {
     AF_SP_RAW,
     NN_PUB,
-    NN_SOCKTYPE_FLAG_NORECV,
+    NN_SOCKTYPE_FLAG_NORECV | NN_SOCKTYPE_FLAG_FLATSEND,
     nn_xpub_create,
     nn_xpub_ispeer,
     NN_LIST_ITEM_INITIALIZER
@@ -174,7 +174,7 @@ static int nn_xsub_events (struct nn_sockbase *self)
 	struct nn_xsub* sock;
 	sock = nn_cont(self, struct nn_xsub, sockbase);
 	return (nn_fq_can_recv(&sock->in_pipes) ? NN_SOCKBASE_EVENT_IN : 0) |
-		(nn_lb_can_send(&sock->out_pipes) ? NN_SOCKBASE_EVENT_OUT : 0);
+		NN_SOCKBASE_EVENT_OUT;
 }
 
 static int nn_xsub_send(struct nn_sockbase *self, struct nn_msg *msg)
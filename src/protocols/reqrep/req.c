@@ -44,6 +44,13 @@
 /*  Default re-send interval is 1 minute. */
 #define NN_REQ_DEFAULT_RESEND_IVL 60000
 
+/*  When the re-send interval is derived from the measured reply latency,
+    requests are never re-sent sooner than this. */
+#define NN_REQ_MIN_RESEND_IVL 10
+
+/*  Duplicates of hedged requests are never sent sooner than this. */
+#define NN_REQ_MIN_HEDGE_DELAY 1
+
 #define NN_REQ_STATE_IDLE 1
 #define NN_REQ_STATE_PASSIVE 2
 #define NN_REQ_STATE_DELAYED 3
@@ -62,6 +69,25 @@
 #define NN_REQ_ACTION_PIPE_RM 6
 
 #define NN_REQ_SRC_RESEND_TIMER 1
+#define NN_REQ_SRC_PIPELINE_TIMER 2
+
+/*  Private functions. */
+static int nn_req_ivl (struct nn_req *self, struct nn_pipe *pipe,
+    int attempts);
+static int nn_req_gethndl (struct nn_msg *msg, nn_req_handle *hndl);
+static void nn_req_sethndl (struct nn_msg *msg, const nn_req_handle *hndl);
+static void nn_req_call_destroy (struct nn_req_call *call);
+static void nn_req_drop (struct nn_req *self, struct nn_list *list);
+static int nn_req_submit (struct nn_req *self, struct nn_msg *msg);
+static void nn_req_flush (struct nn_req *self);
+static void nn_req_setdeadline (struct nn_req *self,
+    struct nn_req_call *call, uint64_t now);
+static void nn_req_schedule (struct nn_req *self, struct nn_req_call *call);
+static void nn_req_hedge (struct nn_req *self, struct nn_req_call *call,
+    uint64_t now);
+static void nn_req_settimer (struct nn_req *self);
+static void nn_req_timeout (struct nn_req *self);
+static void nn_req_collect (struct nn_req *self);
 
 static const struct nn_sockbase_vfptr nn_req_sockbase_vfptr = {
     nn_req_stop,
@@ -92,11 +118,26 @@ void nn_req_init (struct nn_req *self,
     nn_random_generate (&self->lastid, sizeof (self->lastid));
 
     self->task.sent_to = NULL;
+    self->task.sent_at = 0;
+    self->task.attempts = 0;
 
     nn_msg_init (&self->task.request, 0);
     nn_msg_init (&self->task.reply, 0);
     nn_timer_init (&self->task.timer, NN_REQ_SRC_RESEND_TIMER, &self->fsm);
     self->resend_ivl = NN_REQ_DEFAULT_RESEND_IVL;
+    self->adaptive = 0;
+    self->hedge = 0;
+
+    /*  Pipelining is switched off by default. */
+    self->pipeline = 1;
+    nn_hash_init (&self->calls);
+    nn_list_init (&self->delayed);
+    nn_list_init (&self->outstanding);
+    nn_list_init (&self->replies);
+    self->ncalls = 0;
+    nn_timer_init (&self->timer, NN_REQ_SRC_PIPELINE_TIMER, &self->fsm);
+    self->expiry = 0;
+    nn_clock_init (&self->clock);
 
     /*  For now, handle is empty. */
     memset (&hndl, 0, sizeof (hndl));
@@ -108,6 +149,16 @@ void nn_req_init (struct nn_req *self,
 
 void nn_req_term (struct nn_req *self)
 {
+    nn_req_drop (self, &self->delayed);
+    nn_req_drop (self, &self->outstanding);
+    nn_req_drop (self, &self->replies);
+    nn_assert (self->ncalls == 0);
+    nn_clock_term (&self->clock);
+    nn_timer_term (&self->timer);
+    nn_list_term (&self->replies);
+    nn_list_term (&self->outstanding);
+    nn_list_term (&self->delayed);
+    nn_hash_term (&self->calls);
     nn_timer_term (&self->task.timer);
     nn_task_term (&self->task);
     nn_msg_term (&self->task.reply);
@@ -148,16 +199,23 @@ void nn_req_in (struct nn_sockbase *self, struct nn_pipe *pipe)
     int rc;
     struct nn_req *req;
     uint32_t reqid;
+    struct nn_pipe *from;
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
     /*  Pass the pipe to the raw REQ socket. */
     nn_xreq_in (&req->xreq.sockbase, pipe);
 
+    if (req->pipeline > 1) {
+        nn_req_collect (req);
+        return;
+    }
+
     while (1) {
 
         /*  Get new reply. */
-        rc = nn_xreq_recv (&req->xreq.sockbase, &req->task.reply);
+        rc = nn_xreq_recv_from (&req->xreq.sockbase, &req->task.reply,
+            &from);
         if (nn_slow (rc == -EAGAIN))
             return;
         errnum_assert (rc == 0, -rc);
@@ -192,6 +250,13 @@ void nn_req_in (struct nn_sockbase *self, struct nn_pipe *pipe)
 
         /*  TODO: Deallocate the request here? */
 
+        /*  Measure the reply latency of the peer. If the request was re-sent
+            it's not clear which of the copies is being replied to. */
+        if (req->state == NN_REQ_STATE_ACTIVE && req->task.attempts == 0 &&
+              from == req->task.sent_to)
+            nn_rtt_sample (nn_xreq_getrtt (from),
+                (int) (nn_clock_now (&req->clock) - req->task.sent_at));
+
         /*  Notify the state machine. */
         if (req->state == NN_REQ_STATE_ACTIVE)
             nn_fsm_action (&req->fsm, NN_REQ_ACTION_IN);
@@ -209,6 +274,12 @@ void nn_req_out (struct nn_sockbase *self, struct nn_pipe *pipe)
     /*  Add the pipe to the underlying raw socket. */
     nn_xreq_out (&req->xreq.sockbase, pipe);
 
+    /*  In pipelined mode, send the requests that are waiting for a peer. */
+    if (req->pipeline > 1) {
+        nn_req_flush (req);
+        return;
+    }
+
     /*  Notify the state machine. */
     if (req->state == NN_REQ_STATE_DELAYED)
         nn_fsm_action (&req->fsm, NN_REQ_ACTION_OUT);
@@ -221,6 +292,15 @@ int nn_req_events (struct nn_sockbase *self)
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
+    /*  In pipelined mode OUT is signalled while the limit of requests in
+        progress is not reached and IN while there are replies to retrieve. */
+    if (req->pipeline > 1) {
+        rc = req->ncalls < req->pipeline ? NN_SOCKBASE_EVENT_OUT : 0;
+        if (!nn_list_empty (&req->replies))
+            rc |= NN_SOCKBASE_EVENT_IN;
+        return rc;
+    }
+
     /*  OUT is signalled all the time because sending a request while
         another one is being processed cancels the old one. */
     rc = NN_SOCKBASE_EVENT_OUT;
@@ -235,7 +315,28 @@ int nn_req_events (struct nn_sockbase *self)
 int nn_req_send (int s, nn_req_handle hndl, const void *buf, size_t len,
     int flags)
 {
-    nn_assert (0);
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr cmsg;
+    size_t ctrl [NN_CMSG_SPACE (sizeof (nn_req_handle)) / sizeof (size_t)];
+
+    /*  The handle is passed to the socket as ancillary data. */
+    cmsg.cmsg_len = NN_CMSG_LEN (sizeof (nn_req_handle));
+    cmsg.cmsg_level = NN_REQ;
+    cmsg.cmsg_type = NN_REQ_HANDLE;
+    memset (ctrl, 0, sizeof (ctrl));
+    memcpy (ctrl, &cmsg, sizeof (cmsg));
+    memcpy (NN_CMSG_DATA (ctrl), &hndl, sizeof (hndl));
+
+    iov.iov_base = (void*) buf;
+    iov.iov_len = len;
+
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctrl;
+    hdr.msg_controllen = sizeof (ctrl);
+
+    return nn_sendmsg (s, &hdr, flags);
 }
 
 int nn_req_csend (struct nn_sockbase *self, struct nn_msg *msg)
@@ -244,15 +345,23 @@ int nn_req_csend (struct nn_sockbase *self, struct nn_msg *msg)
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
+    if (req->pipeline > 1)
+        return nn_req_submit (req, msg);
+
     /*  Generate new request ID for the new request and put it into message
         header. The most important bit is set to 1 to indicate that this is
         the bottom of the backtrace stack. */
     ++req->task.id;
+    req->task.attempts = 0;
     nn_assert (nn_chunkref_size (&msg->sphdr) == 0);
     nn_chunkref_term (&msg->sphdr);
     nn_chunkref_init (&msg->sphdr, 4);
     nn_putl (nn_chunkref_data (&msg->sphdr), req->task.id | 0x80000000);
 
+    /*  Remember the handle of the request so that it can be attached to
+        the reply. */
+    req->task.hashndl = nn_req_gethndl (msg, &req->task.hndl);
+
     /*  Store the message so that it can be re-sent if there's no reply. */
     nn_msg_term (&req->task.request);
     nn_msg_mv (&req->task.request, msg);
@@ -266,16 +375,63 @@ int nn_req_csend (struct nn_sockbase *self, struct nn_msg *msg)
 int nn_req_recv (int s, nn_req_handle *hndl, void *buf, size_t len,
     int flags)
 {
-    nn_assert (0);
-}
+    int rc;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    size_t ctrl [32];
+
+    iov.iov_base = buf;
+    iov.iov_len = len;
+
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctrl;
+    hdr.msg_controllen = sizeof (ctrl);
+
+    rc = nn_recvmsg (s, &hdr, flags);
+    if (nn_slow (rc < 0))
+        return rc;
+
+    /*  Retrieve the handle of the request from the ancillary data. If the
+        request was sent without a handle, return an empty one. */
+    memset (hndl, 0, sizeof (nn_req_handle));
+    cmsg = NN_CMSG_FIRSTHDR (&hdr);
+    while (cmsg) {
+        if (cmsg->cmsg_level == NN_REQ && cmsg->cmsg_type == NN_REQ_HANDLE) {
+            memcpy (hndl, NN_CMSG_DATA (cmsg), sizeof (nn_req_handle));
+            break;
+        }
+        cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+    }
 
+    return rc;
+}
 
 int nn_req_crecv (struct nn_sockbase *self, struct nn_msg *msg)
 {
     struct nn_req *req;
+    struct nn_req_call *call;
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
+    /*  In pipelined mode, replies are passed to the user in the order they
+        have arrived. */
+    if (req->pipeline > 1) {
+        if (nn_slow (nn_list_empty (&req->replies)))
+            return req->ncalls ? -EAGAIN : -EFSM;
+        call = nn_cont (nn_list_begin (&req->replies), struct nn_req_call,
+            item);
+        nn_list_erase (&req->replies, &call->item);
+        --req->ncalls;
+        nn_msg_mv (msg, &call->reply);
+        nn_msg_init (&call->reply, 0);
+        if (call->hashndl)
+            nn_req_sethndl (msg, &call->hndl);
+        nn_req_call_destroy (call);
+        return 0;
+    }
+
     /*  No request was sent. Waiting for a reply doesn't make sense. */
     if (nn_slow (!nn_req_inprogress (req)))
         return -EFSM;
@@ -287,6 +443,8 @@ int nn_req_crecv (struct nn_sockbase *self, struct nn_msg *msg)
     /*  If the reply was already received, just pass it to the caller. */
     nn_msg_mv (msg, &req->task.reply);
     nn_msg_init (&req->task.reply, 0);
+    if (req->task.hashndl)
+        nn_req_sethndl (msg, &req->task.hndl);
 
     /*  Notify the state machine. */
     nn_fsm_action (&req->fsm, NN_REQ_ACTION_RECEIVED);
@@ -298,6 +456,7 @@ int nn_req_setopt (struct nn_sockbase *self, int level, int option,
         const void *optval, size_t optvallen)
 {
     struct nn_req *req;
+    int val;
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
@@ -311,7 +470,45 @@ int nn_req_setopt (struct nn_sockbase *self, int level, int option,
         return 0;
     }
 
-    return -ENOPROTOOPT;
+    if (option == NN_REQ_RESEND_ADAPTIVE) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        val = *(int*) optval;
+        if (nn_slow (val != 0 && val != 1))
+            return -EINVAL;
+        req->adaptive = val;
+        return 0;
+    }
+
+    if (option == NN_REQ_HEDGE) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        val = *(int*) optval;
+        if (nn_slow (val < 0 || val > 100))
+            return -EINVAL;
+        req->hedge = val;
+        return 0;
+    }
+
+    if (option == NN_REQ_PIPELINE) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        val = *(int*) optval;
+        if (nn_slow (val < 1))
+            return -EINVAL;
+
+        /*  Switching between the classic and the pipelined mode is possible
+            only while there are no requests in progress. */
+        if (nn_slow ((val > 1) != (req->pipeline > 1) &&
+              (req->ncalls || nn_req_inprogress (req))))
+            return -EFSM;
+
+        req->pipeline = val;
+        return 0;
+    }
+
+    /*  Options of the raw socket. */
+    return nn_xreq_setopt (self, level, option, optval, optvallen);
 }
 
 int nn_req_getopt (struct nn_sockbase *self, int level, int option,
@@ -332,7 +529,32 @@ int nn_req_getopt (struct nn_sockbase *self, int level, int option,
         return 0;
     }
 
-    return -ENOPROTOOPT;
+    if (option == NN_REQ_PIPELINE) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = req->pipeline;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_REQ_RESEND_ADAPTIVE) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = req->adaptive;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_REQ_HEDGE) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = req->hedge;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    /*  Options of the raw socket. */
+    return nn_xreq_getopt (self, level, option, optval, optvallen);
 }
 
 void nn_req_shutdown (struct nn_fsm *self, int src, int type,
@@ -344,10 +566,12 @@ void nn_req_shutdown (struct nn_fsm *self, int src, int type,
 
     if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
         nn_timer_stop (&req->task.timer);
+        nn_timer_stop (&req->timer);
         req->state = NN_REQ_STATE_STOPPING;
     }
     if (nn_slow (req->state == NN_REQ_STATE_STOPPING)) {
-        if (!nn_timer_isidle (&req->task.timer))
+        if (!nn_timer_isidle (&req->task.timer) ||
+              !nn_timer_isidle (&req->timer))
             return;
         req->state = NN_REQ_STATE_IDLE;
         nn_fsm_stopped_noevent (&req->fsm);
@@ -365,6 +589,22 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
 
     req = nn_cont (self, struct nn_req, fsm);
 
+    /*  The timer of the pipelined mode is independent of the state of the
+        classic request. It may still be running when the socket was switched
+        back to the classic mode. */
+    if (src == NN_REQ_SRC_PIPELINE_TIMER) {
+        switch (type) {
+        case NN_TIMER_TIMEOUT:
+            nn_timer_stop (&req->timer);
+            return;
+        case NN_TIMER_STOPPED:
+            nn_req_timeout (req);
+            return;
+        default:
+            nn_fsm_bad_action (req->state, src, type);
+        }
+    }
+
     switch (req->state) {
 
 /******************************************************************************/
@@ -475,6 +715,7 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
             case NN_TIMER_TIMEOUT:
                 nn_timer_stop (&req->task.timer);
                 req->task.sent_to = NULL;
+                ++req->task.attempts;
                 req->state = NN_REQ_STATE_TIMED_OUT;
                 return;
             default:
@@ -641,9 +882,11 @@ void nn_req_action_send (struct nn_req *self, int allow_delay)
         in case the request gets lost somewhere further out
         in the topology. */
     if (nn_fast (rc == 0)) {
-        nn_timer_start (&self->task.timer, self->resend_ivl);
         nn_assert (to);
+        nn_timer_start (&self->task.timer,
+            nn_req_ivl (self, to, self->task.attempts));
         self->task.sent_to = to;
+        self->task.sent_at = nn_clock_now (&self->clock);
         self->state = NN_REQ_STATE_ACTIVE;
         return;
     }
@@ -666,15 +909,407 @@ static int nn_req_create (void *hint, struct nn_sockbase **sockbase)
 
 void nn_req_rm (struct nn_sockbase *self, struct nn_pipe *pipe) {
     struct nn_req *req;
+    struct nn_list_item *it;
+    struct nn_req_call *call;
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
     nn_xreq_rm (self, pipe);
+
+    /*  Requests sent to the pipe are re-sent immediately, unless there's
+        a duplicate of the request sent to a different pipe. */
+    if (req->pipeline > 1) {
+        it = nn_list_begin (&req->outstanding);
+        while (it != nn_list_end (&req->outstanding)) {
+            call = nn_cont (it, struct nn_req_call, item);
+            it = nn_list_next (&req->outstanding, it);
+            if (call->hedged_to == pipe)
+                call->hedged_to = NULL;
+            if (call->sent_to != pipe)
+                continue;
+            if (call->hedged_to) {
+                call->sent_to = call->hedged_to;
+                call->sent_at = call->hedged_at;
+                call->hedged_to = NULL;
+                continue;
+            }
+            nn_list_erase (&req->outstanding, &call->item);
+            call->sent_to = NULL;
+            nn_list_insert (&req->delayed, &call->item,
+                nn_list_end (&req->delayed));
+        }
+        nn_req_flush (req);
+        return;
+    }
+
     if (nn_slow (pipe == req->task.sent_to)) {
         nn_fsm_action (&req->fsm, NN_REQ_ACTION_PIPE_RM);
     }
 }
 
+/*  Returns the interval after which the request sent to the pipe should be
+    re-sent. 'attempts' is the number of times the request has already been
+    re-sent because of a timeout. */
+static int nn_req_ivl (struct nn_req *self, struct nn_pipe *pipe,
+    int attempts)
+{
+    int ivl;
+
+    if (!self->adaptive)
+        return self->resend_ivl;
+
+    /*  Until there's a reply from the peer, use the configured interval. */
+    ivl = nn_rtt_timeout (nn_xreq_getrtt (pipe));
+    if (ivl < 0)
+        return self->resend_ivl;
+    if (ivl < NN_REQ_MIN_RESEND_IVL)
+        ivl = NN_REQ_MIN_RESEND_IVL;
+
+    /*  Back off exponentially so that a slow peer is not flooded by copies
+        of the same request. The configured interval is the upper bound. */
+    while (attempts-- && ivl < self->resend_ivl)
+        ivl *= 2;
+
+    return ivl < self->resend_ivl ? ivl : self->resend_ivl;
+}
+
+/******************************************************************************/
+/*  Pipelined mode.                                                           */
+/*  Each request has its own ID and is stored in 'calls' hash until the reply */
+/*  arrives. Requests are moved between 'delayed' (waiting for a peer),       */
+/*  'outstanding' (waiting for the reply) and 'replies' (waiting for the      */
+/*  user) lists. Instead of a timer per request, there is a single timer set  */
+/*  to the earliest re-send deadline.                                         */
+/******************************************************************************/
+
+/*  If the message carries the handle of the request in its ancillary data,
+    the handle is retrieved and removed from the message. Other properties,
+    such as the routing key, are left in place. Returns 1 if the handle was
+    found, 0 otherwise. */
+static int nn_req_gethndl (struct nn_msg *msg, nn_req_handle *hndl)
+{
+    struct nn_cmsghdr *cmsg;
+
+    cmsg = nn_msg_getcmsg (msg, NN_REQ, NN_REQ_HANDLE);
+    if (!cmsg || cmsg->cmsg_len < NN_CMSG_LEN (sizeof (nn_req_handle)))
+        return 0;
+    memcpy (hndl, NN_CMSG_DATA (cmsg), sizeof (nn_req_handle));
+    nn_msg_rmcmsg (msg, cmsg);
+    return 1;
+}
+
+/*  Replaces the ancillary data of the message by the handle of the request. */
+static void nn_req_sethndl (struct nn_msg *msg, const nn_req_handle *hndl)
+{
+    struct nn_cmsghdr cmsg;
+    uint8_t *data;
+
+    cmsg.cmsg_len = NN_CMSG_LEN (sizeof (nn_req_handle));
+    cmsg.cmsg_level = NN_REQ;
+    cmsg.cmsg_type = NN_REQ_HANDLE;
+
+    nn_chunkref_term (&msg->hdrs);
+    nn_chunkref_init (&msg->hdrs, NN_CMSG_SPACE (sizeof (nn_req_handle)));
+    data = nn_chunkref_data (&msg->hdrs);
+    memset (data, 0, NN_CMSG_SPACE (sizeof (nn_req_handle)));
+    memcpy (data, &cmsg, sizeof (cmsg));
+    memcpy (NN_CMSG_DATA (data), hndl, sizeof (nn_req_handle));
+}
+
+static void nn_req_call_destroy (struct nn_req_call *call)
+{
+    nn_list_item_term (&call->item);
+    nn_hash_item_term (&call->hitem);
+    nn_msg_term (&call->reply);
+    nn_msg_term (&call->request);
+    nn_free (call);
+}
+
+/*  Deallocates all the requests in the list. */
+static void nn_req_drop (struct nn_req *self, struct nn_list *list)
+{
+    struct nn_req_call *call;
+
+    while (!nn_list_empty (list)) {
+        call = nn_cont (nn_list_begin (list), struct nn_req_call, item);
+        nn_list_erase (list, &call->item);
+        if (list != &self->replies)
+            nn_hash_erase (&self->calls, &call->hitem);
+        --self->ncalls;
+        nn_req_call_destroy (call);
+    }
+}
+
+static int nn_req_submit (struct nn_req *self, struct nn_msg *msg)
+{
+    struct nn_req_call *call;
+
+    /*  Wait till some of the requests in progress are replied to. */
+    if (nn_slow (self->ncalls >= self->pipeline))
+        return -EAGAIN;
+
+    call = nn_alloc (sizeof (struct nn_req_call), "request (req)");
+    alloc_assert (call);
+
+    /*  Generate new request ID for the request and put it into message
+        header. The most important bit is set to 1 to indicate that this is
+        the bottom of the backtrace stack. */
+    call->id = ++self->lastid | 0x80000000;
+    nn_assert (nn_chunkref_size (&msg->sphdr) == 0);
+    nn_chunkref_term (&msg->sphdr);
+    nn_chunkref_init (&msg->sphdr, 4);
+    nn_putl (nn_chunkref_data (&msg->sphdr), call->id);
+
+    call->hashndl = nn_req_gethndl (msg, &call->hndl);
+    nn_msg_mv (&call->request, msg);
+    nn_msg_init (&call->reply, 0);
+    call->sent_to = NULL;
+    call->sent_at = 0;
+    call->attempts = 0;
+    call->deadline = 0;
+    call->hedging = 0;
+    call->resend_at = 0;
+    call->hedged_to = NULL;
+    call->hedged_at = 0;
+    nn_hash_item_init (&call->hitem);
+    nn_list_item_init (&call->item);
+
+    nn_hash_insert (&self->calls, call->id, &call->hitem);
+    nn_list_insert (&self->delayed, &call->item, nn_list_end (&self->delayed));
+    ++self->ncalls;
+
+    nn_req_flush (self);
+
+    return 0;
+}
+
+/*  Sends as many of the delayed requests as possible. */
+static void nn_req_flush (struct nn_req *self)
+{
+    int rc;
+    struct nn_msg msg;
+    struct nn_pipe *to;
+    struct nn_req_call *call;
+    uint64_t now;
+
+    now = nn_clock_now (&self->clock);
+    while (!nn_list_empty (&self->delayed)) {
+        call = nn_cont (nn_list_begin (&self->delayed), struct nn_req_call,
+            item);
+        nn_msg_cp (&msg, &call->request);
+        rc = nn_xreq_send_to (&self->xreq.sockbase, &msg, &to);
+        if (nn_slow (rc == -EAGAIN)) {
+            nn_msg_term (&msg);
+            break;
+        }
+        errnum_assert (rc == 0, -rc);
+        nn_assert (to);
+
+        nn_list_erase (&self->delayed, &call->item);
+        call->sent_to = to;
+        call->sent_at = now;
+        call->hedged_to = NULL;
+        nn_req_setdeadline (self, call, now);
+        nn_req_schedule (self, call);
+    }
+
+    nn_req_settimer (self);
+}
+
+/*  Sets the point in time when the request that was just sent should be
+    re-sent or, with hedging enabled, duplicated to another pipe. */
+static void nn_req_setdeadline (struct nn_req *self,
+    struct nn_req_call *call, uint64_t now)
+{
+    int delay;
+
+    call->deadline = now + nn_req_ivl (self, call->sent_to, call->attempts);
+    call->hedging = 0;
+
+    /*  Duplicate the request once the reply is later than the given
+        percentile of the reply latency of the peer. */
+    if (self->hedge) {
+        delay = nn_rtt_percentile (nn_xreq_getrtt (call->sent_to),
+            self->hedge);
+        if (delay < 0)
+            return;
+        if (delay < NN_REQ_MIN_HEDGE_DELAY)
+            delay = NN_REQ_MIN_HEDGE_DELAY;
+        if (now + delay < call->deadline) {
+            call->resend_at = call->deadline;
+            call->deadline = now + delay;
+            call->hedging = 1;
+        }
+    }
+}
+
+/*  Sends a duplicate of the request to a pipe other than the one the request
+    was sent to. Whichever reply arrives first is passed to the user. */
+static void nn_req_hedge (struct nn_req *self, struct nn_req_call *call,
+    uint64_t now)
+{
+    int rc;
+    struct nn_msg msg;
+    struct nn_pipe *to;
+
+    nn_msg_cp (&msg, &call->request);
+    rc = nn_xreq_send_except (&self->xreq.sockbase, &msg, call->sent_to, &to);
+    if (nn_slow (rc == -EAGAIN)) {
+        nn_msg_term (&msg);
+        return;
+    }
+    errnum_assert (rc == 0, -rc);
+    call->hedged_to = to;
+    call->hedged_at = now;
+}
+
+/*  Inserts the request into the list of outstanding requests so that
+    the list remains ordered by the deadline. Unless the re-send interval was
+    changed, the request belongs to the end of the list. */
+static void nn_req_schedule (struct nn_req *self, struct nn_req_call *call)
+{
+    struct nn_list_item *it;
+    struct nn_list_item *prev;
+
+    it = nn_list_end (&self->outstanding);
+    while (it != nn_list_begin (&self->outstanding)) {
+        prev = nn_list_prev (&self->outstanding, it);
+        if (nn_cont (prev, struct nn_req_call, item)->deadline <=
+              call->deadline)
+            break;
+        it = prev;
+    }
+    nn_list_insert (&self->outstanding, &call->item, it);
+}
+
+/*  Makes sure the timer fires at the deadline of the first outstanding
+    request. */
+static void nn_req_settimer (struct nn_req *self)
+{
+    struct nn_req_call *call;
+    uint64_t now;
+
+    if (nn_list_empty (&self->outstanding))
+        return;
+    call = nn_cont (nn_list_begin (&self->outstanding), struct nn_req_call,
+        item);
+
+    /*  If the timer is running, it's enough to restart it when it would
+        fire too late. It's re-armed once it's stopped. */
+    if (!nn_timer_isidle (&self->timer)) {
+        if (call->deadline < self->expiry)
+            nn_timer_stop (&self->timer);
+        return;
+    }
+
+    now = nn_clock_now (&self->clock);
+    self->expiry = call->deadline;
+    nn_timer_start (&self->timer,
+        call->deadline > now ? (int) (call->deadline - now) : 0);
+}
+
+/*  Re-sends the requests whose deadline have expired. */
+static void nn_req_timeout (struct nn_req *self)
+{
+    struct nn_req_call *call;
+    uint64_t now;
+
+    now = nn_clock_now (&self->clock);
+    while (!nn_list_empty (&self->outstanding)) {
+        call = nn_cont (nn_list_begin (&self->outstanding),
+            struct nn_req_call, item);
+        if (call->deadline > now)
+            break;
+        nn_list_erase (&self->outstanding, &call->item);
+
+        /*  It's time to duplicate the request. Wait for the re-send
+            deadline afterwards. */
+        if (call->hedging) {
+            nn_req_hedge (self, call, now);
+            call->hedging = 0;
+            call->deadline = call->resend_at;
+            nn_req_schedule (self, call);
+            continue;
+        }
+
+        call->sent_to = NULL;
+        call->hedged_to = NULL;
+        ++call->attempts;
+        nn_list_insert (&self->delayed, &call->item,
+            nn_list_end (&self->delayed));
+    }
+
+    nn_req_flush (self);
+}
+
+/*  Matches the incoming replies to the requests in progress. */
+static void nn_req_collect (struct nn_req *self)
+{
+    int rc;
+    struct nn_msg msg;
+    uint32_t reqid;
+    struct nn_hash_item *hitem;
+    struct nn_req_call *call;
+    struct nn_pipe *from;
+    uint64_t now;
+
+    while (1) {
+
+        /*  Get new reply. */
+        rc = nn_xreq_recv_from (&self->xreq.sockbase, &msg, &from);
+        if (nn_slow (rc == -EAGAIN))
+            return;
+        errnum_assert (rc == 0, -rc);
+
+        /*  Ignore malformed replies. */
+        if (nn_slow (nn_chunkref_size (&msg.sphdr) != sizeof (uint32_t))) {
+            nn_msg_term (&msg);
+            continue;
+        }
+
+        /*  Ignore replies to unknown requests. These are most likely
+            duplicate replies to re-sent requests. */
+        reqid = nn_getl (nn_chunkref_data (&msg.sphdr));
+        hitem = nn_slow (!(reqid & 0x80000000)) ? NULL :
+            nn_hash_get (&self->calls, reqid);
+        if (nn_slow (!hitem)) {
+            nn_msg_term (&msg);
+            continue;
+        }
+        call = nn_cont (hitem, struct nn_req_call, hitem);
+
+        /*  Measure the reply latency of the peer. If the request was re-sent
+            it's not clear which of the copies is being replied to. */
+        if (call->attempts == 0 && call->sent_to) {
+            now = nn_clock_now (&self->clock);
+            if (from == call->sent_to)
+                nn_rtt_sample (nn_xreq_getrtt (from),
+                    (int) (now - call->sent_at));
+            else if (from == call->hedged_to)
+                nn_rtt_sample (nn_xreq_getrtt (from),
+                    (int) (now - call->hedged_at));
+        }
+
+        /*  Trim the request ID. */
+        nn_chunkref_term (&msg.sphdr);
+        nn_chunkref_init (&msg.sphdr, 0);
+
+        /*  Store the reply and drop the request, it won't be re-sent
+            anymore. */
+        nn_msg_term (&call->reply);
+        nn_msg_mv (&call->reply, &msg);
+        nn_msg_term (&call->request);
+        nn_msg_init (&call->request, 0);
+
+        nn_hash_erase (&self->calls, &call->hitem);
+        nn_list_erase (call->sent_to ? &self->outstanding : &self->delayed,
+            &call->item);
+        call->sent_to = NULL;
+        nn_list_insert (&self->replies, &call->item,
+            nn_list_end (&self->replies));
+    }
+}
+
 static struct nn_socktype nn_req_socktype_struct = {
     AF_SP,
     NN_REQ,
@@ -28,6 +28,56 @@
 
 #include "../../protocol.h"
 #include "../../aio/fsm.h"
+#include "../../aio/timer.h"
+#include "../../utils/hash.h"
+#include "../../utils/list.h"
+#include "../../utils/clock.h"
+
+/*  A request submitted while the socket is in pipelined mode. */
+struct nn_req_call {
+
+    /*  ID of the request. The reply is matched to the request using it. */
+    uint32_t id;
+
+    /*  User-defined handle of the request, if any. */
+    nn_req_handle hndl;
+    int hashndl;
+
+    /*  Stored request, so that it can be re-sent if needed. */
+    struct nn_msg request;
+
+    /*  Stored reply, so that user can retrieve it later on. */
+    struct nn_msg reply;
+
+    /*  Pipe the request has been sent to or NULL if it is waiting to be
+        sent. */
+    struct nn_pipe *sent_to;
+
+    /*  Point in time when the request was sent to 'sent_to'. */
+    uint64_t sent_at;
+
+    /*  Number of times the request was re-sent because of a timeout. */
+    int attempts;
+
+    /*  Point in time when the timer should fire for the request next. If
+        'hedging' is set, a duplicate of the request is sent to another pipe
+        at that point and the request is re-sent at 'resend_at'. Otherwise,
+        the request is re-sent at 'deadline'. */
+    uint64_t deadline;
+    int hedging;
+    uint64_t resend_at;
+
+    /*  Pipe the duplicate of the request was sent to, if any. */
+    struct nn_pipe *hedged_to;
+    uint64_t hedged_at;
+
+    /*  Requests waiting for the reply are registered in 'calls' hash. */
+    struct nn_hash_item hitem;
+
+    /*  The request is in exactly one of 'delayed', 'outstanding' and
+        'replies' lists. */
+    struct nn_list_item item;
+};
 
 struct nn_req {
 
@@ -43,9 +93,39 @@ struct nn_req {
 
     /*  Protocol-specific socket options. */
     int resend_ivl;
+    int adaptive;
+    int hedge;
 
     /*  The request being processed. */
     struct nn_task task;
+
+    /*  Maximal number of requests being processed at the same time. If set
+        to 1, sending a new request cancels the one being processed. */
+    int pipeline;
+
+    /*  In pipelined mode, requests waiting for the reply, keyed by the
+        request ID. */
+    struct nn_hash calls;
+
+    /*  Requests that could not be sent because there was no peer
+        available. */
+    struct nn_list delayed;
+
+    /*  Requests that were sent, ordered by the re-send deadline. */
+    struct nn_list outstanding;
+
+    /*  Requests that were replied to, in the order the replies arrived,
+        waiting for the user to retrieve them. */
+    struct nn_list replies;
+
+    /*  Number of requests in all three lists above. */
+    int ncalls;
+
+    /*  A single timer re-sends all the outstanding requests. It is always
+        set to the deadline of the first request in 'outstanding'. */
+    struct nn_timer timer;
+    uint64_t expiry;
+    struct nn_clock clock;
 };
 
 extern struct nn_socktype *nn_req_socktype;
@@ -0,0 +1,105 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "rtt.h"
+
+#include "../../utils/err.h"
+#include "../../utils/fast.h"
+#include "../../utils/attr.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int nn_rtt_compare (const void *a, const void *b)
+{
+    return *(const int*) a - *(const int*) b;
+}
+
+void nn_rtt_init (struct nn_rtt *self)
+{
+    self->srtt = 0;
+    self->rttvar = 0;
+    self->nsamples = 0;
+    self->pct = 0;
+    self->pctval = -1;
+}
+
+void nn_rtt_term (NN_UNUSED struct nn_rtt *self)
+{
+}
+
+void nn_rtt_sample (struct nn_rtt *self, int rtt)
+{
+    int delta;
+
+    nn_assert (rtt >= 0);
+
+    /*  The first sample initialises the estimate. Afterwards, the smoothed
+        round-trip time moves by 1/8 of the error and the deviation by 1/4
+        of the difference. */
+    if (nn_slow (self->nsamples == 0)) {
+        self->srtt = rtt << 3;
+        self->rttvar = rtt << 1;
+    }
+    else {
+        delta = rtt - (self->srtt >> 3);
+        self->srtt += delta;
+        if (delta < 0)
+            delta = -delta;
+        self->rttvar += delta - (self->rttvar >> 2);
+    }
+
+    self->window [self->nsamples % NN_RTT_WINDOW] = rtt;
+    ++self->nsamples;
+    self->pct = 0;
+}
+
+int nn_rtt_timeout (struct nn_rtt *self)
+{
+    if (nn_slow (self->nsamples == 0))
+        return -1;
+    return (self->srtt >> 3) + self->rttvar;
+}
+
+int nn_rtt_percentile (struct nn_rtt *self, int pct)
+{
+    int sorted [NN_RTT_WINDOW];
+    int n;
+    int rank;
+
+    nn_assert (pct > 0 && pct <= 100);
+
+    if (nn_slow (self->nsamples < NN_RTT_MINSAMPLES))
+        return -1;
+    if (nn_fast (self->pct == pct))
+        return self->pctval;
+
+    /*  Nearest-rank percentile of the window. */
+    n = self->nsamples < NN_RTT_WINDOW ? (int) self->nsamples : NN_RTT_WINDOW;
+    memcpy (sorted, self->window, n * sizeof (int));
+    qsort (sorted, n, sizeof (int), nn_rtt_compare);
+    rank = (n * pct + 99) / 100;
+    self->pct = pct;
+    self->pctval = sorted [rank - 1];
+
+    return self->pctval;
+}
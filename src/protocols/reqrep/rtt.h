@@ -0,0 +1,72 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_RTT_INCLUDED
+#define NN_RTT_INCLUDED
+
+#include "../../utils/int.h"
+
+/*  Estimator of the time it takes a peer to reply to a request. It keeps
+    the smoothed round-trip time and its mean deviation the same way TCP
+    does, and a window of the most recent samples to estimate percentiles.
+    All the times are in milliseconds. */
+
+#define NN_RTT_WINDOW 64
+
+/*  Minimal number of samples needed to estimate a percentile. */
+#define NN_RTT_MINSAMPLES 20
+
+struct nn_rtt {
+
+    /*  Smoothed round-trip time scaled by 8 and its mean deviation scaled
+        by 4. */
+    int srtt;
+    int rttvar;
+
+    /*  Total number of samples taken. The most recent one is stored at
+        position (nsamples - 1) % NN_RTT_WINDOW of 'window'. */
+    uint32_t nsamples;
+    int window [NN_RTT_WINDOW];
+
+    /*  The last percentile computed. It is valid only until the next sample
+        is taken. If 'pct' is 0, there's no percentile cached. */
+    int pct;
+    int pctval;
+};
+
+void nn_rtt_init (struct nn_rtt *self);
+void nn_rtt_term (struct nn_rtt *self);
+
+/*  Accounts for a reply that arrived 'rtt' milliseconds after the request
+    was sent. */
+void nn_rtt_sample (struct nn_rtt *self, int rtt);
+
+/*  Returns the time after which the request should be considered lost,
+    i.e. the smoothed round-trip time plus four times its deviation, or -1
+    if there are no samples yet. */
+int nn_rtt_timeout (struct nn_rtt *self);
+
+/*  Returns the given percentile of the recent samples or -1 if there are
+    not enough samples yet. */
+int nn_rtt_percentile (struct nn_rtt *self, int pct);
+
+#endif
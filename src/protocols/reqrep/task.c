@@ -26,6 +26,7 @@ void nn_task_init (struct nn_task *self, uint32_t id, nn_req_handle hndl)
 {
     self->id = id;
     self->hndl = hndl;
+    self->hashndl = 0;
 }
 
 void nn_task_term (struct nn_task *self)
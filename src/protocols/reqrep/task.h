@@ -39,6 +39,9 @@ struct nn_task {
     /*  User-defined handle of the task. */
     nn_req_handle hndl;
 
+    /*  1 if the user has supplied the handle, 0 otherwise. */
+    int hashndl;
+
     /*  Stored request, so that it can be re-sent if needed. */
     struct nn_msg request;
 
@@ -51,6 +54,12 @@ struct nn_task {
     /*  Pipe the current request has been sent to. This is an optimisation so
         that request can be re-sent immediately if the pipe disappears.  */
     struct nn_pipe *sent_to;
+
+    /*  Point in time when the request was sent to 'sent_to' and number of
+        times it was re-sent because of a timeout. Used to measure the reply
+        latency of the peers. */
+    uint64_t sent_at;
+    int attempts;
 };
 
 void nn_task_init (struct nn_task *self, uint32_t id, nn_req_handle hndl);
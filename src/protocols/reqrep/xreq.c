@@ -35,6 +35,7 @@
 struct nn_xreq_data {
     struct nn_lb_data lb;
     struct nn_fq_data fq;
+    struct nn_rtt rtt;
 };
 
 /*  Private functions. */
@@ -60,6 +61,9 @@ void nn_xreq_init (struct nn_xreq *self, const struct nn_sockbase_vfptr *vfptr,
     nn_sockbase_init (&self->sockbase, vfptr, hint);
     nn_lb_init (&self->lb);
     nn_fq_init (&self->fq);
+
+    /*  The request is complete once the reply arrives. */
+    nn_lb_track (&self->lb);
 }
 
 void nn_xreq_term (struct nn_xreq *self)
@@ -104,6 +108,7 @@ int nn_xreq_add (struct nn_sockbase *self, struct nn_pipe *pipe)
     nn_pipe_setdata (pipe, data);
     nn_lb_add (&xreq->lb, &data->lb, pipe, sndprio);
     nn_fq_add (&xreq->fq, &data->fq, pipe, rcvprio);
+    nn_rtt_init (&data->rtt);
 
     return 0;
 }
@@ -117,6 +122,7 @@ void nn_xreq_rm (struct nn_sockbase *self, struct nn_pipe *pipe)
     data = nn_pipe_getdata (pipe);
     nn_lb_rm (&xreq->lb, &data->lb);
     nn_fq_rm (&xreq->fq, &data->fq);
+    nn_rtt_term (&data->rtt);
     nn_free (data);
 
     nn_sockbase_stat_increment (self, NN_STAT_CURRENT_SND_PRIORITY,
@@ -175,15 +181,46 @@ int nn_xreq_send_to (struct nn_sockbase *self, struct nn_msg *msg,
     return 0;
 }
 
+int nn_xreq_send_except (struct nn_sockbase *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to)
+{
+    int rc;
+
+    rc = nn_lb_send_except (&nn_cont (self, struct nn_xreq, sockbase)->lb,
+        msg, except, to);
+    if (nn_slow (rc == -EAGAIN))
+        return -EAGAIN;
+    errnum_assert (rc >= 0, -rc);
+
+    return 0;
+}
+
 int nn_xreq_recv (struct nn_sockbase *self, struct nn_msg *msg)
+{
+    return nn_xreq_recv_from (self, msg, NULL);
+}
+
+int nn_xreq_recv_from (struct nn_sockbase *self, struct nn_msg *msg,
+    struct nn_pipe **from)
 {
     int rc;
+    struct nn_xreq *xreq;
+    struct nn_pipe *pipe;
+    struct nn_xreq_data *data;
+
+    xreq = nn_cont (self, struct nn_xreq, sockbase);
 
-    rc = nn_fq_recv (&nn_cont (self, struct nn_xreq, sockbase)->fq, msg, NULL);
+    rc = nn_fq_recv (&xreq->fq, msg, &pipe);
     if (rc == -EAGAIN)
         return -EAGAIN;
     errnum_assert (rc >= 0, -rc);
 
+    /*  The peer is done with one of the requests. */
+    data = nn_pipe_getdata (pipe);
+    nn_lb_done (&xreq->lb, &data->lb);
+    if (from)
+        *from = pipe;
+
     if (!(rc & NN_PIPE_PARSED)) {
 
         /*  Ignore malformed replies. */
@@ -204,17 +241,43 @@ int nn_xreq_recv (struct nn_sockbase *self, struct nn_msg *msg)
     return 0;
 }
 
-int nn_xreq_setopt (NN_UNUSED struct nn_sockbase *self,
-    NN_UNUSED int level, NN_UNUSED int option,
-    NN_UNUSED const void *optval, NN_UNUSED size_t optvallen)
+int nn_xreq_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen)
 {
+    struct nn_xreq *xreq;
+
+    xreq = nn_cont (self, struct nn_xreq, sockbase);
+
+    if (level != NN_REQ)
+        return -ENOPROTOOPT;
+
+    if (option == NN_REQ_BALANCE) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        return nn_lb_setpolicy (&xreq->lb, *(int*) optval);
+    }
+
     return -ENOPROTOOPT;
 }
 
-int nn_xreq_getopt (NN_UNUSED struct nn_sockbase *self,
-    NN_UNUSED int level, NN_UNUSED int option,
-    NN_UNUSED void *optval, NN_UNUSED size_t *optvallen)
+int nn_xreq_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen)
 {
+    struct nn_xreq *xreq;
+
+    xreq = nn_cont (self, struct nn_xreq, sockbase);
+
+    if (level != NN_REQ)
+        return -ENOPROTOOPT;
+
+    if (option == NN_REQ_BALANCE) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = nn_lb_getpolicy (&xreq->lb);
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
     return -ENOPROTOOPT;
 }
 
@@ -235,6 +298,14 @@ int nn_xreq_ispeer (int socktype)
     return socktype == NN_REP ? 1 : 0;
 }
 
+struct nn_rtt *nn_xreq_getrtt (struct nn_pipe *pipe)
+{
+    struct nn_xreq_data *data;
+
+    data = nn_pipe_getdata (pipe);
+    return &data->rtt;
+}
+
 static struct nn_socktype nn_xreq_socktype_struct = {
     AF_SP_RAW,
     NN_REQ,
@@ -28,6 +28,8 @@
 #include "../utils/lb.h"
 #include "../utils/fq.h"
 
+#include "rtt.h"
+
 struct nn_xreq {
     struct nn_sockbase sockbase;
     struct nn_lb lb;
@@ -46,7 +48,11 @@ int nn_xreq_events (struct nn_sockbase *self);
 int nn_xreq_send (struct nn_sockbase *self, struct nn_msg *msg);
 int nn_xreq_send_to (struct nn_sockbase *self, struct nn_msg *msg,
     struct nn_pipe **to);
+int nn_xreq_send_except (struct nn_sockbase *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to);
 int nn_xreq_recv (struct nn_sockbase *self, struct nn_msg *msg);
+int nn_xreq_recv_from (struct nn_sockbase *self, struct nn_msg *msg,
+    struct nn_pipe **from);
 int nn_xreq_setopt (struct nn_sockbase *self, int level, int option,
     const void *optval, size_t optvallen);
 int nn_xreq_getopt (struct nn_sockbase *self, int level, int option,
@@ -54,6 +60,10 @@ int nn_xreq_getopt (struct nn_sockbase *self, int level, int option,
 
 int nn_xreq_ispeer (int socktype);
 
+/*  Returns the estimator of the reply latency of the pipe. The estimator is
+    not updated by the raw socket itself. */
+struct nn_rtt *nn_xreq_getrtt (struct nn_pipe *pipe);
+
 extern struct nn_socktype *nn_xreq_socktype;
 
 #endif
@@ -22,29 +22,47 @@
 
 #include "fq.h"
 
+#include "../../nn.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
+#include "../../utils/fast.h"
 
 #include <stddef.h>
 
+/*  Private functions. */
+static int nn_fq_priority (struct nn_fq *self, struct nn_fq_data *data);
+static int64_t nn_fq_quantum (struct nn_fq_data *data);
+static struct nn_fq_data *nn_fq_turn (struct nn_fq *self);
+
 void nn_fq_init (struct nn_fq *self)
 {
     nn_priolist_init (&self->priolist);
+    self->policy = NN_FQ_ROUNDROBIN;
+    nn_list_init (&self->pipes);
 }
 
 void nn_fq_term (struct nn_fq *self)
 {
+    nn_list_term (&self->pipes);
     nn_priolist_term (&self->priolist);
 }
 
 void nn_fq_add (struct nn_fq *self, struct nn_fq_data *data,
     struct nn_pipe *pipe, int priority)
 {
-    nn_priolist_add (&self->priolist, &data->priodata, pipe, priority);
+    data->priority = priority;
+    data->deficit = 0;
+    nn_list_item_init (&data->item);
+    nn_list_insert (&self->pipes, &data->item, nn_list_end (&self->pipes));
+    nn_priolist_add (&self->priolist, &data->priodata, pipe,
+        nn_fq_priority (self, data));
 }
 
 void nn_fq_rm (struct nn_fq *self, struct nn_fq_data *data)
 {
+    nn_list_erase (&self->pipes, &data->item);
+    nn_list_item_term (&data->item);
     nn_priolist_rm (&self->priolist, &data->priodata);
 }
 
@@ -62,12 +80,19 @@ int nn_fq_recv (struct nn_fq *self, struct nn_msg *msg, struct nn_pipe **pipe)
 {
     int rc;
     struct nn_pipe *p;
+    struct nn_fq_data *data;
 
     /*  Pipe is NULL only when there are no avialable pipes. */
     p = nn_priolist_getpipe (&self->priolist);
     if (nn_slow (!p))
         return -EAGAIN;
 
+    data = NULL;
+    if (self->policy == NN_FQ_DRR) {
+        data = nn_fq_turn (self);
+        p = data->priodata.pipe;
+    }
+
     /*  Receive the messsage. */
     rc = nn_pipe_recv (p, msg);
     errnum_assert (rc >= 0, -rc);
@@ -76,9 +101,114 @@ int nn_fq_recv (struct nn_fq *self, struct nn_msg *msg, struct nn_pipe **pipe)
     if (pipe)
         *pipe = p;
 
+    /*  With deficit round-robin, the pipe keeps its turn until it runs out
+        of bytes. The size of the next message is not known in advance, so
+        the last message of the turn may overdraw the deficit. A pipe that
+        has no more messages doesn't keep the unused bytes. */
+    if (data) {
+        data->deficit -= nn_msg_bodysize (msg);
+        if (rc & NN_PIPE_RELEASE) {
+            if (data->deficit > 0)
+                data->deficit = 0;
+        }
+        else if (data->deficit > 0)
+            return rc;
+    }
+
     /*  Move to the next pipe. */
     nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
 
     return rc & ~NN_PIPE_RELEASE;
 }
 
+int nn_fq_setpolicy (struct nn_fq *self, int policy)
+{
+    struct nn_list_item *it;
+    struct nn_fq_data *data;
+    int active;
+
+    if (nn_slow (policy != NN_FQ_ROUNDROBIN && policy != NN_FQ_DRR))
+        return -EINVAL;
+    if (policy == self->policy)
+        return 0;
+    self->policy = policy;
+
+    /*  Re-insert the pipes at the priority levels used by the new policy. */
+    for (it = nn_list_begin (&self->pipes);
+          it != nn_list_end (&self->pipes);
+          it = nn_list_next (&self->pipes, it)) {
+        data = nn_cont (it, struct nn_fq_data, item);
+        active = nn_list_item_isinlist (&data->priodata.item);
+        nn_priolist_rm (&self->priolist, &data->priodata);
+        nn_priolist_add (&self->priolist, &data->priodata,
+            data->priodata.pipe, nn_fq_priority (self, data));
+        data->deficit = 0;
+        if (active)
+            nn_priolist_activate (&self->priolist, &data->priodata);
+    }
+
+    return 0;
+}
+
+int nn_fq_getpolicy (struct nn_fq *self)
+{
+    return self->policy;
+}
+
+/*  With deficit round-robin, priorities are turned into weights and all the
+    pipes are put to the same level. */
+static int nn_fq_priority (struct nn_fq *self, struct nn_fq_data *data)
+{
+    return self->policy == NN_FQ_DRR ? 1 : data->priority;
+}
+
+static int64_t nn_fq_quantum (struct nn_fq_data *data)
+{
+    return (int64_t) (NN_PRIOLIST_SLOTS + 1 - data->priority) * NN_FQ_QUANTUM;
+}
+
+/*  Returns the pipe whose turn it is. Pipe starting its turn is credited
+    with its quantum. If it's still in debt afterwards, it's skipped. */
+static struct nn_fq_data *nn_fq_turn (struct nn_fq *self)
+{
+    struct nn_priolist_slot *slot;
+    struct nn_fq_data *data;
+    struct nn_list_item *it;
+    int64_t rounds;
+    int64_t r;
+    int i;
+
+    slot = &self->priolist.slots [self->priolist.current - 1];
+    for (i = 0; ; ++i) {
+        data = nn_cont (slot->current, struct nn_fq_data, priodata);
+        if (data->deficit > 0)
+            return data;
+
+        /*  All the pipes are in debt even after a whole round. Rather than
+            going round again and again, credit as many rounds at once as
+            needed for the least indebted pipe to get its turn. */
+        if (i == slot->npipes) {
+            rounds = -1;
+            for (it = nn_list_begin (&slot->pipes);
+                  it != nn_list_end (&slot->pipes);
+                  it = nn_list_next (&slot->pipes, it)) {
+                data = nn_cont (it, struct nn_fq_data, priodata.item);
+                r = -data->deficit / nn_fq_quantum (data);
+                if (rounds < 0 || r < rounds)
+                    rounds = r;
+            }
+            for (it = nn_list_begin (&slot->pipes);
+                  it != nn_list_end (&slot->pipes);
+                  it = nn_list_next (&slot->pipes, it)) {
+                data = nn_cont (it, struct nn_fq_data, priodata.item);
+                data->deficit += rounds * nn_fq_quantum (data);
+            }
+            data = nn_cont (slot->current, struct nn_fq_data, priodata);
+        }
+
+        data->deficit += nn_fq_quantum (data);
+        if (data->deficit > 0)
+            return data;
+        nn_priolist_advance (&self->priolist, 0);
+    }
+}
@@ -27,15 +27,41 @@
 
 #include "priolist.h"
 
+#include "../../utils/list.h"
+
 /*  Fair-queuer. Retrieves messages from a set of pipes in round-robin
-    manner. */
+    manner. By default, each pipe gets to deliver one message per turn and
+    pipes of higher priority are always preferred. With NN_FQ_DRR policy,
+    inbound bandwidth is shared using deficit round-robin instead: each pipe
+    gets to deliver a number of bytes per turn, proportional to its weight.
+    Weight of a pipe is derived from its priority, so that no pipe starves
+    but higher-priority pipes get a larger share. */
+
+/*  Number of bytes a pipe of weight 1 may deliver per turn. */
+#define NN_FQ_QUANTUM 1024
 
 struct nn_fq_data {
     struct nn_priolist_data priodata;
+
+    /*  Priority the pipe was added with. */
+    int priority;
+
+    /*  Number of bytes the pipe may still deliver in this turn. Negative
+        value is a debt the pipe pays off by skipping turns. */
+    int64_t deficit;
+
+    /*  The structure is a member of nn_fq's 'pipes' list. */
+    struct nn_list_item item;
 };
 
 struct nn_fq {
     struct nn_priolist priolist;
+
+    /*  One of NN_FQ_* values. */
+    int policy;
+
+    /*  All the pipes, whether they have messages available or not. */
+    struct nn_list pipes;
 };
 
 void nn_fq_init (struct nn_fq *self);
@@ -47,4 +73,9 @@ void nn_fq_in (struct nn_fq *self, struct nn_fq_data *data);
 int nn_fq_can_recv (struct nn_fq *self);
 int nn_fq_recv (struct nn_fq *self, struct nn_msg *msg, struct nn_pipe **pipe);
 
+/*  Sets the fair queueing policy. Returns -EINVAL if the policy is
+    unknown. */
+int nn_fq_setpolicy (struct nn_fq *self, int policy);
+int nn_fq_getpolicy (struct nn_fq *self);
+
 #endif
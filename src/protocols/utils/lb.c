@@ -22,29 +22,77 @@
 
 #include "lb.h"
 
+#include "../../nn.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
+#include "../../utils/random.h"
+#include "../../utils/attr.h"
+#include "../../utils/alloc.h"
+#include "../../utils/fast.h"
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*  Private functions. */
+static int nn_lb_send_current (struct nn_lb *self, struct nn_msg *msg,
+    struct nn_pipe **to);
+static int nn_lb_load (struct nn_lb *self, struct nn_lb_data *data);
+static uint32_t nn_lb_random (struct nn_lb *self);
+static struct nn_lb_data *nn_lb_least (struct nn_lb *self,
+    struct nn_priolist_slot *slot, struct nn_pipe *except);
+static struct nn_lb_data *nn_lb_p2c (struct nn_lb *self,
+    struct nn_priolist_slot *slot);
+static uint32_t nn_lb_hash (const uint8_t *data, size_t len);
+static int nn_lb_key (struct nn_msg *msg, uint32_t *hash);
+static void nn_lb_strip_key (struct nn_msg *msg);
+static uint32_t nn_lb_id (struct nn_lb *self, struct nn_pipe *pipe);
+static uint32_t nn_lb_mix (uint32_t hash);
+static int nn_lb_vnode_cmp (const void *a, const void *b);
+static void nn_lb_ring_add (struct nn_lb *self, struct nn_lb_data *data);
+static void nn_lb_ring_rm (struct nn_lb *self, struct nn_lb_data *data);
+static struct nn_lb_data *nn_lb_lookup (struct nn_lb *self, uint32_t hash);
 
 void nn_lb_init (struct nn_lb *self)
 {
     nn_priolist_init (&self->priolist);
+    self->policy = NN_BALANCE_ROUNDROBIN;
+    self->track = 0;
+    nn_random_generate (&self->seed, sizeof (self->seed));
+    if (!self->seed)
+        self->seed = 1;
+    nn_list_init (&self->pipes);
+    self->ring = NULL;
+    self->nvnodes = 0;
 }
 
 void nn_lb_term (struct nn_lb *self)
 {
+    if (self->ring)
+        nn_free (self->ring);
+    nn_list_term (&self->pipes);
     nn_priolist_term (&self->priolist);
 }
 
 void nn_lb_add (struct nn_lb *self, struct nn_lb_data *data,
     struct nn_pipe *pipe, int priority)
 {
+    data->inflight = 0;
+    data->id = nn_lb_id (self, pipe);
+    nn_list_item_init (&data->item);
+    nn_list_insert (&self->pipes, &data->item, nn_list_end (&self->pipes));
+    if (self->policy == NN_BALANCE_HASH)
+        nn_lb_ring_add (self, data);
     nn_priolist_add (&self->priolist, &data->priodata, pipe, priority);
 }
 
 void nn_lb_rm (struct nn_lb *self, struct nn_lb_data *data)
 {
+    if (self->policy == NN_BALANCE_HASH)
+        nn_lb_ring_rm (self, data);
+    nn_list_erase (&self->pipes, &data->item);
+    nn_list_item_term (&data->item);
     nn_priolist_rm (&self->priolist, &data->priodata);
 }
 
@@ -63,26 +111,398 @@ int nn_lb_get_priority (struct nn_lb *self)
     return nn_priolist_get_priority (&self->priolist);
 }
 
+int nn_lb_setpolicy (struct nn_lb *self, int policy)
+{
+    struct nn_list_item *it;
+
+    if (nn_slow (policy != NN_BALANCE_ROUNDROBIN &&
+          policy != NN_BALANCE_LEAST && policy != NN_BALANCE_P2C &&
+          policy != NN_BALANCE_HASH))
+        return -EINVAL;
+    if (policy == self->policy)
+        return 0;
+
+    /*  Build the ring when switching to consistent hashing and drop it when
+        switching away from it. */
+    if (policy == NN_BALANCE_HASH) {
+        for (it = nn_list_begin (&self->pipes);
+              it != nn_list_end (&self->pipes);
+              it = nn_list_next (&self->pipes, it))
+            nn_lb_ring_add (self, nn_cont (it, struct nn_lb_data, item));
+    }
+    else if (self->policy == NN_BALANCE_HASH) {
+        if (self->ring)
+            nn_free (self->ring);
+        self->ring = NULL;
+        self->nvnodes = 0;
+    }
+
+    self->policy = policy;
+    return 0;
+}
+
+int nn_lb_getpolicy (struct nn_lb *self)
+{
+    return self->policy;
+}
+
+void nn_lb_track (struct nn_lb *self)
+{
+    self->track = 1;
+}
+
+void nn_lb_done (NN_UNUSED struct nn_lb *self, struct nn_lb_data *data)
+{
+    /*  Peers may send unsolicited or duplicate replies. */
+    if (data->inflight > 0)
+        --data->inflight;
+}
+
 int nn_lb_send (struct nn_lb *self, struct nn_msg *msg, struct nn_pipe **to)
 {
-    int rc;
+    struct nn_priolist_slot *slot;
+    struct nn_lb_data *data;
+    uint32_t hash;
+    int keyed;
+
+    /*  Current pipe is NULL only when there are no avialable pipes. */
+    if (nn_slow (!nn_priolist_getpipe (&self->priolist)))
+        return -EAGAIN;
+
+    keyed = nn_lb_key (msg, &hash);
+
+    /*  With consistent hashing, messages with a key go to the pipe the key
+        maps to. Messages without a key are distributed in round-robin
+        fashion. */
+    slot = &self->priolist.slots [self->priolist.current - 1];
+    if (self->policy == NN_BALANCE_HASH) {
+        if (keyed && slot->npipes > 1)
+            nn_priolist_select (&self->priolist,
+                &nn_lb_lookup (self, hash)->priodata);
+        return nn_lb_send_current (self, msg, to);
+    }
+
+    /*  Unless round-robin is used, choose the pipe according to the load. */
+    if (self->policy != NN_BALANCE_ROUNDROBIN && slot->npipes > 1) {
+        data = self->policy == NN_BALANCE_LEAST ?
+            nn_lb_least (self, slot, NULL) : nn_lb_p2c (self, slot);
+        nn_priolist_select (&self->priolist, &data->priodata);
+    }
+
+    return nn_lb_send_current (self, msg, to);
+}
+
+int nn_lb_send_except (struct nn_lb *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to)
+{
     struct nn_pipe *pipe;
+    struct nn_lb_data *data;
 
-    /*  Pipe is NULL only when there are no avialable pipes. */
     pipe = nn_priolist_getpipe (&self->priolist);
     if (nn_slow (!pipe))
         return -EAGAIN;
 
+    /*  With a load-based policy, use the least loaded of the other pipes.
+        The pipe a key maps to is the excluded one, so with consistent
+        hashing the same applies. */
+    if (self->policy != NN_BALANCE_ROUNDROBIN) {
+        data = nn_lb_least (self,
+            &self->priolist.slots [self->priolist.current - 1], except);
+        if (!data)
+            return -EAGAIN;
+        nn_priolist_select (&self->priolist, &data->priodata);
+        nn_lb_strip_key (msg);
+        return nn_lb_send_current (self, msg, to);
+    }
+
+    /*  Skip the excluded pipe. If it's the only pipe at the current priority
+        level, advancing returns back to it. */
+    if (pipe == except) {
+        nn_priolist_advance (&self->priolist, 0);
+        pipe = nn_priolist_getpipe (&self->priolist);
+        if (pipe == except)
+            return -EAGAIN;
+    }
+
+    nn_lb_strip_key (msg);
+    return nn_lb_send_current (self, msg, to);
+}
+
+/*  Sends the message to the current pipe and moves to the next one. */
+static int nn_lb_send_current (struct nn_lb *self, struct nn_msg *msg,
+    struct nn_pipe **to)
+{
+    int rc;
+    struct nn_priolist_data *priodata;
+
+    priodata = self->priolist.slots [self->priolist.current - 1].current;
+
     /*  Send the messsage. */
-    rc = nn_pipe_send (pipe, msg);
+    rc = nn_pipe_send (priodata->pipe, msg);
     errnum_assert (rc >= 0, -rc);
+    if (self->track)
+        ++nn_cont (priodata, struct nn_lb_data, priodata)->inflight;
 
     /*  Move to the next pipe. */
     nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
 
     if (to != NULL)
-        *to = pipe;
+        *to = priodata->pipe;
 
     return rc & ~NN_PIPE_RELEASE;
 }
 
+static int nn_lb_load (struct nn_lb *self, struct nn_lb_data *data)
+{
+    return self->track ? data->inflight :
+        nn_pipe_queued (data->priodata.pipe);
+}
+
+/*  Xorshift generator. Unlike nn_random_generate it has no global state
+    shared by all the sockets. */
+static uint32_t nn_lb_random (struct nn_lb *self)
+{
+    self->seed ^= self->seed << 13;
+    self->seed ^= self->seed >> 17;
+    self->seed ^= self->seed << 5;
+    return self->seed;
+}
+
+/*  Returns the least loaded pipe other than 'except' or NULL if there's no
+    such pipe. Ties are broken in round-robin order, starting with the
+    current pipe. */
+static struct nn_lb_data *nn_lb_least (struct nn_lb *self,
+    struct nn_priolist_slot *slot, struct nn_pipe *except)
+{
+    struct nn_list_item *it;
+    struct nn_lb_data *data;
+    struct nn_lb_data *best;
+    int load;
+    int bestload;
+    int i;
+
+    best = NULL;
+    bestload = 0;
+    it = &slot->current->item;
+    for (i = 0; i != slot->npipes; ++i) {
+        if (i > 0) {
+            it = nn_list_next (&slot->pipes, it);
+            if (!it)
+                it = nn_list_begin (&slot->pipes);
+        }
+        data = nn_cont (it, struct nn_lb_data, priodata.item);
+        if (data->priodata.pipe == except)
+            continue;
+        load = nn_lb_load (self, data);
+        if (!best || load < bestload) {
+            best = data;
+            bestload = load;
+
+            /*  No pipe can do better than an idle one. */
+            if (load == 0)
+                break;
+        }
+    }
+
+    return best;
+}
+
+/*  Picks two different pipes at random and returns the less loaded one. */
+static struct nn_lb_data *nn_lb_p2c (struct nn_lb *self,
+    struct nn_priolist_slot *slot)
+{
+    struct nn_list_item *it;
+    struct nn_lb_data *first;
+    struct nn_lb_data *second;
+    int a;
+    int b;
+    int i;
+
+    a = nn_lb_random (self) % slot->npipes;
+    b = nn_lb_random (self) % (slot->npipes - 1);
+    if (b >= a)
+        ++b;
+
+    first = NULL;
+    second = NULL;
+    it = nn_list_begin (&slot->pipes);
+    for (i = 0; !first || !second; ++i) {
+        if (i == a)
+            first = nn_cont (it, struct nn_lb_data, priodata.item);
+        if (i == b)
+            second = nn_cont (it, struct nn_lb_data, priodata.item);
+        it = nn_list_next (&slot->pipes, it);
+    }
+
+    return nn_lb_load (self, second) < nn_lb_load (self, first) ?
+        second : first;
+}
+
+/*  FNV-1a followed by a finalisation step. */
+static uint32_t nn_lb_hash (const uint8_t *data, size_t len)
+{
+    uint32_t hash;
+    size_t i;
+
+    hash = 2166136261u;
+    for (i = 0; i != len; ++i) {
+        hash ^= data [i];
+        hash *= 16777619u;
+    }
+    return nn_lb_mix (hash);
+}
+
+/*  If the message carries a routing key, the key is hashed and removed from
+    the message. Returns 1 if there was a key, 0 otherwise. */
+static int nn_lb_key (struct nn_msg *msg, uint32_t *hash)
+{
+    struct nn_cmsghdr *cmsg;
+
+    cmsg = nn_msg_getcmsg (msg, NN_SOL_SOCKET, NN_BALANCE_KEY);
+    if (nn_fast (!cmsg))
+        return 0;
+    *hash = nn_lb_hash (NN_CMSG_DATA (cmsg), cmsg->cmsg_len - NN_CMSG_LEN (0));
+    nn_msg_rmcmsg (msg, cmsg);
+    return 1;
+}
+
+/*  Removes the routing key from the message, if there is one. Used where the
+    key plays no role in choosing the pipe. */
+static void nn_lb_strip_key (struct nn_msg *msg)
+{
+    struct nn_cmsghdr *cmsg;
+
+    cmsg = nn_msg_getcmsg (msg, NN_SOL_SOCKET, NN_BALANCE_KEY);
+    if (cmsg)
+        nn_msg_rmcmsg (msg, cmsg);
+}
+
+/*  Pipes are identified by the address of their endpoint. That way all the
+    sockets connected to the same set of peers map keys the same way and a
+    peer gets its keys back after reconnecting. Pipes sharing an address,
+    e.g. those accepted by a bound endpoint, are told apart by rehashing. */
+static uint32_t nn_lb_id (struct nn_lb *self, struct nn_pipe *pipe)
+{
+    const char *addr;
+    uint32_t id;
+    struct nn_list_item *it;
+
+    addr = nn_pipe_getaddr (pipe);
+    id = nn_lb_hash ((const uint8_t*) addr, strlen (addr));
+    it = nn_list_begin (&self->pipes);
+    while (it != nn_list_end (&self->pipes)) {
+        if (nn_cont (it, struct nn_lb_data, item)->id == id) {
+            id = nn_lb_mix (id + 1);
+            it = nn_list_begin (&self->pipes);
+            continue;
+        }
+        it = nn_list_next (&self->pipes, it);
+    }
+    return id;
+}
+
+/*  Finalisation step of MurmurHash3. Spreads the bits of the hash evenly. */
+static uint32_t nn_lb_mix (uint32_t hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static int nn_lb_vnode_cmp (const void *a, const void *b)
+{
+    uint32_t ha;
+    uint32_t hb;
+
+    ha = ((const struct nn_lb_vnode*) a)->hash;
+    hb = ((const struct nn_lb_vnode*) b)->hash;
+    return ha < hb ? -1 : (ha > hb ? 1 : 0);
+}
+
+/*  Places the points of the pipe on the ring. Points of the other pipes
+    don't move, so only the keys falling between the new points and their
+    predecessors are remapped. */
+static void nn_lb_ring_add (struct nn_lb *self, struct nn_lb_data *data)
+{
+    size_t sz;
+    int i;
+    int j;
+    int k;
+    struct nn_lb_vnode points [NN_LB_VNODES];
+
+    for (i = 0; i != NN_LB_VNODES; ++i) {
+        points [i].hash = nn_lb_mix (data->id ^ ((uint32_t) i * 0x9e3779b9u));
+        points [i].data = data;
+    }
+    qsort (points, NN_LB_VNODES, sizeof (struct nn_lb_vnode),
+        nn_lb_vnode_cmp);
+
+    sz = (self->nvnodes + NN_LB_VNODES) * sizeof (struct nn_lb_vnode);
+    self->ring = self->ring ? nn_realloc (self->ring, sz) :
+        nn_alloc (sz, "load balancing ring");
+    alloc_assert (self->ring);
+
+    /*  The ring is already sorted. Merge the new points into it, starting
+        from the end so that each existing point is moved at most once. */
+    i = self->nvnodes - 1;
+    j = NN_LB_VNODES - 1;
+    k = self->nvnodes + NN_LB_VNODES - 1;
+    while (j >= 0) {
+        if (i >= 0 && self->ring [i].hash > points [j].hash)
+            self->ring [k--] = self->ring [i--];
+        else
+            self->ring [k--] = points [j--];
+    }
+    self->nvnodes += NN_LB_VNODES;
+}
+
+/*  Removes the points of the pipe from the ring. Only the keys that were
+    mapped to the pipe are remapped. */
+static void nn_lb_ring_rm (struct nn_lb *self, struct nn_lb_data *data)
+{
+    int i;
+    int j;
+
+    j = 0;
+    for (i = 0; i != self->nvnodes; ++i)
+        if (self->ring [i].data != data)
+            self->ring [j++] = self->ring [i];
+    self->nvnodes = j;
+}
+
+/*  Returns the pipe the hash maps to. If the pipe is not able to accept
+    messages at the moment, or if it has a different priority than the
+    current one, the next suitable pipe on the ring is used. */
+static struct nn_lb_data *nn_lb_lookup (struct nn_lb *self, uint32_t hash)
+{
+    struct nn_lb_data *data;
+    int lo;
+    int hi;
+    int mid;
+    int i;
+
+    /*  Find the first point at or after the hash. */
+    lo = 0;
+    hi = self->nvnodes;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (self->ring [mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (i = 0; i != self->nvnodes; ++i) {
+        data = self->ring [(lo + i) % self->nvnodes].data;
+        if (data->priodata.priority == self->priolist.current &&
+              nn_list_item_isinlist (&data->priodata.item))
+            return data;
+    }
+
+    /*  There's always at least one pipe at the current priority. */
+    nn_assert (0);
+    return NULL;
+}
@@ -27,14 +27,61 @@
 
 #include "priolist.h"
 
-/*  A load balancer. Round-robins messages to a set of pipes. */
+#include "../../utils/int.h"
+
+#include "../../utils/list.h"
+
+/*  A load balancer. Distributes messages among the pipes of the highest
+    priority available. By default, the pipes are used in round-robin
+    fashion. Alternatively, the message can be sent to the least loaded pipe
+    (NN_BALANCE_LEAST), to the less loaded of two pipes chosen at random
+    (NN_BALANCE_P2C) or to the pipe its key maps to (NN_BALANCE_HASH). */
+
+/*  Number of points each pipe is assigned on the consistent hashing ring. */
+#define NN_LB_VNODES 64
 
 struct nn_lb_data {
     struct nn_priolist_data priodata;
+
+    /*  Number of messages sent to the pipe that were not completed yet.
+        Maintained only if the protocol reports the completions. */
+    int inflight;
+
+    /*  Random identifier the pipe's points on the ring are derived from. */
+    uint32_t id;
+
+    /*  The structure is a member of nn_lb's 'pipes' list. */
+    struct nn_list_item item;
+};
+
+/*  A point on the consistent hashing ring. */
+struct nn_lb_vnode {
+    uint32_t hash;
+    struct nn_lb_data *data;
 };
 
 struct nn_lb {
     struct nn_priolist priolist;
+
+    /*  One of NN_BALANCE_* values. */
+    int policy;
+
+    /*  If set, the load of a pipe is the number of messages that were not
+        completed yet. Otherwise, it is the number of messages queued in the
+        transport. */
+    int track;
+
+    /*  State of the pseudo-random number generator used by NN_BALANCE_P2C. */
+    uint32_t seed;
+
+    /*  All the pipes, whether they are able to accept messages or not. */
+    struct nn_list pipes;
+
+    /*  Points of all the pipes, sorted by hash. Keys are mapped to the first
+        point at or after their own hash. The ring exists only while
+        NN_BALANCE_HASH policy is in use. */
+    struct nn_lb_vnode *ring;
+    int nvnodes;
 };
 
 void nn_lb_init (struct nn_lb *self);
@@ -45,6 +92,26 @@ void nn_lb_rm (struct nn_lb *self, struct nn_lb_data *data);
 void nn_lb_out (struct nn_lb *self, struct nn_lb_data *data);
 int nn_lb_can_send (struct nn_lb *self);
 int nn_lb_get_priority (struct nn_lb *self);
+
+/*  Sets the load balancing policy. Returns -EINVAL if the policy is
+    unknown. */
+int nn_lb_setpolicy (struct nn_lb *self, int policy);
+int nn_lb_getpolicy (struct nn_lb *self);
+
+/*  Protocols that know when the peer is done with a message, e.g. when the
+    reply to a request arrives, call nn_lb_track once and nn_lb_done for each
+    message completed. */
+void nn_lb_track (struct nn_lb *self);
+void nn_lb_done (struct nn_lb *self, struct nn_lb_data *data);
+
+/*  Sends the message to one of the pipes. Routing key is removed from the
+    message's ancillary data so that it's not passed to the peer. */
 int nn_lb_send (struct nn_lb *self, struct nn_msg *msg, struct nn_pipe **to);
 
+/*  Same as nn_lb_send, except that the message is never sent to 'except'
+    pipe. Only pipes of the current priority are considered. If there's no
+    such pipe available, -EAGAIN is returned. */
+int nn_lb_send_except (struct nn_lb *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to);
+
 #endif
@@ -49,6 +49,9 @@ struct nn_priolist_slot {
     /*  The list of pipes on particular priority level. */
     struct nn_list pipes;
 
+    /*  Number of pipes in the list. */
+    int npipes;
+
     /*  Pointer to the current pipe within the priority level. If there's no
         pipe available, the field is set to NULL. */
     struct nn_priolist_data *current;
@@ -96,6 +99,11 @@ struct nn_pipe *nn_priolist_getpipe (struct nn_priolist *self);
     nn_priolist_activate function. */
 void nn_priolist_advance (struct nn_priolist *self, int release);
 
+/*  Makes the pipe current. The pipe must be active and it must have the
+    current priority. */
+void nn_priolist_select (struct nn_priolist *self,
+    struct nn_priolist_data *data);
+
 /*  Returns current priority. Used for statistics only  */
 int nn_priolist_get_priority (struct nn_priolist *self);
 
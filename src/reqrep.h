@@ -35,6 +35,13 @@ extern "C" {
 #define NN_REP (NN_PROTO_REQREP * 16 + 1)
 
 #define NN_REQ_RESEND_IVL 1
+#define NN_REQ_PIPELINE 2
+#define NN_REQ_RESEND_ADAPTIVE 3
+#define NN_REQ_HEDGE 4
+#define NN_REQ_BALANCE 5
+
+/*  Ancillary data carrying the handle of the request. */
+#define NN_REQ_HANDLE 1
 
 typedef union nn_req_handle {
     int i;
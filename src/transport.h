@@ -171,6 +171,9 @@ struct nn_ep_options
     int sndprio;
     int rcvprio;
     int ipv4only;
+    int sndbatch;
+    int rcvbatch;
+    int rcvzerocopy;
 };
 
 /*  The member of this structure are used internally by the core. Never use
@@ -186,6 +189,8 @@ struct nn_pipebase {
     struct nn_fsm_event in;
     struct nn_fsm_event out;
     struct nn_ep_options options;
+    int queued;
+    const char *addr;
 };
 
 /*  Initialise the pipe.  */
@@ -207,6 +212,11 @@ void nn_pipebase_received (struct nn_pipebase *self);
 /*  Call this function when current outgoing message was fully sent. */
 void nn_pipebase_sent (struct nn_pipebase *self);
 
+/*  Transports that queue outbound messages call this function whenever the
+    number of messages accepted but not yet written to the network changes.
+    Load balancers use it to tell busy peers from idle ones. */
+void nn_pipebase_setqueued (struct nn_pipebase *self, int queued);
+
 /*  Retrieve value of a socket option. */
 void nn_pipebase_getopt (struct nn_pipebase *self, int level, int option,
     void *optval, size_t *optvallen);
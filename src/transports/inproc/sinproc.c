@@ -39,15 +39,6 @@
 #define NN_SINPROC_ACTION_READY 1
 #define NN_SINPROC_ACTION_ACCEPTED 2
 
-/*  Set when SENT event was sent to the peer but RECEIVED haven't been
-    passed back yet. */
-#define NN_SINPROC_FLAG_SENDING 1
-
-/*  Set when SENT event was received, but the new message cannot be written
-    to the queue yet, i.e. RECEIVED event haven't been returned
-    to the peer yet. */
-#define NN_SINPROC_FLAG_RECEIVING 2
-
 /*  Private functions. */
 static void nn_sinproc_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
@@ -70,14 +61,12 @@ void nn_sinproc_init (struct nn_sinproc *self, int src,
     nn_fsm_init (&self->fsm, nn_sinproc_handler, nn_sinproc_shutdown,
         src, self, owner);
     self->state = NN_SINPROC_STATE_IDLE;
-    self->flags = 0;
     self->peer = NULL;
     nn_pipebase_init (&self->pipebase, &nn_sinproc_pipebase_vfptr, epbase);
     sz = sizeof (rcvbuf);
     nn_epbase_getopt (epbase, NN_SOL_SOCKET, NN_RCVBUF, &rcvbuf, &sz);
     nn_assert (sz == sizeof (rcvbuf));
     nn_msgqueue_init (&self->msgqueue, rcvbuf);
-    nn_msg_init (&self->msg, 0);
     nn_fsm_event_init (&self->event_connect);
     nn_fsm_event_init (&self->event_sent);
     nn_fsm_event_init (&self->event_received);
@@ -92,7 +81,6 @@ void nn_sinproc_term (struct nn_sinproc *self)
     nn_fsm_event_term (&self->event_received);
     nn_fsm_event_term (&self->event_sent);
     nn_fsm_event_term (&self->event_connect);
-    nn_msg_term (&self->msg);
     nn_msgqueue_term (&self->msgqueue);
     nn_pipebase_term (&self->pipebase);
     nn_fsm_term (&self->fsm);
@@ -135,6 +123,7 @@ void nn_sinproc_stop (struct nn_sinproc *self)
 
 static int nn_sinproc_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
+    int rc;
     struct nn_sinproc *sinproc;
 
     sinproc = nn_cont (self, struct nn_sinproc, pipebase);
@@ -146,17 +135,23 @@ static int nn_sinproc_send (struct nn_pipebase *self, struct nn_msg *msg)
 
     /*  Sanity checks. */
     nn_assert_state (sinproc, NN_SINPROC_STATE_ACTIVE);
-    nn_assert (!(sinproc->flags & NN_SINPROC_FLAG_SENDING));
 
-    /*  Expose the message to the peer. */
-    nn_msg_term (&sinproc->msg);
-    nn_msg_mv (&sinproc->msg, msg);
+    /*  Write the message directly to the peer's inbound queue. The peer
+        expects the payload to be stored in a single chunk. */
+    nn_msg_flatten (msg);
+    rc = nn_msgqueue_send (&sinproc->peer->msgqueue, msg);
 
-    /*  Notify the peer that there's a message to get. */
-    sinproc->flags |= NN_SINPROC_FLAG_SENDING;
-    nn_fsm_raiseto (&sinproc->fsm, &sinproc->peer->fsm,
-        &sinproc->peer->event_sent, NN_SINPROC_SRC_PEER,
-        NN_SINPROC_SENT, sinproc);
+    /*  If the peer has drained the queue, let it know that there's
+        a message to get. */
+    if (rc & NN_MSGQUEUE_WAKEUP)
+        nn_fsm_raiseto (&sinproc->fsm, &sinproc->peer->fsm,
+            &sinproc->peer->event_sent, NN_SINPROC_SRC_PEER,
+            NN_SINPROC_SENT, sinproc);
+
+    /*  Unless the queue is full, the pipe remains writable. Otherwise, we'll
+        wait till the peer receives some messages. */
+    if (nn_fast (!(rc & NN_MSGQUEUE_FULL)))
+        nn_pipebase_sent (&sinproc->pipebase);
 
     return 0;
 }
@@ -174,30 +169,23 @@ static int nn_sinproc_recv (struct nn_pipebase *self, struct nn_msg *msg)
 
     /*  Move the message to the caller. */
     rc = nn_msgqueue_recv (&sinproc->msgqueue, msg);
-    errnum_assert (rc == 0, -rc);
-
-    /*  If there was a message from peer lingering because of the exceeded
-        buffer limit, try to enqueue it once again. */
-    if (sinproc->state != NN_SINPROC_STATE_DISCONNECTED) {
-        if (nn_slow (sinproc->flags & NN_SINPROC_FLAG_RECEIVING)) {
-            rc = nn_msgqueue_send (&sinproc->msgqueue, &sinproc->peer->msg);
-            nn_assert (rc == 0 || rc == -EAGAIN);
-            if (rc == 0) {
-                errnum_assert (rc == 0, -rc);
-                nn_msg_init (&sinproc->peer->msg, 0);
-                nn_fsm_raiseto (&sinproc->fsm, &sinproc->peer->fsm,
-                    &sinproc->peer->event_received, NN_SINPROC_SRC_PEER,
-                    NN_SINPROC_RECEIVED, sinproc);
-                sinproc->flags &= ~NN_SINPROC_FLAG_RECEIVING;
-            }
-        }
-    }
 
-    if (!nn_msgqueue_empty (&sinproc->msgqueue))
+    /*  If the peer was blocked because of the exceeded buffer limit,
+        let it know it can send again. */
+    if (nn_slow (rc & NN_MSGQUEUE_RESUME) &&
+          sinproc->state != NN_SINPROC_STATE_DISCONNECTED)
+        nn_fsm_raiseto (&sinproc->fsm, &sinproc->peer->fsm,
+            &sinproc->peer->event_received, NN_SINPROC_SRC_PEER,
+            NN_SINPROC_RECEIVED, sinproc);
+
+    /*  Unless the queue is empty, the pipe remains readable. Otherwise,
+        the peer will notify us when it writes a new message. */
+    if (nn_fast (!(rc & NN_MSGQUEUE_EMPTY)))
        nn_pipebase_received (&sinproc->pipebase);
 
     return NN_PIPEBASE_PARSED;
 }
+
 static void nn_sinproc_shutdown_events (struct nn_sinproc *self, int src,
     int type, NN_UNUSED void *srcptr)
 {
@@ -224,6 +212,7 @@ static void nn_sinproc_shutdown_events (struct nn_sinproc *self, int src,
         }
     case NN_SINPROC_SRC_PEER:
         switch (type) {
+        case NN_SINPROC_SENT:
         case NN_SINPROC_RECEIVED:
             return;
         }
@@ -274,13 +263,13 @@ static void nn_sinproc_shutdown (struct nn_fsm *self, int src, int type,
 
     /*  Are all events processed? We can't cancel them unfortunately  */
     if (nn_fsm_event_active (&sinproc->event_received)
+        || nn_fsm_event_active (&sinproc->event_sent)
         || nn_fsm_event_active (&sinproc->event_disconnect))
     {
         return;
     }
     /*  These events are deemed to be impossible here  */
     nn_assert (!nn_fsm_event_active (&sinproc->event_connect));
-    nn_assert (!nn_fsm_event_active (&sinproc->event_sent));
 
     /*  **********************************************  */
     /*  All checks are successful. Just stop right now  */
@@ -295,7 +284,6 @@ static void nn_sinproc_handler (struct nn_fsm *self, int src, int type,
 {
     int rc;
     struct nn_sinproc *sinproc;
-    int empty;
 
     sinproc = nn_cont (self, struct nn_sinproc, fsm);
 
@@ -395,33 +383,16 @@ static void nn_sinproc_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_SINPROC_SENT:
 
-                empty = nn_msgqueue_empty (&sinproc->msgqueue);
-
-                /*  Push the message to the inbound message queue. */
-                rc = nn_msgqueue_send (&sinproc->msgqueue,
-                    &sinproc->peer->msg);
-                if (rc == -EAGAIN) {
-                    sinproc->flags |= NN_SINPROC_FLAG_RECEIVING;
-                    return;
-                }
-                errnum_assert (rc == 0, -rc);
-                nn_msg_init (&sinproc->peer->msg, 0);
-
-                /*  Notify the user that there's a message to receive. */
-                if (empty)
-                    nn_pipebase_received (&sinproc->pipebase);
-
-                /*  Notify the peer that the message was received. */
-                nn_fsm_raiseto (&sinproc->fsm, &sinproc->peer->fsm,
-                    &sinproc->peer->event_received, NN_SINPROC_SRC_PEER,
-                    NN_SINPROC_RECEIVED, sinproc);
-
+                /*  The peer has written a message to the empty inbound
+                    queue. Notify the user that there's a message to
+                    receive. */
+                nn_pipebase_received (&sinproc->pipebase);
                 return;
 
             case NN_SINPROC_RECEIVED:
-                nn_assert (sinproc->flags & NN_SINPROC_FLAG_SENDING);
+
+                /*  The peer has made room in its inbound queue. */
                 nn_pipebase_sent (&sinproc->pipebase);
-                sinproc->flags &= ~NN_SINPROC_FLAG_SENDING;
                 return;
 
             case NN_SINPROC_DISCONNECT:
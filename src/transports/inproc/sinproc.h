@@ -23,7 +23,7 @@
 #ifndef NN_SINPROC_INCLUDED
 #define NN_SINPROC_INCLUDED
 
-#include "msgqueue.h"
+#include "../utils/msgqueue.h"
 
 #include "../../transport.h"
 
@@ -50,9 +50,6 @@ struct nn_sinproc {
     struct nn_fsm fsm;
     int state;
 
-    /*  Any combination of the flags defined in the .c file. */
-    int flags;
-
     /*  Pointer to the peer inproc session, if connected. NULL otherwise. */
     struct nn_sinproc *peer;
 
@@ -60,14 +57,10 @@ struct nn_sinproc {
     struct nn_pipebase pipebase;
 
     /*  Inbound message queue. The messages contained are meant to be received
-        by the user later on. */
+        by the user later on. The peer session writes the messages directly
+        to the queue, without locking this session. */
     struct nn_msgqueue msgqueue;
 
-    /*  This message is the one being sent from this session to the peer
-        session. It holds the data only temporarily, until the peer moves
-        it to its msgqueue. */
-    struct nn_msg msg;
-
     /*  Outbound events. I.e. event sent by this sinproc to the peer sinproc. */
     struct nn_fsm_event event_connect;
 
@@ -41,15 +41,19 @@
 #define NN_SIPC_STATE_SHUTTING_DOWN 5
 #define NN_SIPC_STATE_DONE 6
 #define NN_SIPC_STATE_STOPPING 7
+#define NN_SIPC_STATE_LINGERING 8
+#define NN_SIPC_STATE_DRAINING 9
 
 /*  Subordinated srcptr objects. */
 #define NN_SIPC_SRC_USOCK 1
 #define NN_SIPC_SRC_STREAMHDR 2
+#define NN_SIPC_SRC_FLUSH 3
+#define NN_SIPC_SRC_TIMER 4
 
 /*  Possible states of the inbound part of the object. */
 #define NN_SIPC_INSTATE_HDR 1
 #define NN_SIPC_INSTATE_BODY 2
-#define NN_SIPC_INSTATE_HASMSG 3
+#define NN_SIPC_INSTATE_FULL 3
 
 /*  Possible states of the outbound part of the object. */
 #define NN_SIPC_OUTSTATE_IDLE 1
@@ -68,10 +72,26 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_sipc_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
+static void nn_sipc_send_batch (struct nn_sipc *self);
+
+/*  Handles the connection being broken. */
+static void nn_sipc_error (struct nn_sipc *self);
+
+/*  Reads messages from the connection into the inbound queue till either
+    the queue is full or the usock has to wait for more data. */
+static void nn_sipc_start_recv (struct nn_sipc *self);
+
+/*  Both functions return 1 if the message was queued and there's room for
+    more messages, 0 otherwise. */
+static int nn_sipc_hdr_received (struct nn_sipc *self);
+static int nn_sipc_msg_received (struct nn_sipc *self);
 
 void nn_sipc_init (struct nn_sipc *self, int src,
     struct nn_epbase *epbase, struct nn_fsm *owner)
 {
+    int rcvbuf;
+    size_t sz;
+
     nn_fsm_init (&self->fsm, nn_sipc_handler, nn_sipc_shutdown,
         src, self, owner);
     self->state = NN_SIPC_STATE_IDLE;
@@ -82,8 +102,19 @@ void nn_sipc_init (struct nn_sipc *self, int src,
     nn_pipebase_init (&self->pipebase, &nn_sipc_pipebase_vfptr, epbase);
     self->instate = -1;
     nn_msg_init (&self->inmsg, 0);
+    sz = sizeof (rcvbuf);
+    nn_epbase_getopt (epbase, NN_SOL_SOCKET, NN_RCVBUF, &rcvbuf, &sz);
+    nn_assert (sz == sizeof (rcvbuf));
+    nn_msgqueue_init (&self->inqueue, rcvbuf);
+    self->zerocopy = 0;
     self->outstate = -1;
-    nn_msg_init (&self->outmsg, 0);
+    nn_sendbatch_init (&self->batch);
+    self->worker = nn_fsm_choose_worker (&self->fsm);
+    nn_worker_task_init (&self->flush_task, NN_SIPC_SRC_FLUSH, &self->fsm);
+    self->gather = 0;
+    self->flushing = 0;
+    self->blocked = 0;
+    nn_timer_init (&self->timer, NN_SIPC_SRC_TIMER, &self->fsm);
     nn_fsm_event_init (&self->done);
 }
 
@@ -92,7 +123,10 @@ void nn_sipc_term (struct nn_sipc *self)
     nn_assert_state (self, NN_SIPC_STATE_IDLE);
 
     nn_fsm_event_term (&self->done);
-    nn_msg_term (&self->outmsg);
+    nn_timer_term (&self->timer);
+    nn_worker_task_term (&self->flush_task);
+    nn_sendbatch_term (&self->batch);
+    nn_msgqueue_term (&self->inqueue);
     nn_msg_term (&self->inmsg);
     nn_pipebase_term (&self->pipebase);
     nn_streamhdr_term (&self->streamhdr);
@@ -125,52 +159,84 @@ void nn_sipc_stop (struct nn_sipc *self)
 static int nn_sipc_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
     struct nn_sipc *sipc;
-    struct nn_iovec iov [3];
+    uint8_t hdr [9];
 
     sipc = nn_cont (self, struct nn_sipc, pipebase);
 
-    nn_assert_state (sipc, NN_SIPC_STATE_ACTIVE);
-    nn_assert (sipc->outstate == NN_SIPC_OUTSTATE_IDLE);
-
-    /*  Move the message to the local storage. */
-    nn_msg_term (&sipc->outmsg);
-    nn_msg_mv (&sipc->outmsg, msg);
-
-    /*  Serialise the message header. */
-    sipc->outhdr [0] = NN_SIPC_MSG_NORMAL;
-    nn_putll (sipc->outhdr + 1, nn_chunkref_size (&sipc->outmsg.sphdr) +
-        nn_chunkref_size (&sipc->outmsg.body));
+    /*  If the connection is already broken, the pipe is only kept for the
+        user to receive the messages that were read from it. The message
+        is dropped and the pipe doesn't accept any more. */
+    if (nn_slow (sipc->state != NN_SIPC_STATE_ACTIVE)) {
+        nn_msg_term (msg);
+        return 0;
+    }
 
-    /*  Start async sending. */
-    iov [0].iov_base = sipc->outhdr;
-    iov [0].iov_len = sizeof (sipc->outhdr);
-    iov [1].iov_base = nn_chunkref_data (&sipc->outmsg.sphdr);
-    iov [1].iov_len = nn_chunkref_size (&sipc->outmsg.sphdr);
-    iov [2].iov_base = nn_chunkref_data (&sipc->outmsg.body);
-    iov [2].iov_len = nn_chunkref_size (&sipc->outmsg.body);
-    nn_usock_send (sipc->usock, iov, 3);
+    /*  Add the message to the outbound queue. Unless the queue is full, the
+        pipe is immediately ready to accept the next message. */
+    hdr [0] = NN_SIPC_MSG_NORMAL;
+    nn_putll (hdr + 1, nn_chunkref_size (&msg->sphdr) +
+        nn_msg_bodysize (msg));
+    if (nn_sendbatch_push (&sipc->batch, hdr, sizeof (hdr), msg))
+        nn_pipebase_sent (&sipc->pipebase);
+    else
+        sipc->blocked = 1;
+    nn_pipebase_setqueued (&sipc->pipebase, nn_sendbatch_count (&sipc->batch));
+
+    /*  If a write is already in progress, the queued messages will be
+        written as soon as it completes. */
+    if (sipc->outstate != NN_SIPC_OUTSTATE_IDLE)
+        return 0;
+
+    /*  In batching mode let the worker thread send the batch later on so
+        that more messages can be gathered in the meantime. There's no point
+        in waiting if the batch is already full though. */
+    if (sipc->gather && !sipc->blocked) {
+        if (!sipc->flushing) {
+            sipc->flushing = 1;
+            nn_worker_execute (sipc->worker, &sipc->flush_task);
+        }
+        return 0;
+    }
 
-    sipc->outstate = NN_SIPC_OUTSTATE_SENDING;
+    nn_sipc_send_batch (sipc);
 
     return 0;
 }
 
 static int nn_sipc_recv (struct nn_pipebase *self, struct nn_msg *msg)
 {
+    int rc;
     struct nn_sipc *sipc;
 
     sipc = nn_cont (self, struct nn_sipc, pipebase);
 
-    nn_assert_state (sipc, NN_SIPC_STATE_ACTIVE);
-    nn_assert (sipc->instate == NN_SIPC_INSTATE_HASMSG);
+    nn_assert (sipc->state == NN_SIPC_STATE_ACTIVE ||
+        sipc->state == NN_SIPC_STATE_SHUTTING_DOWN ||
+        sipc->state == NN_SIPC_STATE_DRAINING);
 
-    /*  Move received message to the user. */
-    nn_msg_mv (msg, &sipc->inmsg);
-    nn_msg_init (&sipc->inmsg, 0);
+    /*  Move the oldest received message to the user. */
+    rc = nn_msgqueue_recv (&sipc->inqueue, msg);
 
-    /*  Start receiving new message. */
-    sipc->instate = NN_SIPC_INSTATE_HDR;
-    nn_usock_recv (sipc->usock, sipc->inhdr, sizeof (sipc->inhdr), NULL);
+    /*  If reading from the connection was suspended because the queue was
+        full, resume it now, unless the connection is broken. */
+    if (rc & NN_MSGQUEUE_RESUME) {
+        nn_assert (sipc->instate == NN_SIPC_INSTATE_FULL);
+        if (sipc->state == NN_SIPC_STATE_ACTIVE)
+            nn_sipc_start_recv (sipc);
+    }
+
+    /*  If there are more messages in the queue, the pipe stays readable.
+        Otherwise the owner will be notified once a new message arrives. */
+    if (!(rc & NN_MSGQUEUE_EMPTY))
+        nn_pipebase_received (&sipc->pipebase);
+
+    /*  The last message read from a broken connection was received. Now
+        the owner can be told about the error. The pipe is stopped by the
+        owner, outside of this call. */
+    else if (sipc->state == NN_SIPC_STATE_DRAINING) {
+        sipc->state = NN_SIPC_STATE_DONE;
+        nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+    }
 
     return 0;
 }
@@ -179,16 +245,80 @@ static void nn_sipc_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
     struct nn_sipc *sipc;
+    int linger;
+    size_t sz;
 
     sipc = nn_cont (self, struct nn_sipc, fsm);
 
     if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
+
+        /*  Messages accepted by the pipe but not yet written are given
+            NN_LINGER milliseconds to get out before the connection is
+            closed. */
+        linger = 0;
+        if (sipc->state == NN_SIPC_STATE_ACTIVE &&
+              !nn_sendbatch_empty (&sipc->batch)) {
+            sz = sizeof (linger);
+            nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET, NN_LINGER,
+                &linger, &sz);
+            nn_assert (sz == sizeof (linger));
+        }
         nn_pipebase_stop (&sipc->pipebase);
+        if (linger != 0) {
+            if (linger > 0)
+                nn_timer_start (&sipc->timer, linger);
+            if (sipc->outstate == NN_SIPC_OUTSTATE_IDLE)
+                nn_sipc_send_batch (sipc);
+            sipc->state = NN_SIPC_STATE_LINGERING;
+            return;
+        }
+        nn_streamhdr_stop (&sipc->streamhdr);
+        sipc->state = NN_SIPC_STATE_STOPPING;
+    }
+    if (nn_slow (sipc->state == NN_SIPC_STATE_LINGERING)) {
+        switch (src) {
+        case NN_SIPC_SRC_USOCK:
+
+            /*  Inbound messages are of no interest anymore. On
+                NN_USOCK_SHUTDOWN and NN_USOCK_ERROR the queued messages
+                can't be written and are dropped. */
+            if (type == NN_USOCK_RECEIVED)
+                return;
+            if (type == NN_USOCK_SENT) {
+                sipc->outstate = NN_SIPC_OUTSTATE_IDLE;
+                nn_sendbatch_sent (&sipc->batch);
+                if (nn_sendbatch_pending (&sipc->batch)) {
+                    nn_sipc_send_batch (sipc);
+                    return;
+                }
+            }
+            break;
+        case NN_SIPC_SRC_FLUSH:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            sipc->flushing = 0;
+            return;
+        case NN_SIPC_SRC_TIMER:
+            nn_assert (type == NN_TIMER_TIMEOUT);
+            break;
+        default:
+            nn_fsm_bad_source (sipc->state, src, type);
+        }
+        nn_timer_stop (&sipc->timer);
         nn_streamhdr_stop (&sipc->streamhdr);
         sipc->state = NN_SIPC_STATE_STOPPING;
     }
     if (nn_slow (sipc->state == NN_SIPC_STATE_STOPPING)) {
-        if (nn_streamhdr_isidle (&sipc->streamhdr)) {
+
+        /*  Wait till the batch flushing task arrives to the worker thread. */
+        if (src == NN_SIPC_SRC_FLUSH) {
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            sipc->flushing = 0;
+        }
+        if (nn_streamhdr_isidle (&sipc->streamhdr) &&
+              nn_timer_isidle (&sipc->timer) && !sipc->flushing) {
+            nn_sendbatch_clear (&sipc->batch);
+            sipc->blocked = 0;
+            nn_msgqueue_clear (&sipc->inqueue);
             nn_usock_swap_owner (sipc->usock, &sipc->usock_owner);
             sipc->usock = NULL;
             sipc->usock_owner.src = -1;
@@ -208,7 +338,11 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
 {
     int rc;
     struct nn_sipc *sipc;
-    uint64_t size;
+    int sndbuf;
+    int sndbatch;
+    int rcvbatch;
+    int zerocopy;
+    size_t sz;
 
     sipc = nn_cont (self, struct nn_sipc, fsm);
 
@@ -286,6 +420,33 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                     return;
                  }
 
+                 /*  Outbound messages are queued up to NN_SNDBUF bytes.
+                     If NN_SNDBATCH is set, they are rather gathered into
+                     batches of that size. */
+                 sz = sizeof (sndbuf);
+                 nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET,
+                     NN_SNDBUF, &sndbuf, &sz);
+                 nn_assert (sz == sizeof (sndbuf));
+                 sz = sizeof (sndbatch);
+                 nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET,
+                     NN_SNDBATCH, &sndbatch, &sz);
+                 nn_assert (sz == sizeof (sndbatch));
+                 sipc->gather = sndbatch > 0 ? 1 : 0;
+                 nn_sendbatch_setlimit (&sipc->batch,
+                     (size_t) (sipc->gather ? sndbatch : sndbuf));
+
+                 /*  Set the maximal size of the inbound batch buffer. */
+                 sz = sizeof (rcvbatch);
+                 nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET,
+                     NN_RCVBATCH, &rcvbatch, &sz);
+                 nn_assert (sz == sizeof (rcvbatch));
+                 nn_usock_set_rcvbatch (sipc->usock, (size_t) rcvbatch);
+                 sz = sizeof (zerocopy);
+                 nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET,
+                     NN_RCVZEROCOPY, &zerocopy, &sz);
+                 nn_assert (sz == sizeof (zerocopy));
+                 sipc->zerocopy = zerocopy;
+
                  /*  Start receiving a message in asynchronous manner. */
                  sipc->instate = NN_SIPC_INSTATE_HDR;
                  nn_usock_recv (sipc->usock, &sipc->inhdr,
@@ -318,45 +479,34 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                 /*  The message is now fully sent. */
                 nn_assert (sipc->outstate == NN_SIPC_OUTSTATE_SENDING);
                 sipc->outstate = NN_SIPC_OUTSTATE_IDLE;
-                nn_msg_term (&sipc->outmsg);
-                nn_msg_init (&sipc->outmsg, 0);
-                nn_pipebase_sent (&sipc->pipebase);
+
+                /*  Release the sent messages and send the messages that
+                    were queued in the meantime straight away. */
+                nn_sendbatch_sent (&sipc->batch);
+                nn_pipebase_setqueued (&sipc->pipebase,
+                    nn_sendbatch_count (&sipc->batch));
+                if (nn_sendbatch_pending (&sipc->batch))
+                    nn_sipc_send_batch (sipc);
+                if (sipc->blocked && !nn_sendbatch_isfull (&sipc->batch)) {
+                    sipc->blocked = 0;
+                    nn_pipebase_sent (&sipc->pipebase);
+                }
                 return;
 
             case NN_USOCK_RECEIVED:
 
                 switch (sipc->instate) {
                 case NN_SIPC_INSTATE_HDR:
-
-                    /*  Message header was received. Allocate memory for the
-                        message. */
-                    nn_assert (sipc->inhdr [0] == NN_SIPC_MSG_NORMAL);
-                    size = nn_getll (sipc->inhdr + 1);
-                    nn_msg_term (&sipc->inmsg);
-                    nn_msg_init (&sipc->inmsg, (size_t) size);
-
-                    /*  Special case when size of the message body is 0. */
-                    if (!size) {
-                        sipc->instate = NN_SIPC_INSTATE_HASMSG;
-                        nn_pipebase_received (&sipc->pipebase);
-                        return;
-                    }
-
-                    /*  Start receiving the message body. */
-                    sipc->instate = NN_SIPC_INSTATE_BODY;
-                    nn_usock_recv (sipc->usock,
-                        nn_chunkref_data (&sipc->inmsg.body),
-                        (size_t) size, NULL);
-
+                    if (nn_sipc_hdr_received (sipc))
+                        nn_sipc_start_recv (sipc);
                     return;
 
                 case NN_SIPC_INSTATE_BODY:
 
-                    /*  Message body was received. Notify the owner that it
-                        can receive it. */
-                    sipc->instate = NN_SIPC_INSTATE_HASMSG;
-                    nn_pipebase_received (&sipc->pipebase);
-
+                    /*  Message body was received. Queue it for the owner
+                        and carry on reading the next one. */
+                    if (nn_sipc_msg_received (sipc))
+                        nn_sipc_start_recv (sipc);
                     return;
 
                 default:
@@ -364,14 +514,16 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                 }
 
             case NN_USOCK_SHUTDOWN:
-                nn_pipebase_stop (&sipc->pipebase);
+
+                /*  The pipe is kept while there are received messages
+                    waiting for the user. */
+                if (nn_msgqueue_empty (&sipc->inqueue))
+                    nn_pipebase_stop (&sipc->pipebase);
                 sipc->state = NN_SIPC_STATE_SHUTTING_DOWN;
                 return;
 
             case NN_USOCK_ERROR:
-                nn_pipebase_stop (&sipc->pipebase);
-                sipc->state = NN_SIPC_STATE_DONE;
-                nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+                nn_sipc_error (sipc);
                 return;
 
 
@@ -379,6 +531,22 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                 nn_fsm_bad_action (sipc->state, src, type);
             }
 
+        case NN_SIPC_SRC_FLUSH:
+            switch (type) {
+            case NN_WORKER_TASK_EXECUTE:
+
+                /*  We are in the worker thread now. Send whatever have been
+                    gathered in the batch so far. */
+                sipc->flushing = 0;
+                if (sipc->outstate == NN_SIPC_OUTSTATE_IDLE &&
+                      nn_sendbatch_pending (&sipc->batch))
+                    nn_sipc_send_batch (sipc);
+                return;
+
+            default:
+                nn_fsm_bad_action (sipc->state, src, type);
+            }
+
         default:
             nn_fsm_bad_source (sipc->state, src, type);
         }
@@ -394,13 +562,34 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
         case NN_SIPC_SRC_USOCK:
             switch (type) {
             case NN_USOCK_ERROR:
-                sipc->state = NN_SIPC_STATE_DONE;
-                nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+                nn_sipc_error (sipc);
                 return;
             default:
                 nn_fsm_bad_action (sipc->state, src, type);
             }
 
+        case NN_SIPC_SRC_FLUSH:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            sipc->flushing = 0;
+            return;
+
+        default:
+            nn_fsm_bad_source (sipc->state, src, type);
+        }
+
+/******************************************************************************/
+/*  DRAINING state.                                                           */
+/*  The underlying connection is closed. We are waiting for the user to       */
+/*  receive the messages that were read from it in advance.                   */
+/******************************************************************************/
+    case NN_SIPC_STATE_DRAINING:
+        switch (src) {
+
+        case NN_SIPC_SRC_FLUSH:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            sipc->flushing = 0;
+            return;
+
         default:
             nn_fsm_bad_source (sipc->state, src, type);
         }
@@ -411,7 +600,16 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
 /*  this state except stopping the object.                                    */
 /******************************************************************************/
     case NN_SIPC_STATE_DONE:
-        nn_fsm_bad_source (sipc->state, src, type);
+        switch (src) {
+
+        case NN_SIPC_SRC_FLUSH:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            sipc->flushing = 0;
+            return;
+
+        default:
+            nn_fsm_bad_source (sipc->state, src, type);
+        }
 
 
 /******************************************************************************/
@@ -421,3 +619,98 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
         nn_fsm_bad_state (sipc->state, src, type);
     }
 }
+
+static void nn_sipc_send_batch (struct nn_sipc *self)
+{
+    nn_assert (self->outstate == NN_SIPC_OUTSTATE_IDLE);
+    nn_sendbatch_send (&self->batch, self->usock);
+    self->outstate = NN_SIPC_OUTSTATE_SENDING;
+}
+
+static void nn_sipc_error (struct nn_sipc *self)
+{
+    /*  Messages that were read from the connection before it broke are
+        delivered to the user first. The error is reported once the last
+        of them is received. */
+    if (!nn_msgqueue_empty (&self->inqueue)) {
+        self->state = NN_SIPC_STATE_DRAINING;
+        return;
+    }
+
+    nn_pipebase_stop (&self->pipebase);
+    self->state = NN_SIPC_STATE_DONE;
+    nn_fsm_raise (&self->fsm, &self->done, NN_SIPC_ERROR);
+}
+
+static void nn_sipc_start_recv (struct nn_sipc *self)
+{
+    /*  Messages that are already available are queued straight away,
+        without waiting for the usock. */
+    do {
+        if (nn_usock_try_recv (self->usock, self->inhdr,
+              sizeof (self->inhdr)) != 0) {
+            self->instate = NN_SIPC_INSTATE_HDR;
+            nn_usock_recv (self->usock, self->inhdr, sizeof (self->inhdr),
+                NULL);
+            return;
+        }
+    } while (nn_sipc_hdr_received (self));
+}
+
+static int nn_sipc_hdr_received (struct nn_sipc *self)
+{
+    uint64_t size;
+    void *chunk;
+
+    /*  Message header was received. Allocate memory for the message. */
+    nn_assert (self->inhdr [0] == NN_SIPC_MSG_NORMAL);
+    size = nn_getll (self->inhdr + 1);
+    nn_msg_term (&self->inmsg);
+
+    /*  In zero-copy mode, message body that is already available is passed
+        to the owner as a slice of the batch buffer. Small messages are stored
+        directly in the message structure anyway. */
+    if (self->zerocopy && size >= NN_CHUNKREF_MAX &&
+          nn_usock_try_recv_slice (self->usock, (size_t) size, &chunk) == 0) {
+        nn_msg_init_chunk (&self->inmsg, chunk);
+        return nn_sipc_msg_received (self);
+    }
+
+    nn_msg_init (&self->inmsg, (size_t) size);
+
+    /*  If the whole message body is already available (or there is no body
+        at all) the message can be queued immediately. */
+    if (!size || nn_usock_try_recv (self->usock,
+          nn_chunkref_data (&self->inmsg.body), (size_t) size) == 0)
+        return nn_sipc_msg_received (self);
+
+    /*  Start receiving the message body. */
+    self->instate = NN_SIPC_INSTATE_BODY;
+    nn_usock_recv (self->usock, nn_chunkref_data (&self->inmsg.body),
+        (size_t) size, NULL);
+
+    return 0;
+}
+
+static int nn_sipc_msg_received (struct nn_sipc *self)
+{
+    int rc;
+
+    rc = nn_msgqueue_send (&self->inqueue, &self->inmsg);
+    nn_msg_init (&self->inmsg, 0);
+
+    /*  If the queue was empty, tell the owner there's a message to
+        receive. */
+    if (rc & NN_MSGQUEUE_WAKEUP)
+        nn_pipebase_received (&self->pipebase);
+
+    /*  If the queue is full, stop reading from the connection till the
+        owner receives some of the messages. */
+    if (rc & NN_MSGQUEUE_FULL) {
+        self->instate = NN_SIPC_INSTATE_FULL;
+        return 0;
+    }
+
+    return 1;
+}
+
@@ -27,8 +27,11 @@
 
 #include "../../aio/fsm.h"
 #include "../../aio/usock.h"
+#include "../../aio/timer.h"
 
 #include "../utils/streamhdr.h"
+#include "../utils/sendbatch.h"
+#include "../utils/msgqueue.h"
 
 #include "../../utils/msg.h"
 
@@ -65,14 +68,37 @@ struct nn_sipc {
     /*  Message being received at the moment. */
     struct nn_msg inmsg;
 
+    /*  Messages that were received but not yet passed to the owner. Reading
+        from the connection is suspended while there are more than NN_RCVBUF
+        bytes in the queue. */
+    struct nn_msgqueue inqueue;
+
+    /*  1 if received messages reference the usock's batch buffer instead of
+        being copied out of it. */
+    int zerocopy;
+
     /*  State of the outbound state machine. */
     int outstate;
 
-    /*  Buffer used to store the header of outgoing message. */
-    uint8_t outhdr [9];
-
-    /*  Message being sent at the moment. */
-    struct nn_msg outmsg;
+    /*  Queue of outbound messages. Messages queued while a write is in
+        progress are written in a single batch once it completes. */
+    struct nn_sendbatch batch;
+
+    /*  1 if NN_SNDBATCH option is set. In such case the batch is written
+        from the worker thread so that the user has a chance to add more
+        messages to it in the meantime. */
+    int gather;
+    struct nn_worker *worker;
+    struct nn_worker_task flush_task;
+    int flushing;
+
+    /*  1 if the pipe doesn't accept new messages because the queue is
+        full. */
+    int blocked;
+
+    /*  Bounds the time spent writing out the queued messages once the
+        pipe is being stopped. See NN_LINGER. */
+    struct nn_timer timer;
 
     /*  Event raised when the state machine ends. */
     struct nn_fsm_event done;
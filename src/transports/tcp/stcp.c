@@ -37,11 +37,13 @@
 #define NN_STCP_STATE_SHUTTING_DOWN 5
 #define NN_STCP_STATE_DONE 6
 #define NN_STCP_STATE_STOPPING 7
+#define NN_STCP_STATE_LINGERING 8
+#define NN_STCP_STATE_DRAINING 9
 
 /*  Possible states of the inbound part of the object. */
 #define NN_STCP_INSTATE_HDR 1
 #define NN_STCP_INSTATE_BODY 2
-#define NN_STCP_INSTATE_HASMSG 3
+#define NN_STCP_INSTATE_FULL 3
 
 /*  Possible states of the outbound part of the object. */
 #define NN_STCP_OUTSTATE_IDLE 1
@@ -50,6 +52,8 @@
 /*  Subordinate srcptr objects. */
 #define NN_STCP_SRC_USOCK 1
 #define NN_STCP_SRC_STREAMHDR 2
+#define NN_STCP_SRC_FLUSH 3
+#define NN_STCP_SRC_TIMER 4
 
 /*  Stream is a special type of pipe. Implementation of the virtual pipe API. */
 static int nn_stcp_send (struct nn_pipebase *self, struct nn_msg *msg);
@@ -64,10 +68,26 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_stcp_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
+static void nn_stcp_send_batch (struct nn_stcp *self);
+
+/*  Handles the connection being broken. */
+static void nn_stcp_error (struct nn_stcp *self);
+
+/*  Reads messages from the connection into the inbound queue till either
+    the queue is full or the usock has to wait for more data. */
+static void nn_stcp_start_recv (struct nn_stcp *self);
+
+/*  Both functions return 1 if the message was queued and there's room for
+    more messages, 0 otherwise. */
+static int nn_stcp_hdr_received (struct nn_stcp *self);
+static int nn_stcp_msg_received (struct nn_stcp *self);
 
 void nn_stcp_init (struct nn_stcp *self, int src,
     struct nn_epbase *epbase, struct nn_fsm *owner)
 {
+    int rcvbuf;
+    size_t sz;
+
     nn_fsm_init (&self->fsm, nn_stcp_handler, nn_stcp_shutdown,
         src, self, owner);
     self->state = NN_STCP_STATE_IDLE;
@@ -78,8 +98,19 @@ void nn_stcp_init (struct nn_stcp *self, int src,
     nn_pipebase_init (&self->pipebase, &nn_stcp_pipebase_vfptr, epbase);
     self->instate = -1;
     nn_msg_init (&self->inmsg, 0);
+    sz = sizeof (rcvbuf);
+    nn_epbase_getopt (epbase, NN_SOL_SOCKET, NN_RCVBUF, &rcvbuf, &sz);
+    nn_assert (sz == sizeof (rcvbuf));
+    nn_msgqueue_init (&self->inqueue, rcvbuf);
+    self->zerocopy = 0;
     self->outstate = -1;
-    nn_msg_init (&self->outmsg, 0);
+    nn_sendbatch_init (&self->batch);
+    self->worker = nn_fsm_choose_worker (&self->fsm);
+    nn_worker_task_init (&self->flush_task, NN_STCP_SRC_FLUSH, &self->fsm);
+    self->gather = 0;
+    self->flushing = 0;
+    self->blocked = 0;
+    nn_timer_init (&self->timer, NN_STCP_SRC_TIMER, &self->fsm);
     nn_fsm_event_init (&self->done);
 }
 
@@ -88,7 +119,10 @@ void nn_stcp_term (struct nn_stcp *self)
     nn_assert_state (self, NN_STCP_STATE_IDLE);
 
     nn_fsm_event_term (&self->done);
-    nn_msg_term (&self->outmsg);
+    nn_timer_term (&self->timer);
+    nn_worker_task_term (&self->flush_task);
+    nn_sendbatch_term (&self->batch);
+    nn_msgqueue_term (&self->inqueue);
     nn_msg_term (&self->inmsg);
     nn_pipebase_term (&self->pipebase);
     nn_streamhdr_term (&self->streamhdr);
@@ -121,51 +155,82 @@ void nn_stcp_stop (struct nn_stcp *self)
 static int nn_stcp_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
     struct nn_stcp *stcp;
-    struct nn_iovec iov [3];
+    uint8_t hdr [8];
 
     stcp = nn_cont (self, struct nn_stcp, pipebase);
 
-    nn_assert_state (stcp, NN_STCP_STATE_ACTIVE);
-    nn_assert (stcp->outstate == NN_STCP_OUTSTATE_IDLE);
-
-    /*  Move the message to the local storage. */
-    nn_msg_term (&stcp->outmsg);
-    nn_msg_mv (&stcp->outmsg, msg);
-
-    /*  Serialise the message header. */
-    nn_putll (stcp->outhdr, nn_chunkref_size (&stcp->outmsg.sphdr) +
-        nn_chunkref_size (&stcp->outmsg.body));
+    /*  If the connection is already broken, the pipe is only kept for the
+        user to receive the messages that were read from it. The message
+        is dropped and the pipe doesn't accept any more. */
+    if (nn_slow (stcp->state != NN_STCP_STATE_ACTIVE)) {
+        nn_msg_term (msg);
+        return 0;
+    }
 
-    /*  Start async sending. */
-    iov [0].iov_base = stcp->outhdr;
-    iov [0].iov_len = sizeof (stcp->outhdr);
-    iov [1].iov_base = nn_chunkref_data (&stcp->outmsg.sphdr);
-    iov [1].iov_len = nn_chunkref_size (&stcp->outmsg.sphdr);
-    iov [2].iov_base = nn_chunkref_data (&stcp->outmsg.body);
-    iov [2].iov_len = nn_chunkref_size (&stcp->outmsg.body);
-    nn_usock_send (stcp->usock, iov, 3);
+    /*  Add the message to the outbound queue. Unless the queue is full, the
+        pipe is immediately ready to accept the next message. */
+    nn_putll (hdr, nn_chunkref_size (&msg->sphdr) + nn_msg_bodysize (msg));
+    if (nn_sendbatch_push (&stcp->batch, hdr, sizeof (hdr), msg))
+        nn_pipebase_sent (&stcp->pipebase);
+    else
+        stcp->blocked = 1;
+    nn_pipebase_setqueued (&stcp->pipebase, nn_sendbatch_count (&stcp->batch));
+
+    /*  If a write is already in progress, the queued messages will be
+        written as soon as it completes. */
+    if (stcp->outstate != NN_STCP_OUTSTATE_IDLE)
+        return 0;
+
+    /*  In batching mode let the worker thread send the batch later on so
+        that more messages can be gathered in the meantime. There's no point
+        in waiting if the batch is already full though. */
+    if (stcp->gather && !stcp->blocked) {
+        if (!stcp->flushing) {
+            stcp->flushing = 1;
+            nn_worker_execute (stcp->worker, &stcp->flush_task);
+        }
+        return 0;
+    }
 
-    stcp->outstate = NN_STCP_OUTSTATE_SENDING;
+    nn_stcp_send_batch (stcp);
 
     return 0;
 }
 
 static int nn_stcp_recv (struct nn_pipebase *self, struct nn_msg *msg)
 {
+    int rc;
     struct nn_stcp *stcp;
 
     stcp = nn_cont (self, struct nn_stcp, pipebase);
 
-    nn_assert_state (stcp, NN_STCP_STATE_ACTIVE);
-    nn_assert (stcp->instate == NN_STCP_INSTATE_HASMSG);
+    nn_assert (stcp->state == NN_STCP_STATE_ACTIVE ||
+        stcp->state == NN_STCP_STATE_SHUTTING_DOWN ||
+        stcp->state == NN_STCP_STATE_DRAINING);
 
-    /*  Move received message to the user. */
-    nn_msg_mv (msg, &stcp->inmsg);
-    nn_msg_init (&stcp->inmsg, 0);
+    /*  Move the oldest received message to the user. */
+    rc = nn_msgqueue_recv (&stcp->inqueue, msg);
 
-    /*  Start receiving new message. */
-    stcp->instate = NN_STCP_INSTATE_HDR;
-    nn_usock_recv (stcp->usock, stcp->inhdr, sizeof (stcp->inhdr), NULL);
+    /*  If reading from the connection was suspended because the queue was
+        full, resume it now, unless the connection is broken. */
+    if (rc & NN_MSGQUEUE_RESUME) {
+        nn_assert (stcp->instate == NN_STCP_INSTATE_FULL);
+        if (stcp->state == NN_STCP_STATE_ACTIVE)
+            nn_stcp_start_recv (stcp);
+    }
+
+    /*  If there are more messages in the queue, the pipe stays readable.
+        Otherwise the owner will be notified once a new message arrives. */
+    if (!(rc & NN_MSGQUEUE_EMPTY))
+        nn_pipebase_received (&stcp->pipebase);
+
+    /*  The last message read from a broken connection was received. Now
+        the owner can be told about the error. The pipe is stopped by the
+        owner, outside of this call. */
+    else if (stcp->state == NN_STCP_STATE_DRAINING) {
+        stcp->state = NN_STCP_STATE_DONE;
+        nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+    }
 
     return 0;
 }
@@ -174,16 +239,80 @@ static void nn_stcp_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
     struct nn_stcp *stcp;
+    int linger;
+    size_t sz;
 
     stcp = nn_cont (self, struct nn_stcp, fsm);
 
     if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
+
+        /*  Messages accepted by the pipe but not yet written are given
+            NN_LINGER milliseconds to get out before the connection is
+            closed. */
+        linger = 0;
+        if (stcp->state == NN_STCP_STATE_ACTIVE &&
+              !nn_sendbatch_empty (&stcp->batch)) {
+            sz = sizeof (linger);
+            nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET, NN_LINGER,
+                &linger, &sz);
+            nn_assert (sz == sizeof (linger));
+        }
         nn_pipebase_stop (&stcp->pipebase);
+        if (linger != 0) {
+            if (linger > 0)
+                nn_timer_start (&stcp->timer, linger);
+            if (stcp->outstate == NN_STCP_OUTSTATE_IDLE)
+                nn_stcp_send_batch (stcp);
+            stcp->state = NN_STCP_STATE_LINGERING;
+            return;
+        }
+        nn_streamhdr_stop (&stcp->streamhdr);
+        stcp->state = NN_STCP_STATE_STOPPING;
+    }
+    if (nn_slow (stcp->state == NN_STCP_STATE_LINGERING)) {
+        switch (src) {
+        case NN_STCP_SRC_USOCK:
+
+            /*  Inbound messages are of no interest anymore. On
+                NN_USOCK_SHUTDOWN and NN_USOCK_ERROR the queued messages
+                can't be written and are dropped. */
+            if (type == NN_USOCK_RECEIVED)
+                return;
+            if (type == NN_USOCK_SENT) {
+                stcp->outstate = NN_STCP_OUTSTATE_IDLE;
+                nn_sendbatch_sent (&stcp->batch);
+                if (nn_sendbatch_pending (&stcp->batch)) {
+                    nn_stcp_send_batch (stcp);
+                    return;
+                }
+            }
+            break;
+        case NN_STCP_SRC_FLUSH:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            stcp->flushing = 0;
+            return;
+        case NN_STCP_SRC_TIMER:
+            nn_assert (type == NN_TIMER_TIMEOUT);
+            break;
+        default:
+            nn_fsm_bad_source (stcp->state, src, type);
+        }
+        nn_timer_stop (&stcp->timer);
         nn_streamhdr_stop (&stcp->streamhdr);
         stcp->state = NN_STCP_STATE_STOPPING;
     }
     if (nn_slow (stcp->state == NN_STCP_STATE_STOPPING)) {
-        if (nn_streamhdr_isidle (&stcp->streamhdr)) {
+
+        /*  Wait till the batch flushing task arrives to the worker thread. */
+        if (src == NN_STCP_SRC_FLUSH) {
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            stcp->flushing = 0;
+        }
+        if (nn_streamhdr_isidle (&stcp->streamhdr) &&
+              nn_timer_isidle (&stcp->timer) && !stcp->flushing) {
+            nn_sendbatch_clear (&stcp->batch);
+            stcp->blocked = 0;
+            nn_msgqueue_clear (&stcp->inqueue);
             nn_usock_swap_owner (stcp->usock, &stcp->usock_owner);
             stcp->usock = NULL;
             stcp->usock_owner.src = -1;
@@ -203,7 +332,11 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
 {
     int rc;
     struct nn_stcp *stcp;
-    uint64_t size;
+    int sndbuf;
+    int sndbatch;
+    int rcvbatch;
+    int zerocopy;
+    size_t sz;
 
     stcp = nn_cont (self, struct nn_stcp, fsm);
 
@@ -280,6 +413,33 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                     return;
                  }
 
+                 /*  Outbound messages are queued up to NN_SNDBUF bytes.
+                     If NN_SNDBATCH is set, they are rather gathered into
+                     batches of that size. */
+                 sz = sizeof (sndbuf);
+                 nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
+                     NN_SNDBUF, &sndbuf, &sz);
+                 nn_assert (sz == sizeof (sndbuf));
+                 sz = sizeof (sndbatch);
+                 nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
+                     NN_SNDBATCH, &sndbatch, &sz);
+                 nn_assert (sz == sizeof (sndbatch));
+                 stcp->gather = sndbatch > 0 ? 1 : 0;
+                 nn_sendbatch_setlimit (&stcp->batch,
+                     (size_t) (stcp->gather ? sndbatch : sndbuf));
+
+                 /*  Set the maximal size of the inbound batch buffer. */
+                 sz = sizeof (rcvbatch);
+                 nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
+                     NN_RCVBATCH, &rcvbatch, &sz);
+                 nn_assert (sz == sizeof (rcvbatch));
+                 nn_usock_set_rcvbatch (stcp->usock, (size_t) rcvbatch);
+                 sz = sizeof (zerocopy);
+                 nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
+                     NN_RCVZEROCOPY, &zerocopy, &sz);
+                 nn_assert (sz == sizeof (zerocopy));
+                 stcp->zerocopy = zerocopy;
+
                  /*  Start receiving a message in asynchronous manner. */
                  stcp->instate = NN_STCP_INSTATE_HDR;
                  nn_usock_recv (stcp->usock, &stcp->inhdr,
@@ -312,44 +472,34 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                 /*  The message is now fully sent. */
                 nn_assert (stcp->outstate == NN_STCP_OUTSTATE_SENDING);
                 stcp->outstate = NN_STCP_OUTSTATE_IDLE;
-                nn_msg_term (&stcp->outmsg);
-                nn_msg_init (&stcp->outmsg, 0);
-                nn_pipebase_sent (&stcp->pipebase);
+
+                /*  Release the sent messages and send the messages that
+                    were queued in the meantime straight away. */
+                nn_sendbatch_sent (&stcp->batch);
+                nn_pipebase_setqueued (&stcp->pipebase,
+                    nn_sendbatch_count (&stcp->batch));
+                if (nn_sendbatch_pending (&stcp->batch))
+                    nn_stcp_send_batch (stcp);
+                if (stcp->blocked && !nn_sendbatch_isfull (&stcp->batch)) {
+                    stcp->blocked = 0;
+                    nn_pipebase_sent (&stcp->pipebase);
+                }
                 return;
 
             case NN_USOCK_RECEIVED:
 
                 switch (stcp->instate) {
                 case NN_STCP_INSTATE_HDR:
-
-                    /*  Message header was received. Allocate memory for the
-                        message. */
-                    size = nn_getll (stcp->inhdr);
-                    nn_msg_term (&stcp->inmsg);
-                    nn_msg_init (&stcp->inmsg, (size_t) size);
-
-                    /*  Special case when size of the message body is 0. */
-                    if (!size) {
-                        stcp->instate = NN_STCP_INSTATE_HASMSG;
-                        nn_pipebase_received (&stcp->pipebase);
-                        return;
-                    }
-
-                    /*  Start receiving the message body. */
-                    stcp->instate = NN_STCP_INSTATE_BODY;
-                    nn_usock_recv (stcp->usock,
-                        nn_chunkref_data (&stcp->inmsg.body),
-                       (size_t) size, NULL);
-
+                    if (nn_stcp_hdr_received (stcp))
+                        nn_stcp_start_recv (stcp);
                     return;
 
                 case NN_STCP_INSTATE_BODY:
 
-                    /*  Message body was received. Notify the owner that it
-                        can receive it. */
-                    stcp->instate = NN_STCP_INSTATE_HASMSG;
-                    nn_pipebase_received (&stcp->pipebase);
-
+                    /*  Message body was received. Queue it for the owner
+                        and carry on reading the next one. */
+                    if (nn_stcp_msg_received (stcp))
+                        nn_stcp_start_recv (stcp);
                     return;
 
                 default:
@@ -358,14 +508,32 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                 }
 
             case NN_USOCK_SHUTDOWN:
-                nn_pipebase_stop (&stcp->pipebase);
+
+                /*  The pipe is kept while there are received messages
+                    waiting for the user. */
+                if (nn_msgqueue_empty (&stcp->inqueue))
+                    nn_pipebase_stop (&stcp->pipebase);
                 stcp->state = NN_STCP_STATE_SHUTTING_DOWN;
                 return;
 
             case NN_USOCK_ERROR:
-                nn_pipebase_stop (&stcp->pipebase);
-                stcp->state = NN_STCP_STATE_DONE;
-                nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+                nn_stcp_error (stcp);
+                return;
+
+            default:
+                nn_fsm_bad_action (stcp->state, src, type);
+            }
+
+        case NN_STCP_SRC_FLUSH:
+            switch (type) {
+            case NN_WORKER_TASK_EXECUTE:
+
+                /*  We are in the worker thread now. Send whatever have been
+                    gathered in the batch so far. */
+                stcp->flushing = 0;
+                if (stcp->outstate == NN_STCP_OUTSTATE_IDLE &&
+                      nn_sendbatch_pending (&stcp->batch))
+                    nn_stcp_send_batch (stcp);
                 return;
 
             default:
@@ -387,25 +555,55 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
         case NN_STCP_SRC_USOCK:
             switch (type) {
             case NN_USOCK_ERROR:
-                stcp->state = NN_STCP_STATE_DONE;
-                nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+                nn_stcp_error (stcp);
                 return;
             default:
                 nn_fsm_bad_action (stcp->state, src, type);
             }
 
+        case NN_STCP_SRC_FLUSH:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            stcp->flushing = 0;
+            return;
+
         default:
             nn_fsm_bad_source (stcp->state, src, type);
         }
 
 
+/******************************************************************************/
+/*  DRAINING state.                                                           */
+/*  The underlying connection is closed. We are waiting for the user to       */
+/*  receive the messages that were read from it in advance.                   */
+/******************************************************************************/
+    case NN_STCP_STATE_DRAINING:
+        switch (src) {
+
+        case NN_STCP_SRC_FLUSH:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            stcp->flushing = 0;
+            return;
+
+        default:
+            nn_fsm_bad_source (stcp->state, src, type);
+        }
+
 /******************************************************************************/
 /*  DONE state.                                                               */
 /*  The underlying connection is closed. There's nothing that can be done in  */
 /*  this state except stopping the object.                                    */
 /******************************************************************************/
     case NN_STCP_STATE_DONE:
-        nn_fsm_bad_source (stcp->state, src, type);
+        switch (src) {
+
+        case NN_STCP_SRC_FLUSH:
+            nn_assert (type == NN_WORKER_TASK_EXECUTE);
+            stcp->flushing = 0;
+            return;
+
+        default:
+            nn_fsm_bad_source (stcp->state, src, type);
+        }
 
 /******************************************************************************/
 /*  Invalid state.                                                            */
@@ -415,3 +613,96 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
     }
 }
 
+static void nn_stcp_send_batch (struct nn_stcp *self)
+{
+    nn_assert (self->outstate == NN_STCP_OUTSTATE_IDLE);
+    nn_sendbatch_send (&self->batch, self->usock);
+    self->outstate = NN_STCP_OUTSTATE_SENDING;
+}
+
+static void nn_stcp_error (struct nn_stcp *self)
+{
+    /*  Messages that were read from the connection before it broke are
+        delivered to the user first. The error is reported once the last
+        of them is received. */
+    if (!nn_msgqueue_empty (&self->inqueue)) {
+        self->state = NN_STCP_STATE_DRAINING;
+        return;
+    }
+
+    nn_pipebase_stop (&self->pipebase);
+    self->state = NN_STCP_STATE_DONE;
+    nn_fsm_raise (&self->fsm, &self->done, NN_STCP_ERROR);
+}
+
+static void nn_stcp_start_recv (struct nn_stcp *self)
+{
+    /*  Messages that are already available are queued straight away,
+        without waiting for the usock. */
+    do {
+        if (nn_usock_try_recv (self->usock, self->inhdr,
+              sizeof (self->inhdr)) != 0) {
+            self->instate = NN_STCP_INSTATE_HDR;
+            nn_usock_recv (self->usock, self->inhdr, sizeof (self->inhdr),
+                NULL);
+            return;
+        }
+    } while (nn_stcp_hdr_received (self));
+}
+
+static int nn_stcp_hdr_received (struct nn_stcp *self)
+{
+    uint64_t size;
+    void *chunk;
+
+    /*  Message header was received. Allocate memory for the message. */
+    size = nn_getll (self->inhdr);
+    nn_msg_term (&self->inmsg);
+
+    /*  In zero-copy mode, message body that is already available is passed
+        to the owner as a slice of the batch buffer. Small messages are stored
+        directly in the message structure anyway. */
+    if (self->zerocopy && size >= NN_CHUNKREF_MAX &&
+          nn_usock_try_recv_slice (self->usock, (size_t) size, &chunk) == 0) {
+        nn_msg_init_chunk (&self->inmsg, chunk);
+        return nn_stcp_msg_received (self);
+    }
+
+    nn_msg_init (&self->inmsg, (size_t) size);
+
+    /*  If the whole message body is already available (or there is no body
+        at all) the message can be queued immediately. */
+    if (!size || nn_usock_try_recv (self->usock,
+          nn_chunkref_data (&self->inmsg.body), (size_t) size) == 0)
+        return nn_stcp_msg_received (self);
+
+    /*  Start receiving the message body. */
+    self->instate = NN_STCP_INSTATE_BODY;
+    nn_usock_recv (self->usock, nn_chunkref_data (&self->inmsg.body),
+       (size_t) size, NULL);
+
+    return 0;
+}
+
+static int nn_stcp_msg_received (struct nn_stcp *self)
+{
+    int rc;
+
+    rc = nn_msgqueue_send (&self->inqueue, &self->inmsg);
+    nn_msg_init (&self->inmsg, 0);
+
+    /*  If the queue was empty, tell the owner there's a message to
+        receive. */
+    if (rc & NN_MSGQUEUE_WAKEUP)
+        nn_pipebase_received (&self->pipebase);
+
+    /*  If the queue is full, stop reading from the connection till the
+        owner receives some of the messages. */
+    if (rc & NN_MSGQUEUE_FULL) {
+        self->instate = NN_STCP_INSTATE_FULL;
+        return 0;
+    }
+
+    return 1;
+}
+
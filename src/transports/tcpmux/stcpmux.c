@@ -131,6 +131,7 @@ static int nn_stcpmux_send (struct nn_pipebase *self, struct nn_msg *msg)
     /*  Move the message to the local storage. */
     nn_msg_term (&stcpmux->outmsg);
     nn_msg_mv (&stcpmux->outmsg, msg);
+    nn_msg_flatten (&stcpmux->outmsg);
 
     /*  Serialise the message header. */
     nn_putll (stcpmux->outhdr, nn_chunkref_size (&stcpmux->outmsg.sphdr) +
@@ -0,0 +1,214 @@
+/*
+    Copyright (c) 2012-2013 Martin Sustrik  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "msgqueue.h"
+
+#include "../../utils/alloc.h"
+#include "../../utils/fast.h"
+#include "../../utils/err.h"
+
+#include <string.h>
+
+/*  Private functions. */
+static struct nn_msgqueue_chunk *nn_msgqueue_xchg (struct nn_msgqueue *self,
+    struct nn_msgqueue_chunk *newval);
+
+/*  Returns the number of bytes the message is accounted for. */
+static uint32_t nn_msgqueue_msgsz (struct nn_msgqueue *self,
+    struct nn_msg *msg)
+{
+    size_t msgsz;
+
+    msgsz = nn_chunkref_size (&msg->sphdr) + nn_msg_bodysize (msg);
+    return msgsz < self->maxmem ? (uint32_t) msgsz : self->maxmem;
+}
+
+void nn_msgqueue_init (struct nn_msgqueue *self, size_t maxmem)
+{
+    struct nn_msgqueue_chunk *chunk;
+
+    nn_atomic_init (&self->count, 0);
+    nn_atomic_init (&self->mem, 0);
+    self->maxmem = maxmem < 0x7fffffff ? (uint32_t) maxmem : 0x7fffffff;
+
+    chunk = nn_alloc (sizeof (struct nn_msgqueue_chunk), "msgqueue chunk");
+    alloc_assert (chunk);
+    chunk->next = NULL;
+
+    self->out.chunk = chunk;
+    self->out.pos = 0;
+    self->in.chunk = chunk;
+    self->in.pos = 0;
+
+    self->spare = NULL;
+#if defined NN_ATOMIC_MUTEX
+    nn_mutex_init (&self->spare_sync);
+#endif
+}
+
+void nn_msgqueue_term (struct nn_msgqueue *self)
+{
+    /*  Deallocate messages in the pipe. */
+    nn_msgqueue_clear (self);
+
+    /*  There are no more messages in the pipe so there's at most one chunk
+        in the queue. Deallocate it. */
+    nn_assert (self->in.chunk == self->out.chunk);
+    nn_free (self->in.chunk);
+
+    /*  Deallocate the spare chunk, if any. */
+    if (self->spare)
+        nn_free (self->spare);
+#if defined NN_ATOMIC_MUTEX
+    nn_mutex_term (&self->spare_sync);
+#endif
+
+    nn_atomic_term (&self->mem);
+    nn_atomic_term (&self->count);
+}
+
+void nn_msgqueue_clear (struct nn_msgqueue *self)
+{
+    struct nn_msg msg;
+
+    /*  Neither the reader nor the writer is using the queue at this point,
+        so the counter can be accessed directly. */
+    while (self->count.n) {
+        nn_msgqueue_recv (self, &msg);
+        nn_msg_term (&msg);
+    }
+}
+
+int nn_msgqueue_empty (struct nn_msgqueue *self)
+{
+    return self->count.n == 0 ? 1 : 0;
+}
+
+int nn_msgqueue_send (struct nn_msgqueue *self, struct nn_msg *msg)
+{
+    int rc;
+    uint32_t msgsz;
+    uint32_t mem;
+    struct nn_msgqueue_chunk *chunk;
+
+    msgsz = nn_msgqueue_msgsz (self, msg);
+
+    /*  Move the content of the message to the pipe. */
+    nn_msg_mv (&self->out.chunk->msgs [self->out.pos], msg);
+    ++self->out.pos;
+
+    /*  If there's no space for a new message in the pipe, either re-use
+        the spare chunk or allocate a new one if there's none. The chunk is
+        linked before the message is published so that the reader can follow
+        the link once it reads the message. */
+    if (nn_slow (self->out.pos == NN_MSGQUEUE_GRANULARITY)) {
+        chunk = nn_msgqueue_xchg (self, NULL);
+        if (nn_slow (!chunk)) {
+            chunk = nn_alloc (sizeof (struct nn_msgqueue_chunk),
+                "msgqueue chunk");
+            alloc_assert (chunk);
+        }
+        chunk->next = NULL;
+        self->out.chunk->next = chunk;
+        self->out.chunk = chunk;
+        self->out.pos = 0;
+    }
+
+    /*  Publish the message. The reader is waiting for a notification only
+        if it have seen the queue empty. Similarly, the writer has to stop
+        only if this message made the queue cross its size limit. */
+    rc = 0;
+    mem = nn_atomic_inc (&self->mem, msgsz);
+    if (nn_slow (mem < self->maxmem && mem + msgsz >= self->maxmem))
+        rc |= NN_MSGQUEUE_FULL;
+    if (nn_atomic_inc (&self->count, 1) == 0)
+        rc |= NN_MSGQUEUE_WAKEUP;
+
+    return rc;
+}
+
+int nn_msgqueue_recv (struct nn_msgqueue *self, struct nn_msg *msg)
+{
+    int rc;
+    uint32_t msgsz;
+    uint32_t mem;
+    struct nn_msgqueue_chunk *o;
+
+    /*  Move the message from the pipe to the user. */
+    nn_msg_mv (msg, &self->in.chunk->msgs [self->in.pos]);
+
+    /*  Move to the next position. The writer has already moved to the next
+        chunk, so the old one can be handed back to it. If the writer haven't
+        taken the previous spare chunk yet, that one is deallocated. */
+    ++self->in.pos;
+    if (nn_slow (self->in.pos == NN_MSGQUEUE_GRANULARITY)) {
+        o = self->in.chunk;
+        self->in.chunk = self->in.chunk->next;
+        self->in.pos = 0;
+        o = nn_msgqueue_xchg (self, o);
+        if (nn_slow (o != NULL))
+            nn_free (o);
+    }
+
+    /*  Adjust the statistics. The writer is waiting for a notification only
+        if this message made the queue drop below its size limit. */
+    rc = 0;
+    msgsz = nn_msgqueue_msgsz (self, msg);
+    mem = nn_atomic_dec (&self->mem, msgsz);
+    if (nn_slow (mem >= self->maxmem && mem - msgsz < self->maxmem))
+        rc |= NN_MSGQUEUE_RESUME;
+    if (nn_atomic_dec (&self->count, 1) == 1)
+        rc |= NN_MSGQUEUE_EMPTY;
+
+    return rc;
+}
+
+
+/*  Atomically replaces the spare chunk and returns the previous one. */
+static struct nn_msgqueue_chunk *nn_msgqueue_xchg (struct nn_msgqueue *self,
+    struct nn_msgqueue_chunk *newval)
+{
+#if defined NN_ATOMIC_WINAPI
+    return (struct nn_msgqueue_chunk*) InterlockedExchangePointer (
+        (PVOID volatile*) &self->spare, newval);
+#elif defined NN_ATOMIC_SOLARIS
+    return (struct nn_msgqueue_chunk*) atomic_swap_ptr (&self->spare, newval);
+#elif defined NN_ATOMIC_GCC_BUILTINS
+    struct nn_msgqueue_chunk *oldval;
+
+    do {
+        oldval = self->spare;
+    } while (nn_slow (!__sync_bool_compare_and_swap (&self->spare,
+        oldval, newval)));
+    return oldval;
+#elif defined NN_ATOMIC_MUTEX
+    struct nn_msgqueue_chunk *oldval;
+
+    nn_mutex_lock (&self->spare_sync);
+    oldval = self->spare;
+    self->spare = newval;
+    nn_mutex_unlock (&self->spare_sync);
+    return oldval;
+#else
+#error
+#endif
+}
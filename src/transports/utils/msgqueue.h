@@ -0,0 +1,126 @@
+/*
+    Copyright (c) 2012-2013 Martin Sustrik  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_MSGQUEUE_INCLUDED
+#define NN_MSGQUEUE_INCLUDED
+
+#include "../../utils/msg.h"
+#include "../../utils/atomic.h"
+#include "../../utils/mutex.h"
+
+#include <stddef.h>
+
+/*  This class is a simple uni-directional message queue. It is lock-free
+    as long as there's a single writer and a single reader, each of them
+    possibly running in a different thread. Instead of polling the queue,
+    the reader and the writer are told when to pass control to each other
+    by the return values of send and receive functions. */
+
+/*  It's not 128 so that chunk including its footer fits into a memory page. */
+#define NN_MSGQUEUE_GRANULARITY 126
+
+/*  Returned by nn_msgqueue_send. WAKEUP means that the queue was empty and
+    the reader has to be notified about the new message. FULL means that
+    the queue has reached its size limit and the writer must not write
+    more messages until the reader tells it to resume. */
+#define NN_MSGQUEUE_WAKEUP 1
+#define NN_MSGQUEUE_FULL 2
+
+/*  Returned by nn_msgqueue_recv. EMPTY means that the message received was
+    the last one and the reader must not read until it is woken up. RESUME
+    means that the queue dropped below its size limit and the writer has to
+    be told that it can write again. */
+#define NN_MSGQUEUE_EMPTY 4
+#define NN_MSGQUEUE_RESUME 8
+
+struct nn_msgqueue_chunk {
+    struct nn_msg msgs [NN_MSGQUEUE_GRANULARITY];
+    struct nn_msgqueue_chunk *next;
+};
+
+struct nn_msgqueue {
+
+    /*  Pointer to the position where next message should be written into
+        the message queue. Accessed only by the writer. */
+    struct {
+        struct nn_msgqueue_chunk *chunk;
+        int pos;
+    } out;
+
+    /*  Pointer to the first unread message in the message queue. Accessed
+        only by the reader. */
+    struct {
+        struct nn_msgqueue_chunk *chunk;
+        int pos;
+    } in;
+
+    /*  Number of messages in the queue. */
+    struct nn_atomic count;
+
+    /*  Amount of memory used by messages in the queue. Each message is
+        accounted for as at most maxmem bytes so that the counter can't
+        overflow. */
+    struct nn_atomic mem;
+
+    /*   Maximal queue size (in bytes). */
+    uint32_t maxmem;
+
+    /*  A chunk the reader is done with, kept for the writer to re-use so
+        that a chunk doesn't have to be allocated and deallocated each time
+        NN_MSGQUEUE_GRANULARITY messages pass through the queue. It is
+        exchanged atomically as the reader and the writer may access it at
+        the same time. */
+    struct nn_msgqueue_chunk *volatile spare;
+
+#if defined NN_ATOMIC_MUTEX
+    /*  Used to emulate atomic operations on 'spare'. */
+    struct nn_mutex spare_sync;
+#endif
+};
+
+/*  Initialise the message pipe. maxmem is the maximal queue size in bytes. */
+void nn_msgqueue_init (struct nn_msgqueue *self, size_t maxmem);
+
+/*  Terminate the message pipe. */
+void nn_msgqueue_term (struct nn_msgqueue *self);
+
+/*  Drops all the messages in the pipe. Neither the reader nor the writer
+    may be using the pipe at the moment. */
+void nn_msgqueue_clear (struct nn_msgqueue *self);
+
+/*  Returns 1 if there are no messages in the pipe. Neither the reader nor
+    the writer may be using the pipe at the moment. */
+int nn_msgqueue_empty (struct nn_msgqueue *self);
+
+/*  Writes a message to the pipe. Must not be called after NN_MSGQUEUE_FULL
+    was returned until the reader gets NN_MSGQUEUE_RESUME. One message
+    exceeding the size limit is always accepted. Returns a combination of
+    NN_MSGQUEUE_WAKEUP and NN_MSGQUEUE_FULL flags. */
+int nn_msgqueue_send (struct nn_msgqueue *self, struct nn_msg *msg);
+
+/*  Reads a message from the pipe. There must be a message in the queue,
+    i.e. it can be called only after the writer reported
+    NN_MSGQUEUE_WAKEUP and until NN_MSGQUEUE_EMPTY is returned. Returns
+    a combination of NN_MSGQUEUE_EMPTY and NN_MSGQUEUE_RESUME flags. */
+int nn_msgqueue_recv (struct nn_msgqueue *self, struct nn_msg *msg);
+
+#endif
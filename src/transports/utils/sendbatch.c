@@ -0,0 +1,219 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "sendbatch.h"
+
+#include "../../utils/alloc.h"
+#include "../../utils/err.h"
+#include "../../utils/fast.h"
+
+#include <string.h>
+
+/*  Private functions. */
+static struct nn_sendbatch_item *nn_sendbatch_item (struct nn_sendbatch *self,
+    int i);
+static void nn_sendbatch_release (struct nn_sendbatch *self, int n);
+static void nn_sendbatch_resize (struct nn_sendbatch *self, int capacity);
+
+void nn_sendbatch_init (struct nn_sendbatch *self)
+{
+    self->maxbytes = 0;
+    self->items = NULL;
+    self->capacity = 0;
+    self->grow = 0;
+    self->first = 0;
+    self->count = 0;
+    self->nsending = 0;
+    self->bytes = 0;
+}
+
+void nn_sendbatch_term (struct nn_sendbatch *self)
+{
+    nn_sendbatch_clear (self);
+    if (self->items)
+        nn_free (self->items);
+}
+
+void nn_sendbatch_setlimit (struct nn_sendbatch *self, size_t maxbytes)
+{
+    nn_assert (self->count == 0);
+
+    self->maxbytes = maxbytes;
+    if (maxbytes && !self->items)
+        nn_sendbatch_resize (self, NN_SENDBATCH_MAXMSGS);
+}
+
+int nn_sendbatch_push (struct nn_sendbatch *self, const void *hdr,
+    size_t hdrlen, struct nn_msg *msg)
+{
+    struct nn_sendbatch_item *item;
+
+    nn_assert (!nn_sendbatch_isfull (self));
+    nn_assert (hdrlen <= NN_SENDBATCH_MAXHDR);
+
+    item = nn_sendbatch_item (self, self->count);
+    memcpy (item->hdr, hdr, hdrlen);
+    item->hdrlen = hdrlen;
+    nn_msg_mv (&item->msg, msg);
+    ++self->count;
+    self->bytes += hdrlen + nn_chunkref_size (&item->msg.sphdr) +
+        nn_msg_bodysize (&item->msg);
+
+    /*  If the buffer is full but the byte limit was not reached yet, make
+        more room for messages. */
+    if (self->count == self->capacity && self->bytes < self->maxbytes &&
+          self->capacity < NN_SENDBATCH_MAXITEMS) {
+        if (self->nsending == 0)
+            nn_sendbatch_resize (self, self->capacity * 2);
+        else
+            self->grow = 1;
+    }
+
+    return nn_sendbatch_isfull (self) ? 0 : 1;
+}
+
+int nn_sendbatch_empty (struct nn_sendbatch *self)
+{
+    return self->count == 0 ? 1 : 0;
+}
+
+int nn_sendbatch_count (struct nn_sendbatch *self)
+{
+    return self->count;
+}
+
+int nn_sendbatch_pending (struct nn_sendbatch *self)
+{
+    return self->count > self->nsending ? 1 : 0;
+}
+
+int nn_sendbatch_isfull (struct nn_sendbatch *self)
+{
+    return self->count == self->capacity ||
+        self->bytes >= self->maxbytes ? 1 : 0;
+}
+
+void nn_sendbatch_send (struct nn_sendbatch *self, struct nn_usock *usock)
+{
+    int i;
+    int iovcnt;
+    struct nn_sendbatch_item *item;
+    struct nn_iovec iov [NN_USOCK_MAX_IOVCNT];
+
+    nn_assert (self->nsending == 0 && self->count > 0);
+
+    /*  Gather as many messages as possible into a single list of buffers. */
+    iovcnt = 0;
+    for (i = 0; i != self->count; ++i) {
+        item = nn_sendbatch_item (self, i);
+        if (iovcnt + 3 + nn_msg_nparts (&item->msg) > NN_USOCK_MAX_IOVCNT)
+            break;
+        iov [iovcnt].iov_base = item->hdr;
+        iov [iovcnt].iov_len = item->hdrlen;
+        ++iovcnt;
+        iovcnt += nn_sendbatch_msgiov (&item->msg, iov + iovcnt);
+    }
+    self->nsending = i;
+
+    nn_usock_send (usock, iov, iovcnt);
+}
+
+void nn_sendbatch_sent (struct nn_sendbatch *self)
+{
+    nn_assert (self->nsending > 0);
+    nn_sendbatch_release (self, self->nsending);
+    self->nsending = 0;
+    if (self->grow) {
+        nn_sendbatch_resize (self, self->capacity * 2);
+        self->grow = 0;
+    }
+}
+
+void nn_sendbatch_clear (struct nn_sendbatch *self)
+{
+    nn_sendbatch_release (self, self->count);
+    self->nsending = 0;
+    self->grow = 0;
+}
+
+int nn_sendbatch_msgiov (struct nn_msg *msg, struct nn_iovec *iov)
+{
+    int i;
+    int nparts;
+    void *chunk;
+
+    iov [0].iov_base = nn_chunkref_data (&msg->sphdr);
+    iov [0].iov_len = nn_chunkref_size (&msg->sphdr);
+    iov [1].iov_base = nn_chunkref_data (&msg->body);
+    iov [1].iov_len = nn_chunkref_size (&msg->body);
+    nparts = nn_msg_nparts (msg);
+    for (i = 0; i != nparts; ++i) {
+        chunk = nn_msg_part (msg, i);
+        iov [2 + i].iov_base = chunk;
+        iov [2 + i].iov_len = nn_chunk_size (chunk);
+    }
+    return 2 + nparts;
+}
+
+static struct nn_sendbatch_item *nn_sendbatch_item (struct nn_sendbatch *self,
+    int i)
+{
+    return &self->items [(self->first + i) % self->capacity];
+}
+
+static void nn_sendbatch_release (struct nn_sendbatch *self, int n)
+{
+    struct nn_sendbatch_item *item;
+
+    while (n--) {
+        item = nn_sendbatch_item (self, 0);
+        self->bytes -= item->hdrlen + nn_chunkref_size (&item->msg.sphdr) +
+            nn_msg_bodysize (&item->msg);
+        nn_msg_term (&item->msg);
+        self->first = (self->first + 1) % self->capacity;
+        --self->count;
+    }
+}
+
+static void nn_sendbatch_resize (struct nn_sendbatch *self, int capacity)
+{
+    int i;
+    struct nn_sendbatch_item *items;
+
+    nn_assert (self->nsending == 0 && capacity >= self->count);
+
+    items = nn_alloc (sizeof (struct nn_sendbatch_item) * capacity,
+        "send batch");
+    alloc_assert (items);
+
+    /*  Messages are moved to the beginning of the new buffer. */
+    for (i = 0; i != self->count; ++i)
+        memcpy (&items [i], nn_sendbatch_item (self, i),
+            sizeof (struct nn_sendbatch_item));
+
+    if (self->items)
+        nn_free (self->items);
+    self->items = items;
+    self->capacity = capacity;
+    self->first = 0;
+}
+
@@ -0,0 +1,133 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_SENDBATCH_INCLUDED
+#define NN_SENDBATCH_INCLUDED
+
+#include "../../aio/usock.h"
+
+#include "../../utils/msg.h"
+#include "../../utils/int.h"
+
+#include <stddef.h>
+
+/*  This class queues outbound messages of a stream-based pipe so that
+    multiple messages can be written to the underlying socket using a single
+    nn_usock_send call and so that the user doesn't have to wait for the
+    previous message to be written before sending the next one. Each message
+    is preceded by a transport-specific header. Messages that are being sent
+    are kept in the batch until the usock reports they were sent. */
+
+/*  Maximal size of the transport-specific message header. */
+#define NN_SENDBATCH_MAXHDR 16
+
+/*  Maximal number of messages written by a single nn_usock_send call. Each
+    message needs at least three iovecs: the transport header, the SP header
+    and the body. Messages with the body composed of multiple chunks need
+    more of them and thus, if there are many of those, fewer messages are
+    written at once. */
+#define NN_SENDBATCH_MAXMSGS (NN_USOCK_MAX_IOVCNT / 3)
+
+/*  Maximal number of messages in the batch. The buffer starts with room for
+    NN_SENDBATCH_MAXMSGS messages and grows as needed up to this limit. */
+#define NN_SENDBATCH_MAXITEMS 1024
+
+/*  Maximal number of iovecs needed to describe a message, not including
+    the transport header. */
+#define NN_SENDBATCH_MSGIOVCNT (NN_MSG_MAXPARTS + 1)
+
+struct nn_sendbatch_item {
+    uint8_t hdr [NN_SENDBATCH_MAXHDR];
+    size_t hdrlen;
+    struct nn_msg msg;
+};
+
+struct nn_sendbatch {
+
+    /*  Maximal number of bytes to keep in the batch. */
+    size_t maxbytes;
+
+    /*  Circular buffer of the messages. It is allocated when the limit
+        is set. */
+    struct nn_sendbatch_item *items;
+    int capacity;
+
+    /*  1 if the buffer ran out of room while a send was in progress. As the
+        usock references the items being sent, the buffer can't be resized
+        before the send is completed. */
+    int grow;
+
+    /*  Index of the oldest message and number of messages in the buffer. */
+    int first;
+    int count;
+
+    /*  Number of messages, starting with the oldest one, that are being
+        sent at the moment. */
+    int nsending;
+
+    /*  Total size of the messages in the batch, including the headers. */
+    size_t bytes;
+};
+
+void nn_sendbatch_init (struct nn_sendbatch *self);
+void nn_sendbatch_term (struct nn_sendbatch *self);
+
+/*  Sets the maximal size of the batch in bytes. The batch must be empty
+    when this function is called. */
+void nn_sendbatch_setlimit (struct nn_sendbatch *self, size_t maxbytes);
+
+/*  Moves the message to the batch. Returns 1 if more messages can be added
+    to the batch, 0 if the batch is full. The batch must not be full when
+    this function is called. */
+int nn_sendbatch_push (struct nn_sendbatch *self, const void *hdr,
+    size_t hdrlen, struct nn_msg *msg);
+
+/*  Returns 1 if there are no messages in the batch. */
+int nn_sendbatch_empty (struct nn_sendbatch *self);
+
+/*  Returns the number of messages in the batch. */
+int nn_sendbatch_count (struct nn_sendbatch *self);
+
+/*  Returns 1 if there are messages in the batch that haven't been passed
+    to the usock yet. */
+int nn_sendbatch_pending (struct nn_sendbatch *self);
+
+/*  Returns 1 if no more messages can be added to the batch. */
+int nn_sendbatch_isfull (struct nn_sendbatch *self);
+
+/*  Passes all the pending messages to the usock in a single call. Previous
+    send must be already completed. */
+void nn_sendbatch_send (struct nn_sendbatch *self, struct nn_usock *usock);
+
+/*  Releases the messages that were passed to the usock. To be called when
+    the usock reports NN_USOCK_SENT. */
+void nn_sendbatch_sent (struct nn_sendbatch *self);
+
+/*  Drops all the messages in the batch. */
+void nn_sendbatch_clear (struct nn_sendbatch *self);
+
+/*  Fills in iovecs describing the SP header and the payload of the message.
+    Returns the number of iovecs used, at most NN_SENDBATCH_MSGIOVCNT. */
+int nn_sendbatch_msgiov (struct nn_msg *msg, struct nn_iovec *iov);
+
+#endif
+
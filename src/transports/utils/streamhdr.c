@@ -287,6 +287,19 @@ invalidhdr:
     case NN_STREAMHDR_STATE_STOPPING_TIMER_DONE:
         switch (src) {
 
+        case NN_STREAMHDR_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_SHUTDOWN:
+                return;
+            case NN_USOCK_ERROR:
+                /*  The peer may close the connection right after sending
+                    the header, e.g. when it rejects the connection. */
+                streamhdr->state = NN_STREAMHDR_STATE_STOPPING_TIMER_ERROR;
+                return;
+            default:
+                nn_fsm_bad_action (streamhdr->state, src, type);
+            }
+
         case NN_STREAMHDR_SRC_TIMER:
             switch (type) {
             case NN_TIMER_STOPPED:
@@ -22,6 +22,7 @@
 */
 
 #include "sws.h"
+#include "ws_simd.h"
 #include "../../ws.h"
 #include "../../nn.h"
 
@@ -43,6 +44,7 @@
 #define NN_SWS_STATE_BROKEN_CONNECTION 6
 #define NN_SWS_STATE_DONE 7
 #define NN_SWS_STATE_STOPPING 8
+#define NN_SWS_STATE_LINGERING 9
 
 /*  Possible states of the inbound part of the object. */
 #define NN_SWS_INSTATE_RECV_HDR 1
@@ -60,6 +62,7 @@
 /*  Subordinate srcptr objects. */
 #define NN_SWS_SRC_USOCK 1
 #define NN_SWS_SRC_HANDSHAKE 2
+#define NN_SWS_SRC_TIMER 3
 
 /*  WebSocket opcode constants as per RFC 6455 5.2. */
 #define NN_WS_OPCODE_FRAGMENT 0x00
@@ -131,6 +134,9 @@ static void nn_sws_validate_utf8_chunk (struct nn_sws *self);
     RFC 6455 section 7. */
 static void nn_sws_validate_close_handshake (struct nn_sws *self);
 
+/*  Passes the queued messages to the usock. */
+static void nn_sws_send_batch (struct nn_sws *self);
+
 void nn_sws_init (struct nn_sws *self, int src,
     struct nn_epbase *epbase, struct nn_fsm *owner)
 {
@@ -146,7 +152,9 @@ void nn_sws_init (struct nn_sws *self, int src,
     self->instate = -1;
     nn_list_init (&self->inmsg_array);
     self->outstate = -1;
-    nn_msg_init (&self->outmsg, 0);
+    nn_sendbatch_init (&self->batch);
+    self->blocked = 0;
+    nn_timer_init (&self->timer, NN_SWS_SRC_TIMER, &self->fsm);
 
     self->continuing = 0;
 
@@ -167,7 +175,8 @@ void nn_sws_term (struct nn_sws *self)
     nn_assert_state (self, NN_SWS_STATE_IDLE);
 
     nn_fsm_event_term (&self->done);
-    nn_msg_term (&self->outmsg);
+    nn_timer_term (&self->timer);
+    nn_sendbatch_term (&self->batch);
     nn_msg_array_term (&self->inmsg_array);
     nn_pipebase_term (&self->pipebase);
     nn_ws_handshake_term (&self->handshaker);
@@ -322,23 +331,14 @@ static int nn_utf8_code_point (const uint8_t *buffer, size_t len)
 static void nn_sws_mask_payload (uint8_t *payload, size_t payload_len,
     const uint8_t *mask, size_t mask_len, int *mask_start_pos)
 {
-    unsigned i;
-
-    if (mask_start_pos) {
-        for (i = 0; i < payload_len; i++) {
-            payload [i] ^= mask [(i + *mask_start_pos) % mask_len];
-        }
+    size_t pos;
 
-        *mask_start_pos = (i + *mask_start_pos) % mask_len;
+    nn_assert (mask_len == NN_WS_SIMD_MASK_LEN);
 
-        return;
-    }
-    else {
-        for (i = 0; i < payload_len; i++) {
-            payload [i] ^= mask [i % mask_len];
-        }
-        return;
-    }
+    pos = mask_start_pos ? (size_t) *mask_start_pos : 0;
+    pos = nn_ws_mask (payload, payload_len, mask, pos);
+    if (mask_start_pos)
+        *mask_start_pos = (int) pos;
 }
 
 static int nn_sws_recv_hdr (struct nn_sws *self)
@@ -363,36 +363,35 @@ static int nn_sws_recv_hdr (struct nn_sws *self)
 static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
     struct nn_sws *sws;
-    struct nn_iovec iov [3];
+    uint8_t hdr [NN_SWS_FRAME_MAX_HDR_LEN];
     int mask_pos;
     size_t nn_msg_size;
     size_t hdr_len;
     struct nn_cmsghdr *cmsg;
     struct nn_msghdr msghdr;
     uint8_t rand_mask [NN_SWS_FRAME_SIZE_MASK];
+    int full;
 
     sws = nn_cont (self, struct nn_sws, pipebase);
 
     nn_assert_state (sws, NN_SWS_STATE_ACTIVE);
-    nn_assert (sws->outstate == NN_SWS_OUTSTATE_IDLE);
 
-    /*  Move the message to the local storage. */
-    nn_msg_term (&sws->outmsg);
-    nn_msg_mv (&sws->outmsg, msg);
+    /*  The payload may need to be masked, so make sure it's contiguous. */
+    nn_msg_flatten (msg);
 
-    memset (sws->outhdr, 0, sizeof (sws->outhdr));
+    memset (hdr, 0, sizeof (hdr));
 
     hdr_len = NN_SWS_FRAME_SIZE_INITIAL;
 
     cmsg = NULL;
     msghdr.msg_iov = NULL;
     msghdr.msg_iovlen = 0;
-    msghdr.msg_controllen = nn_chunkref_size (&sws->outmsg.hdrs);
+    msghdr.msg_controllen = nn_chunkref_size (&msg->hdrs);
 
     /*  If the outgoing message has specified an opcode and control framing in
         its header, properly frame it as per RFC 6455 5.2. */
     if (msghdr.msg_controllen > 0) {
-        msghdr.msg_control = nn_chunkref_data (&sws->outmsg.hdrs);
+        msghdr.msg_control = nn_chunkref_data (&msg->hdrs);
         cmsg = NN_CMSG_FIRSTHDR (&msghdr);
         while (cmsg) {
             if (cmsg->cmsg_level == NN_WS && cmsg->cmsg_type == NN_WS_HDR_OPCODE)
@@ -403,79 +402,82 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg)
 
     /*  If the header does not specify an opcode, assume default. */
     if (cmsg)
-        sws->outhdr [0] = *(uint8_t *) NN_CMSG_DATA (cmsg);
+        hdr [0] = *(uint8_t *) NN_CMSG_DATA (cmsg);
     else
-        sws->outhdr [0] = NN_WS_OPCODE_BINARY;
+        hdr [0] = NN_WS_OPCODE_BINARY;
 
     /*  For now, enforce that outgoing messages are the final frame. */
-    sws->outhdr [0] |= NN_SWS_FRAME_BITMASK_FIN;
+    hdr [0] |= NN_SWS_FRAME_BITMASK_FIN;
 
-    nn_msg_size = nn_chunkref_size (&sws->outmsg.sphdr) +
-        nn_chunkref_size (&sws->outmsg.body);
+    nn_msg_size = nn_chunkref_size (&msg->sphdr) +
+        nn_chunkref_size (&msg->body);
 
     /*  Framing WebSocket payload size in network byte order (big endian). */
     if (nn_msg_size <= NN_SWS_PAYLOAD_MAX_LENGTH) {
-        sws->outhdr [1] |= (uint8_t) nn_msg_size;
+        hdr [1] |= (uint8_t) nn_msg_size;
         hdr_len += NN_SWS_FRAME_SIZE_PAYLOAD_0;
     }
     else if (nn_msg_size <= NN_SWS_PAYLOAD_MAX_LENGTH_16) {
-        sws->outhdr [1] |= NN_SWS_PAYLOAD_FRAME_16;
-        nn_puts (&sws->outhdr [hdr_len], (uint16_t) nn_msg_size);
+        hdr [1] |= NN_SWS_PAYLOAD_FRAME_16;
+        nn_puts (&hdr [hdr_len], (uint16_t) nn_msg_size);
         hdr_len += NN_SWS_FRAME_SIZE_PAYLOAD_16;
     }
     else {
-        sws->outhdr [1] |= NN_SWS_PAYLOAD_FRAME_63;
-        nn_putll (&sws->outhdr [hdr_len], (uint64_t) nn_msg_size);
+        hdr [1] |= NN_SWS_PAYLOAD_FRAME_63;
+        nn_putll (&hdr [hdr_len], (uint64_t) nn_msg_size);
         hdr_len += NN_SWS_FRAME_SIZE_PAYLOAD_63;
     }
 
     if (sws->mode == NN_WS_CLIENT) {
-        sws->outhdr [1] |= NN_SWS_FRAME_BITMASK_MASKED;
+        hdr [1] |= NN_SWS_FRAME_BITMASK_MASKED;
 
         /*  Generate 32-bit mask as per RFC 6455 5.3. */
         nn_random_generate (rand_mask, NN_SWS_FRAME_SIZE_MASK);
         
-        memcpy (&sws->outhdr [hdr_len], rand_mask, NN_SWS_FRAME_SIZE_MASK);
+        memcpy (&hdr [hdr_len], rand_mask, NN_SWS_FRAME_SIZE_MASK);
         hdr_len += NN_SWS_FRAME_SIZE_MASK;
 
         /*  Mask payload, beginning with header and moving to body. */
         mask_pos = 0;
 
-        nn_sws_mask_payload (nn_chunkref_data (&sws->outmsg.sphdr),
-            nn_chunkref_size (&sws->outmsg.sphdr),
+        nn_sws_mask_payload (nn_chunkref_data (&msg->sphdr),
+            nn_chunkref_size (&msg->sphdr),
             rand_mask, NN_SWS_FRAME_SIZE_MASK, &mask_pos);
 
-        nn_sws_mask_payload (nn_chunkref_data (&sws->outmsg.body),
-            nn_chunkref_size (&sws->outmsg.body),
+        nn_sws_mask_payload (nn_chunkref_data (&msg->body),
+            nn_chunkref_size (&msg->body),
             rand_mask, NN_SWS_FRAME_SIZE_MASK, &mask_pos);
 
     }
     else if (sws->mode == NN_WS_SERVER) {
-        sws->outhdr [1] |= NN_SWS_FRAME_BITMASK_NOT_MASKED;
+        hdr [1] |= NN_SWS_FRAME_BITMASK_NOT_MASKED;
     }
     else {
         /*  Developer error; sws object was not constructed properly. */
         nn_assert (0);
     }
 
-    /*  Start async sending. */
-    iov [0].iov_base = sws->outhdr;
-    iov [0].iov_len = hdr_len;
-    iov [1].iov_base = nn_chunkref_data (&sws->outmsg.sphdr);
-    iov [1].iov_len = nn_chunkref_size (&sws->outmsg.sphdr);
-    iov [2].iov_base = nn_chunkref_data (&sws->outmsg.body);
-    iov [2].iov_len = nn_chunkref_size (&sws->outmsg.body);
-    nn_usock_send (sws->usock, iov, 3);
+    /*  Add the message to the outbound queue. If a write is already in
+        progress, the message will be written as soon as it completes. */
+    full = !nn_sendbatch_push (&sws->batch, hdr, hdr_len, msg);
+    nn_pipebase_setqueued (&sws->pipebase, nn_sendbatch_count (&sws->batch));
+    if (sws->outstate == NN_SWS_OUTSTATE_IDLE)
+        nn_sws_send_batch (sws);
 
-    sws->outstate = NN_SWS_OUTSTATE_SENDING;
-
-    /*  If a Close handshake was just sent, it's time to shut down. */
-    if ((sws->outhdr [0] & NN_SWS_FRAME_BITMASK_OPCODE) ==
-        NN_WS_OPCODE_CLOSE) {
+    /*  If a Close handshake was just queued, it's time to shut down. */
+    if ((hdr [0] & NN_SWS_FRAME_BITMASK_OPCODE) == NN_WS_OPCODE_CLOSE) {
         nn_pipebase_stop (&sws->pipebase);
         sws->state = NN_SWS_STATE_CLOSING_CONNECTION;
+        return 0;
     }
 
+    /*  Unless the queue is full, the pipe is immediately ready to accept
+        the next message. */
+    if (full)
+        sws->blocked = 1;
+    else
+        nn_pipebase_sent (&sws->pipebase);
+
     return 0;
 }
 
@@ -610,6 +612,7 @@ static void nn_sws_validate_utf8_chunk (struct nn_sws *self)
 {
     uint8_t *pos;
     int code_point_len;
+    int valid_len;
     int len;
 
     len = self->inmsg_current_chunk_len;
@@ -663,6 +666,14 @@ static void nn_sws_validate_utf8_chunk (struct nn_sws *self)
 
     while (len > 0) {
 
+        /*  Skip the part of the buffer the vectorised validator vouches
+            for; only the rest is checked code point by code point. */
+        valid_len = nn_ws_utf8_prefix (pos, len);
+        pos += valid_len;
+        len -= valid_len;
+        if (!len)
+            break;
+
         code_point_len = nn_utf8_code_point (pos, len);
 
         if (code_point_len > 0) {
@@ -719,6 +730,7 @@ static void nn_sws_validate_close_handshake (struct nn_sws *self)
     uint8_t *pos;
     uint16_t close_code;
     int code_point_len;
+    int valid_len;
     int len;
     
     len = self->inmsg_current_chunk_len - NN_SWS_CLOSE_CODE_LEN;
@@ -727,6 +739,12 @@ static void nn_sws_validate_close_handshake (struct nn_sws *self)
     /*  As per RFC 6455 7.1.6, the Close Reason following the Close Code
         must be well-formed UTF-8. */
     while (len > 0) {
+        valid_len = nn_ws_utf8_prefix (pos, len);
+        len -= valid_len;
+        pos += valid_len;
+        if (!len)
+            break;
+
         code_point_len = nn_utf8_code_point (pos, len);
 
         if (code_point_len > 0) {
@@ -857,17 +875,70 @@ static void nn_sws_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
     struct nn_sws *sws;
+    int linger;
+    size_t sz;
 
     sws = nn_cont (self, struct nn_sws, fsm);
 
     if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
+
+        /*  Messages accepted by the pipe but not yet written are given
+            NN_LINGER milliseconds to get out before the connection is
+            closed. */
+        linger = 0;
+        if (sws->state == NN_SWS_STATE_ACTIVE &&
+              !nn_sendbatch_empty (&sws->batch)) {
+            sz = sizeof (linger);
+            nn_pipebase_getopt (&sws->pipebase, NN_SOL_SOCKET, NN_LINGER,
+                &linger, &sz);
+            nn_assert (sz == sizeof (linger));
+        }
         /*  TODO: Consider sending a close code here? */
         nn_pipebase_stop (&sws->pipebase);
+        if (linger != 0) {
+            if (linger > 0)
+                nn_timer_start (&sws->timer, linger);
+            if (sws->outstate == NN_SWS_OUTSTATE_IDLE)
+                nn_sws_send_batch (sws);
+            sws->state = NN_SWS_STATE_LINGERING;
+            return;
+        }
+        nn_ws_handshake_stop (&sws->handshaker);
+        sws->state = NN_SWS_STATE_STOPPING;
+    }
+    if (nn_slow (sws->state == NN_SWS_STATE_LINGERING)) {
+        switch (src) {
+        case NN_SWS_SRC_USOCK:
+
+            /*  Inbound messages are of no interest anymore. On
+                NN_USOCK_SHUTDOWN and NN_USOCK_ERROR the queued messages
+                can't be written and are dropped. */
+            if (type == NN_USOCK_RECEIVED)
+                return;
+            if (type == NN_USOCK_SENT) {
+                sws->outstate = NN_SWS_OUTSTATE_IDLE;
+                nn_sendbatch_sent (&sws->batch);
+                if (nn_sendbatch_pending (&sws->batch)) {
+                    nn_sws_send_batch (sws);
+                    return;
+                }
+            }
+            break;
+        case NN_SWS_SRC_TIMER:
+            nn_assert (type == NN_TIMER_TIMEOUT);
+            break;
+        default:
+            nn_fsm_bad_source (sws->state, src, type);
+        }
+        nn_timer_stop (&sws->timer);
         nn_ws_handshake_stop (&sws->handshaker);
         sws->state = NN_SWS_STATE_STOPPING;
     }
     if (nn_slow (sws->state == NN_SWS_STATE_STOPPING)) {
-        if (nn_ws_handshake_isidle (&sws->handshaker)) {
+        if (nn_ws_handshake_isidle (&sws->handshaker) &&
+              nn_timer_isidle (&sws->timer)) {
+            nn_sendbatch_clear (&sws->batch);
+            sws->blocked = 0;
             nn_usock_swap_owner (sws->usock, &sws->usock_owner);
             sws->usock = NULL;
             sws->usock_owner.src = -1;
@@ -887,6 +958,8 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
 {
     struct nn_sws *sws;
     int rc;
+    int sndbuf;
+    size_t sz;
 
     sws = nn_cont (self, struct nn_sws, fsm);
 
@@ -964,6 +1037,14 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                     return;
                  }
 
+                 /*  Outbound messages are queued up to NN_SNDBUF bytes. */
+                 sz = sizeof (sndbuf);
+                 nn_pipebase_getopt (&sws->pipebase, NN_SOL_SOCKET,
+                     NN_SNDBUF, &sndbuf, &sz);
+                 nn_assert (sz == sizeof (sndbuf));
+                 nn_sendbatch_setlimit (&sws->batch, (size_t) sndbuf);
+                 sws->blocked = 0;
+
                  /*  Start receiving a message in asynchronous manner. */
                  nn_sws_recv_hdr (sws);
 
@@ -994,9 +1075,18 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                 /*  The message is now fully sent. */
                 nn_assert (sws->outstate == NN_SWS_OUTSTATE_SENDING);
                 sws->outstate = NN_SWS_OUTSTATE_IDLE;
-                nn_msg_term (&sws->outmsg);
-                nn_msg_init (&sws->outmsg, 0);
-                nn_pipebase_sent (&sws->pipebase);
+
+                /*  Release the sent messages and send the messages that
+                    were queued in the meantime straight away. */
+                nn_sendbatch_sent (&sws->batch);
+                nn_pipebase_setqueued (&sws->pipebase,
+                    nn_sendbatch_count (&sws->batch));
+                if (nn_sendbatch_pending (&sws->batch))
+                    nn_sws_send_batch (sws);
+                if (sws->blocked && !nn_sendbatch_isfull (&sws->batch)) {
+                    sws->blocked = 0;
+                    nn_pipebase_sent (&sws->pipebase);
+                }
                 return;
 
             case NN_USOCK_RECEIVED:
@@ -1502,6 +1592,17 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
                     to peer. */
                 nn_assert (sws->outstate == NN_SWS_OUTSTATE_SENDING);
                 sws->outstate = NN_SWS_OUTSTATE_IDLE;
+
+                /*  Messages queued before the closing handshake have to
+                    be sent first. */
+                if (!nn_sendbatch_empty (&sws->batch)) {
+                    nn_sendbatch_sent (&sws->batch);
+                    if (nn_sendbatch_pending (&sws->batch)) {
+                        nn_sws_send_batch (sws);
+                        return;
+                    }
+                }
+
                 sws->state = NN_SWS_STATE_DONE;
                 nn_fsm_raise (&sws->fsm, &sws->done,
                     NN_SWS_RETURN_CLOSE_HANDSHAKE);
@@ -1557,3 +1658,10 @@ static void nn_sws_handler (struct nn_fsm *self, int src, int type,
         nn_fsm_bad_state (sws->state, src, type);
     }
 }
+
+static void nn_sws_send_batch (struct nn_sws *self)
+{
+    nn_assert (self->outstate == NN_SWS_OUTSTATE_IDLE);
+    nn_sendbatch_send (&self->batch, self->usock);
+    self->outstate = NN_SWS_OUTSTATE_SENDING;
+}
@@ -28,9 +28,12 @@
 
 #include "../../aio/fsm.h"
 #include "../../aio/usock.h"
+#include "../../aio/timer.h"
 
 #include "ws_handshake.h"
 
+#include "../utils/sendbatch.h"
+
 #include "../../utils/msg.h"
 #include "../../utils/list.h"
 
@@ -158,11 +161,17 @@ struct nn_sws {
     /*  State of the outbound state machine. */
     int outstate;
 
-    /*  Buffer used to store the header of outgoing message. */
-    uint8_t outhdr [NN_SWS_FRAME_MAX_HDR_LEN];
+    /*  Queue of outbound messages. Messages queued while a write is in
+        progress are written in a single batch once it completes. */
+    struct nn_sendbatch batch;
+
+    /*  1 if the pipe doesn't accept new messages because the queue is
+        full. */
+    int blocked;
 
-    /*  Message being sent at the moment. */
-    struct nn_msg outmsg;
+    /*  Bounds the time spent writing out the queued messages once the
+        pipe is being stopped. See NN_LINGER. */
+    struct nn_timer timer;
 
     /*  Event raised when the state machine ends. */
     struct nn_fsm_event done;
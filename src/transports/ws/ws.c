@@ -26,6 +26,7 @@
 #include "bws.h"
 #include "cws.h"
 #include "sws.h"
+#include "ws_simd.h"
 
 #include "../../ws.h"
 
@@ -64,6 +65,7 @@ static const struct nn_optset_vfptr nn_ws_optset_vfptr = {
 };
 
 /*  nn_transport interface. */
+static void nn_ws_init (void);
 static int nn_ws_bind (void *hint, struct nn_epbase **epbase);
 static int nn_ws_connect (void *hint, struct nn_epbase **epbase);
 static struct nn_optset *nn_ws_optset (void);
@@ -71,7 +73,7 @@ static struct nn_optset *nn_ws_optset (void);
 static struct nn_transport nn_ws_vfptr = {
     "ws",
     NN_WS,
-    NULL,
+    nn_ws_init,
     NULL,
     nn_ws_bind,
     nn_ws_connect,
@@ -81,6 +83,11 @@ static struct nn_transport nn_ws_vfptr = {
 
 struct nn_transport *nn_ws = &nn_ws_vfptr;
 
+static void nn_ws_init (void)
+{
+    nn_ws_simd_init ();
+}
+
 static int nn_ws_bind (void *hint, struct nn_epbase **epbase)
 {
     return nn_bws_create (hint, epbase);
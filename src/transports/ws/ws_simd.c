@@ -0,0 +1,493 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "ws_simd.h"
+
+#include "../../nn.h"
+
+#include "../../utils/err.h"
+
+#include <string.h>
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define NN_WS_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/*  Error classes of the lookup-table UTF-8 validator (Keiser & Lemire,
+    "Validating UTF-8 In Less Than One Instruction Per Byte"). Each input
+    byte is classified using the high nibble of the previous byte, the low
+    nibble of the previous byte and the high nibble of the byte itself.
+    AND of the three classes is non-zero only for invalid sequences. */
+#define NN_WS_UTF8_TOO_SHORT 0x01
+#define NN_WS_UTF8_TOO_LONG 0x02
+#define NN_WS_UTF8_OVERLONG_3 0x04
+#define NN_WS_UTF8_TOO_LARGE 0x08
+#define NN_WS_UTF8_SURROGATE 0x10
+#define NN_WS_UTF8_OVERLONG_2 0x20
+#define NN_WS_UTF8_TOO_LARGE_1000 0x40
+#define NN_WS_UTF8_OVERLONG_4 0x40
+#define NN_WS_UTF8_TWO_CONTS 0x80
+#define NN_WS_UTF8_CARRY (NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_TOO_LONG |\
+    NN_WS_UTF8_TWO_CONTS)
+
+#if defined NN_WS_SIMD_X86
+
+static const uint8_t nn_ws_utf8_byte_1_high [16] = {
+    NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG,
+    NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG,
+    NN_WS_UTF8_TOO_LONG, NN_WS_UTF8_TOO_LONG,
+    NN_WS_UTF8_TWO_CONTS, NN_WS_UTF8_TWO_CONTS, NN_WS_UTF8_TWO_CONTS,
+    NN_WS_UTF8_TWO_CONTS,
+    NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_OVERLONG_2,
+    NN_WS_UTF8_TOO_SHORT,
+    NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_OVERLONG_3 | NN_WS_UTF8_SURROGATE,
+    NN_WS_UTF8_TOO_SHORT | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000 |
+        NN_WS_UTF8_OVERLONG_4
+};
+
+static const uint8_t nn_ws_utf8_byte_1_low [16] = {
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_OVERLONG_3 | NN_WS_UTF8_OVERLONG_2 |
+        NN_WS_UTF8_OVERLONG_4,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_OVERLONG_2,
+    NN_WS_UTF8_CARRY,
+    NN_WS_UTF8_CARRY,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000 |
+        NN_WS_UTF8_SURROGATE,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000,
+    NN_WS_UTF8_CARRY | NN_WS_UTF8_TOO_LARGE | NN_WS_UTF8_TOO_LARGE_1000
+};
+
+static const uint8_t nn_ws_utf8_byte_2_high [16] = {
+    NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT,
+    NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT,
+    NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT,
+    NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 | NN_WS_UTF8_TWO_CONTS |
+        NN_WS_UTF8_OVERLONG_3 | NN_WS_UTF8_TOO_LARGE_1000 |
+        NN_WS_UTF8_OVERLONG_4,
+    NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 | NN_WS_UTF8_TWO_CONTS |
+        NN_WS_UTF8_OVERLONG_3 | NN_WS_UTF8_TOO_LARGE,
+    NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 | NN_WS_UTF8_TWO_CONTS |
+        NN_WS_UTF8_SURROGATE | NN_WS_UTF8_TOO_LARGE,
+    NN_WS_UTF8_TOO_LONG | NN_WS_UTF8_OVERLONG_2 | NN_WS_UTF8_TWO_CONTS |
+        NN_WS_UTF8_SURROGATE | NN_WS_UTF8_TOO_LARGE,
+    NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT, NN_WS_UTF8_TOO_SHORT,
+    NN_WS_UTF8_TOO_SHORT
+};
+
+/*  Any byte greater than the corresponding one here at the end of a block
+    starts a sequence that continues in the next block. */
+static const uint8_t nn_ws_utf8_max_value [32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf
+};
+
+#endif
+
+static size_t nn_ws_mask_word (uint8_t *buf, size_t len, const uint8_t *mask,
+    size_t pos);
+static size_t nn_ws_utf8_prefix_word (const uint8_t *buf, size_t len);
+#if defined NN_WS_SIMD_X86
+static size_t nn_ws_mask_sse2 (uint8_t *buf, size_t len, const uint8_t *mask,
+    size_t pos);
+static size_t nn_ws_mask_avx2 (uint8_t *buf, size_t len, const uint8_t *mask,
+    size_t pos);
+static size_t nn_ws_utf8_prefix_ssse3 (const uint8_t *buf, size_t len);
+static size_t nn_ws_utf8_prefix_avx2 (const uint8_t *buf, size_t len);
+#endif
+
+/*  Implementation currently in use. Set when the library is initialised,
+    the kernels are pure functions, so there's no need for locking. */
+static int nn_ws_simd_current = NN_WS_SIMD_NONE;
+static size_t (*nn_ws_mask_fn) (uint8_t *buf, size_t len,
+    const uint8_t *mask, size_t pos) = nn_ws_mask_word;
+static size_t (*nn_ws_utf8_prefix_fn) (const uint8_t *buf, size_t len) =
+    nn_ws_utf8_prefix_word;
+
+void nn_ws_simd_init (void)
+{
+    if (nn_ws_simd_setlevel (NN_WS_SIMD_AVX2) == 0)
+        return;
+    if (nn_ws_simd_setlevel (NN_WS_SIMD_SSE) == 0)
+        return;
+    nn_ws_simd_setlevel (NN_WS_SIMD_NONE);
+}
+
+int nn_ws_simd_setlevel (int level)
+{
+    switch (level) {
+    case NN_WS_SIMD_NONE:
+        nn_ws_mask_fn = nn_ws_mask_word;
+        nn_ws_utf8_prefix_fn = nn_ws_utf8_prefix_word;
+        break;
+#if defined NN_WS_SIMD_X86
+    case NN_WS_SIMD_SSE:
+        if (!__builtin_cpu_supports ("sse2") ||
+              !__builtin_cpu_supports ("ssse3"))
+            return -ENOTSUP;
+        nn_ws_mask_fn = nn_ws_mask_sse2;
+        nn_ws_utf8_prefix_fn = nn_ws_utf8_prefix_ssse3;
+        break;
+    case NN_WS_SIMD_AVX2:
+        if (!__builtin_cpu_supports ("avx2"))
+            return -ENOTSUP;
+        nn_ws_mask_fn = nn_ws_mask_avx2;
+        nn_ws_utf8_prefix_fn = nn_ws_utf8_prefix_avx2;
+        break;
+#endif
+    default:
+        return -ENOTSUP;
+    }
+    nn_ws_simd_current = level;
+    return 0;
+}
+
+int nn_ws_simd_level (void)
+{
+    return nn_ws_simd_current;
+}
+
+size_t nn_ws_mask (uint8_t *buf, size_t len, const uint8_t *mask, size_t pos)
+{
+    return nn_ws_mask_fn (buf, len, mask, pos);
+}
+
+size_t nn_ws_utf8_prefix (const uint8_t *buf, size_t len)
+{
+    return nn_ws_utf8_prefix_fn (buf, len);
+}
+
+/*  Fills 'rotated' with the mask rotated so that it starts at 'pos'. Any
+    multiple of four bytes can then be masked using the rotated mask
+    repeated. */
+static void nn_ws_mask_rotate (const uint8_t *mask, size_t pos,
+    uint8_t *rotated)
+{
+    int i;
+
+    for (i = 0; i != NN_WS_SIMD_MASK_LEN; ++i)
+        rotated [i] = mask [(pos + i) % NN_WS_SIMD_MASK_LEN];
+}
+
+/*  Masks the tail of the buffer byte by byte. */
+static size_t nn_ws_mask_tail (uint8_t *buf, size_t len,
+    const uint8_t *rotated, size_t pos)
+{
+    size_t i;
+
+    for (i = 0; i != len; ++i)
+        buf [i] ^= rotated [i % NN_WS_SIMD_MASK_LEN];
+    return (pos + len) % NN_WS_SIMD_MASK_LEN;
+}
+
+static size_t nn_ws_mask_word (uint8_t *buf, size_t len, const uint8_t *mask,
+    size_t pos)
+{
+    uint8_t rotated [8];
+    uint64_t m;
+    uint64_t w;
+    size_t i;
+
+    nn_ws_mask_rotate (mask, pos, rotated);
+    memcpy (rotated + 4, rotated, 4);
+    memcpy (&m, rotated, 8);
+    for (i = 0; i + 8 <= len; i += 8) {
+        memcpy (&w, buf + i, 8);
+        w ^= m;
+        memcpy (buf + i, &w, 8);
+    }
+    return nn_ws_mask_tail (buf + i, len - i, rotated, pos + i);
+}
+
+/*  Validates the buffer code point by code point, skipping ASCII a word at
+    a time. Stops at the first invalid or truncated sequence. */
+static size_t nn_ws_utf8_prefix_word (const uint8_t *buf, size_t len)
+{
+    uint64_t w;
+    size_t pos;
+    size_t n;
+    size_t i;
+    uint8_t lo;
+    uint8_t hi;
+
+    pos = 0;
+    while (pos < len) {
+        while (pos + 8 <= len) {
+            memcpy (&w, buf + pos, 8);
+            if (w & 0x8080808080808080ULL)
+                break;
+            pos += 8;
+        }
+        if (pos == len)
+            break;
+        if (buf [pos] < 0x80) {
+            ++pos;
+            continue;
+        }
+
+        /*  Allowed range of the second byte is narrower for some lead
+            bytes to exclude overlong forms, surrogates and code points
+            above U+10FFFF. */
+        lo = 0x80;
+        hi = 0xbf;
+        if (buf [pos] < 0xc2 || buf [pos] > 0xf4)
+            return pos;
+        else if (buf [pos] <= 0xdf)
+            n = 2;
+        else if (buf [pos] <= 0xef) {
+            n = 3;
+            if (buf [pos] == 0xe0)
+                lo = 0xa0;
+            else if (buf [pos] == 0xed)
+                hi = 0x9f;
+        }
+        else {
+            n = 4;
+            if (buf [pos] == 0xf0)
+                lo = 0x90;
+            else if (buf [pos] == 0xf4)
+                hi = 0x8f;
+        }
+        if (len - pos < n || buf [pos + 1] < lo || buf [pos + 1] > hi)
+            return pos;
+        for (i = 2; i < n; ++i)
+            if ((buf [pos + i] & 0xc0) != 0x80)
+                return pos;
+        pos += n;
+    }
+    return pos;
+}
+
+#if defined NN_WS_SIMD_X86
+
+/*  Moves the end of a validated prefix back to a code point boundary. */
+static size_t nn_ws_utf8_backoff (const uint8_t *buf, size_t pos)
+{
+    while (pos > 0 && (buf [pos] & 0xc0) == 0x80)
+        --pos;
+    return pos;
+}
+
+/*  Handles the end of the buffer once all the full blocks have been found
+    valid. If the last block ends inside a multi-byte sequence, the prefix
+    stops at the lead byte of that sequence. */
+static size_t nn_ws_utf8_incomplete (const uint8_t *buf, size_t pos)
+{
+    size_t i;
+
+    for (i = pos; i != pos - 3; --i)
+        if (buf [i - 1] >= 0xc0)
+            return i - 1;
+    nn_assert (0);
+    return 0;
+}
+
+__attribute__ ((target ("sse2")))
+static size_t nn_ws_mask_sse2 (uint8_t *buf, size_t len, const uint8_t *mask,
+    size_t pos)
+{
+    uint8_t rotated [NN_WS_SIMD_MASK_LEN];
+    uint32_t m32;
+    __m128i m;
+    __m128i v;
+    size_t i;
+
+    nn_ws_mask_rotate (mask, pos, rotated);
+    memcpy (&m32, rotated, 4);
+    m = _mm_set1_epi32 ((int) m32);
+    for (i = 0; i + 16 <= len; i += 16) {
+        v = _mm_loadu_si128 ((const __m128i*) (buf + i));
+        _mm_storeu_si128 ((__m128i*) (buf + i), _mm_xor_si128 (v, m));
+    }
+    return nn_ws_mask_tail (buf + i, len - i, rotated, pos + i);
+}
+
+__attribute__ ((target ("avx2")))
+static size_t nn_ws_mask_avx2 (uint8_t *buf, size_t len, const uint8_t *mask,
+    size_t pos)
+{
+    uint8_t rotated [NN_WS_SIMD_MASK_LEN];
+    uint32_t m32;
+    __m256i m;
+    __m256i v;
+    size_t i;
+
+    nn_ws_mask_rotate (mask, pos, rotated);
+    memcpy (&m32, rotated, 4);
+    m = _mm256_set1_epi32 ((int) m32);
+    for (i = 0; i + 64 <= len; i += 64) {
+        v = _mm256_loadu_si256 ((const __m256i*) (buf + i));
+        _mm256_storeu_si256 ((__m256i*) (buf + i), _mm256_xor_si256 (v, m));
+        v = _mm256_loadu_si256 ((const __m256i*) (buf + i + 32));
+        _mm256_storeu_si256 ((__m256i*) (buf + i + 32),
+            _mm256_xor_si256 (v, m));
+    }
+    for (; i + 32 <= len; i += 32) {
+        v = _mm256_loadu_si256 ((const __m256i*) (buf + i));
+        _mm256_storeu_si256 ((__m256i*) (buf + i), _mm256_xor_si256 (v, m));
+    }
+    return nn_ws_mask_tail (buf + i, len - i, rotated, pos + i);
+}
+
+__attribute__ ((target ("ssse3")))
+static size_t nn_ws_utf8_prefix_ssse3 (const uint8_t *buf, size_t len)
+{
+    const __m128i t1 = _mm_loadu_si128 ((const __m128i*)
+        nn_ws_utf8_byte_1_high);
+    const __m128i t2 = _mm_loadu_si128 ((const __m128i*)
+        nn_ws_utf8_byte_1_low);
+    const __m128i t3 = _mm_loadu_si128 ((const __m128i*)
+        nn_ws_utf8_byte_2_high);
+    const __m128i maxv = _mm_loadu_si128 ((const __m128i*)
+        (nn_ws_utf8_max_value + 16));
+    const __m128i nibble = _mm_set1_epi8 (0x0f);
+    __m128i prev;
+    __m128i incomplete;
+    __m128i in;
+    __m128i prev1;
+    __m128i sc;
+    __m128i must23;
+    __m128i err;
+    size_t pos;
+    size_t good;
+
+    prev = _mm_setzero_si128 ();
+    incomplete = _mm_setzero_si128 ();
+    good = 0;
+    for (pos = 0; pos + 16 <= len; pos += 16) {
+        in = _mm_loadu_si128 ((const __m128i*) (buf + pos));
+
+        /*  Pure ASCII block can only be wrong if the previous block ended
+            in the middle of a multi-byte sequence. */
+        if (_mm_movemask_epi8 (in) == 0)
+            err = incomplete;
+        else {
+            prev1 = _mm_alignr_epi8 (in, prev, 15);
+            sc = _mm_and_si128 (_mm_and_si128 (
+                _mm_shuffle_epi8 (t1,
+                    _mm_and_si128 (_mm_srli_epi16 (prev1, 4), nibble)),
+                _mm_shuffle_epi8 (t2, _mm_and_si128 (prev1, nibble))),
+                _mm_shuffle_epi8 (t3,
+                    _mm_and_si128 (_mm_srli_epi16 (in, 4), nibble)));
+            must23 = _mm_or_si128 (
+                _mm_subs_epu8 (_mm_alignr_epi8 (in, prev, 14),
+                    _mm_set1_epi8 ((char) (0xe0 - 0x80))),
+                _mm_subs_epu8 (_mm_alignr_epi8 (in, prev, 13),
+                    _mm_set1_epi8 ((char) (0xf0 - 0x80))));
+            err = _mm_xor_si128 (_mm_and_si128 (must23,
+                _mm_set1_epi8 ((char) 0x80)), sc);
+        }
+        if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (err,
+              _mm_setzero_si128 ())) != 0xffff)
+            return nn_ws_utf8_backoff (buf, good);
+        incomplete = _mm_subs_epu8 (in, maxv);
+        prev = in;
+
+        /*  Sequences starting in the previous block are now fully
+            checked. */
+        good = pos;
+    }
+    if (pos == 0)
+        return 0;
+    if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (incomplete,
+          _mm_setzero_si128 ())) != 0xffff)
+        return nn_ws_utf8_incomplete (buf, pos);
+    return pos;
+}
+
+__attribute__ ((target ("avx2")))
+static size_t nn_ws_utf8_prefix_avx2 (const uint8_t *buf, size_t len)
+{
+    const __m256i t1 = _mm256_broadcastsi128_si256 (_mm_loadu_si128 (
+        (const __m128i*) nn_ws_utf8_byte_1_high));
+    const __m256i t2 = _mm256_broadcastsi128_si256 (_mm_loadu_si128 (
+        (const __m128i*) nn_ws_utf8_byte_1_low));
+    const __m256i t3 = _mm256_broadcastsi128_si256 (_mm_loadu_si128 (
+        (const __m128i*) nn_ws_utf8_byte_2_high));
+    const __m256i maxv = _mm256_loadu_si256 ((const __m256i*)
+        nn_ws_utf8_max_value);
+    const __m256i nibble = _mm256_set1_epi8 (0x0f);
+    __m256i prev;
+    __m256i incomplete;
+    __m256i in;
+    __m256i shifted;
+    __m256i prev1;
+    __m256i sc;
+    __m256i must23;
+    __m256i err;
+    size_t pos;
+    size_t good;
+
+    prev = _mm256_setzero_si256 ();
+    incomplete = _mm256_setzero_si256 ();
+    good = 0;
+    for (pos = 0; pos + 32 <= len; pos += 32) {
+        in = _mm256_loadu_si256 ((const __m256i*) (buf + pos));
+        if (_mm256_movemask_epi8 (in) == 0)
+            err = incomplete;
+        else {
+
+            /*  Byte shifts in AVX2 work within 128-bit lanes. Combine the
+                upper half of the previous block with the lower half of
+                this one to get the bytes crossing the lane boundary. */
+            shifted = _mm256_permute2x128_si256 (prev, in, 0x21);
+            prev1 = _mm256_alignr_epi8 (in, shifted, 15);
+            sc = _mm256_and_si256 (_mm256_and_si256 (
+                _mm256_shuffle_epi8 (t1,
+                    _mm256_and_si256 (_mm256_srli_epi16 (prev1, 4), nibble)),
+                _mm256_shuffle_epi8 (t2, _mm256_and_si256 (prev1, nibble))),
+                _mm256_shuffle_epi8 (t3,
+                    _mm256_and_si256 (_mm256_srli_epi16 (in, 4), nibble)));
+            must23 = _mm256_or_si256 (
+                _mm256_subs_epu8 (_mm256_alignr_epi8 (in, shifted, 14),
+                    _mm256_set1_epi8 ((char) (0xe0 - 0x80))),
+                _mm256_subs_epu8 (_mm256_alignr_epi8 (in, shifted, 13),
+                    _mm256_set1_epi8 ((char) (0xf0 - 0x80))));
+            err = _mm256_xor_si256 (_mm256_and_si256 (must23,
+                _mm256_set1_epi8 ((char) 0x80)), sc);
+        }
+        if (!_mm256_testz_si256 (err, err))
+            return nn_ws_utf8_backoff (buf, good);
+        incomplete = _mm256_subs_epu8 (in, maxv);
+        prev = in;
+        good = pos;
+    }
+    if (pos == 0)
+        return 0;
+    if (!_mm256_testz_si256 (incomplete, incomplete))
+        return nn_ws_utf8_incomplete (buf, pos);
+    return pos;
+}
+
+#endif
+
@@ -0,0 +1,68 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_WS_SIMD_INCLUDED
+#define NN_WS_SIMD_INCLUDED
+
+#include "../../utils/int.h"
+
+#include <stddef.h>
+
+/*  Vectorised kernels for the hot loops of the WebSocket transport: payload
+    (un)masking and UTF-8 validation of text frames. The best implementation
+    supported by the CPU is picked at run time. Until nn_ws_simd_init is
+    called the portable word-at-a-time implementation is used. */
+
+/*  Available implementations. NN_WS_SIMD_SSE stands for SSE2 masking and
+    SSSE3 validation; SSE2 alone lacks the byte shuffle the validator needs. */
+#define NN_WS_SIMD_NONE 0
+#define NN_WS_SIMD_SSE 1
+#define NN_WS_SIMD_AVX2 2
+
+/*  Length of the WebSocket masking key. */
+#define NN_WS_SIMD_MASK_LEN 4
+
+/*  Selects the fastest implementation supported by the CPU. */
+void nn_ws_simd_init (void);
+
+/*  Forces the use of particular implementation. Returns -ENOTSUP if it is
+    not supported by the CPU or the compiler. Meant for tests and
+    benchmarks. */
+int nn_ws_simd_setlevel (int level);
+
+/*  Returns the implementation in use. */
+int nn_ws_simd_level (void);
+
+/*  XORs the buffer with the 4-byte mask in place. 'pos' is the offset into
+    the mask to start with. Returns the offset to continue with for the
+    next buffer of the same payload. */
+size_t nn_ws_mask (uint8_t *buf, size_t len, const uint8_t *mask,
+    size_t pos);
+
+/*  Returns length of the prefix of the buffer that is known to be valid
+    UTF-8 and ends at a code point boundary. The prefix may be shorter than
+    the valid part of the buffer; the caller is expected to validate the
+    rest byte by byte. */
+size_t nn_ws_utf8_prefix (const uint8_t *buf, size_t len);
+
+#endif
+
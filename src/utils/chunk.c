@@ -22,6 +22,7 @@
 */
 
 #include "chunk.h"
+#include "chunkpool.h"
 #include "atomic.h"
 #include "alloc.h"
 #include "fast.h"
@@ -33,6 +34,11 @@
 #define NN_CHUNK_TAG 0xdeadcafe
 #define NN_CHUNK_TAG_DEALLOCATED 0xbeadfeed
 
+/*  Slices have no header of their own. The upper byte of their tag identifies
+    them as slices while the lower bytes hold their size. */
+#define NN_CHUNK_TAG_SLICE 0xa5000000
+#define NN_CHUNK_TAG_SLICE_MASK 0xff000000
+
 typedef void (*nn_chunk_free_fn) (void *p);
 
 struct nn_chunk {
@@ -48,11 +54,14 @@ struct nn_chunk {
 
     /*  The structure if followed by optional empty space, a 32 bit unsigned
         integer specifying the size of said empty space, a 32 bit tag and
-        the message data itself. */
+        the message data itself. Slices of the chunk are preceded by the same
+        two integers, pointing back to the chunk header. */
 };
 
 /*  Private functions. */
 static struct nn_chunk *nn_chunk_getptr (void *p);
+static int nn_chunk_isslice (void *p);
+static void nn_chunk_setprefix (struct nn_chunk *self, void *p, uint32_t tag);
 static void *nn_chunk_getdata (struct nn_chunk *c);
 static void nn_chunk_default_free (void *p);
 static size_t nn_chunk_hdrsize ();
@@ -61,6 +70,7 @@ int nn_chunk_alloc (size_t size, int type, void **result)
 {
     size_t sz;
     struct nn_chunk *self;
+    nn_chunk_free_fn ffn;
     const size_t hdrsz = nn_chunk_hdrsize ();
 
     /*  Compute total size to be allocated. Check for overflow. */
@@ -69,12 +79,17 @@ int nn_chunk_alloc (size_t size, int type, void **result)
         return -ENOMEM;
 
     /*  Allocate the actual memory depending on the type. */
-    switch (type) {
-    case 0:
-        self = nn_alloc (sz, "message chunk");
-        break;
-    default:
+    if (nn_slow (type != NN_CHUNK_DEFAULT && type != NN_CHUNK_POOLED))
         return -EINVAL;
+
+    /*  Chunks too big to be pooled are allocated the default way. */
+    if (type == NN_CHUNK_POOLED && nn_fast (sz <= NN_CHUNKPOOL_MAX_SIZE)) {
+        self = nn_chunkpool_alloc (sz);
+        ffn = nn_chunkpool_free;
+    }
+    else {
+        self = nn_alloc (sz, "message chunk");
+        ffn = nn_chunk_default_free;
     }
     if (nn_slow (!self))
         return -ENOMEM;
@@ -82,7 +97,7 @@ int nn_chunk_alloc (size_t size, int type, void **result)
     /*  Fill in the chunk header. */
     nn_atomic_init (&self->refcount, 1);
     self->size = size;
-    self->ffn = nn_chunk_default_free;
+    self->ffn = ffn;
 
     /*  Fill in the size of the empty space between the chunk header
         and the message. */
@@ -102,13 +117,17 @@ int nn_chunk_realloc (size_t size, void **chunk)
     void *new_ptr;
     size_t hdr_size;
     size_t new_size;
+    size_t old_size;
     int rc;
 
     self = nn_chunk_getptr (*chunk);
 
     /*  Check if we only have one reference to this object, in that case we can
-        reallocate the memory chunk. */
-    if (self->refcount.n == 1) {
+        reallocate the memory chunk. Pooled chunks cannot be resized in place
+        as they belong to a fixed size class. Slices don't own the memory
+        they live in. */
+    if (self->refcount.n == 1 && self->ffn == nn_chunk_default_free &&
+          !nn_chunk_isslice (*chunk)) {
 
         /* Compute new size, check for overflow. */
         hdr_size = nn_chunk_hdrsize ();
@@ -125,19 +144,21 @@ int nn_chunk_realloc (size_t size, void **chunk)
         *chunk = nn_chunk_getdata (new_chunk);
     }
 
-    /*  There are many references to this memory chunk, we have to create a new
-        one and copy the data. */
+    /*  There are many references to this memory chunk (or it is a pooled one
+        or a slice), we have to create a new one and copy the data. */
     else {
         new_ptr = NULL;
-        rc = nn_chunk_alloc (size, 0, &new_ptr);
+        rc = nn_chunk_alloc (size, self->ffn == nn_chunk_default_free ?
+            NN_CHUNK_DEFAULT : NN_CHUNK_POOLED, &new_ptr);
 
         if (nn_slow (rc != 0)) {
             return rc;
         }
 
-        memcpy (new_ptr, nn_chunk_getdata (self), self->size);
+        old_size = nn_chunk_size (*chunk);
+        memcpy (new_ptr, *chunk, size < old_size ? size : old_size);
+        nn_chunk_free (*chunk);
         *chunk = new_ptr;
-        nn_atomic_dec (&self->refcount, 1);
     }
 
     return 0;
@@ -177,26 +198,34 @@ void nn_chunk_addref (void *p, uint32_t n)
 
 size_t nn_chunk_size (void *p)
 {
+    if (nn_chunk_isslice (p))
+        return nn_getl ((uint8_t*) p - sizeof (uint32_t)) &
+            ~NN_CHUNK_TAG_SLICE_MASK;
     return nn_chunk_getptr (p)->size;
 }
 
 void *nn_chunk_trim (void *p, size_t n)
 {
     struct nn_chunk *self;
-    const size_t hdrsz = sizeof (struct nn_chunk) + 2 * sizeof (uint32_t);
-    size_t empty_space;
+    size_t size;
 
     self = nn_chunk_getptr (p);
 
     /*  Sanity check. We cannot trim more bytes than there are in the chunk. */
-    nn_assert (n <= self->size);
+    size = nn_chunk_size (p);
+    nn_assert (n <= size);
+
+    /*  The size of a slice is stored in its tag. */
+    if (nn_chunk_isslice (p)) {
+        p = ((uint8_t*) p) + n;
+        nn_chunk_setprefix (self, p,
+            NN_CHUNK_TAG_SLICE | (uint32_t) (size - n));
+        return p;
+    }
 
     /*  Adjust the chunk header. */
     p = ((uint8_t*) p) + n;
-    nn_putl ((uint8_t*) (((uint32_t*) p) - 1), NN_CHUNK_TAG);
-    empty_space = (uint8_t*) p - (uint8_t*) self - hdrsz;
-    nn_assert(empty_space < UINT32_MAX);
-    nn_putl ((uint8_t*) (((uint32_t*) p) - 2), (uint32_t) empty_space);
+    nn_chunk_setprefix (self, p, NN_CHUNK_TAG);
 
     /*  Adjust the size of the message. */
     self->size -= n;
@@ -204,17 +233,52 @@ void *nn_chunk_trim (void *p, size_t n)
     return p;
 }
 
+void *nn_chunk_slice (void *p, size_t off, size_t size)
+{
+    struct nn_chunk *self;
+
+    self = nn_chunk_getptr (p);
+
+    nn_assert (off >= NN_CHUNK_SLICE_HEADROOM);
+    nn_assert (off + size <= nn_chunk_size (p));
+    nn_assert (size <= NN_CHUNK_SLICE_MAX);
+
+    /*  The slice holds a reference to the chunk. */
+    nn_atomic_inc (&self->refcount, 1);
+
+    p = ((uint8_t*) p) + off;
+    nn_chunk_setprefix (self, p, NN_CHUNK_TAG_SLICE | (uint32_t) size);
+    return p;
+}
+
 static struct nn_chunk *nn_chunk_getptr (void *p)
 {
     uint32_t off;
 
-    nn_assert (nn_getl ((uint8_t*) p - sizeof (uint32_t)) == NN_CHUNK_TAG);
+    nn_assert (nn_getl ((uint8_t*) p - sizeof (uint32_t)) == NN_CHUNK_TAG ||
+        nn_chunk_isslice (p));
     off = nn_getl ((uint8_t*) p - 2 * sizeof (uint32_t));
 
     return (struct  nn_chunk*) ((uint8_t*) p - 2 *sizeof (uint32_t) - off -
         sizeof (struct nn_chunk));
 }
 
+static int nn_chunk_isslice (void *p)
+{
+    return (nn_getl ((uint8_t*) p - sizeof (uint32_t)) &
+        NN_CHUNK_TAG_SLICE_MASK) == NN_CHUNK_TAG_SLICE;
+}
+
+static void nn_chunk_setprefix (struct nn_chunk *self, void *p, uint32_t tag)
+{
+    size_t empty_space;
+
+    nn_putl ((uint8_t*) (((uint32_t*) p) - 1), tag);
+    empty_space = (uint8_t*) p - (uint8_t*) self - nn_chunk_hdrsize ();
+    nn_assert (empty_space < UINT32_MAX);
+    nn_putl ((uint8_t*) (((uint32_t*) p) - 2), (uint32_t) empty_space);
+}
+
 static void *nn_chunk_getdata (struct nn_chunk *self)
 {
     return ((uint8_t*) (self + 1)) + 2 * sizeof (uint32_t);
@@ -26,6 +26,19 @@
 #include <stddef.h>
 #include "int.h"
 
+/*  Allocation mechanisms. NN_CHUNK_DEFAULT allocates the chunk straight from
+    the heap. NN_CHUNK_POOLED recycles chunks via per-thread caches (see
+    chunkpool.h); requests too big for the pool are served from the heap. */
+#define NN_CHUNK_DEFAULT 0
+#define NN_CHUNK_POOLED 1
+
+/*  Number of bytes preceding the data of a slice that are overwritten when
+    the slice is created. */
+#define NN_CHUNK_SLICE_HEADROOM 8
+
+/*  Maximal size of a slice. */
+#define NN_CHUNK_SLICE_MAX 0xffffff
+
 /*  Allocates the chunk using the allocation mechanism specified by 'type'. */
 int nn_chunk_alloc (size_t size, int type, void **result);
 
@@ -46,5 +59,12 @@ size_t nn_chunk_size (void *p);
     chunk. */
 void *nn_chunk_trim (void *p, size_t n);
 
+/*  Creates a slice of 'size' bytes starting 'off' bytes into the chunk. The
+    slice behaves like a chunk of its own, however, it shares the memory and
+    the reference count with the original chunk. NN_CHUNK_SLICE_HEADROOM bytes
+    preceding the slice are overwritten, thus 'off' must be at least that big
+    and the bytes in question must not be used otherwise. */
+void *nn_chunk_slice (void *p, size_t off, size_t size);
+
 #endif
 
@@ -0,0 +1,402 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "chunkpool.h"
+#include "alloc.h"
+#include "mutex.h"
+#include "fast.h"
+#include "err.h"
+
+#if defined NN_HAVE_WINDOWS
+#include "win.h"
+#else
+#include <pthread.h>
+#endif
+
+#include <string.h>
+
+/*  Maximal amount of memory, per size class, kept in a thread's cache and
+    in the global depot, respectively. */
+#define NN_CHUNKPOOL_CACHE_BYTES (256 * 1024)
+#define NN_CHUNKPOOL_DEPOT_BYTES (1024 * 1024)
+
+/*  Every block is preceded by a prefix holding its size class. The prefix is
+    16 bytes long so that the alignment guaranteed by the system allocator
+    is preserved. */
+union nn_chunkpool_prefix {
+    uint32_t cls;
+    uint8_t padding [16];
+};
+
+/*  Singly-linked list of free blocks. The link is stored in the first bytes
+    of the block body. */
+struct nn_chunkpool_list {
+    void *head;
+    int count;
+};
+
+struct nn_chunkpool_cache {
+    struct nn_chunkpool_list lists [NN_CHUNKPOOL_NCLASSES];
+    struct nn_chunkpool_stats stats;
+};
+
+struct nn_chunkpool_depot {
+    struct nn_mutex sync;
+    struct nn_chunkpool_list lists [NN_CHUNKPOOL_NCLASSES];
+    struct nn_chunkpool_stats stats;
+};
+
+static struct nn_chunkpool_depot nn_chunkpool_depot;
+
+#if defined NN_HAVE_WINDOWS
+static INIT_ONCE nn_chunkpool_once = INIT_ONCE_STATIC_INIT;
+static DWORD nn_chunkpool_key;
+#else
+static pthread_once_t nn_chunkpool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t nn_chunkpool_key;
+#endif
+
+/*  Private functions. */
+static void nn_chunkpool_init (void);
+static struct nn_chunkpool_cache *nn_chunkpool_getcache (int create);
+static void nn_chunkpool_cache_destroy (void *arg);
+static int nn_chunkpool_class (size_t size);
+static int nn_chunkpool_cache_limit (int cls);
+static int nn_chunkpool_depot_limit (int cls);
+static void *nn_chunkpool_newblock (int cls);
+static void *nn_chunkpool_pop (struct nn_chunkpool_list *list);
+static void nn_chunkpool_push (struct nn_chunkpool_list *list, void *p);
+static void nn_chunkpool_fold (struct nn_chunkpool_cache *cache);
+static void nn_chunkpool_refill (struct nn_chunkpool_cache *cache, int cls);
+static void nn_chunkpool_spill (struct nn_chunkpool_cache *cache, int cls,
+    int count);
+
+#if defined NN_HAVE_WINDOWS
+
+static VOID WINAPI nn_chunkpool_fls_destroy (PVOID arg)
+{
+    if (arg)
+        nn_chunkpool_cache_destroy (arg);
+}
+
+static BOOL CALLBACK nn_chunkpool_init_once (PINIT_ONCE once, PVOID param,
+    PVOID *context)
+{
+    nn_chunkpool_init ();
+    return TRUE;
+}
+
+#endif
+
+void *nn_chunkpool_alloc (size_t size)
+{
+    int cls;
+    struct nn_chunkpool_cache *cache;
+    struct nn_chunkpool_list *list;
+
+    if (nn_slow (size > NN_CHUNKPOOL_MAX_SIZE))
+        return NULL;
+    cls = nn_chunkpool_class (size);
+
+    /*  If the thread cache cannot be created, bypass the pool. */
+    cache = nn_chunkpool_getcache (1);
+    if (nn_slow (!cache))
+        return nn_chunkpool_newblock (cls);
+
+    ++cache->stats.allocs;
+
+    /*  Fast path: take a block from the thread cache. If it is empty,
+        try to get a batch of blocks from the depot. */
+    list = &cache->lists [cls];
+    if (nn_slow (!list->head))
+        nn_chunkpool_refill (cache, cls);
+    if (nn_fast (list->head != NULL)) {
+        ++cache->stats.hits;
+        return nn_chunkpool_pop (list);
+    }
+
+    /*  There's no free block around. Ask the system allocator. */
+    ++cache->stats.misses;
+    return nn_chunkpool_newblock (cls);
+}
+
+void nn_chunkpool_free (void *p)
+{
+    union nn_chunkpool_prefix *prefix;
+    int cls;
+    int limit;
+    struct nn_chunkpool_cache *cache;
+    struct nn_chunkpool_list *list;
+
+    prefix = ((union nn_chunkpool_prefix*) p) - 1;
+    cls = (int) prefix->cls;
+    nn_assert (cls >= 0 && cls < NN_CHUNKPOOL_NCLASSES);
+
+    cache = nn_chunkpool_getcache (1);
+    if (nn_slow (!cache)) {
+        nn_free (prefix);
+        return;
+    }
+
+    /*  Return the block to the thread cache. If the cache overflows, move
+        half of it to the depot. */
+    list = &cache->lists [cls];
+    nn_chunkpool_push (list, p);
+    limit = nn_chunkpool_cache_limit (cls);
+    if (nn_slow (list->count > limit))
+        nn_chunkpool_spill (cache, cls, list->count - limit / 2);
+}
+
+void nn_chunkpool_stats (struct nn_chunkpool_stats *stats)
+{
+    struct nn_chunkpool_cache *cache;
+
+    cache = nn_chunkpool_getcache (0);
+    nn_mutex_lock (&nn_chunkpool_depot.sync);
+    if (cache)
+        nn_chunkpool_fold (cache);
+    *stats = nn_chunkpool_depot.stats;
+    nn_mutex_unlock (&nn_chunkpool_depot.sync);
+}
+
+void nn_chunkpool_drain (void)
+{
+    struct nn_chunkpool_cache *cache;
+    struct nn_chunkpool_list *list;
+    int cls;
+#if defined NN_HAVE_WINDOWS
+    BOOL brc;
+#else
+    int rc;
+#endif
+
+    /*  Dispose of the calling thread's cache. The thread gets a new one if
+        it uses the pool again. */
+    cache = nn_chunkpool_getcache (0);
+    if (cache) {
+        nn_chunkpool_cache_destroy (cache);
+#if defined NN_HAVE_WINDOWS
+        brc = FlsSetValue (nn_chunkpool_key, NULL);
+        win_assert (brc);
+#else
+        rc = pthread_setspecific (nn_chunkpool_key, NULL);
+        errnum_assert (rc == 0, rc);
+#endif
+    }
+
+    nn_mutex_lock (&nn_chunkpool_depot.sync);
+    for (cls = 0; cls != NN_CHUNKPOOL_NCLASSES; ++cls) {
+        list = &nn_chunkpool_depot.lists [cls];
+        while (list->head)
+            nn_free (((union nn_chunkpool_prefix*)
+                nn_chunkpool_pop (list)) - 1);
+    }
+    nn_mutex_unlock (&nn_chunkpool_depot.sync);
+}
+
+static void nn_chunkpool_init (void)
+{
+#if !defined NN_HAVE_WINDOWS
+    int rc;
+#endif
+
+    nn_mutex_init (&nn_chunkpool_depot.sync);
+    memset (nn_chunkpool_depot.lists, 0, sizeof (nn_chunkpool_depot.lists));
+    memset (&nn_chunkpool_depot.stats, 0, sizeof (nn_chunkpool_depot.stats));
+#if defined NN_HAVE_WINDOWS
+    nn_chunkpool_key = FlsAlloc (nn_chunkpool_fls_destroy);
+    win_assert (nn_chunkpool_key != FLS_OUT_OF_INDEXES);
+#else
+    rc = pthread_key_create (&nn_chunkpool_key, nn_chunkpool_cache_destroy);
+    errnum_assert (rc == 0, rc);
+#endif
+}
+
+static struct nn_chunkpool_cache *nn_chunkpool_getcache (int create)
+{
+    struct nn_chunkpool_cache *cache;
+#if defined NN_HAVE_WINDOWS
+    BOOL brc;
+#else
+    int rc;
+#endif
+
+#if defined NN_HAVE_WINDOWS
+    brc = InitOnceExecuteOnce (&nn_chunkpool_once, nn_chunkpool_init_once,
+        NULL, NULL);
+    win_assert (brc);
+    cache = FlsGetValue (nn_chunkpool_key);
+#else
+    rc = pthread_once (&nn_chunkpool_once, nn_chunkpool_init);
+    errnum_assert (rc == 0, rc);
+    cache = pthread_getspecific (nn_chunkpool_key);
+#endif
+    if (nn_fast (cache != NULL) || !create)
+        return cache;
+
+    /*  First use of the pool in this thread. Create the cache. */
+    cache = nn_alloc (sizeof (struct nn_chunkpool_cache), "chunk pool cache");
+    if (nn_slow (!cache))
+        return NULL;
+    memset (cache, 0, sizeof (struct nn_chunkpool_cache));
+#if defined NN_HAVE_WINDOWS
+    brc = FlsSetValue (nn_chunkpool_key, cache);
+    win_assert (brc);
+#else
+    rc = pthread_setspecific (nn_chunkpool_key, cache);
+    errnum_assert (rc == 0, rc);
+#endif
+
+    return cache;
+}
+
+static void nn_chunkpool_cache_destroy (void *arg)
+{
+    struct nn_chunkpool_cache *cache;
+    int cls;
+
+    /*  The thread is exiting. Hand all its cached blocks over to the depot
+        so that other threads can use them. */
+    cache = (struct nn_chunkpool_cache*) arg;
+    for (cls = 0; cls != NN_CHUNKPOOL_NCLASSES; ++cls)
+        nn_chunkpool_spill (cache, cls, cache->lists [cls].count);
+    nn_mutex_lock (&nn_chunkpool_depot.sync);
+    nn_chunkpool_fold (cache);
+    nn_mutex_unlock (&nn_chunkpool_depot.sync);
+    nn_free (cache);
+}
+
+static int nn_chunkpool_class (size_t size)
+{
+    int shift;
+    size_t total;
+
+    total = size + sizeof (union nn_chunkpool_prefix);
+    shift = NN_CHUNKPOOL_MIN_SHIFT;
+    while (((size_t) 1 << shift) < total)
+        ++shift;
+    return shift - NN_CHUNKPOOL_MIN_SHIFT;
+}
+
+static int nn_chunkpool_cache_limit (int cls)
+{
+    int limit;
+
+    limit = NN_CHUNKPOOL_CACHE_BYTES >> (cls + NN_CHUNKPOOL_MIN_SHIFT);
+    return limit < 4 ? 4 : (limit > 64 ? 64 : limit);
+}
+
+static int nn_chunkpool_depot_limit (int cls)
+{
+    int limit;
+
+    limit = NN_CHUNKPOOL_DEPOT_BYTES >> (cls + NN_CHUNKPOOL_MIN_SHIFT);
+    return limit < 16 ? 16 : (limit > 1024 ? 1024 : limit);
+}
+
+static void *nn_chunkpool_newblock (int cls)
+{
+    union nn_chunkpool_prefix *prefix;
+
+    prefix = nn_alloc ((size_t) 1 << (cls + NN_CHUNKPOOL_MIN_SHIFT),
+        "pooled chunk");
+    if (nn_slow (!prefix))
+        return NULL;
+    prefix->cls = (uint32_t) cls;
+    return prefix + 1;
+}
+
+static void *nn_chunkpool_pop (struct nn_chunkpool_list *list)
+{
+    void *p;
+
+    p = list->head;
+    list->head = *(void**) p;
+    --list->count;
+    return p;
+}
+
+static void nn_chunkpool_push (struct nn_chunkpool_list *list, void *p)
+{
+    *(void**) p = list->head;
+    list->head = p;
+    ++list->count;
+}
+
+static void nn_chunkpool_fold (struct nn_chunkpool_cache *cache)
+{
+    struct nn_chunkpool_stats *stats;
+
+    /*  Depot's mutex must be held by the caller. */
+    stats = &nn_chunkpool_depot.stats;
+    stats->allocs += cache->stats.allocs;
+    stats->hits += cache->stats.hits;
+    stats->misses += cache->stats.misses;
+    stats->releases += cache->stats.releases;
+    memset (&cache->stats, 0, sizeof (cache->stats));
+}
+
+static void nn_chunkpool_refill (struct nn_chunkpool_cache *cache, int cls)
+{
+    int count;
+    struct nn_chunkpool_list *src;
+    struct nn_chunkpool_list *dst;
+
+    src = &nn_chunkpool_depot.lists [cls];
+    dst = &cache->lists [cls];
+    count = nn_chunkpool_cache_limit (cls) / 2;
+
+    nn_mutex_lock (&nn_chunkpool_depot.sync);
+    while (count-- && src->head)
+        nn_chunkpool_push (dst, nn_chunkpool_pop (src));
+    nn_chunkpool_fold (cache);
+    nn_mutex_unlock (&nn_chunkpool_depot.sync);
+}
+
+static void nn_chunkpool_spill (struct nn_chunkpool_cache *cache, int cls,
+    int count)
+{
+    int limit;
+    void *p;
+    struct nn_chunkpool_list *src;
+    struct nn_chunkpool_list *dst;
+
+    src = &cache->lists [cls];
+    dst = &nn_chunkpool_depot.lists [cls];
+    limit = nn_chunkpool_depot_limit (cls);
+
+    nn_mutex_lock (&nn_chunkpool_depot.sync);
+    while (count-- && src->head) {
+        p = nn_chunkpool_pop (src);
+
+        /*  If the depot is full, give the memory back to the system. */
+        if (nn_slow (dst->count >= limit)) {
+            nn_free (((union nn_chunkpool_prefix*) p) - 1);
+            ++cache->stats.releases;
+            continue;
+        }
+        nn_chunkpool_push (dst, p);
+    }
+    nn_chunkpool_fold (cache);
+    nn_mutex_unlock (&nn_chunkpool_depot.sync);
+}
+
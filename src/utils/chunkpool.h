@@ -0,0 +1,85 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_CHUNKPOOL_INCLUDED
+#define NN_CHUNKPOOL_INCLUDED
+
+#include <stddef.h>
+#include "int.h"
+
+/*  Size-classed allocator for message chunks. Blocks are recycled via
+    a small per-thread cache backed by a global depot, so that allocating
+    and freeing small messages doesn't hit the system allocator. Blocks can
+    be freed from any thread, not only from the one they were allocated in.
+
+    Size classes are powers of two between NN_CHUNKPOOL_MIN_SIZE and
+    NN_CHUNKPOOL_MAX_SIZE. Bigger requests are not served by the pool. */
+
+#define NN_CHUNKPOOL_MIN_SHIFT 6
+#define NN_CHUNKPOOL_MAX_SHIFT 16
+#define NN_CHUNKPOOL_NCLASSES \
+    (NN_CHUNKPOOL_MAX_SHIFT - NN_CHUNKPOOL_MIN_SHIFT + 1)
+
+/*  Biggest block the pool can hand out to the user. The size of the block
+    prefix used to remember the size class is already subtracted. */
+#define NN_CHUNKPOOL_MAX_SIZE \
+    (((size_t) 1 << NN_CHUNKPOOL_MAX_SHIFT) - 16)
+
+struct nn_chunkpool_stats {
+
+    /*  Total number of allocations served by the pool. */
+    uint64_t allocs;
+
+    /*  Number of allocations served from a cache or from the depot. */
+    uint64_t hits;
+
+    /*  Number of allocations that had to fall back to the system
+        allocator. */
+    uint64_t misses;
+
+    /*  Number of blocks returned to the system allocator because both the
+        thread cache and the depot were full. */
+    uint64_t releases;
+};
+
+/*  Allocates a block of at least 'size' bytes. Returns NULL if 'size' is
+    bigger than NN_CHUNKPOOL_MAX_SIZE or if the memory is exhausted. */
+void *nn_chunkpool_alloc (size_t size);
+
+/*  Returns the block to the pool. */
+void nn_chunkpool_free (void *p);
+
+/*  Retrieves the statistics of the pool. Counters are accumulated in
+    per-thread caches and folded into the global statistics whenever the
+    thread exchanges blocks with the depot, thus the numbers may lag behind
+    a bit. Statistics of the calling thread are always up to date. */
+void nn_chunkpool_stats (struct nn_chunkpool_stats *stats);
+
+/*  Returns the blocks held by the depot and by the calling thread's cache to
+    the system allocator. Caches of other threads are handed over to the
+    depot when the threads exit, so once the worker threads are shut down,
+    this releases all the memory held by the pool. The pool remains usable
+    afterwards. */
+void nn_chunkpool_drain (void);
+
+#endif
+
@@ -51,7 +51,7 @@ void nn_chunkref_init (struct nn_chunkref *self, size_t size)
 
     ch = (struct nn_chunkref_chunk*) self;
     ch->tag = 0xff;
-    rc = nn_chunk_alloc (size, 0, &ch->chunk);
+    rc = nn_chunk_alloc (size, NN_CHUNK_POOLED, &ch->chunk);
     errno_assert (rc == 0);
 }
 
@@ -86,7 +86,7 @@ void *nn_chunkref_getchunk (struct nn_chunkref *self)
         return ch->chunk;
     }
 
-    rc = nn_chunk_alloc (self->u.ref [0], 0, &chunk);
+    rc = nn_chunk_alloc (self->u.ref [0], NN_CHUNK_POOLED, &chunk);
     errno_assert (rc == 0);
     memcpy (chunk, &self->u.ref [1], self->u.ref [0]);
     self->u.ref [0] = 0;
@@ -0,0 +1,197 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "mpscq.h"
+#include "err.h"
+#include "fast.h"
+
+/*  Value of 'head' when the queue is empty and the consumer is asleep. */
+#define NN_MPSCQ_SLEEPING ((struct nn_mpscq_item*) 1)
+
+/*  Private functions. */
+static int nn_mpscq_cas (struct nn_mpscq *self, struct nn_mpscq_item *oldval,
+    struct nn_mpscq_item *newval);
+static struct nn_mpscq_item *nn_mpscq_xchg (struct nn_mpscq *self,
+    struct nn_mpscq_item *newval);
+
+void nn_mpscq_init (struct nn_mpscq *self)
+{
+    self->head = NULL;
+    nn_mutex_init (&self->sync);
+#if defined NN_ATOMIC_MUTEX
+    nn_mutex_init (&self->head_sync);
+#endif
+}
+
+void nn_mpscq_term (struct nn_mpscq *self)
+{
+    self->head = NULL;
+#if defined NN_ATOMIC_MUTEX
+    nn_mutex_term (&self->head_sync);
+#endif
+    nn_mutex_term (&self->sync);
+}
+
+int nn_mpscq_push (struct nn_mpscq *self, struct nn_mpscq_item *item)
+{
+    struct nn_mpscq_item *head;
+
+    nn_assert (item->next == NN_MPSCQ_NOTINQUEUE);
+
+    do {
+        head = self->head;
+        item->next = head == NN_MPSCQ_SLEEPING ? NULL : head;
+    } while (nn_slow (!nn_mpscq_cas (self, head, item)));
+
+    return head == NN_MPSCQ_SLEEPING ? 1 : 0;
+}
+
+void nn_mpscq_remove (struct nn_mpscq *self, struct nn_mpscq_item *item)
+{
+    struct nn_mpscq_item *it;
+
+    if (item->next == NN_MPSCQ_NOTINQUEUE)
+        return;
+
+    nn_mutex_lock (&self->sync);
+
+    /*  If the item is at the head of the queue, it has to be unlinked
+        atomically as producers may be pushing new items at the same time.
+        If that happens, the item is not at the head any more. */
+    it = self->head;
+    if (it == item && nn_mpscq_cas (self, item, item->next)) {
+        item->next = NN_MPSCQ_NOTINQUEUE;
+        nn_mutex_unlock (&self->sync);
+        return;
+    }
+
+    /*  Items below the head are modified neither by the producers nor,
+        as the mutex is locked, by the consumer. */
+    it = self->head;
+    for (; it != NULL && it != NN_MPSCQ_SLEEPING; it = it->next) {
+        if (it->next == item) {
+            it->next = item->next;
+            item->next = NN_MPSCQ_NOTINQUEUE;
+            break;
+        }
+    }
+
+    nn_mutex_unlock (&self->sync);
+}
+
+struct nn_mpscq_item *nn_mpscq_pop_all (struct nn_mpscq *self)
+{
+    struct nn_mpscq_item *it;
+    struct nn_mpscq_item *prev;
+    struct nn_mpscq_item *next;
+
+    /*  Fast path. Producers never empty the queue, so if it's empty now it
+        will be empty after the exchange as well. */
+    if (self->head == NULL)
+        return NULL;
+
+    nn_mutex_lock (&self->sync);
+
+    /*  Take all the items. This also cancels the sleeping mark, if any. */
+    it = nn_mpscq_xchg (self, NULL);
+    if (it == NN_MPSCQ_SLEEPING)
+        it = NULL;
+
+    /*  Items are linked from the newest to the oldest one. Reverse the
+        list. */
+    prev = NULL;
+    while (it) {
+        next = it->next;
+        it->next = prev;
+        prev = it;
+        it = next;
+    }
+
+    nn_mutex_unlock (&self->sync);
+
+    return prev;
+}
+
+struct nn_mpscq_item *nn_mpscq_next (struct nn_mpscq_item *item)
+{
+    struct nn_mpscq_item *next;
+
+    next = item->next;
+    item->next = NN_MPSCQ_NOTINQUEUE;
+    return next;
+}
+
+int nn_mpscq_sleep (struct nn_mpscq *self)
+{
+    if (self->head == NN_MPSCQ_SLEEPING)
+        return 1;
+    return nn_mpscq_cas (self, NULL, NN_MPSCQ_SLEEPING);
+}
+
+void nn_mpscq_item_init (struct nn_mpscq_item *self)
+{
+    self->next = NN_MPSCQ_NOTINQUEUE;
+}
+
+void nn_mpscq_item_term (struct nn_mpscq_item *self)
+{
+    nn_assert (self->next == NN_MPSCQ_NOTINQUEUE);
+}
+
+int nn_mpscq_item_isinqueue (struct nn_mpscq_item *self)
+{
+    return self->next == NN_MPSCQ_NOTINQUEUE ? 0 : 1;
+}
+
+static int nn_mpscq_cas (struct nn_mpscq *self, struct nn_mpscq_item *oldval,
+    struct nn_mpscq_item *newval)
+{
+#if defined NN_ATOMIC_WINAPI
+    return InterlockedCompareExchangePointer ((PVOID volatile*) &self->head,
+        newval, oldval) == oldval ? 1 : 0;
+#elif defined NN_ATOMIC_SOLARIS
+    return atomic_cas_ptr (&self->head, oldval, newval) == oldval ? 1 : 0;
+#elif defined NN_ATOMIC_GCC_BUILTINS
+    return __sync_bool_compare_and_swap (&self->head, oldval, newval) ? 1 : 0;
+#elif defined NN_ATOMIC_MUTEX
+    int res;
+    nn_mutex_lock (&self->head_sync);
+    res = self->head == oldval ? 1 : 0;
+    if (res)
+        self->head = newval;
+    nn_mutex_unlock (&self->head_sync);
+    return res;
+#else
+#error
+#endif
+}
+
+static struct nn_mpscq_item *nn_mpscq_xchg (struct nn_mpscq *self,
+    struct nn_mpscq_item *newval)
+{
+    struct nn_mpscq_item *oldval;
+
+    do {
+        oldval = self->head;
+    } while (nn_slow (!nn_mpscq_cas (self, oldval, newval)));
+    return oldval;
+}
@@ -0,0 +1,100 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_MPSCQ_INCLUDED
+#define NN_MPSCQ_INCLUDED
+
+#include "atomic.h"
+#include "mutex.h"
+
+/*  Intrusive queue with any number of producers and a single consumer.
+    Pushing an item is lock-free. The consumer takes all the queued items
+    at once. The consumer can also announce that it's going to sleep, in
+    which case the next producer is told to wake it up. */
+
+/*  Undefined value for initialising a queue item which is not
+    part of a queue. */
+#define NN_MPSCQ_NOTINQUEUE ((struct nn_mpscq_item*) -1)
+
+struct nn_mpscq_item {
+    struct nn_mpscq_item *next;
+};
+
+struct nn_mpscq {
+
+    /*  The most recently pushed item. Items are linked from the newest to
+        the oldest one. */
+    struct nn_mpscq_item *volatile head;
+
+    /*  Synchronises the consumer with removal of items from the queue.
+        Producers don't use it. */
+    struct nn_mutex sync;
+
+#if defined NN_ATOMIC_MUTEX
+    /*  Used to emulate atomic operations on 'head'. */
+    struct nn_mutex head_sync;
+#endif
+};
+
+/*  Initialise the queue. */
+void nn_mpscq_init (struct nn_mpscq *self);
+
+/*  Terminate the queue. Note that queue must be emptied before the
+    termination. */
+void nn_mpscq_term (struct nn_mpscq *self);
+
+/*  Inserts one element into the queue. Returns 1 if the consumer is asleep
+    and has to be woken up, 0 otherwise. */
+int nn_mpscq_push (struct nn_mpscq *self, struct nn_mpscq_item *item);
+
+/*  Remove the item if it is present in the queue, i.e. if it was not taken
+    by the consumer yet. */
+void nn_mpscq_remove (struct nn_mpscq *self, struct nn_mpscq_item *item);
+
+/*  Retrieves all the elements from the queue. Returns the oldest one or NULL
+    if the queue is empty. The remaining elements can be retrieved, in the
+    order in which they were pushed, using nn_mpscq_next. To be called by
+    the consumer only. */
+struct nn_mpscq_item *nn_mpscq_pop_all (struct nn_mpscq *self);
+
+/*  Returns the element that was pushed after 'item' and retrieved by the
+    same nn_mpscq_pop_all call, or NULL if there's none. 'item' itself
+    is not a part of the queue afterwards and can be pushed again. */
+struct nn_mpscq_item *nn_mpscq_next (struct nn_mpscq_item *item);
+
+/*  To be called by the consumer before it goes to sleep. If the queue is
+    empty, 1 is returned and the next push will ask for the consumer to be
+    woken up. Otherwise, 0 is returned and the consumer should retrieve
+    the queued elements instead of sleeping. */
+int nn_mpscq_sleep (struct nn_mpscq *self);
+
+/*  Initialise a queue item. At this point it is not a part of any queue. */
+void nn_mpscq_item_init (struct nn_mpscq_item *self);
+
+/*  Terminate a queue item. The item must not be in a queue prior to
+    this call. */
+void nn_mpscq_item_term (struct nn_mpscq_item *self);
+
+/*  Returns 1 if item is a part of a queue. 0 otherwise. */
+int nn_mpscq_item_isinqueue (struct nn_mpscq_item *self);
+
+#endif
@@ -21,14 +21,22 @@
 */
 
 #include "msg.h"
+#include "err.h"
+#include "fast.h"
+
+#include "../nn.h"
 
 #include <string.h>
 
+/*  Private functions. */
+static void nn_msg_addref_parts (struct nn_msg *self, uint32_t n);
+
 void nn_msg_init (struct nn_msg *self, size_t size)
 {
     nn_chunkref_init (&self->sphdr, 0);
     nn_chunkref_init (&self->hdrs, 0);
     nn_chunkref_init (&self->body, size);
+    nn_chunkref_init (&self->parts, 0);
 }
 
 void nn_msg_init_chunk (struct nn_msg *self, void *chunk)
@@ -36,13 +44,91 @@ void nn_msg_init_chunk (struct nn_msg *self, void *chunk)
     nn_chunkref_init (&self->sphdr, 0);
     nn_chunkref_init (&self->hdrs, 0);
     nn_chunkref_init_chunk (&self->body, chunk);
+    nn_chunkref_init (&self->parts, 0);
+}
+
+void nn_msg_init_parts (struct nn_msg *self, void **chunks, int nchunks)
+{
+    nn_assert (nchunks >= 1 && nchunks <= NN_MSG_MAXPARTS);
+
+    nn_msg_init_chunk (self, chunks [0]);
+    nn_chunkref_term (&self->parts);
+    nn_chunkref_init (&self->parts, (nchunks - 1) * sizeof (void*));
+    memcpy (nn_chunkref_data (&self->parts), chunks + 1,
+        (nchunks - 1) * sizeof (void*));
+}
+
+int nn_msg_nparts (struct nn_msg *self)
+{
+    return (int) (nn_chunkref_size (&self->parts) / sizeof (void*));
+}
+
+void *nn_msg_part (struct nn_msg *self, int i)
+{
+    void *chunk;
+
+    nn_assert (i >= 0 && i < nn_msg_nparts (self));
+    memcpy (&chunk, ((void**) nn_chunkref_data (&self->parts)) + i,
+        sizeof (void*));
+    return chunk;
+}
+
+size_t nn_msg_bodysize (struct nn_msg *self)
+{
+    int i;
+    int nparts;
+    size_t sz;
+
+    sz = nn_chunkref_size (&self->body);
+    nparts = nn_msg_nparts (self);
+    for (i = 0; i != nparts; ++i)
+        sz += nn_chunk_size (nn_msg_part (self, i));
+    return sz;
+}
+
+void nn_msg_flatten (struct nn_msg *self)
+{
+    int i;
+    int nparts;
+    size_t sz;
+    size_t pos;
+    void *chunk;
+    struct nn_chunkref body;
+
+    nparts = nn_msg_nparts (self);
+    if (nn_fast (nparts == 0))
+        return;
+
+    /*  Copy the whole payload into a new body. */
+    sz = nn_msg_bodysize (self);
+    nn_chunkref_init (&body, sz);
+    pos = nn_chunkref_size (&self->body);
+    memcpy (nn_chunkref_data (&body), nn_chunkref_data (&self->body), pos);
+    for (i = 0; i != nparts; ++i) {
+        chunk = nn_msg_part (self, i);
+        memcpy (((uint8_t*) nn_chunkref_data (&body)) + pos, chunk,
+            nn_chunk_size (chunk));
+        pos += nn_chunk_size (chunk);
+        nn_chunk_free (chunk);
+    }
+    nn_chunkref_term (&self->parts);
+    nn_chunkref_init (&self->parts, 0);
+    nn_chunkref_term (&self->body);
+    nn_chunkref_mv (&self->body, &body);
 }
 
 void nn_msg_term (struct nn_msg *self)
 {
+    int i;
+    int nparts;
+
+    nparts = nn_msg_nparts (self);
+    for (i = 0; i != nparts; ++i)
+        nn_chunk_free (nn_msg_part (self, i));
     nn_chunkref_term (&self->sphdr);
     nn_chunkref_term (&self->hdrs);
     nn_chunkref_term (&self->body);
+    nn_chunkref_term (&self->parts);
 }
 
 void nn_msg_mv (struct nn_msg *dst, struct nn_msg *src)
@@ -50,6 +136,7 @@ void nn_msg_mv (struct nn_msg *dst, struct nn_msg *src)
     nn_chunkref_mv (&dst->sphdr, &src->sphdr);
     nn_chunkref_mv (&dst->hdrs, &src->hdrs);
     nn_chunkref_mv (&dst->body, &src->body);
+    nn_chunkref_mv (&dst->parts, &src->parts);
 }
 
 void nn_msg_cp (struct nn_msg *dst, struct nn_msg *src)
@@ -57,6 +144,8 @@ void nn_msg_cp (struct nn_msg *dst, struct nn_msg *src)
     nn_chunkref_cp (&dst->sphdr, &src->sphdr);
     nn_chunkref_cp (&dst->hdrs, &src->hdrs);
     nn_chunkref_cp (&dst->body, &src->body);
+    nn_chunkref_cp (&dst->parts, &src->parts);
+    nn_msg_addref_parts (src, 1);
 }
 
 void nn_msg_bulkcopy_start (struct nn_msg *self, uint32_t copies)
@@ -64,6 +153,8 @@ void nn_msg_bulkcopy_start (struct nn_msg *self, uint32_t copies)
     nn_chunkref_bulkcopy_start (&self->sphdr, copies);
     nn_chunkref_bulkcopy_start (&self->hdrs, copies);
     nn_chunkref_bulkcopy_start (&self->body, copies);
+    nn_chunkref_bulkcopy_start (&self->parts, copies);
+    nn_msg_addref_parts (self, copies);
 }
 
 void nn_msg_bulkcopy_cp (struct nn_msg *dst, struct nn_msg *src)
@@ -71,6 +162,7 @@ void nn_msg_bulkcopy_cp (struct nn_msg *dst, struct nn_msg *src)
     nn_chunkref_bulkcopy_cp (&dst->sphdr, &src->sphdr);
     nn_chunkref_bulkcopy_cp (&dst->hdrs, &src->hdrs);
     nn_chunkref_bulkcopy_cp (&dst->body, &src->body);
+    nn_chunkref_bulkcopy_cp (&dst->parts, &src->parts);
 }
 
 void nn_msg_replace_body (struct nn_msg *self, struct nn_chunkref new_body) 
@@ -79,3 +171,65 @@ void nn_msg_replace_body (struct nn_msg *self, struct nn_chunkref new_body)
     self->body = new_body;
 }
 
+struct nn_cmsghdr *nn_msg_getcmsg (struct nn_msg *self, int level, int type)
+{
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+
+    if (nn_fast (nn_chunkref_size (&self->hdrs) == 0))
+        return NULL;
+
+    hdr.msg_iov = NULL;
+    hdr.msg_iovlen = 0;
+    hdr.msg_control = nn_chunkref_data (&self->hdrs);
+    hdr.msg_controllen = nn_chunkref_size (&self->hdrs);
+    cmsg = NN_CMSG_FIRSTHDR (&hdr);
+    while (cmsg) {
+
+        /*  Malformed property would make the iteration loop forever. */
+        if (nn_slow (cmsg->cmsg_len < NN_CMSG_LEN (0)))
+            return NULL;
+
+        if (cmsg->cmsg_level == level && cmsg->cmsg_type == type)
+            return cmsg;
+        cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+    }
+
+    return NULL;
+}
+
+void nn_msg_rmcmsg (struct nn_msg *self, struct nn_cmsghdr *cmsg)
+{
+    struct nn_chunkref hdrs;
+    uint8_t *data;
+    size_t size;
+    size_t pos;
+    size_t len;
+
+    data = nn_chunkref_data (&self->hdrs);
+    size = nn_chunkref_size (&self->hdrs);
+    pos = (uint8_t*) cmsg - data;
+    len = NN_CMSG_ALIGN_ (cmsg->cmsg_len);
+    if (len > size - pos)
+        len = size - pos;
+
+    /*  The buffer may be shared with other messages, so the remaining
+        properties are copied to a new one. */
+    nn_chunkref_init (&hdrs, size - len);
+    memcpy (nn_chunkref_data (&hdrs), data, pos);
+    memcpy (((uint8_t*) nn_chunkref_data (&hdrs)) + pos, data + pos + len,
+        size - pos - len);
+    nn_chunkref_term (&self->hdrs);
+    nn_chunkref_mv (&self->hdrs, &hdrs);
+}
+
+static void nn_msg_addref_parts (struct nn_msg *self, uint32_t n)
+{
+    int i;
+    int nparts;
+
+    nparts = nn_msg_nparts (self);
+    for (i = 0; i != nparts; ++i)
+        nn_chunk_addref (nn_msg_part (self, i), n);
+}
+
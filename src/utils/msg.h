@@ -27,6 +27,9 @@
 
 #include <stddef.h>
 
+/*  Maximal number of chunks the message body can be composed of. */
+#define NN_MSG_MAXPARTS 16
+
 struct nn_msg {
 
     /*  Contains SP message header. This field directly corresponds
@@ -40,6 +43,11 @@ struct nn_msg {
 
     /*  Contains application level message payload. */
     struct nn_chunkref body;
+
+    /*  Array of pointers to chunks holding the remainder of the payload,
+        if it was supplied in multiple chunks. The message holds a reference
+        to each of the chunks. Usually empty. */
+    struct nn_chunkref parts;
 };
 
 /*  Initialises a message with body 'size' bytes long and empty header. */
@@ -48,6 +56,21 @@ void nn_msg_init (struct nn_msg *self, size_t size);
 /*  Initialise message with body provided in the form of chunk pointer. */
 void nn_msg_init_chunk (struct nn_msg *self, void *chunk);
 
+/*  Initialise message with body composed of 'nchunks' chunks. The message
+    takes ownership of the chunks. */
+void nn_msg_init_parts (struct nn_msg *self, void **chunks, int nchunks);
+
+/*  Returns number of chunks following the body and the individual chunks. */
+int nn_msg_nparts (struct nn_msg *self);
+void *nn_msg_part (struct nn_msg *self, int i);
+
+/*  Returns size of the whole message payload, including all the parts. */
+size_t nn_msg_bodysize (struct nn_msg *self);
+
+/*  Merges all the parts of the payload into the body. Use before accessing
+    the body of a message that could have been sent by the user. */
+void nn_msg_flatten (struct nn_msg *self);
+
 /*  Frees resources allocate with the message. */
 void nn_msg_term (struct nn_msg *self);
 
@@ -72,5 +95,13 @@ void nn_msg_bulkcopy_cp (struct nn_msg *dst, struct nn_msg *src);
     that substantially rewrite or preprocess the userland message to be written. */
 void nn_msg_replace_body(struct nn_msg *self, struct nn_chunkref newBody);
 
+/*  Returns the first ancillary property of the specified level and type
+    attached to the message or NULL if there's no such property. */
+struct nn_cmsghdr *nn_msg_getcmsg (struct nn_msg *self, int level, int type);
+
+/*  Removes the ancillary property returned by nn_msg_getcmsg from the
+    message. */
+void nn_msg_rmcmsg (struct nn_msg *self, struct nn_cmsghdr *cmsg);
+
 #endif
 
@@ -50,6 +50,9 @@ void worker (NN_UNUSED void *arg)
 
 int main ()
 {
+    int rc;
+    int busy_poll;
+    size_t sz;
     struct nn_thread thread;
 
     sb = test_socket (AF_SP, NN_PAIR);
@@ -64,6 +67,29 @@ int main ()
 
     nn_thread_term (&thread);
 
+    /*  Check NN_BUSY_POLL option handling. */
+    busy_poll = -1;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_BUSY_POLL, &busy_poll,
+        sizeof (busy_poll));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    busy_poll = 1000000;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_BUSY_POLL, &busy_poll,
+        sizeof (busy_poll));
+    errno_assert (rc == 0);
+    busy_poll = 0;
+    sz = sizeof (busy_poll);
+    rc = nn_getsockopt (sb, NN_SOL_SOCKET, NN_BUSY_POLL, &busy_poll, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (busy_poll) && busy_poll == 1000000);
+
+    /*  Same as above, this time the receiver spins rather than sleeps. */
+    nn_thread_init (&thread, worker, NULL);
+
+    test_recv (sb, "ABC");
+    test_recv (sb, "ABC");
+
+    nn_thread_term (&thread);
+
     test_close (sc);
     test_close (sb);
 
@@ -0,0 +1,150 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/utils/attr.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/alloc.c"
+#include "../src/utils/mutex.c"
+#include "../src/utils/atomic.c"
+#include "../src/utils/wire.c"
+#include "../src/utils/chunkpool.c"
+#include "../src/utils/chunk.c"
+#include "../src/utils/thread.c"
+
+/*  This test checks whether chunks are recycled by the chunk pool. */
+
+#define NCHUNKS 100
+
+void *chunks [NCHUNKS];
+
+static void worker (NN_UNUSED void *arg)
+{
+    int i;
+
+    /*  Free the chunks allocated by the main thread. */
+    for (i = 0; i != NCHUNKS; ++i)
+        nn_chunk_free (chunks [i]);
+}
+
+int main ()
+{
+    int rc;
+    int i;
+    void *p;
+    void *q;
+    struct nn_chunkpool_stats stats;
+    struct nn_thread thread;
+
+    /*  Invalid allocation type. */
+    rc = nn_chunk_alloc (10, 666, &p);
+    nn_assert (rc == -EINVAL);
+
+    /*  Freed chunk is handed out once again. */
+    rc = nn_chunk_alloc (100, NN_CHUNK_POOLED, &p);
+    errnum_assert (rc == 0, -rc);
+    memset (p, 'a', 100);
+    nn_chunk_free (p);
+    rc = nn_chunk_alloc (90, NN_CHUNK_POOLED, &q);
+    errnum_assert (rc == 0, -rc);
+    nn_assert (p == q);
+    nn_chunkpool_stats (&stats);
+    nn_assert (stats.allocs == 2);
+    nn_assert (stats.misses == 1);
+    nn_assert (stats.hits == 1);
+
+    /*  Trimmed chunk can be resized. Pooled chunks are resized by copying. */
+    memcpy (q, "0123456789", 10);
+    q = nn_chunk_trim (q, 5);
+    rc = nn_chunk_realloc (1000, &q);
+    errnum_assert (rc == 0, -rc);
+    nn_assert (nn_chunk_size (q) == 1000);
+    nn_assert (memcmp (q, "56789", 5) == 0);
+    rc = nn_chunk_realloc (3, &q);
+    errnum_assert (rc == 0, -rc);
+    nn_assert (nn_chunk_size (q) == 3);
+    nn_assert (memcmp (q, "567", 3) == 0);
+    nn_chunk_free (q);
+
+    /*  Slices share the memory with the original chunk and outlive it. */
+    rc = nn_chunk_alloc (100, NN_CHUNK_DEFAULT, &p);
+    errnum_assert (rc == 0, -rc);
+    for (i = 0; i != 100; ++i)
+        ((char*) p) [i] = (char) i;
+    q = nn_chunk_slice (p, 50, 20);
+    nn_assert (q == (char*) p + 50);
+    nn_assert (nn_chunk_size (q) == 20);
+    nn_assert (nn_chunk_size (p) == 100);
+    nn_chunk_free (p);
+    nn_assert (((char*) q) [0] == 50 && ((char*) q) [19] == 69);
+    q = nn_chunk_trim (q, 10);
+    nn_assert (nn_chunk_size (q) == 10);
+    nn_assert (((char*) q) [0] == 60);
+    nn_chunk_addref (q, 1);
+    nn_chunk_free (q);
+    rc = nn_chunk_realloc (1000, &q);
+    errnum_assert (rc == 0, -rc);
+    nn_assert (nn_chunk_size (q) == 1000);
+    nn_assert (((char*) q) [0] == 60 && ((char*) q) [9] == 69);
+    nn_chunk_free (q);
+
+    /*  Chunks too big for the pool are allocated from the heap. */
+    rc = nn_chunk_alloc (NN_CHUNKPOOL_MAX_SIZE + 1, NN_CHUNK_POOLED, &p);
+    errnum_assert (rc == 0, -rc);
+    nn_chunkpool_stats (&stats);
+    nn_assert (stats.allocs == 4);
+    nn_chunk_free (p);
+
+    /*  Chunks can be freed from a different thread. Once the thread exits
+        they are available to the other threads via the depot. */
+    for (i = 0; i != NCHUNKS; ++i) {
+        rc = nn_chunk_alloc (2000, NN_CHUNK_POOLED, &chunks [i]);
+        errnum_assert (rc == 0, -rc);
+    }
+    nn_thread_init (&thread, worker, NULL);
+    nn_thread_term (&thread);
+    nn_chunkpool_stats (&stats);
+    nn_assert (stats.allocs == 4 + NCHUNKS);
+    for (i = 0; i != NCHUNKS; ++i) {
+        rc = nn_chunk_alloc (2000, NN_CHUNK_POOLED, &chunks [i]);
+        errnum_assert (rc == 0, -rc);
+    }
+    nn_chunkpool_stats (&stats);
+    nn_assert (stats.hits >= 2 + NCHUNKS / 2);
+    for (i = 0; i != NCHUNKS; ++i)
+        nn_chunk_free (chunks [i]);
+
+    /*  Draining returns all the cached blocks to the system. The pool
+        remains usable afterwards. */
+    nn_chunkpool_drain ();
+    nn_chunkpool_stats (&stats);
+    rc = nn_chunk_alloc (2000, NN_CHUNK_POOLED, &p);
+    errnum_assert (rc == 0, -rc);
+    i = (int) stats.misses;
+    nn_chunkpool_stats (&stats);
+    nn_assert ((int) stats.misses == i + 1);
+    nn_chunk_free (p);
+    nn_chunkpool_drain ();
+
+    return 0;
+}
+
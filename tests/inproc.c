@@ -28,10 +28,15 @@
 
 #include "testutil.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+
 /*  Tests inproc transport. */
 
 #define SOCKET_ADDRESS "inproc://test"
 
+#define NPAIRS 8
+
 int main ()
 {
     int rc;
@@ -47,6 +52,16 @@ int main ()
     void *control;
     struct nn_cmsghdr *cmsg;
     unsigned char *data;
+    int pairs [NPAIRS] [2];
+    char addr [32];
+
+    /*  Run several worker threads, so that the sockets below are spread
+        among them. */
+#if defined NN_HAVE_WINDOWS
+    _putenv ("NN_WORKER_THREADS=4");
+#else
+    setenv ("NN_WORKER_THREADS", "4", 1);
+#endif
 
     /*  Create a simple topology. */
     sc = test_socket (AF_SP, NN_PAIR);
@@ -219,6 +234,30 @@ int main ()
     test_close (sc);
     test_close (s2);
 
+    /*  Test several pairs of sockets handled by different worker threads
+        at the same time. */
+    for (i = 0; i != NPAIRS; ++i) {
+        sprintf (addr, "inproc://pair%d", i);
+        pairs [i] [0] = test_socket (AF_SP, NN_PAIR);
+        test_bind (pairs [i] [0], addr);
+        pairs [i] [1] = test_socket (AF_SP, NN_PAIR);
+        test_connect (pairs [i] [1], addr);
+    }
+    for (val = 0; val != 100; ++val) {
+        for (i = 0; i != NPAIRS; ++i)
+            test_send (pairs [i] [1], "ABC");
+        for (i = 0; i != NPAIRS; ++i) {
+            test_recv (pairs [i] [0], "ABC");
+            test_send (pairs [i] [0], "DEF");
+        }
+        for (i = 0; i != NPAIRS; ++i)
+            test_recv (pairs [i] [1], "DEF");
+    }
+    for (i = 0; i != NPAIRS; ++i) {
+        test_close (pairs [i] [1]);
+        test_close (pairs [i] [0]);
+    }
+
     return 0;
 }
 
@@ -27,16 +27,22 @@
 
 #include "testutil.h"
 
+#include <string.h>
+
 /*  Tests IPC transport. */
 
 #define SOCKET_ADDRESS "ipc://test.ipc"
 
 int main ()
 {
+    int rc;
     int sb;
     int sc;
     int i;
+    int j;
+    int opt;
     int s1, s2;
+    char data [1000];
 
 	size_t size;
 	char * buf;
@@ -86,6 +92,97 @@ int main ()
     test_close (sc);
     test_close (sb);
 
+    /*  Test batching of outbound messages. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 1024;
+    rc = nn_setsockopt (sc, NN_SOL_SOCKET, NN_SNDBATCH, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    test_connect (sc, SOCKET_ADDRESS);
+    for (i = 0; i != 1000; ++i) {
+        test_send (sc, "XYZ");
+    }
+    for (i = 0; i != 1000; ++i) {
+        test_recv (sb, "XYZ");
+    }
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test that the outbound queue is bounded by NN_SNDBUF. Once the peer
+        stops receiving, sends fail with EAGAIN or time out, yet all the
+        messages accepted so far are delivered. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = 1024;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_RCVBUF, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 16384;
+    rc = nn_setsockopt (sc, NN_SOL_SOCKET, NN_SNDBUF, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    opt = 100;
+    rc = nn_setsockopt (sc, NN_SOL_SOCKET, NN_SNDTIMEO, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    test_connect (sc, SOCKET_ADDRESS);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    for (i = 0; i != 1000000; ++i) {
+        memset (data, 'a' + i % 26, sizeof (data));
+        rc = nn_send (sc, data, sizeof (data), NN_DONTWAIT);
+        if (rc < 0) {
+            errno_assert (nn_errno () == EAGAIN);
+            break;
+        }
+        nn_assert (rc == sizeof (data));
+    }
+    nn_assert (i != 1000000);
+    for (j = 0; j != 1000; ++j) {
+        memset (data, 'a' + i % 26, sizeof (data));
+        rc = nn_send (sc, data, sizeof (data), 0);
+        if (rc < 0) {
+            errno_assert (nn_errno () == EAGAIN);
+            break;
+        }
+        nn_assert (rc == sizeof (data));
+        ++i;
+    }
+    nn_assert (j != 1000);
+    for (j = 0; j != i; ++j) {
+        rc = nn_recv (sb, data, sizeof (data), 0);
+        errno_assert (rc == sizeof (data));
+        while (rc--)
+            nn_assert (data [rc] == 'a' + j % 26);
+    }
+    test_send (sc, "DEF");
+    test_recv (sb, "DEF");
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test that the messages read ahead of the user are still received
+        after the peer closes the connection. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = 1000;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+    for (i = 0; i != 100; ++i) {
+        memset (data, 'a' + i % 26, sizeof (data));
+        rc = nn_send (sc, data, sizeof (data), 0);
+        errno_assert (rc == sizeof (data));
+    }
+    test_close (sc);
+    nn_sleep (100);
+    for (i = 0; i != 100; ++i) {
+        rc = nn_recv (sb, data, sizeof (data), 0);
+        errno_assert (rc == sizeof (data));
+        while (rc--)
+            nn_assert (data [rc] == 'a' + i % 26);
+    }
+    test_close (sb);
+
     /*  Test whether connection rejection is handled decently. */
     sb = test_socket (AF_SP, NN_PAIR);
     test_bind (sb, SOCKET_ADDRESS);
@@ -0,0 +1,150 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/pipeline.h"
+
+#include "testutil.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*  Test of nn_sendmmsg and nn_recvmmsg. */
+
+#define SOCKET_ADDRESS "inproc://a"
+#define MSG_COUNT 150
+
+int main ()
+{
+    int rc;
+    int i;
+    int sb;
+    int sc;
+    int total;
+    void *chunk;
+    char bufs [MSG_COUNT][8];
+    struct nn_iovec iovs [MSG_COUNT];
+    struct nn_mmsghdr msgs [MSG_COUNT];
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+
+    /*  Nothing to receive. */
+    iovs [0].iov_base = bufs [0];
+    iovs [0].iov_len = sizeof (bufs [0]);
+    memset (&msgs [0], 0, sizeof (msgs [0]));
+    msgs [0].msg_hdr.msg_iov = &iovs [0];
+    msgs [0].msg_hdr.msg_iovlen = 1;
+    rc = nn_recvmmsg (sb, msgs, 1, NN_DONTWAIT);
+    nn_assert (rc == -1 && nn_errno () == EAGAIN);
+    rc = nn_sendmmsg (sc, msgs, 0, 0);
+    errno_assert (rc == 0);
+
+    /*  Send more messages than fit into a single batch. The first message
+        is passed in a chunk. */
+    for (i = 0; i != MSG_COUNT; ++i) {
+        sprintf (bufs [i], "%d", i);
+        iovs [i].iov_base = bufs [i];
+        iovs [i].iov_len = strlen (bufs [i]);
+        memset (&msgs [i], 0, sizeof (msgs [i]));
+        msgs [i].msg_hdr.msg_iov = &iovs [i];
+        msgs [i].msg_hdr.msg_iovlen = 1;
+    }
+    chunk = nn_allocmsg (1, 0);
+    errno_assert (chunk);
+    *(char*) chunk = '0';
+    iovs [0].iov_base = &chunk;
+    iovs [0].iov_len = NN_MSG;
+    total = 0;
+    while (total != MSG_COUNT) {
+        rc = nn_sendmmsg (sc, msgs + total, MSG_COUNT - total, 0);
+        errno_assert (rc > 0);
+        for (i = total; i != total + rc; ++i)
+            nn_assert (msgs [i].msg_len == (int) (i < 10 ? 1 :
+                i < 100 ? 2 : 3));
+        total += rc;
+    }
+
+    /*  Receive them in batches, the first message into a chunk. */
+    for (i = 0; i != MSG_COUNT; ++i) {
+        iovs [i].iov_base = bufs [i];
+        iovs [i].iov_len = sizeof (bufs [i]);
+    }
+    iovs [0].iov_base = &chunk;
+    iovs [0].iov_len = NN_MSG;
+    total = 0;
+    while (total != MSG_COUNT) {
+        rc = nn_recvmmsg (sb, msgs + total, MSG_COUNT - total, 0);
+        errno_assert (rc > 0);
+        total += rc;
+    }
+    nn_assert (msgs [0].msg_len == 1 && *(char*) chunk == '0');
+    nn_freemsg (chunk);
+    for (i = 1; i != MSG_COUNT; ++i) {
+        nn_assert (msgs [i].msg_len == (int) strlen (bufs [i]));
+        nn_assert (atoi (bufs [i]) == i);
+    }
+    rc = nn_recvmmsg (sb, msgs, MSG_COUNT, NN_DONTWAIT);
+    nn_assert (rc == -1 && nn_errno () == EAGAIN);
+
+    /*  A malformed message stops the batch. It's reported by the next
+        call. */
+    for (i = 0; i != 3; ++i) {
+        iovs [i].iov_base = bufs [i];
+        iovs [i].iov_len = 1;
+    }
+    msgs [1].msg_hdr.msg_iovlen = -1;
+    rc = nn_sendmmsg (sc, msgs, 3, 0);
+    errno_assert (rc == 1);
+    rc = nn_sendmmsg (sc, msgs + 1, 2, 0);
+    nn_assert (rc == -1 && nn_errno () == EMSGSIZE);
+    msgs [1].msg_hdr.msg_iovlen = 1;
+
+    /*  Malformed headers are rejected before any message is received. */
+    msgs [1].msg_hdr.msg_iovlen = -1;
+    rc = nn_recvmmsg (sb, msgs, 3, 0);
+    nn_assert (rc == -1 && nn_errno () == EMSGSIZE);
+    msgs [1].msg_hdr.msg_iovlen = 1;
+    rc = nn_recvmmsg (sb, msgs, 3, 0);
+    errno_assert (rc == 1);
+    nn_assert (msgs [0].msg_len == 1 && bufs [0][0] == '0');
+
+    /*  Socket types that can't send or receive. */
+    test_close (sc);
+    sc = test_socket (AF_SP, NN_PULL);
+    rc = nn_sendmmsg (sc, msgs, 1, 0);
+    nn_assert (rc == -1 && nn_errno () == ENOTSUP);
+    test_close (sc);
+    sc = test_socket (AF_SP, NN_PUSH);
+    rc = nn_recvmmsg (sc, msgs, 1, 0);
+    nn_assert (rc == -1 && nn_errno () == ENOTSUP);
+    rc = nn_sendmmsg (sc, msgs, 1, NN_DONTWAIT);
+    nn_assert (rc == -1 && nn_errno () == EAGAIN);
+
+    test_close (sc);
+    test_close (sb);
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/utils/cont.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/mutex.c"
+#include "../src/utils/mpscq.c"
+#include "../src/utils/efd.c"
+#include "../src/utils/closefd.c"
+#include "../src/utils/thread.c"
+
+#define PRODUCERS 4
+#define ITEMS 20000
+
+/*  Typical object that can be added to a queue. */
+struct item {
+    int producer;
+    int value;
+    struct nn_mpscq_item item;
+};
+
+static struct nn_mpscq queue;
+static struct nn_efd efd;
+static struct item items [PRODUCERS] [ITEMS];
+
+static void producer (void *arg)
+{
+    int i;
+    struct item *its;
+
+    its = (struct item*) arg;
+    for (i = 0; i != ITEMS; ++i)
+        if (nn_mpscq_push (&queue, &its [i].item))
+            nn_efd_signal (&efd);
+}
+
+int main ()
+{
+    int i;
+    int j;
+    int rc;
+    int received;
+    int next [PRODUCERS];
+    struct item a;
+    struct item b;
+    struct item c;
+    struct item *it;
+    struct nn_mpscq_item *item;
+    struct nn_thread threads [PRODUCERS];
+
+    nn_mpscq_init (&queue);
+    nn_mpscq_item_init (&a.item);
+    nn_mpscq_item_init (&b.item);
+    nn_mpscq_item_init (&c.item);
+    a.value = 1;
+    b.value = 2;
+    c.value = 3;
+
+    /*  Empty queue. */
+    nn_assert (nn_mpscq_pop_all (&queue) == NULL);
+
+    /*  Items are retrieved in the order they were pushed. */
+    rc = nn_mpscq_push (&queue, &a.item);
+    nn_assert (rc == 0);
+    rc = nn_mpscq_push (&queue, &b.item);
+    nn_assert (rc == 0);
+    rc = nn_mpscq_push (&queue, &c.item);
+    nn_assert (rc == 0);
+    nn_assert (nn_mpscq_item_isinqueue (&b.item));
+    item = nn_mpscq_pop_all (&queue);
+    nn_assert (item == &a.item);
+    item = nn_mpscq_next (item);
+    nn_assert (item == &b.item);
+    item = nn_mpscq_next (item);
+    nn_assert (item == &c.item);
+    item = nn_mpscq_next (item);
+    nn_assert (item == NULL);
+    nn_assert (!nn_mpscq_item_isinqueue (&b.item));
+    nn_assert (nn_mpscq_pop_all (&queue) == NULL);
+
+    /*  Only the first push after the consumer announced it's going to sleep
+        asks for it to be woken up. */
+    rc = nn_mpscq_sleep (&queue);
+    nn_assert (rc == 1);
+    rc = nn_mpscq_push (&queue, &a.item);
+    nn_assert (rc == 1);
+    rc = nn_mpscq_push (&queue, &b.item);
+    nn_assert (rc == 0);
+    rc = nn_mpscq_sleep (&queue);
+    nn_assert (rc == 0);
+
+    /*  Remove items from the head, the middle and the tail of the queue. */
+    rc = nn_mpscq_push (&queue, &c.item);
+    nn_assert (rc == 0);
+    nn_mpscq_remove (&queue, &b.item);
+    nn_assert (!nn_mpscq_item_isinqueue (&b.item));
+    nn_mpscq_remove (&queue, &b.item);
+    item = nn_mpscq_pop_all (&queue);
+    nn_assert (item == &a.item);
+    item = nn_mpscq_next (item);
+    nn_assert (item == &c.item);
+    nn_assert (nn_mpscq_next (item) == NULL);
+    nn_mpscq_push (&queue, &a.item);
+    nn_mpscq_push (&queue, &b.item);
+    nn_mpscq_push (&queue, &c.item);
+    nn_mpscq_remove (&queue, &c.item);
+    nn_mpscq_remove (&queue, &a.item);
+    item = nn_mpscq_pop_all (&queue);
+    nn_assert (item == &b.item);
+    nn_assert (nn_mpscq_next (item) == NULL);
+
+    /*  Retrieving the items cancels the sleeping mark. */
+    rc = nn_mpscq_sleep (&queue);
+    nn_assert (rc == 1);
+    nn_assert (nn_mpscq_pop_all (&queue) == NULL);
+    rc = nn_mpscq_push (&queue, &a.item);
+    nn_assert (rc == 0);
+    item = nn_mpscq_pop_all (&queue);
+    nn_assert (item == &a.item);
+    nn_assert (nn_mpscq_next (item) == NULL);
+
+    nn_mpscq_item_term (&c.item);
+    nn_mpscq_item_term (&b.item);
+    nn_mpscq_item_term (&a.item);
+
+    /*  Several producers. Items from each producer have to arrive in order
+        and the consumer must never miss a wake-up. */
+    rc = nn_efd_init (&efd);
+    errnum_assert (rc == 0, -rc);
+    for (i = 0; i != PRODUCERS; ++i) {
+        next [i] = 0;
+        for (j = 0; j != ITEMS; ++j) {
+            items [i] [j].producer = i;
+            items [i] [j].value = j;
+            nn_mpscq_item_init (&items [i] [j].item);
+        }
+    }
+    for (i = 0; i != PRODUCERS; ++i)
+        nn_thread_init (&threads [i], producer, items [i]);
+    received = 0;
+    while (received != PRODUCERS * ITEMS) {
+        if (nn_mpscq_sleep (&queue)) {
+            rc = nn_efd_wait (&efd, 10000);
+            errnum_assert (rc == 0, -rc);
+            nn_efd_unsignal (&efd);
+        }
+        item = nn_mpscq_pop_all (&queue);
+        while (item) {
+            it = nn_cont (item, struct item, item);
+            nn_assert (it->value == next [it->producer]);
+            ++next [it->producer];
+            ++received;
+            item = nn_mpscq_next (item);
+        }
+    }
+    for (i = 0; i != PRODUCERS; ++i)
+        nn_thread_term (&threads [i]);
+    for (i = 0; i != PRODUCERS; ++i)
+        for (j = 0; j != ITEMS; ++j)
+            nn_mpscq_item_term (&items [i] [j].item);
+    nn_efd_term (&efd);
+    nn_mpscq_term (&queue);
+
+    return 0;
+}
@@ -25,14 +25,101 @@
 #include "../src/pipeline.h"
 #include "testutil.h"
 
+#include <stdio.h>
+#include <string.h>
+
 #define SOCKET_ADDRESS "inproc://a"
 
+#define NKEYS 16
+
+/*  Sends a message with the specified routing key attached. */
+static void send_keyed (int sock, const char *key, char *data)
+{
+    int rc;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    size_t ctrl [NN_CMSG_SPACE (16) / sizeof (size_t)];
+
+    memset (ctrl, 0, sizeof (ctrl));
+    cmsg = (struct nn_cmsghdr*) ctrl;
+    cmsg->cmsg_len = NN_CMSG_LEN (strlen (key));
+    cmsg->cmsg_level = NN_SOL_SOCKET;
+    cmsg->cmsg_type = NN_BALANCE_KEY;
+    memcpy (NN_CMSG_DATA (cmsg), key, strlen (key));
+
+    iov.iov_base = data;
+    iov.iov_len = strlen (data);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctrl;
+    hdr.msg_controllen = NN_CMSG_SPACE (strlen (key));
+    rc = nn_sendmsg (sock, &hdr, 0);
+    errno_assert (rc == (int) strlen (data));
+}
+
+/*  Waits for a message to arrive to one of the sockets and returns the index
+    of the socket. Checks that the routing key was not passed along. */
+static int recv_any (int *socks, int nsocks)
+{
+    int rc;
+    int i;
+    struct nn_pollfd pfd [4];
+    char buf [16];
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    void *control;
+
+    nn_assert (nsocks <= 4);
+    for (i = 0; i != nsocks; ++i) {
+        pfd [i].fd = socks [i];
+        pfd [i].events = NN_POLLIN;
+        pfd [i].revents = 0;
+    }
+    rc = nn_poll (pfd, nsocks, 1000);
+    errno_assert (rc >= 0);
+    nn_assert (rc == 1);
+    for (i = 0; !(pfd [i].revents & NN_POLLIN); ++i);
+
+    iov.iov_base = buf;
+    iov.iov_len = sizeof (buf);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = &control;
+    hdr.msg_controllen = NN_MSG;
+    rc = nn_recvmsg (socks [i], &hdr, 0);
+    errno_assert (rc >= 0);
+    cmsg = NN_CMSG_FIRSTHDR (&hdr);
+    while (cmsg) {
+        nn_assert (cmsg->cmsg_level != NN_SOL_SOCKET ||
+            cmsg->cmsg_type != NN_BALANCE_KEY);
+        cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+    }
+    nn_freemsg (control);
+
+    return i;
+}
+
 int main ()
 {
     int push1;
     int push2;
     int pull1;
     int pull2;
+    int rc;
+    int balance;
+    size_t sz;
+    int pulls [3];
+    int owners [NKEYS];
+    int victim;
+    int used;
+    int i;
+    char key [8];
+    int fairness;
+    int rcvbuf;
+    char bulk [32768];
+    void *buf;
 
     /*  Test fan-out. */
 
@@ -76,6 +163,126 @@ int main ()
     test_close (push1);
     test_close (push2);
 
+    /*  Test selecting the load balancing policy. */
+
+    push1 = test_socket (AF_SP, NN_PUSH);
+    balance = NN_BALANCE_P2C;
+    rc = nn_setsockopt (push1, NN_PUSH, NN_PUSH_BALANCE,
+        &balance, sizeof (balance));
+    errno_assert (rc == 0);
+    balance = -1;
+    rc = nn_setsockopt (push1, NN_PUSH, NN_PUSH_BALANCE,
+        &balance, sizeof (balance));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    sz = sizeof (balance);
+    rc = nn_getsockopt (push1, NN_PUSH, NN_PUSH_BALANCE, &balance, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (balance) && balance == NN_BALANCE_P2C);
+    test_close (push1);
+
+    /*  Test key affinity with consistent hashing. */
+
+    push1 = test_socket (AF_SP, NN_PUSH);
+    balance = NN_BALANCE_HASH;
+    rc = nn_setsockopt (push1, NN_PUSH, NN_PUSH_BALANCE,
+        &balance, sizeof (balance));
+    errno_assert (rc == 0);
+    test_bind (push1, SOCKET_ADDRESS);
+    for (i = 0; i != 3; ++i) {
+        pulls [i] = test_socket (AF_SP, NN_PULL);
+        test_connect (pulls [i], SOCKET_ADDRESS);
+    }
+    nn_sleep (10);
+
+    /*  Keys are spread among the peers, each key sticking to its peer. */
+    used = 0;
+    for (i = 0; i != NKEYS; ++i) {
+        sprintf (key, "key%d", i);
+        send_keyed (push1, key, "ABC");
+        owners [i] = recv_any (pulls, 3);
+        used |= 1 << owners [i];
+    }
+    nn_assert (used != 1 && used != 2 && used != 4);
+    for (i = 0; i != NKEYS; ++i) {
+        sprintf (key, "key%d", i);
+        send_keyed (push1, key, "DEF");
+        nn_assert (recv_any (pulls, 3) == owners [i]);
+    }
+
+    /*  When a peer leaves, only the keys it owned are remapped. */
+    victim = owners [0];
+    test_close (pulls [victim]);
+    pulls [victim] = pulls [2];
+    for (i = 0; i != NKEYS; ++i)
+        if (owners [i] == victim)
+            owners [i] = -1;
+        else if (owners [i] == 2)
+            owners [i] = victim;
+    nn_sleep (10);
+    for (i = 0; i != NKEYS; ++i) {
+        sprintf (key, "key%d", i);
+        send_keyed (push1, key, "GHI");
+        rc = recv_any (pulls, 2);
+        if (owners [i] >= 0)
+            nn_assert (rc == owners [i]);
+    }
+
+    test_close (pulls [0]);
+    test_close (pulls [1]);
+    test_close (push1);
+
+    /*  Test that with deficit round-robin small messages are not stuck
+        behind large ones. */
+
+    pull1 = test_socket (AF_SP, NN_PULL);
+    fairness = -1;
+    rc = nn_setsockopt (pull1, NN_PULL, NN_PULL_FAIRNESS,
+        &fairness, sizeof (fairness));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    fairness = NN_FQ_DRR;
+    rc = nn_setsockopt (pull1, NN_PULL, NN_PULL_FAIRNESS,
+        &fairness, sizeof (fairness));
+    errno_assert (rc == 0);
+    sz = sizeof (fairness);
+    rc = nn_getsockopt (pull1, NN_PULL, NN_PULL_FAIRNESS, &fairness, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (fairness) && fairness == NN_FQ_DRR);
+    rcvbuf = 1024 * 1024;
+    rc = nn_setsockopt (pull1, NN_SOL_SOCKET, NN_RCVBUF,
+        &rcvbuf, sizeof (rcvbuf));
+    errno_assert (rc == 0);
+    test_bind (pull1, SOCKET_ADDRESS);
+    push1 = test_socket (AF_SP, NN_PUSH);
+    test_connect (push1, SOCKET_ADDRESS);
+    push2 = test_socket (AF_SP, NN_PUSH);
+    test_connect (push2, SOCKET_ADDRESS);
+    nn_sleep (10);
+
+    memset (bulk, 0, sizeof (bulk));
+    for (i = 0; i != 20; ++i) {
+        rc = nn_send (push1, bulk, sizeof (bulk), 0);
+        errno_assert (rc == sizeof (bulk));
+        test_send (push2, "ABC");
+    }
+    nn_sleep (50);
+
+    /*  Under round-robin the messages would be interleaved. */
+    used = 0;
+    for (i = 0; i != 40; ++i) {
+        rc = nn_recv (pull1, &buf, NN_MSG, 0);
+        errno_assert (rc >= 0);
+        if (rc == 3) {
+            nn_assert (i < 22);
+            ++used;
+        }
+        nn_freemsg (buf);
+    }
+    nn_assert (used == 20);
+
+    test_close (push2);
+    test_close (push1);
+    test_close (pull1);
+
     return 0;
 }
 
@@ -0,0 +1,200 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/pipeline.h"
+#include "../src/inproc.h"
+
+#include "testutil.h"
+#include "../src/utils/attr.h"
+#include "../src/utils/thread.c"
+
+#include <string.h>
+
+/*  Test of the persistent pollset. */
+
+#define SOCKET_ADDRESS "inproc://pollset%d"
+#define PAIR_COUNT 64
+
+int sb [PAIR_COUNT];
+int sc [PAIR_COUNT];
+
+void routine (NN_UNUSED void *arg)
+{
+   nn_sleep (10);
+   test_send (sc [7], "ABC");
+}
+
+void routine2 (NN_UNUSED void *arg)
+{
+   nn_sleep (10);
+   nn_term ();
+}
+
+int main ()
+{
+    int rc;
+    int i;
+    int s;
+    char addr [32];
+    char buf [3];
+    int seen [PAIR_COUNT];
+    struct nn_pollset *ps;
+    struct nn_pollfd pfd [PAIR_COUNT];
+    struct nn_thread thread;
+
+    for (i = 0; i != PAIR_COUNT; ++i) {
+        sprintf (addr, SOCKET_ADDRESS, i);
+        sb [i] = test_socket (AF_SP, NN_PAIR);
+        test_bind (sb [i], addr);
+        sc [i] = test_socket (AF_SP, NN_PAIR);
+        test_connect (sc [i], addr);
+    }
+
+    ps = nn_pollset_create ();
+    errno_assert (ps);
+    for (i = 0; i != PAIR_COUNT; ++i) {
+        rc = nn_pollset_add (ps, sb [i], NN_POLLIN);
+        errno_assert (rc == 0);
+    }
+
+    /*  Invalid use. */
+    rc = nn_pollset_add (ps, sb [0], NN_POLLIN);
+    nn_assert (rc == -1 && nn_errno () == EEXIST);
+    rc = nn_pollset_modify (ps, sc [0], NN_POLLIN);
+    nn_assert (rc == -1 && nn_errno () == ENOENT);
+    rc = nn_pollset_remove (ps, sc [0]);
+    nn_assert (rc == -1 && nn_errno () == ENOENT);
+    rc = nn_pollset_add (ps, sc [0], 4);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    rc = nn_pollset_add (ps, 12345, NN_POLLIN);
+    nn_assert (rc == -1 && nn_errno () == EBADF);
+    s = test_socket (AF_SP, NN_PUSH);
+    rc = nn_pollset_add (ps, s, NN_POLLIN | NN_POLLOUT);
+    nn_assert (rc == -1 && nn_errno () == ENOPROTOOPT);
+    rc = nn_pollset_add (ps, s, NN_POLLOUT);
+    errno_assert (rc == 0);
+    rc = nn_pollset_modify (ps, s, NN_POLLIN);
+    nn_assert (rc == -1 && nn_errno () == ENOPROTOOPT);
+    rc = nn_pollset_wait (ps, pfd, PAIR_COUNT, 0);
+    errno_assert (rc == 0);
+    rc = nn_pollset_remove (ps, s);
+    errno_assert (rc == 0);
+    test_close (s);
+
+    /*  Nothing is ready yet. */
+    rc = nn_pollset_wait (ps, pfd, PAIR_COUNT, 10);
+    errno_assert (rc == 0);
+
+    /*  Only the sockets with a message pending are reported. */
+    test_send (sc [3], "ABC");
+    test_send (sc [40], "ABC");
+    test_send (sc [63], "ABC");
+    nn_sleep (10);
+    rc = nn_pollset_wait (ps, pfd, PAIR_COUNT, -1);
+    errno_assert (rc == 3);
+    memset (seen, 0, sizeof (seen));
+    for (i = 0; i != rc; ++i) {
+        nn_assert (pfd [i].revents == NN_POLLIN);
+        nn_assert (pfd [i].events == NN_POLLIN);
+        if (pfd [i].fd == sb [3])
+            seen [3] = 1;
+        else if (pfd [i].fd == sb [40])
+            seen [40] = 1;
+        else if (pfd [i].fd == sb [63])
+            seen [63] = 1;
+    }
+    nn_assert (seen [3] && seen [40] && seen [63]);
+
+    /*  Sockets that don't fit into the array are reported by the next
+        call. */
+    rc = nn_pollset_wait (ps, pfd, 2, -1);
+    errno_assert (rc == 2);
+    rc = nn_pollset_wait (ps, pfd + 2, 1, -1);
+    errno_assert (rc == 1);
+    nn_assert (pfd [2].fd != pfd [0].fd && pfd [2].fd != pfd [1].fd);
+
+    /*  Sockets are not reported once the message is received. */
+    test_recv (sb [3], "ABC");
+    test_recv (sb [40], "ABC");
+    rc = nn_pollset_wait (ps, pfd, PAIR_COUNT, -1);
+    errno_assert (rc == 1);
+    nn_assert (pfd [0].fd == sb [63]);
+
+    /*  Both events of a socket are reported in a single entry. */
+    rc = nn_pollset_modify (ps, sb [63], NN_POLLIN | NN_POLLOUT);
+    errno_assert (rc == 0);
+    rc = nn_pollset_wait (ps, pfd, PAIR_COUNT, -1);
+    errno_assert (rc == 1);
+    nn_assert (pfd [0].fd == sb [63]);
+    nn_assert (pfd [0].events == (NN_POLLIN | NN_POLLOUT));
+    nn_assert (pfd [0].revents == (NN_POLLIN | NN_POLLOUT));
+    rc = nn_pollset_modify (ps, sb [63], NN_POLLOUT);
+    errno_assert (rc == 0);
+    test_recv (sb [63], "ABC");
+    rc = nn_pollset_wait (ps, pfd, PAIR_COUNT, -1);
+    errno_assert (rc == 1);
+    nn_assert (pfd [0].fd == sb [63] && pfd [0].revents == NN_POLLOUT);
+    rc = nn_pollset_modify (ps, sb [63], NN_POLLIN);
+    errno_assert (rc == 0);
+
+    /*  Removed sockets are not reported. */
+    rc = nn_pollset_remove (ps, sb [5]);
+    errno_assert (rc == 0);
+    test_send (sc [5], "ABC");
+    rc = nn_pollset_wait (ps, pfd, PAIR_COUNT, 10);
+    errno_assert (rc == 0);
+    test_recv (sb [5], "ABC");
+
+    /*  Signalling from a different thread. */
+    nn_thread_init (&thread, routine, NULL);
+    rc = nn_pollset_wait (ps, pfd, PAIR_COUNT, 1000);
+    errno_assert (rc == 1);
+    nn_assert (pfd [0].fd == sb [7] && pfd [0].revents == NN_POLLIN);
+    test_recv (sb [7], "ABC");
+    nn_thread_term (&thread);
+
+    /*  Terminating the library from a different thread. */
+    nn_thread_init (&thread, routine2, NULL);
+    rc = nn_pollset_wait (ps, pfd, PAIR_COUNT, 1000);
+    nn_assert (rc < 0 && nn_errno () == ETERM);
+    rc = nn_recv (sb [0], buf, sizeof (buf), 0);
+    nn_assert (rc < 0 && nn_errno () == ETERM);
+    nn_thread_term (&thread);
+
+    /*  All the pollset functions that touch the library fail afterwards. */
+    rc = nn_pollset_wait (ps, pfd, PAIR_COUNT, 0);
+    nn_assert (rc < 0 && nn_errno () == ETERM);
+    rc = nn_pollset_add (ps, sb [5], NN_POLLIN);
+    nn_assert (rc < 0 && nn_errno () == ETERM);
+    nn_assert (nn_pollset_create () == NULL && nn_errno () == ETERM);
+
+    rc = nn_pollset_close (ps);
+    errno_assert (rc == 0);
+    for (i = 0; i != PAIR_COUNT; ++i) {
+        test_close (sc [i]);
+        test_close (sb [i]);
+    }
+
+    return 0;
+}
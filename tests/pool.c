@@ -0,0 +1,172 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/utils/cont.h"
+#include "../src/utils/attr.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/alloc.c"
+#include "../src/utils/mutex.c"
+#include "../src/utils/sem.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/glock.c"
+#include "../src/utils/efd.c"
+#include "../src/utils/closefd.c"
+#include "../src/utils/clock.c"
+#include "../src/utils/list.c"
+#include "../src/utils/queue.c"
+#include "../src/utils/mpscq.c"
+#include "../src/aio/fsm.c"
+#include "../src/aio/ctx.c"
+#include "../src/aio/timerset.c"
+#include "../src/aio/poller.c"
+#include "../src/aio/worker.c"
+#include "../src/aio/pool.c"
+
+#define WORKERS 4
+#define CTXS 10
+#define ROUNDS 5
+
+#define SRC_TASK 1
+
+/*  An AIO context, with a state machine that records the worker thread
+    it is executed by. */
+struct ctx {
+    struct nn_ctx ctx;
+    struct nn_fsm fsm;
+    struct nn_worker_task task;
+    struct nn_sem done;
+#if !defined NN_HAVE_WINDOWS
+    pthread_t thread;
+    int executed;
+#endif
+};
+
+static struct nn_pool pool;
+static struct ctx ctxs [CTXS];
+
+static void handler (struct nn_fsm *self, int src, int type,
+    NN_UNUSED void *srcptr)
+{
+    struct ctx *c;
+
+    c = nn_cont (self, struct ctx, fsm);
+    nn_assert (src == SRC_TASK && type == NN_WORKER_TASK_EXECUTE);
+#if !defined NN_HAVE_WINDOWS
+    if (c->executed)
+        nn_assert (pthread_equal (c->thread, pthread_self ()));
+    c->thread = pthread_self ();
+    c->executed = 1;
+#endif
+    nn_sem_post (&c->done);
+}
+
+static int load (struct nn_worker *worker)
+{
+    return pool.loads [worker - pool.workers];
+}
+
+int main ()
+{
+    int rc;
+    int i;
+    int j;
+    int total;
+    struct nn_worker *worker;
+
+    nn_alloc_init ();
+    rc = nn_pool_init (&pool, WORKERS);
+    errnum_assert (rc == 0, -rc);
+    nn_assert (nn_pool_nworkers (&pool) == WORKERS);
+
+    /*  Contexts are spread evenly among the workers. */
+    nn_glock_lock ();
+    for (i = 0; i != CTXS; ++i)
+        nn_ctx_init (&ctxs [i].ctx, &pool, NULL);
+    nn_glock_unlock ();
+    for (i = 0; i != WORKERS; ++i)
+        nn_assert (pool.loads [i] == CTXS / WORKERS ||
+            pool.loads [i] == CTXS / WORKERS + 1);
+
+    for (i = 0; i != CTXS; ++i) {
+        nn_fsm_init_root (&ctxs [i].fsm, handler, handler, &ctxs [i].ctx);
+        nn_worker_task_init (&ctxs [i].task, SRC_TASK, &ctxs [i].fsm);
+        nn_sem_init (&ctxs [i].done);
+#if !defined NN_HAVE_WINDOWS
+        ctxs [i].executed = 0;
+#endif
+    }
+
+    /*  Each context is always handled by the same worker. */
+    for (j = 0; j != ROUNDS; ++j) {
+        for (i = 0; i != CTXS; ++i) {
+            worker = nn_ctx_choose_worker (&ctxs [i].ctx);
+            nn_assert (worker == ctxs [i].ctx.worker);
+            nn_worker_execute (worker, &ctxs [i].task);
+        }
+        for (i = 0; i != CTXS; ++i) {
+            rc = nn_sem_wait (&ctxs [i].done);
+            errnum_assert (rc == 0, -rc);
+        }
+    }
+
+#if !defined NN_HAVE_WINDOWS
+    /*  Contexts pinned to different workers run in different threads. */
+    for (i = 0; i != CTXS; ++i)
+        for (j = 0; j != CTXS; ++j)
+            nn_assert ((ctxs [i].ctx.worker == ctxs [j].ctx.worker) ==
+                (pthread_equal (ctxs [i].thread, ctxs [j].thread) != 0));
+#endif
+
+    for (i = 0; i != CTXS; ++i) {
+        nn_sem_term (&ctxs [i].done);
+        nn_worker_task_term (&ctxs [i].task);
+        nn_fsm_term (&ctxs [i].fsm);
+    }
+
+    /*  Releasing a context decrements the load of its worker only. A new
+        context goes to the least loaded worker. */
+    nn_glock_lock ();
+    worker = ctxs [0].ctx.worker;
+    j = load (worker);
+    nn_ctx_term (&ctxs [0].ctx);
+    nn_assert (load (worker) == j - 1);
+    total = load (worker);
+    for (i = 0; i != WORKERS; ++i)
+        if (pool.loads [i] < total)
+            total = pool.loads [i];
+    nn_ctx_init (&ctxs [0].ctx, &pool, NULL);
+    nn_assert (load (ctxs [0].ctx.worker) == total + 1);
+    for (i = 0; i != CTXS; ++i)
+        nn_ctx_term (&ctxs [i].ctx);
+    nn_glock_unlock ();
+
+    total = 0;
+    for (i = 0; i != WORKERS; ++i)
+        total += pool.loads [i];
+    nn_assert (total == 0);
+
+    nn_pool_term (&pool);
+    nn_alloc_term ();
+
+    return 0;
+}
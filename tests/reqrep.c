@@ -37,6 +37,20 @@ int main ()
     int resend_ivl;
     char buf [7];
     int timeo;
+    int pipeline;
+    int i;
+    nn_req_handle hndl;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    void *ctrls [16];
+    void *bodies [16];
+    int adaptive;
+    int hedge;
+    int rep;
+    int other;
+    struct nn_pollfd pfd [2];
+    int balance;
+    int j;
 
     /*  Test req/rep with full socket types. */
     rep1 = test_socket (AF_SP, NN_REP);
@@ -176,6 +190,236 @@ int main ()
     test_close (req1);
     test_close (rep1);
 
+    /*  Test pipelined requests replied to out of order. */
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_bind (req1, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP_RAW, NN_REP);
+    test_connect (rep1, SOCKET_ADDRESS);
+    pipeline = 16;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_PIPELINE,
+        &pipeline, sizeof (pipeline));
+    errno_assert (rc == 0);
+
+    for (i = 0; i != 16; ++i) {
+        hndl.i = i;
+        buf [0] = 'A' + i;
+        rc = nn_req_send (req1, hndl, buf, 1, 0);
+        errno_assert (rc == 1);
+    }
+
+    /*  The limit of requests in progress was reached. */
+    rc = nn_req_send (req1, hndl, "X", 1, NN_DONTWAIT);
+    nn_assert (rc < 0 && nn_errno () == EAGAIN);
+
+    /*  The mode can't be switched while there are requests in progress. */
+    pipeline = 1;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_PIPELINE,
+        &pipeline, sizeof (pipeline));
+    nn_assert (rc < 0 && nn_errno () == EFSM);
+
+    for (i = 0; i != 16; ++i) {
+        iov.iov_base = &bodies [i];
+        iov.iov_len = NN_MSG;
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = &ctrls [i];
+        hdr.msg_controllen = NN_MSG;
+        rc = nn_recvmsg (rep1, &hdr, 0);
+        errno_assert (rc == 1);
+    }
+    for (i = 15; i >= 0; --i) {
+        iov.iov_base = &bodies [i];
+        iov.iov_len = NN_MSG;
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = &ctrls [i];
+        hdr.msg_controllen = NN_MSG;
+        rc = nn_sendmsg (rep1, &hdr, 0);
+        errno_assert (rc == 1);
+    }
+
+    /*  Replies are delivered in the order they have arrived. */
+    for (i = 15; i >= 0; --i) {
+        rc = nn_req_recv (req1, &hndl, buf, sizeof (buf), 0);
+        errno_assert (rc == 1);
+        nn_assert (hndl.i == i);
+        nn_assert (buf [0] == 'A' + i);
+    }
+    rc = nn_recv (req1, buf, sizeof (buf), NN_DONTWAIT);
+    nn_assert (rc < 0 && nn_errno () == EFSM);
+
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_PIPELINE,
+        &pipeline, sizeof (pipeline));
+    errno_assert (rc == 0);
+
+    test_close (req1);
+    test_close (rep1);
+
+    /*  Test re-sending of pipelined requests. */
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_bind (req1, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_connect (rep1, SOCKET_ADDRESS);
+    pipeline = 2;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_PIPELINE,
+        &pipeline, sizeof (pipeline));
+    errno_assert (rc == 0);
+    resend_ivl = 100;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_RESEND_IVL,
+        &resend_ivl, sizeof (resend_ivl));
+    errno_assert (rc == 0);
+
+    test_send (req1, "ABC");
+    test_send (req1, "DEF");
+    test_recv (rep1, "ABC");
+    test_recv (rep1, "DEF");
+    test_recv (rep1, "ABC");
+    test_recv (rep1, "DEF");
+    test_send (rep1, "GHI");
+    test_recv (req1, "GHI");
+
+    test_close (req1);
+    test_close (rep1);
+
+    /*  Test re-sending with the interval derived from the reply latency. */
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_bind (req1, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_connect (rep1, SOCKET_ADDRESS);
+    adaptive = 1;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_RESEND_ADAPTIVE,
+        &adaptive, sizeof (adaptive));
+    errno_assert (rc == 0);
+    timeo = 1000;
+    rc = nn_setsockopt (rep1, NN_SOL_SOCKET, NN_RCVTIMEO,
+       &timeo, sizeof (timeo));
+    errno_assert (rc == 0);
+
+    for (i = 0; i != 10; ++i) {
+        test_send (req1, "ABC");
+        test_recv (rep1, "ABC");
+        test_send (rep1, "DEF");
+        test_recv (req1, "DEF");
+    }
+
+    /*  The peer used to reply quickly, so the request is re-sent long before
+        the default re-send interval elapses. */
+    test_send (req1, "ABC");
+    test_recv (rep1, "ABC");
+    test_recv (rep1, "ABC");
+
+    test_close (req1);
+    test_close (rep1);
+
+    /*  Test hedged requests. */
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_bind (req1, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_connect (rep1, SOCKET_ADDRESS);
+    rep2 = test_socket (AF_SP, NN_REP);
+    test_connect (rep2, SOCKET_ADDRESS);
+    pipeline = 2;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_PIPELINE,
+        &pipeline, sizeof (pipeline));
+    errno_assert (rc == 0);
+    hedge = 95;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_HEDGE, &hedge, sizeof (hedge));
+    errno_assert (rc == 0);
+    timeo = 1000;
+    rc = nn_setsockopt (rep1, NN_SOL_SOCKET, NN_RCVTIMEO,
+       &timeo, sizeof (timeo));
+    errno_assert (rc == 0);
+    rc = nn_setsockopt (rep2, NN_SOL_SOCKET, NN_RCVTIMEO,
+       &timeo, sizeof (timeo));
+    errno_assert (rc == 0);
+
+    /*  Let the socket learn the reply latency of both peers. */
+    pfd [0].fd = rep1;
+    pfd [0].events = NN_POLLIN;
+    pfd [1].fd = rep2;
+    pfd [1].events = NN_POLLIN;
+    for (i = 0; i != 50; ++i) {
+        test_send (req1, "ABC");
+        rc = nn_poll (pfd, 2, 1000);
+        errno_assert (rc > 0);
+        rep = pfd [0].revents & NN_POLLIN ? rep1 : rep2;
+        test_recv (rep, "ABC");
+        test_send (rep, "DEF");
+        test_recv (req1, "DEF");
+    }
+
+    /*  If a peer doesn't reply in time, the request is duplicated to the
+        other one. */
+    test_send (req1, "ABC");
+    rc = nn_poll (pfd, 2, 1000);
+    errno_assert (rc > 0);
+    rep = pfd [0].revents & NN_POLLIN ? rep1 : rep2;
+    other = rep == rep1 ? rep2 : rep1;
+    test_recv (rep, "ABC");
+    test_recv (other, "ABC");
+    test_send (other, "GHI");
+    test_recv (req1, "GHI");
+
+    test_close (req1);
+    test_close (rep2);
+    test_close (rep1);
+
+    /*  Test that requests are not sent to a peer that hasn't replied yet
+        when load-based balancing is used. */
+    for (j = 0; j != 2; ++j) {
+        req1 = test_socket (AF_SP, NN_REQ);
+        test_bind (req1, SOCKET_ADDRESS);
+        rep1 = test_socket (AF_SP, NN_REP);
+        test_connect (rep1, SOCKET_ADDRESS);
+        rep2 = test_socket (AF_SP, NN_REP);
+        test_connect (rep2, SOCKET_ADDRESS);
+        pipeline = 2;
+        rc = nn_setsockopt (req1, NN_REQ, NN_REQ_PIPELINE,
+            &pipeline, sizeof (pipeline));
+        errno_assert (rc == 0);
+        balance = j == 0 ? NN_BALANCE_LEAST : NN_BALANCE_P2C;
+        rc = nn_setsockopt (req1, NN_REQ, NN_REQ_BALANCE,
+            &balance, sizeof (balance));
+        errno_assert (rc == 0);
+        timeo = 1000;
+        rc = nn_setsockopt (rep1, NN_SOL_SOCKET, NN_RCVTIMEO,
+           &timeo, sizeof (timeo));
+        errno_assert (rc == 0);
+        rc = nn_setsockopt (rep2, NN_SOL_SOCKET, NN_RCVTIMEO,
+           &timeo, sizeof (timeo));
+        errno_assert (rc == 0);
+
+        /*  Wait till both peers are connected. */
+        nn_sleep (10);
+
+        test_send (req1, "ABC");
+        pfd [0].fd = rep1;
+        pfd [0].events = NN_POLLIN;
+        pfd [1].fd = rep2;
+        pfd [1].events = NN_POLLIN;
+        rc = nn_poll (pfd, 2, 1000);
+        errno_assert (rc > 0);
+        rep = pfd [0].revents & NN_POLLIN ? rep1 : rep2;
+        other = rep == rep1 ? rep2 : rep1;
+        test_recv (rep, "ABC");
+
+        for (i = 0; i != 10; ++i) {
+            test_send (req1, "DEF");
+            test_recv (other, "DEF");
+            test_send (other, "GHI");
+            test_recv (req1, "GHI");
+        }
+
+        balance = -1;
+        rc = nn_setsockopt (req1, NN_REQ, NN_REQ_BALANCE,
+            &balance, sizeof (balance));
+        nn_assert (rc < 0 && nn_errno () == EINVAL);
+
+        test_close (req1);
+        test_close (rep2);
+        test_close (rep1);
+    }
+
     return 0;
 }
 
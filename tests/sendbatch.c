@@ -0,0 +1,142 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/utils/attr.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/alloc.c"
+#include "../src/utils/mutex.c"
+#include "../src/utils/atomic.c"
+#include "../src/utils/wire.c"
+#include "../src/utils/chunkpool.c"
+#include "../src/utils/chunk.c"
+#include "../src/utils/chunkref.c"
+#include "../src/utils/msg.c"
+#include "../src/transports/utils/sendbatch.c"
+
+/*  This test checks the bounds of the outbound message queue and that the
+    queue's buffer is not moved while the usock references it. */
+
+#define MSGSIZE 100
+#define HDRSIZE 8
+
+/*  The usock is replaced by a stub that remembers what it was asked
+    to write. */
+static int send_calls;
+static int send_iovcnt;
+static const void *send_first;
+
+void nn_usock_send (NN_UNUSED struct nn_usock *self,
+    const struct nn_iovec *iov, int iovcnt)
+{
+    ++send_calls;
+    send_iovcnt = iovcnt;
+    send_first = iov [0].iov_base;
+}
+
+static int push (struct nn_sendbatch *batch, int i)
+{
+    uint8_t hdr [HDRSIZE];
+    struct nn_msg msg;
+
+    memset (hdr, i, sizeof (hdr));
+    nn_msg_init (&msg, MSGSIZE);
+    memset (nn_chunkref_data (&msg.body), i, MSGSIZE);
+    return nn_sendbatch_push (batch, hdr, sizeof (hdr), &msg);
+}
+
+int main ()
+{
+    int i;
+    int rc;
+    int capacity;
+    struct nn_sendbatch_item *items;
+    struct nn_sendbatch batch;
+
+    /*  The queue accepts messages until NN_SNDBUF bytes are queued. */
+    nn_sendbatch_init (&batch);
+    nn_sendbatch_setlimit (&batch, 10 * (HDRSIZE + MSGSIZE) - 1);
+    for (i = 0; i != 9; ++i) {
+        rc = push (&batch, i);
+        nn_assert (rc == 1);
+    }
+    nn_assert (!nn_sendbatch_isfull (&batch));
+    rc = push (&batch, i);
+    nn_assert (rc == 0);
+    nn_assert (nn_sendbatch_isfull (&batch));
+    nn_assert (nn_sendbatch_count (&batch) == 10);
+
+    /*  All of them are written at once. Once written, there's room for
+        more messages. */
+    nn_assert (nn_sendbatch_pending (&batch));
+    nn_sendbatch_send (&batch, NULL);
+    nn_assert (send_calls == 1);
+    nn_assert (send_iovcnt == 10 * 3);
+    nn_assert (!nn_sendbatch_pending (&batch));
+    nn_assert (nn_sendbatch_isfull (&batch));
+    nn_sendbatch_sent (&batch);
+    nn_assert (nn_sendbatch_empty (&batch));
+    nn_assert (!nn_sendbatch_isfull (&batch));
+    nn_sendbatch_term (&batch);
+
+    /*  If the buffer fills up while a write is in progress, it is not
+        resized until the write completes. */
+    nn_sendbatch_init (&batch);
+    nn_sendbatch_setlimit (&batch, 1024 * 1024);
+    capacity = batch.capacity;
+    items = batch.items;
+    push (&batch, 0);
+    nn_sendbatch_send (&batch, NULL);
+    nn_assert (send_calls == 2);
+    nn_assert (send_first == items [0].hdr);
+    for (i = 1; i != capacity - 1; ++i) {
+        rc = push (&batch, i);
+        nn_assert (rc == 1);
+    }
+    rc = push (&batch, i);
+    nn_assert (rc == 0);
+    nn_assert (nn_sendbatch_isfull (&batch));
+    nn_assert (batch.items == items && batch.capacity == capacity);
+    nn_assert (items [0].hdr [0] == 0);
+    nn_assert (*(uint8_t*) nn_chunkref_data (&items [0].msg.body) == 0);
+
+    /*  The write completes and the buffer grows. */
+    nn_sendbatch_sent (&batch);
+    nn_assert (batch.capacity == capacity * 2);
+    nn_assert (nn_sendbatch_count (&batch) == capacity - 1);
+    nn_assert (!nn_sendbatch_isfull (&batch));
+    for (i = 0; i != capacity - 1; ++i)
+        nn_assert (batch.items [i].hdr [0] == i + 1);
+
+    /*  With no write in progress, the buffer grows as soon as it fills. */
+    capacity = batch.capacity;
+    for (i = nn_sendbatch_count (&batch); i != capacity; ++i) {
+        rc = push (&batch, i + 1);
+        nn_assert (rc == 1);
+    }
+    nn_assert (batch.capacity == capacity * 2);
+    nn_assert (nn_sendbatch_count (&batch) == capacity);
+    nn_sendbatch_term (&batch);
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/pipeline.h"
+
+#include "testutil.h"
+
+/*  Test of the socket table: it grows beyond the initial number of slots
+    and descriptors of closed sockets are rejected even once the slot is
+    reused by a new socket. */
+
+/*  PUSH sockets need a single file descriptor each. */
+#define SOCKET_COUNT 600
+
+int main ()
+{
+    int rc;
+    int i;
+    int j;
+    int s;
+    int stale;
+    int socks [SOCKET_COUNT];
+    char buf [3];
+
+    for (i = 0; i != SOCKET_COUNT; ++i) {
+        socks [i] = test_socket (AF_SP, NN_PUSH);
+        for (j = 0; j != i; ++j)
+            nn_assert (socks [j] != socks [i]);
+    }
+
+    /*  Reuse a slot. */
+    stale = socks [300];
+    test_close (stale);
+    rc = nn_close (stale);
+    nn_assert (rc == -1 && nn_errno () == EBADF);
+    socks [300] = test_socket (AF_SP, NN_PUSH);
+    nn_assert (socks [300] != stale);
+
+    /*  The old descriptor doesn't refer to the new socket. */
+    rc = nn_send (stale, "ABC", 3, NN_DONTWAIT);
+    nn_assert (rc == -1 && nn_errno () == EBADF);
+    rc = nn_close (stale);
+    nn_assert (rc == -1 && nn_errno () == EBADF);
+    rc = nn_send (socks [300], "ABC", 3, NN_DONTWAIT);
+    nn_assert (rc == -1 && nn_errno () == EAGAIN);
+
+    /*  Descriptors that never referred to a socket. */
+    rc = nn_close (-1);
+    nn_assert (rc == -1 && nn_errno () == EBADF);
+    rc = nn_close (0x7fffffff);
+    nn_assert (rc == -1 && nn_errno () == EBADF);
+    rc = nn_recv (1 << 19, buf, sizeof (buf), NN_DONTWAIT);
+    nn_assert (rc == -1 && nn_errno () == EBADF);
+
+    for (i = 0; i != SOCKET_COUNT; ++i)
+        test_close (socks [i]);
+
+    /*  Once the library is uninitialised and initialised again, a working
+        socket is returned. */
+    s = test_socket (AF_SP, NN_PAIR);
+    test_close (s);
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/protocols/pubsub/subindex.c"
+#include "../src/utils/alloc.c"
+#include "../src/utils/list.c"
+#include "../src/utils/err.c"
+
+static int matched (struct nn_subindex *index, size_t nmatches,
+    struct nn_subindex_subscriber *sub)
+{
+    size_t i;
+
+    for (i = 0; i != nmatches; ++i)
+        if (index->matches [i] == sub)
+            return 1;
+    return 0;
+}
+
+int main ()
+{
+    int rc;
+    size_t n;
+    struct nn_subindex index;
+    struct nn_subindex_subscriber a;
+    struct nn_subindex_subscriber b;
+    struct nn_subindex_subscriber c;
+
+    /*  Try matching with an empty index. */
+    nn_subindex_init (&index);
+    n = nn_subindex_match (&index, (const uint8_t*) "", 0);
+    nn_assert (n == 0);
+    n = nn_subindex_match (&index, (const uint8_t*) "ABC", 3);
+    nn_assert (n == 0);
+    nn_subindex_term (&index);
+
+    /*  Try matching with "all" subscription. */
+    nn_subindex_init (&index);
+    nn_subindex_subscriber_init (&a);
+    rc = nn_subindex_subscribe (&index, &a, (const uint8_t*) "", 0);
+    nn_assert (rc == 1);
+    n = nn_subindex_match (&index, (const uint8_t*) "", 0);
+    nn_assert (n == 1 && index.matches [0] == &a);
+    n = nn_subindex_match (&index, (const uint8_t*) "ABC", 3);
+    nn_assert (n == 1 && index.matches [0] == &a);
+    nn_subindex_rm (&index, &a);
+    nn_subindex_subscriber_term (&a);
+    nn_subindex_term (&index);
+
+    /*  Only the subscribers subscribed to a prefix of the message match. */
+    nn_subindex_init (&index);
+    nn_subindex_subscriber_init (&a);
+    nn_subindex_subscriber_init (&b);
+    nn_subindex_subscriber_init (&c);
+    rc = nn_subindex_subscribe (&index, &a, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 1);
+    rc = nn_subindex_subscribe (&index, &b, (const uint8_t*) "ABD", 3);
+    nn_assert (rc == 1);
+    rc = nn_subindex_subscribe (&index, &c, (const uint8_t*) "AB", 2);
+    nn_assert (rc == 1);
+    n = nn_subindex_match (&index, (const uint8_t*) "A", 1);
+    nn_assert (n == 0);
+    n = nn_subindex_match (&index, (const uint8_t*) "AB", 2);
+    nn_assert (n == 1 && matched (&index, n, &c));
+    n = nn_subindex_match (&index, (const uint8_t*) "ABCDE", 5);
+    nn_assert (n == 2 && matched (&index, n, &a) && matched (&index, n, &c));
+    n = nn_subindex_match (&index, (const uint8_t*) "ABDDE", 5);
+    nn_assert (n == 2 && matched (&index, n, &b) && matched (&index, n, &c));
+    n = nn_subindex_match (&index, (const uint8_t*) "ABE", 3);
+    nn_assert (n == 1 && matched (&index, n, &c));
+
+    /*  Removing the subscription in the middle of the path compresses it. */
+    rc = nn_subindex_unsubscribe (&index, &c, (const uint8_t*) "AB", 2);
+    nn_assert (rc == 1);
+    n = nn_subindex_match (&index, (const uint8_t*) "ABCDE", 5);
+    nn_assert (n == 1 && matched (&index, n, &a));
+    n = nn_subindex_match (&index, (const uint8_t*) "ABE", 3);
+    nn_assert (n == 0);
+    rc = nn_subindex_unsubscribe (&index, &b, (const uint8_t*) "ABD", 3);
+    nn_assert (rc == 1);
+    nn_assert (index.root->nchildren == 1);
+    nn_assert (index.root->children [0]->prefix_len == 3);
+    n = nn_subindex_match (&index, (const uint8_t*) "ABC", 3);
+    nn_assert (n == 1 && matched (&index, n, &a));
+    nn_subindex_rm (&index, &a);
+    nn_assert (index.root->nchildren == 0);
+    nn_subindex_subscriber_term (&c);
+    nn_subindex_subscriber_term (&b);
+    nn_subindex_subscriber_term (&a);
+    nn_subindex_term (&index);
+
+    /*  A subscriber with several matching subscriptions is reported once. */
+    nn_subindex_init (&index);
+    nn_subindex_subscriber_init (&a);
+    rc = nn_subindex_subscribe (&index, &a, (const uint8_t*) "A", 1);
+    nn_assert (rc == 1);
+    rc = nn_subindex_subscribe (&index, &a, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 1);
+    n = nn_subindex_match (&index, (const uint8_t*) "ABCD", 4);
+    nn_assert (n == 1 && index.matches [0] == &a);
+    nn_subindex_rm (&index, &a);
+    n = nn_subindex_match (&index, (const uint8_t*) "ABCD", 4);
+    nn_assert (n == 0);
+    nn_subindex_subscriber_term (&a);
+    nn_subindex_term (&index);
+
+    /*  Check the reference counting of subscriptions. */
+    nn_subindex_init (&index);
+    nn_subindex_subscriber_init (&a);
+    nn_subindex_subscriber_init (&b);
+    rc = nn_subindex_subscribe (&index, &a, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 1);
+    rc = nn_subindex_subscribe (&index, &a, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 0);
+    rc = nn_subindex_unsubscribe (&index, &b, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == -EINVAL);
+    rc = nn_subindex_unsubscribe (&index, &a, (const uint8_t*) "AB", 2);
+    nn_assert (rc == -EINVAL);
+    rc = nn_subindex_unsubscribe (&index, &a, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 0);
+    n = nn_subindex_match (&index, (const uint8_t*) "ABC", 3);
+    nn_assert (n == 1);
+    rc = nn_subindex_unsubscribe (&index, &a, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 1);
+    n = nn_subindex_match (&index, (const uint8_t*) "ABC", 3);
+    nn_assert (n == 0);
+    rc = nn_subindex_unsubscribe (&index, &a, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == -EINVAL);
+    nn_subindex_subscriber_term (&b);
+    nn_subindex_subscriber_term (&a);
+    nn_subindex_term (&index);
+
+    return 0;
+}
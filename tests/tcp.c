@@ -27,6 +27,8 @@
 
 #include "testutil.h"
 
+#include <string.h>
+
 /*  Tests TCP transport. */
 
 #define SOCKET_ADDRESS "tcp://127.0.0.1:5555"
@@ -41,6 +43,9 @@ int main ()
     int opt;
     size_t sz;
     int s1, s2;
+    int j;
+    char buf [8192];
+    void *msgs [16];
 
     /*  Try closing bound but unconnected socket. */
     sb = test_socket (AF_SP, NN_PAIR);
@@ -150,6 +155,228 @@ int main ()
     test_close (sc);
     test_close (sb);
 
+    /*  Test batching of outbound messages. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = -1;
+    rc = nn_setsockopt (sc, NN_SOL_SOCKET, NN_SNDBATCH, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 1024;
+    rc = nn_setsockopt (sc, NN_SOL_SOCKET, NN_SNDBATCH, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sc, NN_SOL_SOCKET, NN_SNDBATCH, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 1024);
+    test_connect (sc, SOCKET_ADDRESS);
+    for (i = 0; i != 1000; ++i) {
+        test_send (sc, "0123456789012345678901234567890123456789");
+    }
+    for (i = 0; i != 1000; ++i) {
+        test_recv (sb, "0123456789012345678901234567890123456789");
+    }
+    for (i = 0; i != 100; ++i) {
+        test_send (sc, "ABC");
+        test_recv (sb, "ABC");
+    }
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test queueing of outbound messages bigger than the send buffer. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 1024;
+    rc = nn_setsockopt (sc, NN_SOL_SOCKET, NN_SNDBUF, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    test_connect (sc, SOCKET_ADDRESS);
+    for (i = 0; i != 64; ++i) {
+        memset (buf, 'a' + i % 26, sizeof (buf));
+        rc = nn_send (sc, buf, i % 2 ? sizeof (buf) : 10, 0);
+        errno_assert (rc >= 0);
+    }
+    for (i = 0; i != 64; ++i) {
+        rc = nn_recv (sb, buf, sizeof (buf), 0);
+        errno_assert (rc >= 0);
+        nn_assert (rc == (i % 2 ? (int) sizeof (buf) : 10));
+        while (rc--)
+            nn_assert (buf [rc] == 'a' + i % 26);
+    }
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test that the outbound queue is bounded. Once the peer stops
+        receiving and the kernel buffers fill up, the queue grows to
+        NN_SNDBUF bytes and further sends fail with EAGAIN or time out.
+        All the messages accepted so far must still be delivered. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = 1024;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_RCVBUF, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 16384;
+    rc = nn_setsockopt (sc, NN_SOL_SOCKET, NN_SNDBUF, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    opt = 100;
+    rc = nn_setsockopt (sc, NN_SOL_SOCKET, NN_SNDTIMEO, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    test_connect (sc, SOCKET_ADDRESS);
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+    for (i = 0; i != 1000000; ++i) {
+        memset (buf, 'a' + i % 26, 1000);
+        rc = nn_send (sc, buf, 1000, NN_DONTWAIT);
+        if (rc < 0) {
+            errno_assert (nn_errno () == EAGAIN);
+            break;
+        }
+        nn_assert (rc == 1000);
+    }
+    nn_assert (i != 1000000);
+    for (j = 0; j != 1000; ++j) {
+        memset (buf, 'a' + i % 26, 1000);
+        rc = nn_send (sc, buf, 1000, 0);
+        if (rc < 0) {
+            errno_assert (nn_errno () == EAGAIN);
+            break;
+        }
+        nn_assert (rc == 1000);
+        ++i;
+    }
+    nn_assert (j != 1000);
+    for (j = 0; j != i; ++j) {
+        rc = nn_recv (sb, buf, sizeof (buf), 0);
+        errno_assert (rc == 1000);
+        while (rc--)
+            nn_assert (buf [rc] == 'a' + j % 26);
+    }
+    test_send (sc, "DEF");
+    test_recv (sb, "DEF");
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test reading ahead of the user with a receive buffer smaller than
+        the messages. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = 1024;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_RCVBUF, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+    for (i = 0; i != 64; ++i) {
+        memset (buf, 'a' + i % 26, sizeof (buf));
+        rc = nn_send (sc, buf, i % 2 ? 1000 : 10, 0);
+        errno_assert (rc >= 0);
+    }
+    nn_sleep (100);
+    for (i = 0; i != 64; ++i) {
+        rc = nn_recv (sb, buf, sizeof (buf), 0);
+        errno_assert (rc >= 0);
+        nn_assert (rc == (i % 2 ? 1000 : 10));
+        while (rc--)
+            nn_assert (buf [rc] == 'a' + i % 26);
+    }
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test that the messages read ahead of the user are still received
+        after the peer closes the connection. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = 1000;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+    for (i = 0; i != 100; ++i) {
+        memset (buf, 'a' + i % 26, 1000);
+        rc = nn_send (sc, buf, 1000, 0);
+        errno_assert (rc == 1000);
+    }
+    test_close (sc);
+    nn_sleep (100);
+    for (i = 0; i != 100; ++i) {
+        rc = nn_recv (sb, buf, sizeof (buf), 0);
+        errno_assert (rc == 1000);
+        while (rc--)
+            nn_assert (buf [rc] == 'a' + i % 26);
+    }
+    test_close (sb);
+
+    /*  Test receiving many messages of various sizes using a single read. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = 0;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_RCVBATCH, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 16384;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_RCVBATCH, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sb, NN_SOL_SOCKET, NN_RCVBATCH, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 16384);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+    for (i = 0; i != 256; i += 16) {
+        for (j = i; j != i + 16; ++j) {
+            memset (buf, 'A' + j % 26, sizeof (buf));
+            rc = nn_send (sc, buf, (j * 397) % sizeof (buf), 0);
+            errno_assert (rc >= 0);
+            nn_assert (rc == (int) ((j * 397) % sizeof (buf)));
+        }
+        for (j = i; j != i + 16; ++j) {
+            rc = nn_recv (sb, buf, sizeof (buf), 0);
+            errno_assert (rc >= 0);
+            nn_assert (rc == (int) ((j * 397) % sizeof (buf)));
+            while (rc--)
+                nn_assert (buf [rc] == 'A' + j % 26);
+        }
+    }
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test zero-copy receiving. Messages stay valid even after the socket
+        they were received from is closed. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = 2;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_RCVZEROCOPY, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 1;
+    rc = nn_setsockopt (sb, NN_SOL_SOCKET, NN_RCVZEROCOPY, &opt, sizeof (opt));
+    errno_assert (rc == 0);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+    for (i = 0; i != 16; ++i) {
+        memset (buf, 'a' + i, sizeof (buf));
+        rc = nn_send (sc, buf, 100 * (i + 1), 0);
+        errno_assert (rc >= 0);
+    }
+    for (i = 0; i != 16; ++i) {
+        rc = nn_recv (sb, &msgs [i], NN_MSG, 0);
+        errno_assert (rc >= 0);
+        nn_assert (rc == 100 * (i + 1));
+    }
+    test_close (sc);
+    test_close (sb);
+    for (i = 0; i != 16; ++i) {
+        for (j = 0; j != 100 * (i + 1); ++j)
+            nn_assert (((char*) msgs [i]) [j] == 'a' + i);
+        if (i % 2) {
+            msgs [i] = nn_reallocmsg (msgs [i], 10000);
+            nn_assert (msgs [i]);
+            nn_assert (((char*) msgs [i]) [0] == 'a' + i);
+        }
+        rc = nn_freemsg (msgs [i]);
+        errno_assert (rc == 0);
+    }
+
     /*  Test whether connection rejection is handled decently. */
     sb = test_socket (AF_SP, NN_PAIR);
     test_bind (sb, SOCKET_ADDRESS);
@@ -36,6 +36,8 @@
 #define THREAD_COUNT 100
 #define TEST2_THREAD_COUNT 10
 #define MESSAGES_PER_THREAD 10
+#define TEST3_THREAD_COUNT 10
+#define TEST3_MESSAGE_SIZE (256 * 1024)
 #define TEST_LOOPS 10
 #define SOCKET_ADDRESS "tcp://127.0.0.1:5557"
 
@@ -72,12 +74,33 @@ static void routine2 (NN_UNUSED void *arg)
     nn_atomic_dec(&active, 1);
 }
 
+static void routine3 (NN_UNUSED void *arg)
+{
+    int rc;
+    int s;
+    int i;
+    void *buf;
+
+    s = test_socket (AF_SP, NN_PULL);
+    for (i = 0; i < 10; ++i)
+        test_connect (s, SOCKET_ADDRESS);
+
+    /*  Close the connections while the peer is in the middle of sending. */
+    rc = nn_recv (s, &buf, NN_MSG, 0);
+    errno_assert (rc == TEST3_MESSAGE_SIZE);
+    nn_freemsg (buf);
+
+    test_close (s);
+    nn_atomic_dec(&active, 1);
+}
+
 int main ()
 {
     int sb;
     int i;
     int j;
     struct nn_thread threads [THREAD_COUNT];
+    static char buf [TEST3_MESSAGE_SIZE];
 
     /*  Stress the shutdown algorithm. */
 
@@ -118,5 +141,27 @@ int main ()
 
     test_close (sb);
 
+    /*  Test the peer closing the connection while sends are still queued
+        for the worker thread. */
+
+    sb = test_socket (AF_SP, NN_PUSH);
+    test_bind (sb, SOCKET_ADDRESS);
+
+    for (j = 0; j != TEST_LOOPS; ++j) {
+        nn_atomic_init(&active, TEST3_THREAD_COUNT);
+        for (i = 0; i != TEST3_THREAD_COUNT; ++i)
+            nn_thread_init (&threads [i], routine3, NULL);
+
+        while (active.n) {
+            (void) nn_send (sb, buf, sizeof (buf), NN_DONTWAIT);
+        }
+
+        for (i = 0; i != TEST3_THREAD_COUNT; ++i)
+            nn_thread_term (&threads [i]);
+        nn_atomic_term(&active);
+    }
+
+    test_close (sb);
+
     return 0;
 }
@@ -31,6 +31,7 @@ int main ()
     int rc;
     int s;
     int timeo;
+    int busy_poll;
     char buf [3];
     struct nn_stopwatch stopwatch;
     uint64_t elapsed;
@@ -55,6 +56,22 @@ int main ()
     errno_assert (rc < 0 && nn_errno () == EAGAIN);
     time_assert (elapsed, 100000);
 
+    /*  Busy-polling must not extend the timeouts. */
+    busy_poll = 10000000;
+    rc = nn_setsockopt (s, NN_SOL_SOCKET, NN_BUSY_POLL, &busy_poll,
+        sizeof (busy_poll));
+    errno_assert (rc == 0);
+    nn_stopwatch_init (&stopwatch);
+    rc = nn_recv (s, buf, sizeof (buf), 0);
+    elapsed = nn_stopwatch_term (&stopwatch);
+    errno_assert (rc < 0 && nn_errno () == EAGAIN);
+    time_assert (elapsed, 100000);
+    nn_stopwatch_init (&stopwatch);
+    rc = nn_send (s, "ABC", 3, 0);
+    elapsed = nn_stopwatch_term (&stopwatch);
+    errno_assert (rc < 0 && nn_errno () == EAGAIN);
+    time_assert (elapsed, 100000);
+
     test_close (s);
 
     return 0;
@@ -25,10 +25,13 @@
 #include "../src/utils/err.c"
 
 #include <stdio.h>
+#include <string.h>
 
 int main ()
 {
     int rc;
+    int i;
+    uint8_t buf [300];
     struct nn_trie trie;
 
     /*  Try matching with an empty trie. */
@@ -205,6 +208,94 @@ int main ()
     nn_assert (rc == 1);
     nn_trie_term (&trie);
 
+    /*  Check growing the node through all the node types and shrinking it
+        back. */
+    nn_trie_init (&trie);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "X", 1);
+    nn_assert (rc == 1);
+    for (i = 0; i != 256; ++i) {
+        buf [0] = 'X';
+        buf [1] = (uint8_t) i;
+        buf [2] = 'Y';
+        rc = nn_trie_subscribe (&trie, buf, 3);
+        nn_assert (rc == 1);
+        nn_assert (trie.root->type == (i < 4 ? NN_TRIE_NODE4 :
+            i < 16 ? NN_TRIE_NODE16 : i < 48 ? NN_TRIE_NODE48 :
+            NN_TRIE_NODE256));
+    }
+    rc = nn_trie_unsubscribe (&trie, (const uint8_t*) "X", 1);
+    nn_assert (rc == 1);
+    for (i = 0; i != 256; ++i) {
+        buf [0] = 'X';
+        buf [1] = (uint8_t) i;
+        buf [2] = 'Y';
+        buf [3] = 'Z';
+        rc = nn_trie_match (&trie, buf, 4);
+        nn_assert (rc == 1);
+        buf [2] = 'Z';
+        rc = nn_trie_match (&trie, buf, 3);
+        nn_assert (rc == 0);
+    }
+    for (i = 0; i != 255; ++i) {
+        buf [0] = 'X';
+        buf [1] = (uint8_t) i;
+        buf [2] = 'Y';
+        rc = nn_trie_unsubscribe (&trie, buf, 3);
+        nn_assert (rc == 1);
+        rc = nn_trie_match (&trie, buf, 3);
+        nn_assert (rc == 0);
+        buf [1] = (uint8_t) (i + 1);
+        rc = nn_trie_match (&trie, buf, 3);
+        nn_assert (rc == 1);
+    }
+
+    /*  Only "X\xffY" is left and the trie is compacted into a single
+        node. */
+    nn_assert (trie.root->type == NN_TRIE_NODE0);
+    nn_assert (trie.root->prefix_len == 3);
+    nn_trie_term (&trie);
+
+    /*  Check subscriptions longer than the former prefix limit. */
+    nn_trie_init (&trie);
+    memset (buf, 'A', sizeof (buf));
+    rc = nn_trie_subscribe (&trie, buf, sizeof (buf));
+    nn_assert (rc == 1);
+    nn_assert (trie.root->type == NN_TRIE_NODE0);
+    buf [100] = 'B';
+    rc = nn_trie_subscribe (&trie, buf, 200);
+    nn_assert (rc == 1);
+    nn_assert (trie.root->prefix_len == 100);
+    rc = nn_trie_match (&trie, buf, 200);
+    nn_assert (rc == 1);
+    rc = nn_trie_match (&trie, buf, 199);
+    nn_assert (rc == 0);
+    buf [100] = 'A';
+    rc = nn_trie_match (&trie, buf, sizeof (buf) - 1);
+    nn_assert (rc == 0);
+    rc = nn_trie_match (&trie, buf, sizeof (buf));
+    nn_assert (rc == 1);
+    nn_trie_term (&trie);
+
+    /*  Unsubscribing from a string that is not subscribed fails. */
+    nn_trie_init (&trie);
+    rc = nn_trie_unsubscribe (&trie, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == -EINVAL);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 1);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 0);
+    rc = nn_trie_unsubscribe (&trie, (const uint8_t*) "AB", 2);
+    nn_assert (rc == -EINVAL);
+    rc = nn_trie_unsubscribe (&trie, (const uint8_t*) "ABD", 3);
+    nn_assert (rc == -EINVAL);
+    rc = nn_trie_unsubscribe (&trie, (const uint8_t*) "ABCD", 4);
+    nn_assert (rc == -EINVAL);
+    rc = nn_trie_unsubscribe (&trie, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 0);
+    rc = nn_trie_unsubscribe (&trie, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 1);
+    nn_assert (trie.root == NULL);
+    nn_trie_term (&trie);
+
     return 0;
 }
-
@@ -0,0 +1,201 @@
+/*
+    Copyright (c) 2026 The nanomsg authors  All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/transports/ws/ws_simd.c"
+#include "../src/utils/err.c"
+
+#include <stdlib.h>
+
+/*  Checks the vectorised WebSocket kernels against straightforward
+    byte-by-byte implementations. */
+
+#define BUFSIZE 512
+
+/*  Returns the length of the longest valid UTF-8 prefix of the buffer
+    that ends at a code point boundary. */
+static size_t utf8_valid_len (const uint8_t *buf, size_t len)
+{
+    size_t pos;
+    size_t n;
+    size_t i;
+    uint8_t lo;
+    uint8_t hi;
+
+    pos = 0;
+    while (pos < len) {
+        lo = 0x80;
+        hi = 0xbf;
+        if (buf [pos] < 0x80)
+            n = 1;
+        else if (buf [pos] >= 0xc2 && buf [pos] <= 0xdf)
+            n = 2;
+        else if (buf [pos] >= 0xe0 && buf [pos] <= 0xef) {
+            n = 3;
+            if (buf [pos] == 0xe0)
+                lo = 0xa0;
+            if (buf [pos] == 0xed)
+                hi = 0x9f;
+        }
+        else if (buf [pos] >= 0xf0 && buf [pos] <= 0xf4) {
+            n = 4;
+            if (buf [pos] == 0xf0)
+                lo = 0x90;
+            if (buf [pos] == 0xf4)
+                hi = 0x8f;
+        }
+        else
+            return pos;
+        if (pos + n > len)
+            return pos;
+        for (i = 1; i != n; ++i) {
+            if (i == 1 && (buf [pos + 1] < lo || buf [pos + 1] > hi))
+                return pos;
+            if ((buf [pos + i] & 0xc0) != 0x80)
+                return pos;
+        }
+        pos += n;
+    }
+    return pos;
+}
+
+/*  Fills the buffer with random mix of valid code points of all lengths. */
+static void fill_utf8 (uint8_t *buf, size_t len)
+{
+    static const char *samples [] = {"a", "Z", "\xc2\xa9", "\xdf\xbf",
+        "\xe0\xa0\x80", "\xe2\x82\xac", "\xed\x9f\xbf", "\xef\xbf\xbf",
+        "\xf0\x90\x80\x80", "\xf3\xa0\x80\x81", "\xf4\x8f\xbf\xbf"};
+    size_t pos;
+    size_t n;
+    const char *s;
+
+    pos = 0;
+    while (pos < len) {
+        s = samples [rand () % (sizeof (samples) / sizeof (samples [0]))];
+        n = strlen (s);
+        if (pos + n > len)
+            s = "x", n = 1;
+        memcpy (buf + pos, s, n);
+        pos += n;
+    }
+}
+
+static void check_prefix (const uint8_t *buf, size_t len)
+{
+    size_t valid;
+    size_t prefix;
+
+    valid = utf8_valid_len (buf, len);
+    prefix = nn_ws_utf8_prefix (buf, len);
+    nn_assert (prefix <= valid);
+    nn_assert (utf8_valid_len (buf, prefix) == prefix);
+
+    /*  The validator must make progress on valid input. */
+    if (valid == len)
+        nn_assert (len < 64 || prefix > len - 64);
+}
+
+static void test_utf8 ()
+{
+    uint8_t buf [BUFSIZE];
+    size_t len;
+    int i;
+    int j;
+    int n;
+
+    for (i = 0; i != 2000; ++i) {
+        len = rand () % BUFSIZE;
+        if (i % 4 == 0)
+            memset (buf, 'a', len);
+        else
+            fill_utf8 (buf, len);
+        check_prefix (buf, len);
+
+        /*  Corrupt a few bytes, including ones that are likely to create
+            overlong encodings, surrogates and truncated sequences. */
+        if (len == 0)
+            continue;
+        n = 1 + rand () % 3;
+        for (j = 0; j != n; ++j) {
+            switch (rand () % 4) {
+            case 0:
+                buf [rand () % len] = (uint8_t) rand ();
+                break;
+            case 1:
+                buf [rand () % len] = 0x80 | (rand () & 0x3f);
+                break;
+            case 2:
+                buf [rand () % len] = 0xc0 | (rand () & 0x3f);
+                break;
+            default:
+                buf [rand () % len] = 'b';
+            }
+        }
+        check_prefix (buf, len);
+    }
+}
+
+static void test_mask ()
+{
+    uint8_t buf [BUFSIZE];
+    uint8_t ref [BUFSIZE];
+    uint8_t mask [NN_WS_SIMD_MASK_LEN];
+    size_t off;
+    size_t len;
+    size_t pos;
+    size_t i;
+    int k;
+
+    for (k = 0; k != 2000; ++k) {
+        off = rand () % 8;
+        len = rand () % (BUFSIZE - off);
+        pos = rand () % NN_WS_SIMD_MASK_LEN;
+        for (i = 0; i != NN_WS_SIMD_MASK_LEN; ++i)
+            mask [i] = (uint8_t) rand ();
+        for (i = 0; i != len; ++i)
+            buf [off + i] = ref [i] = (uint8_t) rand ();
+        for (i = 0; i != len; ++i)
+            ref [i] ^= mask [(pos + i) % NN_WS_SIMD_MASK_LEN];
+        nn_assert (nn_ws_mask (buf + off, len, mask, pos) ==
+            (pos + len) % NN_WS_SIMD_MASK_LEN);
+        nn_assert (memcmp (buf + off, ref, len) == 0);
+    }
+}
+
+int main ()
+{
+    int level;
+
+    for (level = NN_WS_SIMD_NONE; level <= NN_WS_SIMD_AVX2; ++level) {
+        if (nn_ws_simd_setlevel (level) != 0)
+            continue;
+        test_mask ();
+        test_utf8 ();
+    }
+
+    /*  Automatic selection always succeeds. */
+    nn_ws_simd_init ();
+    test_mask ();
+    test_utf8 ();
+
+    return 0;
+}
+
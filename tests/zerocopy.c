@@ -22,6 +22,7 @@
 */
 
 #include "../src/nn.h"
+#include "../src/pair.h"
 #include "../src/pubsub.h"
 #include "../src/reqrep.h"
 
@@ -192,11 +193,70 @@ void test_reallocmsg_pubsub ()
     nn_close (pub);
 }
 
+void test_sendmsg_parts (char *addr)
+{
+    int rc;
+    int i;
+    int sb;
+    int sc;
+    void *p [3];
+    struct nn_iovec iov [3];
+    struct nn_msghdr hdr;
+    char buf [32];
+
+    /*  Create sockets. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    sc = test_socket (AF_SP, NN_PAIR);
+
+    /*  Make send fail and check whether none of the zero-copy buffers is
+        deallocated. */
+    for (i = 0; i != 3; ++i) {
+        p [i] = nn_allocmsg (4 + i, 0);
+        nn_assert (p [i]);
+        memset (p [i], 'A' + i, 4 + i);
+        iov [i].iov_base = &p [i];
+        iov [i].iov_len = NN_MSG;
+    }
+    memset (&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = iov;
+    hdr.msg_iovlen = 3;
+    rc = nn_sendmsg (sc, &hdr, NN_DONTWAIT);
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EAGAIN);
+
+    /*  Mixing zero-copy buffers with ordinary ones is not allowed. */
+    iov [1].iov_base = buf;
+    iov [1].iov_len = 5;
+    rc = nn_sendmsg (sc, &hdr, 0);
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EINVAL);
+    iov [1].iov_base = &p [1];
+    iov [1].iov_len = NN_MSG;
+
+    /*  Send the message composed of multiple buffers. */
+    test_bind (sb, addr);
+    test_connect (sc, addr);
+    rc = nn_sendmsg (sc, &hdr, 0);
+    errno_assert (rc >= 0);
+    nn_assert (rc == 15);
+    rc = nn_recv (sb, buf, sizeof (buf), 0);
+    errno_assert (rc >= 0);
+    nn_assert (rc == 15);
+    nn_assert (memcmp (buf, "AAAABBBBBCCCCCC", 15) == 0);
+
+    /*  Clean up. */
+    test_close (sc);
+    test_close (sb);
+}
+
 int main ()
 {
     test_allocmsg_reqrep ();
     test_reallocmsg_reqrep ();
     test_reallocmsg_pubsub ();
+    test_sendmsg_parts ("inproc://parts");
+    test_sendmsg_parts ("tcp://127.0.0.1:5555");
+    test_sendmsg_parts ("ipc://parts.ipc");
     return 0;
 }
 